@@ -4,6 +4,8 @@
 # compile-speed regressions — the 2026-06 rounds (GC off in stradac,
 # hash-set builtin lookup, lexer fast paths, module caching) made this a
 # tracked performance surface that the test suite can't see.
+# Each run also records stradac -t phase times (lex/parse/semantic/codegen),
+# reported best-of per phase, so a regression can be pinned to a phase.
 #
 # Usage: ./bench_compiler.sh [runs]   (default 5, best-of)
 set -e
@@ -16,13 +18,20 @@ if [ ! -x "$STRADAC" ]; then echo "build ./stradac first (make)"; exit 2; fi
 if [ ! -f "$CORPUS" ]; then echo "corpus missing: $CORPUS (run make once)"; exit 2; fi
 
 OUT=$(mktemp --suffix=.c)
-trap 'rm -f "$OUT"' EXIT
+
+PHASES=$(mktemp)
+trap 'rm -f "$OUT" "$PHASES"' EXIT
 
 best=""
 for ((r=1; r<=RUNS; r++)); do
-    t=$( { TIMEFORMAT='%R'; time env STRADA_GC=off "$STRADAC" "$CORPUS" "$OUT" > /dev/null 2>&1; } 2>&1 )
+    t=$( { TIMEFORMAT='%R'; time env STRADA_GC=off "$STRADAC" -t "$CORPUS" "$OUT" > "$PHASES.run" 2>&1; } 2>&1 )
     echo "  run $r: ${t}s"
     if [ -z "$best" ] || (( $(echo "$t < $best" | bc -l) )); then best=$t; fi
+    # "  Lexer:    0.28 seconds" -> "Lexer 0.28"
+    awk '/^  [A-Za-z]+: +[0-9.]+ seconds/ { sub(":", "", $1); print $1, $2 }' "$PHASES.run" >> "$PHASES"
 done
+rm -f "$PHASES.run"
 lines=$(wc -l < "$CORPUS")
 echo "compiler: best ${best}s for $lines lines ($(echo "scale=0; $lines / $best" | bc -l) lines/sec)"
+awk '{ if (!($1 in b) || $2 < b[$1]) b[$1] = $2; if (!($1 in seen)) { seen[$1] = 1; order[n++] = $1 } }
+     END { for (i = 0; i < n; i++) printf "  %-9s best %.3fs\n", order[i] ":", b[order[i]] }' "$PHASES"
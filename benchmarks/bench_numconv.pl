@@ -0,0 +1,33 @@
+#!/usr/bin/env perl
+# Perl counterpart of bench_numconv.strada (identical workload).
+use strict; use warnings; use Time::HiRes qw(time);
+use JSON::PP;
+
+my $t0 = time;
+my $slen = 0;
+for my $i (0..999999) { my $v = $i / 7.0 + 0.25; my $s = "" . $v; $slen += length $s }
+my $t1 = time;
+printf "stringify: %d %.6f\n", $slen, $t1 - $t0;
+
+my @fields;
+for my $i (0..999) {
+    push @fields, "" . ($i * 13) . "." . ($i % 100);
+    push @fields, ($i % 10) . "." . $i . "e" . ($i % 30);
+}
+my $sum = 0.0;
+my $n = @fields;
+$sum = $sum + $fields[$_ % $n] for 0..999999;
+my $t2 = time;
+printf "numify: %.6e %.6f\n", $sum, $t2 - $t1;
+
+my @nums = map { $_ * 1.5 + 0.125 } 0..199999;
+my $doc = encode_json(\@nums);
+my $back = decode_json($doc);
+my $t3 = time;
+printf "json: %d %d %.6f\n", length $doc, scalar @$back, $t3 - $t2;
+
+my $flen = 0;
+for my $i (0..499999) { my $v = $i / 3.0; $flen += length sprintf("%g %.3e %.10g", $v, $v, $v) }
+my $t4 = time;
+printf "sprintf: %d %.6f\n", $flen, $t4 - $t3;
+printf "total: %.6f\n", $t4 - $t0;
@@ -14,7 +14,7 @@ NODE=${NODE:-node}
 PHP=${PHP:-php}
 GO=${GO:-go}
 
-ALL_BENCHMARKS="bench_compute bench_strings bench_array_hash bench_functions bench_oop bench_hotpaths bench_sort bench_regex bench_pipeline bench_exceptions bench_async bench_gc bench_json bench_data bench_startup bench_utf8 bench_binary bench_closures bench_sprintf bench_binary_trees bench_oop_so"
+ALL_BENCHMARKS="bench_compute bench_strings bench_array_hash bench_functions bench_oop bench_hotpaths bench_sort bench_regex bench_pipeline bench_exceptions bench_async bench_gc bench_json bench_data bench_startup bench_utf8 bench_binary bench_closures bench_sprintf bench_numconv bench_hash_probe bench_collections bench_fusion bench_par bench_hash_churn bench_sketch bench_array_bulk bench_binary_trees bench_oop_so"
 
 usage() {
     echo "Usage: $0 [OPTIONS] [BENCHMARK ...]"
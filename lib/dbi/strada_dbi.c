@@ -404,6 +404,26 @@ DbiStatement* dbi_prepare(DbiHandle *dbh, const char *sql) {
     return sth;
 }
 
+#ifdef HAVE_SQLITE3
+/* Bind one parameter. Values come from strada_array_get, which reads
+ * packed arrays and honours the head offset; small ints arrive tagged. */
+static void dbi_sqlite_bind(sqlite3_stmt *stmt, int idx, StradaValue *val) {
+    if (STRADA_IS_TAGGED_INT(val)) {
+        sqlite3_bind_int64(stmt, idx, STRADA_TAGGED_INT_VAL(val));
+    } else if (!val || val->type == STRADA_UNDEF) {
+        sqlite3_bind_null(stmt, idx);
+    } else if (val->type == STRADA_INT) {
+        sqlite3_bind_int64(stmt, idx, val->value.iv);
+    } else if (val->type == STRADA_NUM) {
+        sqlite3_bind_double(stmt, idx, val->value.nv);
+    } else {
+        char *str = strada_to_str(val);   /* malloc'd; SQLITE_TRANSIENT copies it */
+        sqlite3_bind_text(stmt, idx, str, -1, SQLITE_TRANSIENT);
+        free(str);
+    }
+}
+#endif
+
 int dbi_execute(DbiStatement *sth, StradaValue *params) {
     if (!sth || !sth->dbh) return -1;
 
@@ -422,18 +442,7 @@ int dbi_execute(DbiStatement *sth, StradaValue *params) {
             if (params && params->type == STRADA_ARRAY) {
                 StradaArray *arr = params->value.av;
                 for (size_t i = 0; i < arr->size && i < (size_t)sth->num_params; i++) {
-                    StradaValue *val = arr->elements[i];
-                    if (!val || val->type == STRADA_UNDEF) {
-                        sqlite3_bind_null(stmt, i + 1);
-                    } else if (val->type == STRADA_INT) {
-                        sqlite3_bind_int64(stmt, i + 1, val->value.iv);
-                    } else if (val->type == STRADA_NUM) {
-                        sqlite3_bind_double(stmt, i + 1, val->value.nv);
-                    } else {
-                        char *str = strada_to_str(val);   /* malloc'd; SQLITE_TRANSIENT copies it */
-                        sqlite3_bind_text(stmt, i + 1, str, -1, SQLITE_TRANSIENT);
-                        free(str);
-                    }
+                    dbi_sqlite_bind(stmt, (int)i + 1, strada_array_get(arr, (int64_t)i));
                 }
             }
 
@@ -449,18 +458,7 @@ int dbi_execute(DbiStatement *sth, StradaValue *params) {
                 if (params && params->type == STRADA_ARRAY) {
                     StradaArray *arr = params->value.av;
                     for (size_t i = 0; i < arr->size && i < (size_t)sth->num_params; i++) {
-                        StradaValue *val = arr->elements[i];
-                        if (!val || val->type == STRADA_UNDEF) {
-                            sqlite3_bind_null(stmt, i + 1);
-                        } else if (val->type == STRADA_INT) {
-                            sqlite3_bind_int64(stmt, i + 1, val->value.iv);
-                        } else if (val->type == STRADA_NUM) {
-                            sqlite3_bind_double(stmt, i + 1, val->value.nv);
-                        } else {
-                            char *str = strada_to_str(val);   /* malloc'd; SQLITE_TRANSIENT copies it */
-                            sqlite3_bind_text(stmt, i + 1, str, -1, SQLITE_TRANSIENT);
-                            free(str);
-                        }
+                        dbi_sqlite_bind(stmt, (int)i + 1, strada_array_get(arr, (int64_t)i));
                     }
                 }
                 return 0;  /* 0 affected rows for SELECT, but success */
@@ -478,21 +476,31 @@ int dbi_execute(DbiStatement *sth, StradaValue *params) {
             /* Bind parameters */
             MYSQL_BIND *binds = NULL;
             char **bound_strs = NULL;   /* malloc'd param strings; freed after execute */
+            /* Numbers are copied out: a tagged int or a packed slot has no
+             * StradaValue field to point the bind at. */
+            union { int64_t iv; double nv; } *bound_nums = NULL;
             if (sth->num_params > 0 && params && params->type == STRADA_ARRAY) {
                 binds = calloc(sth->num_params, sizeof(MYSQL_BIND));
                 bound_strs = calloc(sth->num_params, sizeof(char*));
+                bound_nums = calloc(sth->num_params, sizeof(*bound_nums));
                 StradaArray *arr = params->value.av;
 
                 for (int i = 0; i < sth->num_params && i < (int)arr->size; i++) {
-                    StradaValue *val = arr->elements[i];
-                    if (!val || val->type == STRADA_UNDEF) {
+                    StradaValue *val = strada_array_get(arr, i);
+                    if (STRADA_IS_TAGGED_INT(val)) {
+                        bound_nums[i].iv = STRADA_TAGGED_INT_VAL(val);
+                        binds[i].buffer_type = MYSQL_TYPE_LONGLONG;
+                        binds[i].buffer = &bound_nums[i].iv;
+                    } else if (!val || val->type == STRADA_UNDEF) {
                         binds[i].buffer_type = MYSQL_TYPE_NULL;
                     } else if (val->type == STRADA_INT) {
+                        bound_nums[i].iv = val->value.iv;
                         binds[i].buffer_type = MYSQL_TYPE_LONGLONG;
-                        binds[i].buffer = &val->value.iv;
+                        binds[i].buffer = &bound_nums[i].iv;
                     } else if (val->type == STRADA_NUM) {
+                        bound_nums[i].nv = val->value.nv;
                         binds[i].buffer_type = MYSQL_TYPE_DOUBLE;
-                        binds[i].buffer = &val->value.nv;
+                        binds[i].buffer = &bound_nums[i].nv;
                     } else {
                         char *str = strada_to_str(val);   /* malloc'd; freed after execute */
                         bound_strs[i] = str;
@@ -505,6 +513,7 @@ int dbi_execute(DbiStatement *sth, StradaValue *params) {
                 if (mysql_stmt_bind_param(stmt, binds) != 0) {
                     set_error(dbh, mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
                     if (bound_strs) { for (int _b = 0; _b < sth->num_params; _b++) free(bound_strs[_b]); free(bound_strs); }
+                    free(bound_nums);
                     free(binds);
                     return -1;
                 }
@@ -513,12 +522,14 @@ int dbi_execute(DbiStatement *sth, StradaValue *params) {
             if (mysql_stmt_execute(stmt) != 0) {
                 set_error(dbh, mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
                 if (bound_strs) { for (int _b = 0; _b < sth->num_params; _b++) free(bound_strs[_b]); free(bound_strs); }
+                free(bound_nums);
                 free(binds);
                 return -1;
             }
 
             sth->affected_rows = mysql_stmt_affected_rows(stmt);
             if (bound_strs) { for (int _b = 0; _b < sth->num_params; _b++) free(bound_strs[_b]); free(bound_strs); }
+            free(bound_nums);
             free(binds);
             return sth->affected_rows;
         }
@@ -554,8 +565,8 @@ int dbi_execute(DbiStatement *sth, StradaValue *params) {
                 StradaArray *arr = params->value.av;
 
                 for (int i = 0; i < sth->num_params && i < (int)arr->size; i++) {
-                    StradaValue *val = arr->elements[i];
-                    if (val && val->type != STRADA_UNDEF) {
+                    StradaValue *val = strada_array_get(arr, i);
+                    if (STRADA_IS_TAGGED_INT(val) || (val && val->type != STRADA_UNDEF)) {
                         /* strada_to_str already returns a malloc'd string; the
                          * extra strdup leaked it. Use it directly (freed by the
                          * cleanup loops below). */
@@ -760,7 +771,7 @@ StradaValue* dbi_fetchrow_hashref(DbiStatement *sth) {
                             val = strada_new_str((const char*)sqlite3_column_text(stmt, i));
                             break;
                     }
-                    strada_hash_set(hash->value.hv, name, val);
+                    strada_hash_set_interned(hash->value.hv, name, strlen(name), val);
                 }
                 return hash;
             } else {
@@ -793,7 +804,7 @@ StradaValue* dbi_fetchrow_hashref(DbiStatement *sth) {
                 } else {
                     val = strada_new_str(PQgetvalue(res, pg_row_hash, i));
                 }
-                strada_hash_set(hash->value.hv, name, val);
+                strada_hash_set_interned(hash->value.hv, name, strlen(name), val);
             }
 
             pg_row_hash++;
@@ -1627,7 +1638,7 @@ double strada_dbi_column_num(DbiStatement *sth, int idx) {
             PGresult *res = (PGresult*)sth->result;
             int row = sth->affected_rows;
             if (PQgetisnull(res, row, idx)) return 0.0;
-            return strtod(PQgetvalue(res, row, idx), NULL);
+            return strada_str_to_double(PQgetvalue(res, row, idx), (size_t)PQgetlength(res, row, idx));
         }
 #endif
         default:
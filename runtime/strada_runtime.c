@@ -52,6 +52,7 @@
 #include <stdint.h>
 #include <time.h>
 #include <math.h>
+#include <float.h>
 #ifdef HAVE_LIBFFI
 #include <ffi.h>
 #endif
@@ -75,6 +76,7 @@
 #include <sys/times.h>
 #include <sys/mman.h>
 #include <sys/file.h>
+#include <sys/uio.h>   /* writev() for large print/say/write_fd payloads */
 #include <sys/statvfs.h>
 #include <termios.h>
 #include <poll.h>
@@ -84,6 +86,10 @@
 #ifdef __linux__
 #include <malloc.h>  /* malloc_usable_size() for string buffer growth optimization */
 #endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define STRADA_SIMD_X86 1
+#include <immintrin.h>  /* SSE2 baseline + AVX2 string kernels (runtime-dispatched) */
+#endif
 
 /* ===== MEMORY CONFIGURATION ===== */
 
@@ -108,7 +114,7 @@ static void *sr_xmalloc(size_t n) {
 static size_t strada_default_array_capacity = 16;
 
 /* Default initial bucket count for new hashes (can be changed at runtime) */
-static size_t strada_default_hash_capacity = 32;
+static size_t strada_default_hash_capacity = 8;
 
 /* ===== HASH TABLE OPTIMIZATIONS ===== */
 
@@ -144,7 +150,49 @@ static void ss_pool_cleanup(void) {
     ss_pool_count = 0;
 }
 
+/* ===== Weak StradaString intern table =====
+ * strada_ss_intern hands out one shared StradaString per distinct short
+ * string, so repeated runtime keys (JSON object keys, DBI column names,
+ * CSV headers, core::intern) cost one allocation, and hash entries built
+ * from them compare by pointer. The table holds no reference: when the
+ * last user releases a string, ss_decref_slow drops it from the table
+ * (ss_intern_forget), so table size tracks live strings only. Open
+ * addressing keyed by the string's hash (the hash-table hash, so entries
+ * can be used as keys directly), linear probing, backward-shift deletion.
+ * Under threads a mutex guards the table, and a lookup only revives an
+ * entry whose refcount is still nonzero; a string already on its way to
+ * ss_decref_slow is left to die and a fresh copy is interned instead. */
+#define SS_INTERN_MAX_LEN 64
+static StradaString **ss_intern_slots = NULL;
+static size_t ss_intern_cap = 0;       /* power of 2 */
+static size_t ss_intern_count = 0;
+static pthread_mutex_t ss_intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void ss_intern_forget(StradaString *ss) {
+    int locked = strada_threading_active;
+    if (locked) pthread_mutex_lock(&ss_intern_mutex);
+    size_t mask = ss_intern_cap - 1;
+    size_t i = ss->hash & mask;
+    while (ss_intern_slots[i] && ss_intern_slots[i] != ss) i = (i + 1) & mask;
+    if (ss_intern_slots[i] == ss) {
+        size_t j = i;
+        for (size_t k = (j + 1) & mask; ss_intern_slots[k]; k = (k + 1) & mask) {
+            size_t home = ss_intern_slots[k]->hash & mask;
+            /* Move k back into the hole unless its home lies in (j, k] */
+            int stays = (j <= k) ? (home > j && home <= k) : (home > j || home <= k);
+            if (!stays) {
+                ss_intern_slots[j] = ss_intern_slots[k];
+                j = k;
+            }
+        }
+        ss_intern_slots[j] = NULL;
+        ss_intern_count--;
+    }
+    if (locked) pthread_mutex_unlock(&ss_intern_mutex);
+}
+
 void ss_decref_slow(StradaString *ss) {
+    if (ss_intern_count && ss->hash) ss_intern_forget(ss);
     /* Return short strings to pool instead of freeing (single-threaded only —
      * the pool has no lock). */
     if (!strada_threading_active && ss->len <= SS_POOL_DATA_MAX && ss_pool_count < SS_POOL_MAX) {
@@ -204,7 +252,7 @@ void ss_decref(StradaString *ss) {
     }
 }
 
-StradaString *ss_new(const char *s, uint32_t len, uint32_t hash) {
+StradaString *ss_new(const char *s, size_t len, uint32_t hash) {
     StradaString *ss;
     if (!strada_threading_active && len <= SS_POOL_DATA_MAX && ss_pool_count > 0) {
         ss = ss_pool_stack[--ss_pool_count];
@@ -219,8 +267,58 @@ StradaString *ss_new(const char *s, uint32_t len, uint32_t hash) {
     return ss;
 }
 
+/* Shared StradaString for s[0..len), as a new reference. Strings longer
+ * than SS_INTERN_MAX_LEN or containing NUL (which the hash-table hash
+ * stops at) are not interned: they get a private copy. */
+StradaString *strada_ss_intern(const char *s, size_t len) {
+    unsigned int hash = 5381;
+    for (size_t i = 0; i < len; i++) {
+        int c = s[i];   /* same (signed) char promotion as strada_hash_string */
+        if (!c) return ss_new(s, len, 0);
+        hash = ((hash << 5) + hash) + c;
+    }
+    if (len > SS_INTERN_MAX_LEN || hash == 0) return ss_new(s, len, hash);
+
+    int locked = strada_threading_active;
+    if (locked) pthread_mutex_lock(&ss_intern_mutex);
+    if ((ss_intern_count + 1) * 2 > ss_intern_cap) {
+        size_t old_cap = ss_intern_cap;
+        StradaString **old = ss_intern_slots;
+        ss_intern_cap = old_cap ? old_cap * 2 : 256;
+        ss_intern_slots = calloc(ss_intern_cap, sizeof(StradaString*));
+        for (size_t i = 0; i < old_cap; i++) {
+            if (!old[i]) continue;
+            size_t j = old[i]->hash & (ss_intern_cap - 1);
+            while (ss_intern_slots[j]) j = (j + 1) & (ss_intern_cap - 1);
+            ss_intern_slots[j] = old[i];
+        }
+        free(old);
+    }
+    size_t mask = ss_intern_cap - 1;
+    size_t i = hash & mask;
+    for (StradaString *e; (e = ss_intern_slots[i]); i = (i + 1) & mask) {
+        if (e->hash != hash || e->len != len || memcmp(e->data, s, len) != 0) continue;
+        if (!locked) {
+            e->refcount++;
+            return e;
+        }
+        uint32_t rc = e->refcount;
+        while (rc && !__sync_bool_compare_and_swap(&e->refcount, rc, rc + 1)) rc = e->refcount;
+        if (rc) {
+            pthread_mutex_unlock(&ss_intern_mutex);
+            return e;
+        }
+        /* Dying entry: skip it; its owner removes it under the lock */
+    }
+    StradaString *ss = ss_new(s, len, hash);
+    ss_intern_slots[i] = ss;
+    ss_intern_count++;
+    if (locked) pthread_mutex_unlock(&ss_intern_mutex);
+    return ss;
+}
+
 /* Allocate an uninitialized StradaString buffer — caller fills in data[] */
-static inline StradaString *ss_new_uninit(uint32_t len) {
+static inline StradaString *ss_new_uninit(size_t len) {
     StradaString *ss;
     if (!strada_threading_active && len <= SS_POOL_DATA_MAX && ss_pool_count > 0) {
         ss = ss_pool_stack[--ss_pool_count];
@@ -236,6 +334,44 @@ static inline StradaString *ss_new_uninit(uint32_t len) {
 /* Packed hash table helpers */
 #define HASH_SMALL_BUCKETS 8   /* For objects with <=3 attributes (50% load factor) */
 #define HASH_COMPACT_ENTRIES 4 /* pre-allocated entry slots for small hashes */
+/* Bucket-group block of the compact layout (see hv_index_bytes) */
+#define HASH_COMPACT_INDEX_BYTES (STRADA_HV_GROUP + HASH_SMALL_BUCKETS * sizeof(uint32_t))
+
+/* Size of the group block for nb buckets. A table under one group has a
+ * single group with full control bytes but only nb slots. */
+static inline size_t hv_index_bytes(size_t nb) {
+    if (nb < STRADA_HV_GROUP) return STRADA_HV_GROUP + nb * sizeof(uint32_t);
+    return (nb / STRADA_HV_GROUP) * STRADA_HV_GROUP_BYTES;
+}
+/* Mark every bucket EMPTY */
+static inline void hv_ctrl_reset(StradaHash *hv) {
+    size_t ngroups = (hv->num_buckets + STRADA_HV_GROUP - 1) / STRADA_HV_GROUP;
+    for (size_t g = 0; g < ngroups; g++)
+        memset(hv->ctrl + g * STRADA_HV_GROUP_BYTES, STRADA_HV_EMPTY, STRADA_HV_GROUP);
+}
+/* Point ctrl at a block of hv_index_bytes(nb) bytes, all EMPTY */
+static inline void hv_index_attach(StradaHash *hv, void *block, size_t nb) {
+    hv->ctrl = (uint8_t *)block;
+    hv->num_buckets = nb;
+    hv_ctrl_reset(hv);
+}
+/* Control byte and entries[] slot of bucket b */
+static inline uint8_t *hv_ctrl_at(StradaHash *hv, size_t b) {
+    return strada_hv_grp(hv, b) + (b & (STRADA_HV_GROUP - 1));
+}
+static inline uint32_t *hv_slot_at(StradaHash *hv, size_t b) {
+    return strada_hv_slots(strada_hv_grp(hv, b)) + (b & (STRADA_HV_GROUP - 1));
+}
+/* Live-bucket bits of a group: tables under one group ignore the tail */
+static inline uint32_t hv_group_valid(const StradaHash *hv) {
+    return hv->num_buckets < STRADA_HV_GROUP ? (1u << hv->num_buckets) - 1 : 0xFFFFu;
+}
+/* Smallest bucket count that holds n entries within the 7/8 max load */
+static inline size_t hv_buckets_for(size_t n) {
+    size_t nb = 4;
+    while (nb * 7 < n * 8) nb *= 2;
+    return nb;
+}
 
 /* Positional in-block proofs for compact single-block hashes. A separate
  * malloc can never coincide with these interior addresses (heap chunk
@@ -243,11 +379,11 @@ static inline StradaString *ss_new_uninit(uint32_t len) {
  * "still lives in the compact block" test even after the other member
  * has been reallocated out. */
 static inline int hv_idx_in_block(StradaHash *hv) {
-    return hv->hash_index == (uint32_t*)((char*)hv + sizeof(StradaHash));
+    return hv->ctrl == (uint8_t*)((char*)hv + sizeof(StradaHash));
 }
 static inline int hv_ent_in_block(StradaHash *hv) {
     return hv->entries == (StradaHashEntry*)((char*)hv + sizeof(StradaHash)
-                                             + HASH_SMALL_BUCKETS * sizeof(uint32_t));
+                                             + HASH_COMPACT_INDEX_BYTES);
 }
 
 static inline uint32_t hash_get_slot(StradaHash *hv) {
@@ -276,33 +412,59 @@ static inline uint32_t hash_get_slot(StradaHash *hv) {
     return (uint32_t)hv->next_slot++;
 }
 
+/* Free bucket to take from a group's free mask f. In the key's first
+ * group its home bucket (hash & mask) wins when free, which is what lets
+ * strada_hv_fetch_int_ph try that one byte before the group compare. */
+static inline size_t hv_pick_free(size_t pos, uint32_t f, unsigned int hash, size_t mask) {
+    size_t home = (size_t)hash & mask;
+    if (pos == (home & ~(size_t)(STRADA_HV_GROUP - 1)) &&
+        (f >> (home & (STRADA_HV_GROUP - 1)) & 1))
+        return home;
+    return pos + (size_t)__builtin_ctz(f);
+}
+
+/* Bucket an insert of a key with this hash would use: the first EMPTY or
+ * DELETED byte along its probe sequence. The caller has already ruled the
+ * key out (or is rebuilding). Returns (size_t)-1 only for a table with no
+ * free bucket at all, which the load limit never allows. */
+static size_t hv_free_bucket(StradaHash *hv, unsigned int hash) {
+    size_t mask = hv->num_buckets - 1;
+    size_t pos = strada_hv_group0(hv, hash);
+    uint32_t valid = hv_group_valid(hv);
+    for (size_t step = STRADA_HV_GROUP; ; step += STRADA_HV_GROUP) {
+        uint32_t f = strada_hv_match_free(strada_hv_grp(hv, pos)) & valid;
+        if (f) return hv_pick_free(pos, f, hash, mask);
+        if (step > mask) return (size_t)-1;
+        pos = (pos + step) & mask;
+    }
+}
+
 static void hash_rebuild_index(StradaHash *hv) {
-    memset(hv->hash_index, 0xFF, hv->num_buckets * sizeof(uint32_t));
+    hv_ctrl_reset(hv);
     hv->num_tombstones = 0;
     for (size_t i = 0; i < hv->next_slot; i++) {
-        if (hv->entries[i].key) {
-            uint32_t pos = hv->entries[i].key->hash & (hv->num_buckets - 1);
-            while (hv->hash_index[pos] != HASH_EMPTY) {
-                pos = (pos + 1) & (hv->num_buckets - 1);
-            }
-            hv->hash_index[pos] = (uint32_t)i;
+        StradaString *k = hv->entries[i].key;
+        if (k) {
+            size_t pos = hv_free_bucket(hv, k->hash);
+            *hv_ctrl_at(hv, pos) = strada_hv_tag(k->hash);
+            *hv_slot_at(hv, pos) = (uint32_t)i;
         }
     }
     /* Index now mirrors entries[] exactly. */
     hv->index_dirty = 0;
 }
 
-/* Linear-scan fallback for hash_index corruption (same mode self-healed
- * by strada_hash_get): if hash_index says HASH_EMPTY at the probe pos but
- * the entries array actually contains the key, scan entries[] directly,
- * rebuild the index, and return the entry slot. Returns -1 if not found.
+/* Linear-scan fallback for bucket-index corruption (same mode self-healed
+ * by strada_hash_get): if the probe misses but the entries array actually
+ * contains the key, scan entries[] directly, rebuild the index, and return
+ * the entry slot. Returns -1 if not found.
  * Used by exists/delete/set's update-path to keep them consistent with
  * get when the open-addressed index is out of sync with the entries. */
 static int32_t hash_linear_find(StradaHash *hv, const char *key, uint32_t key_len, unsigned int hash) {
     if (!hv || hv->next_slot == 0) return -1;
     /* Clean hashes never need a full scan — the probe sequence is canonical.
      * The scan is purely a recovery mechanism for cross-boundary dispatch
-     * corruption (hash_index gets desynced from entries[]); skipping it
+     * corruption (the index gets desynced from entries[]); skipping it
      * here is what keeps hash_set on large hashes from going quadratic. */
     if (!hv->index_dirty) return -1;
     for (size_t i = 0; i < hv->next_slot; i++) {
@@ -319,6 +481,173 @@ static int32_t hash_linear_find(StradaHash *hv, const char *key, uint32_t key_le
     return -1;
 }
 
+/* Bucket holding key, or -1. Each group is one 16-byte compare against
+ * the key's 7-bit tag; only tag matches touch entries[] and the key
+ * bytes. With ins non-NULL a miss also reports the bucket an insert
+ * should use (first EMPTY/DELETED seen, or (size_t)-1 if none). */
+static inline int64_t hv_probe(StradaHash *hv, const char *key, uint32_t key_len,
+                               unsigned int hash, size_t *ins) {
+    uint8_t tag = strada_hv_tag(hash);
+    size_t mask = hv->num_buckets - 1;
+    size_t pos = strada_hv_group0(hv, hash);
+    size_t free_pos = (size_t)-1;
+    for (size_t step = STRADA_HV_GROUP; ; step += STRADA_HV_GROUP) {
+        uint8_t *g = strada_hv_grp(hv, pos);
+        uint32_t m = strada_hv_match(g, tag);
+        while (m) {
+            unsigned i = (unsigned)__builtin_ctz(m);
+            StradaString *k = hv->entries[strada_hv_slots(g)[i]].key;
+            if (k->hash == hash && k->len == key_len &&
+                (k->data == key || memcmp(k->data, key, key_len) == 0))
+                return (int64_t)(pos + i);
+            m &= m - 1;
+        }
+        uint32_t f = strada_hv_match_free(g) & hv_group_valid(hv);
+        if (ins && free_pos == (size_t)-1 && f)
+            free_pos = hv_pick_free(pos, f, hash, mask);
+        if (strada_hv_match(g, STRADA_HV_EMPTY) || step > mask) break;
+        pos = (pos + step) & mask;
+    }
+    if (ins) *ins = free_pos;
+    return -1;
+}
+
+/* Entry for key, or NULL. A miss on a dirty index falls back to the
+ * self-healing linear scan. */
+static inline StradaHashEntry *hv_find(StradaHash *hv, const char *key,
+                                       uint32_t key_len, unsigned int hash) {
+    int64_t b = hv_probe(hv, key, key_len, hash, NULL);
+    if (__builtin_expect(b >= 0, 1)) return &hv->entries[*hv_slot_at(hv, (size_t)b)];
+    int32_t slot = hash_linear_find(hv, key, key_len, hash);
+    return slot >= 0 ? &hv->entries[slot] : NULL;
+}
+
+/* Entry for key, or NULL with *ins set for hv_insert_at */
+static inline StradaHashEntry *hv_find_for_insert(StradaHash *hv, const char *key,
+                                                  uint32_t key_len, unsigned int hash,
+                                                  size_t *ins) {
+    *ins = (size_t)-1;
+    int64_t b = hv_probe(hv, key, key_len, hash, ins);
+    if (__builtin_expect(b >= 0, 1)) return &hv->entries[*hv_slot_at(hv, (size_t)b)];
+    int32_t slot = hash_linear_find(hv, key, key_len, hash);
+    return slot >= 0 ? &hv->entries[slot] : NULL;
+}
+
+/* Bucket holding key (after self-heal), or -1: for deletes */
+static inline int64_t hv_find_bucket(StradaHash *hv, const char *key,
+                                     uint32_t key_len, unsigned int hash) {
+    int64_t b = hv_probe(hv, key, key_len, hash, NULL);
+    if (b < 0 && hash_linear_find(hv, key, key_len, hash) >= 0)
+        b = hv_probe(hv, key, key_len, hash, NULL);
+    return b;
+}
+
+static void strada_hash_resize(StradaHash *hv);
+
+/* Add a new entry (key known absent) at bucket ins from hv_find_for_insert.
+ * Takes the key and value references. Returns the entry, which stays put
+ * across the resize this may trigger (only the index is reallocated). */
+static StradaHashEntry *hv_insert_at(StradaHash *hv, size_t ins,
+                                     StradaString *key, StradaValue *sv) {
+    if (__builtin_expect(ins == (size_t)-1, 0)) {
+        strada_hash_resize(hv);
+        ins = hv_free_bucket(hv, key->hash);
+    }
+    uint32_t slot = hash_get_slot(hv);
+    StradaHashEntry *e = &hv->entries[slot];
+    e->key = key;
+    e->value = sv;
+    uint8_t *c = hv_ctrl_at(hv, ins);
+    if (*c == STRADA_HV_DELETED) hv->num_tombstones--;
+    *c = strada_hv_tag(key->hash);
+    *hv_slot_at(hv, ins) = slot;
+    hv->num_entries++;
+    if ((hv->num_entries + hv->num_tombstones) * 8 > hv->num_buckets * 7) {
+        strada_hash_resize(hv);
+    }
+    return e;
+}
+
+/* Process-wide counts reported by core::mem_stats */
+static size_t hv_stat_compactions = 0;
+static size_t hv_stat_shrinks = 0;
+static size_t hv_stat_bytes_released = 0;
+
+/* Smallest entries[] that hv_compact leaves behind */
+#define HASH_COMPACT_MIN_SLOTS 16
+
+/* Called by hv_remove_bucket once at most a quarter of entries[] is live:
+ * slide the live entries down in insertion order, drop the free list and
+ * rebuild the index without tombstones. entries[] and the index then
+ * shrink to about twice the live count, so a churned cache ends up sized
+ * for what it holds. Another compaction needs 3/4 of the survivors gone,
+ * which keeps deletes amortized O(1). An each() in progress keeps its
+ * place: iter_index becomes the count of live entries before it. Storage
+ * inside a compact block stays where it is. */
+static void hv_compact(StradaHash *hv) {
+    size_t n = 0;
+    size_t iter = hv->iter_index;
+    for (size_t i = 0; i < hv->next_slot; i++) {
+        if (i == hv->iter_index) iter = n;
+        if (hv->entries[i].key) {
+            if (n != i) hv->entries[n] = hv->entries[i];
+            n++;
+        }
+    }
+    if (hv->iter_index >= hv->next_slot) iter = n;
+    hv->iter_index = iter;
+    hv->next_slot = n;
+    hv->free_head = HASH_EMPTY;
+    __atomic_fetch_add(&hv_stat_compactions, 1, __ATOMIC_RELAXED);
+
+    size_t released = 0;
+    size_t cap = 8;
+    while (cap < n * 2) cap *= 2;
+    if (cap < hv->capacity && !hv_ent_in_block(hv)) {
+        hv->entries = sr_xrealloc(hv->entries, cap * sizeof(StradaHashEntry));
+        released += (hv->capacity - cap) * sizeof(StradaHashEntry);
+        hv->capacity = cap;
+    }
+    size_t nb = hv_buckets_for(n * 2);
+    if (nb < HASH_SMALL_BUCKETS) nb = HASH_SMALL_BUCKETS;
+    if (nb < hv->num_buckets && !hv_idx_in_block(hv)) {
+        released += hv_index_bytes(hv->num_buckets) - hv_index_bytes(nb);
+        free(hv->ctrl);
+        hv_index_attach(hv, sr_xmalloc(hv_index_bytes(nb)), nb);
+    }
+    if (released) {
+        __atomic_fetch_add(&hv_stat_shrinks, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&hv_stat_bytes_released, released, __ATOMIC_RELAXED);
+    }
+    hash_rebuild_index(hv);
+}
+
+/* Unlink the entry in bucket b: drops the key, returns the value (the
+ * caller's reference now). A bucket whose group still has an EMPTY byte
+ * goes straight back to EMPTY — no probe ever ran past that group — so
+ * only groups that were once full collect DELETED markers. Mostly-empty
+ * hashes are compacted (hv_compact), which moves entries: callers must
+ * not hold entry pointers across a delete. */
+static StradaValue *hv_remove_bucket(StradaHash *hv, size_t b) {
+    uint32_t idx = *hv_slot_at(hv, b);
+    StradaHashEntry *e = &hv->entries[idx];
+    StradaValue *val = e->value;
+    uint8_t *g = strada_hv_grp(hv, b);
+    if (strada_hv_match(g, STRADA_HV_EMPTY)) {
+        g[b & (STRADA_HV_GROUP - 1)] = STRADA_HV_EMPTY;
+    } else {
+        g[b & (STRADA_HV_GROUP - 1)] = STRADA_HV_DELETED;
+        hv->num_tombstones++;
+    }
+    ss_decref(e->key);
+    e->key = NULL; e->value = NULL;
+    e->next = hv->free_head; hv->free_head = idx;
+    hv->num_entries--;
+    if (hv->next_slot >= HASH_COMPACT_MIN_SLOTS && hv->num_entries * 4 <= hv->next_slot)
+        hv_compact(hv);
+    return val;
+}
+
 void strada_hash_mark_index_dirty(StradaHash *hv) {
     if (hv) hv->index_dirty = 1;
 }
@@ -367,6 +696,381 @@ extern int strada_threading_active;
 /* Forward declaration — used by strada_to_str for tagged ints */
 static inline int strada_fast_itoa(int64_t val, char *buf);
 
+/* ===== Number <-> string conversion =====
+ * Stringifying a double (Perl's %.15g) and numifying a string used to go
+ * through snprintf and strtod on every call. Both are exact, but glibc
+ * formats through a multi-precision path and strtod is locale-aware, so
+ * CSV/JSON ingest spent most of its number handling there.
+ *
+ * strada_d2s_shortest is Ryu (Adams, PLDI 2018): the shortest digit
+ * string that reads back as the same double, from 128-bit multiplies by
+ * a table of powers of 5. When that string has at most P <= 15
+ * significant digits it is exactly what %.Pg prints: P-digit decimals
+ * are spaced wider than one ulp, so the nearest of them to the value is
+ * the shortest form padded with zeros. Values whose shortest form is
+ * longer (0.1 + 0.2), and subnormals, still go to snprintf.
+ *
+ * strada_parse_decimal is Clinger's fast path plus Eisel-Lemire (Lemire,
+ * "Number Parsing at a Gigabyte per Second"): the correctly rounded
+ * double from a 19-digit mantissa and a 128-bit power of ten. Longer
+ * mantissas, subnormals and the rare ambiguous rounding go to strtod.
+ * The tables are generated by tools/gen_numtables.pl. */
+#include "strada_num_tables.h"
+
+#ifdef __SIZEOF_INT128__
+#define STRADA_FAST_NUMCONV 1
+typedef unsigned __int128 strada_u128;
+
+static inline uint32_t ryu_pow5bits(int32_t e) { return (uint32_t)(((e * 1217359) >> 19) + 1); }
+static inline uint32_t ryu_log10_pow2(int32_t e) { return (uint32_t)((e * 78913) >> 18); }
+static inline uint32_t ryu_log10_pow5(int32_t e) { return (uint32_t)((e * 732923) >> 20); }
+
+static inline uint32_t ryu_pow5_factor(uint64_t v) {
+    uint32_t n = 0;
+    while (v % 5 == 0) { v /= 5; n++; }
+    return n;
+}
+
+static inline uint64_t ryu_mul_shift(uint64_t m, const uint64_t *mul, int32_t j) {
+    strada_u128 b0 = (strada_u128)m * mul[0];
+    strada_u128 b2 = (strada_u128)m * mul[1];
+    return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+
+static inline int strada_u64_ndigits(uint64_t v) {
+    int n = 1;
+    while (v >= 10) { v /= 10; n++; }
+    return n;
+}
+
+/* Shortest m * 10^e that reads back as |v| (finite, nonzero). Returns
+ * the number of digits in m. */
+static int strada_d2s_shortest(double v, uint64_t *out_m, int *out_e) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint64_t ieee_m = bits & ((1ULL << 52) - 1);
+    uint32_t ieee_e = (uint32_t)((bits >> 52) & 0x7FF);
+    int32_t e2;
+    uint64_t m2;
+    if (ieee_e == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieee_m;
+    } else {
+        e2 = (int32_t)ieee_e - 1023 - 52 - 2;
+        m2 = (1ULL << 52) | ieee_m;
+    }
+    int accept_bounds = (m2 & 1) == 0;
+
+    /* The interval of decimals that round to v is (mm, mp) around mv,
+     * all scaled by 4 so the half-ulp bounds are integers. */
+    uint64_t mv = 4 * m2;
+    uint32_t mm_shift = ieee_m != 0 || ieee_e <= 1;
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    int vm_tz = 0, vr_tz = 0;
+    if (e2 >= 0) {
+        uint32_t q = ryu_log10_pow2(e2) - (e2 > 3);
+        e10 = (int32_t)q;
+        int32_t k = 125 + (int32_t)ryu_pow5bits((int32_t)q) - 1;
+        int32_t i = -e2 + (int32_t)q + k;
+        const uint64_t *mul = strada_ryu_pow5_inv_split[q];
+        vr = ryu_mul_shift(mv, mul, i);
+        vp = ryu_mul_shift(mv + 2, mul, i);
+        vm = ryu_mul_shift(mv - 1 - mm_shift, mul, i);
+        if (q <= 21) {
+            /* only one of mp, mv and mm can be a multiple of 5 */
+            if (mv % 5 == 0) vr_tz = ryu_pow5_factor(mv) >= q;
+            else if (accept_bounds) vm_tz = ryu_pow5_factor(mv - 1 - mm_shift) >= q;
+            else vp -= ryu_pow5_factor(mv + 2) >= q;
+        }
+    } else {
+        uint32_t q = ryu_log10_pow5(-e2) - (-e2 > 1);
+        e10 = (int32_t)q + e2;
+        int32_t i = -e2 - (int32_t)q;
+        int32_t k = (int32_t)ryu_pow5bits(i) - 125;
+        int32_t j = (int32_t)q - k;
+        const uint64_t *mul = strada_ryu_pow5_split[i];
+        vr = ryu_mul_shift(mv, mul, j);
+        vp = ryu_mul_shift(mv + 2, mul, j);
+        vm = ryu_mul_shift(mv - 1 - mm_shift, mul, j);
+        if (q <= 1) {
+            /* mv = 4 * m2 always has two trailing zero bits */
+            vr_tz = 1;
+            if (accept_bounds) vm_tz = mm_shift == 1;
+            else vp--;
+        } else if (q < 63) {
+            vr_tz = (mv & ((1ULL << q) - 1)) == 0;
+        }
+    }
+
+    /* Drop digits while the interval still holds a shorter decimal. */
+    int32_t removed = 0;
+    uint64_t output;
+    if (vm_tz || vr_tz) {
+        uint32_t last = 0;
+        while (vp / 10 > vm / 10) {
+            vm_tz &= vm % 10 == 0;
+            vr_tz &= last == 0;
+            last = (uint32_t)(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+            removed++;
+        }
+        if (vm_tz) {
+            while (vm % 10 == 0) {
+                vr_tz &= last == 0;
+                last = (uint32_t)(vr % 10);
+                vr /= 10; vp /= 10; vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_tz && last == 5 && vr % 2 == 0) last = 4;   /* round half to even */
+        output = vr + ((vr == vm && (!accept_bounds || !vm_tz)) || last >= 5);
+    } else {
+        int round_up = 0;
+        if (vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100; vp /= 100; vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10; vp /= 10; vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *out_m = output;
+    *out_e = e10 + removed;
+    return strada_u64_ndigits(output);
+}
+#endif /* __SIZEOF_INT128__ */
+
+/* %g text for the digits digs[0..nd) (digs[0] nonzero) at decimal
+ * exponent e10: fixed or exponent form per the C rules for precision
+ * gprec, trailing zeros dropped (no '#'). Returns the end of the text. */
+static char *strada_g_body(char *o, const char *digs, int nd, int e10, int gprec, int upper) {
+    int lastnz = nd - 1;
+    while (lastnz > 0 && digs[lastnz] == '0') lastnz--;
+    if (e10 < -4 || e10 >= gprec) {
+        *o++ = digs[0];
+        if (lastnz >= 1) {
+            *o++ = '.';
+            for (int k = 1; k <= lastnz; k++) *o++ = digs[k];
+        }
+        *o++ = upper ? 'E' : 'e';
+        int ae = e10 < 0 ? -e10 : e10;
+        *o++ = e10 < 0 ? '-' : '+';
+        if (ae >= 100) { *o++ = (char)('0' + ae / 100); ae %= 100; *o++ = (char)('0' + ae / 10); *o++ = (char)('0' + ae % 10); }
+        else { *o++ = (char)('0' + ae / 10); *o++ = (char)('0' + ae % 10); }
+    } else if (e10 >= 0) {
+        for (int k = 0; k <= e10; k++) *o++ = k < nd ? digs[k] : '0';
+        if (lastnz > e10) {
+            *o++ = '.';
+            for (int k = e10 + 1; k <= lastnz; k++) *o++ = digs[k];
+        }
+    } else {
+        *o++ = '0'; *o++ = '.';
+        for (int k = 0; k < -e10 - 1; k++) *o++ = '0';
+        for (int k = 0; k <= lastnz; k++) *o++ = digs[k];
+    }
+    return o;
+}
+
+#ifdef STRADA_FAST_NUMCONV
+/* Round the normal |a| to ndig <= 17 significant digits from the 128-bit
+ * truncated 10^k of the parse table: X = a * 10^k carries fewer than two
+ * units of error in its last bit, so the rounding decision is exact
+ * unless the fraction sits within that of one half (a tie, or close to
+ * one) or of a whole unit. Returns 0 in those cases. */
+static int strada_d2fixed(double a, int ndig, uint64_t *out_r, int *out_e10) {
+    uint64_t bits;
+    memcpy(&bits, &a, sizeof(bits));
+    uint64_t m = (bits & ((1ULL << 52) - 1)) | (1ULL << 52);
+    int e2 = (int)((bits >> 52) & 0x7FF) - 1075;         /* a = m * 2^e2 */
+    int e10 = ((e2 + 52) * 78913) >> 18;                 /* floor(log10(a)) or one less */
+    uint64_t lo = 1;
+    for (int k = 1; k < ndig; k++) lo *= 10;             /* 10^(ndig-1) */
+    for (int tries = 0; tries < 2; tries++) {
+        int k = ndig - 1 - e10;
+        if (k < STRADA_P10_MIN_EXP || k > STRADA_P10_MAX_EXP) return 0;
+        const uint64_t *pw = strada_p10_128[k - STRADA_P10_MIN_EXP];
+        /* 10^k = pw * 2^(b - 127); (m * pw) >> 64 without the low word */
+        int b = (int)((217706 * (int64_t)k) >> 16);
+        strada_u128 x = (strada_u128)m * pw[1] + (((strada_u128)m * pw[0]) >> 64);
+        int f = 127 - e2 - b - 64;                       /* fraction bits in x */
+        if (f < 8 || f > 120) return 0;
+        uint64_t ip = (uint64_t)(x >> f);
+        if (ip < lo) { e10--; continue; }
+        if (ip / 10 >= lo) { e10++; continue; }
+        strada_u128 frac = x & (((strada_u128)1 << f) - 1);
+        strada_u128 half = (strada_u128)1 << (f - 1);
+        if (frac + 2 >= ((strada_u128)1 << f)) return 0;
+        if (frac + 2 >= half && frac <= half + 2) return 0;
+        uint64_t r = ip + (frac > half);
+        if (r / 10 >= lo) { r /= 10; e10++; }           /* 99..9 rounded up */
+        *out_r = r;
+        *out_e10 = e10;
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+/* Round the finite, nonzero |a| to ndig significant digits: *r gets
+ * exactly ndig digits and *e10 the exponent of the first. The
+ * fixed-precision product is cheapest; what it cannot settle (mostly
+ * round values such as 1200000 under %g, whose scaled product lands on
+ * an integer) falls to the shortest form, exact when it fits in
+ * ndig <= 15 digits (see above). Returns 0 when the caller needs a
+ * slower exact path. */
+static int strada_round_digits(double a, int ndig, uint64_t *r, int *e10) {
+#ifdef STRADA_FAST_NUMCONV
+    if (ndig > 17 || a < DBL_MIN) return 0;   /* subnormals carry fewer digits */
+    if (strada_d2fixed(a, ndig, r, e10)) return 1;
+    if (ndig <= 15) {
+        uint64_t m;
+        int e;
+        int nd = strada_d2s_shortest(a, &m, &e);
+        if (nd <= ndig) {
+            for (int k = nd; k < ndig; k++) m *= 10;
+            *r = m;
+            *e10 = e + nd - 1;
+            return 1;
+        }
+    }
+    return 0;
+#else
+    (void)a; (void)ndig; (void)r; (void)e10;
+    return 0;
+#endif
+}
+
+#ifdef STRADA_FAST_NUMCONV
+static const double strada_exact_p10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Correctly rounded m * 10^e10 for m != 0. Returns 0 when the result
+ * is out of reach (subnormal, overflow or an ambiguous halfway case). */
+static int strada_decimal_to_double(uint64_t m, int64_t e10, double *out) {
+    /* Clinger: both operands exact, so one IEEE operation rounds once */
+    if (m <= (1ULL << 53) && e10 >= -22 && e10 <= 22) {
+        double d = (double)m;
+        *out = e10 < 0 ? d / strada_exact_p10[-e10] : d * strada_exact_p10[e10];
+        return 1;
+    }
+    if (e10 < STRADA_P10_MIN_EXP || e10 > STRADA_P10_MAX_EXP) return 0;
+
+    /* Eisel-Lemire: normalize m, multiply by the truncated 128-bit
+     * 10^e10 and keep 54 bits; widen to 192 bits when the low bits of
+     * the first product could still carry into them. */
+    int clz = __builtin_clzll(m);
+    m <<= clz;
+    uint64_t exp2 = (uint64_t)(((217706 * e10) >> 16) + 64 + 1023) - (uint64_t)clz;
+    const uint64_t *pw = strada_p10_128[e10 - STRADA_P10_MIN_EXP];
+    strada_u128 x = (strada_u128)m * pw[1];
+    uint64_t x_hi = (uint64_t)(x >> 64), x_lo = (uint64_t)x;
+    if ((x_hi & 0x1FF) == 0x1FF && x_lo + m < m) {
+        strada_u128 y = (strada_u128)m * pw[0];
+        uint64_t y_hi = (uint64_t)(y >> 64), y_lo = (uint64_t)y;
+        uint64_t merged_hi = x_hi, merged_lo = x_lo + y_hi;
+        if (merged_lo < x_lo) merged_hi++;
+        if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + m < m) return 0;
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+    uint64_t msb = x_hi >> 63;
+    uint64_t mant = x_hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+    if (x_lo == 0 && (x_hi & 0x1FF) == 0 && (mant & 3) == 1) return 0;
+    mant += mant & 1;
+    mant >>= 1;
+    if (mant >> 53) {
+        mant >>= 1;
+        exp2++;
+    }
+    if (exp2 - 1 >= 0x7FF - 1) return 0;
+    uint64_t bits = exp2 << 52 | (mant & ((1ULL << 52) - 1));
+    memcpy(out, &bits, sizeof(*out));
+    return 1;
+}
+#endif
+
+/* Parse a decimal number at s[0..len): [sign] digits [. digits]
+ * [e [sign] digits], at least one digit. Stores the correctly rounded
+ * double in *out and the bytes used in *used. Returns 1 on success, 0
+ * when s does not start with such a number, and -1 when the number needs
+ * strtod (more than 19 significant digits, subnormal or ambiguous). */
+static int strada_parse_decimal(const char *s, size_t len, double *out, size_t *used) {
+#ifdef STRADA_FAST_NUMCONV
+    const char *p = s, *end = s + len;
+    int neg = 0;
+    if (p < end && (*p == '+' || *p == '-')) { neg = *p == '-'; p++; }
+    uint64_t m = 0;
+    int nd = 0;
+    int64_t e10 = 0;
+    int saw_digit = 0;
+    while (p < end && *p == '0') { p++; saw_digit = 1; }
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        if (nd < 19) { m = m * 10 + (uint64_t)(*p - '0'); nd++; }
+        else if (*p == '0') e10++;
+        else return -1;
+        p++;
+        saw_digit = 1;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (nd == 0) {
+            while (p < end && *p == '0') { p++; e10--; saw_digit = 1; }
+        }
+        while (p < end && (unsigned)(*p - '0') < 10) {
+            if (nd < 19) { m = m * 10 + (uint64_t)(*p - '0'); nd++; e10--; }
+            else if (*p != '0') return -1;
+            p++;
+            saw_digit = 1;
+        }
+    }
+    if (!saw_digit) return 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int eneg = 0;
+        if (q < end && (*q == '+' || *q == '-')) { eneg = *q == '-'; q++; }
+        if (q < end && (unsigned)(*q - '0') < 10) {
+            int64_t x = 0;
+            while (q < end && (unsigned)(*q - '0') < 10) {
+                if (x < 100000) x = x * 10 + (*q - '0');
+                q++;
+            }
+            e10 += eneg ? -x : x;
+            p = q;
+        }
+    }
+    double d = 0.0;
+    if (m != 0 && !strada_decimal_to_double(m, e10, &d)) return -1;
+    *out = neg ? -d : d;
+    *used = (size_t)(p - s);
+    return 1;
+#else
+    (void)s; (void)len; (void)out; (void)used;
+    return -1;
+#endif
+}
+
+double strada_str_to_double(const char *s, size_t len) {
+    double d;
+    size_t used;
+    if (strada_parse_decimal(s, len, &d, &used) == 1) return d;
+    char tmp[64];
+    char *buf = len < sizeof(tmp) ? tmp : malloc(len + 1);
+    if (!buf) return 0.0;
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    d = strtod(buf, NULL);
+    if (buf != tmp) free(buf);
+    return d;
+}
+
 /* Format a double using Perl's stringification conventions:
  *   - +inf  → "Inf"
  *   - -inf  → "-Inf"
@@ -392,11 +1096,27 @@ static int strada_format_double(double nv, char *buf, size_t buflen) {
      * (and overlaps with %lld in the 0..INT64_MAX range, since the bit
      * patterns are identical). Skip if nv has any fractional part. */
     if (nv > 0 && nv < 1.8446744073709552e19 && nv == floor(nv)) {
+        if (nv < 9.2e18 && buflen >= 24) return strada_fast_itoa((int64_t)nv, buf);
         return snprintf(buf, buflen, "%llu", (unsigned long long)nv);
     }
+    uint64_t r;
+    int e10;
+    if (buflen >= 32 && strada_round_digits(fabs(nv), 15, &r, &e10)) {
+        char digs[16];
+        for (int k = 14; k >= 0; k--) { digs[k] = (char)('0' + r % 10); r /= 10; }
+        char *o = buf;
+        if (nv < 0) *o++ = '-';
+        o = strada_g_body(o, digs, 15, e10, 15, 0);
+        *o = '\0';
+        return (int)(o - buf);
+    }
     return snprintf(buf, buflen, "%.15g", nv);
 }
 
+int strada_double_to_str(double v, char *buf) {
+    return strada_format_double(v, buf, 32);
+}
+
 /* Forward declaration — used by strada_to_str / strada_to_str_buf to
  * dispatch the '""' (stringify) overload when a blessed ref defines one. */
 static StradaMethod strada_overload_lookup(const char *package, const char *op);
@@ -579,6 +1299,56 @@ static inline StradaValue *strada_value_alloc(void) {
     return sv;
 }
 
+/* ===== SMALL-STRING BLOCKS =====
+ * A STR value of at most STRADA_SSO_MAX bytes is allocated as one block —
+ * the StradaValue followed by a StradaString header and its bytes — so the
+ * common short key/token/field costs one malloc instead of two and its bytes
+ * share the value's cache lines. See STRADA_STR_IS_EMBEDDED in the header for
+ * the sharing rules. Blocks recycle through their own free-list (the value
+ * pool's slots are only sizeof(StradaValue)). Arena values stay separate:
+ * arena slots are fixed-size. */
+#define STRADA_SSO_BLOCK (sizeof(StradaValue) + sizeof(StradaString) + STRADA_SSO_MAX + 1)
+#define SSO_POOL_MAX 16384
+static StradaValue *sso_pool_stack[SSO_POOL_MAX];
+static int sso_pool_count = 0;
+
+static void strada_sso_pool_cleanup(void) {
+    for (int i = 0; i < sso_pool_count; i++)
+        free(sso_pool_stack[i]);
+    sso_pool_count = 0;
+}
+
+/* New STR value (refcount 1, flags clear) with room for `len` bytes at
+ * value.pv, NUL-terminated at len; the caller fills in the bytes and sets
+ * struct_size. Small strings are embedded, the rest get a StradaString. */
+static inline StradaValue *strada_str_value_uninit(size_t len) {
+    StradaValue *sv;
+    if (len <= STRADA_SSO_MAX
+#ifdef STRADA_ARENA
+        && !(cur_arena && !strada_threading_active)
+#endif
+       ) {
+        if (!strada_threading_active && sso_pool_count > 0)
+            sv = sso_pool_stack[--sso_pool_count];
+        else
+            sv = sr_xmalloc(STRADA_SSO_BLOCK);
+        StradaString *ss = (StradaString *)(sv + 1);
+        ss->refcount = 1;
+        ss->hash = 0;
+        ss->len = len;
+        sv->value.pv = ss->data;
+        sv->meta = NULL;
+    } else {
+        sv = strada_value_alloc();
+        sv->value.pv = ss_new_uninit(len)->data;
+    }
+    sv->value.pv[len] = '\0';
+    sv->type = STRADA_STR;
+    sv->refcount = 1;
+    sv->struct_size = 0;
+    return sv;
+}
+
 /* Allocate an `n`-slot StradaValue* scratch buffer wrapped in a STRADA_CSTRUCT
  * whose free() releases the buffer. The inlined merge-sort (CodeGen.strada)
  * uses this and pushes it on the try/catch cleanup stack, so a comparator that
@@ -925,9 +1695,575 @@ StradaValue* strada_idiv(StradaValue *a, StradaValue *b) {
     return STRADA_MAKE_TAGGED_INT(av / bv);
 }
 
+/* ===== SIMD string kernels =====
+ * ASCII detection, UTF-8 validation, codepoint counting and ASCII case
+ * mapping run under every string constructor, file read, socket recv and
+ * JSON decode. x86-64 always has SSE2, so those paths use it directly; the
+ * AVX2 versions are chosen once, on first use, from __builtin_cpu_supports.
+ * Other targets scan a word at a time. All kernels read only p[0..len). */
+#ifdef STRADA_SIMD_X86
+static int strada_simd_avx2 = -1;   /* -1 = not probed yet */
+
+static inline int strada_cpu_avx2(void) {
+    int v = __atomic_load_n(&strada_simd_avx2, __ATOMIC_RELAXED);
+    if (v < 0) {
+        __builtin_cpu_init();
+        v = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&strada_simd_avx2, v, __ATOMIC_RELAXED);
+    }
+    return v;
+}
+
+__attribute__((target("avx2")))
+static size_t strada_ascii_run_avx2(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(p + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(p + i + 96));
+        __m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (_mm256_movemask_epi8(any)) break;
+    }
+    for (; i + 32 <= len; i += 32) {
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(p + i)));
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+    return i;
+}
+#endif
+
+/* Length of the all-ASCII prefix of p[0..len) (== len for pure ASCII). */
+static size_t strada_ascii_run(const unsigned char *p, size_t len) {
+    size_t i = 0;
+#ifdef STRADA_SIMD_X86
+    if (len >= 64 && strada_cpu_avx2()) i = strada_ascii_run_avx2(p, len);
+    for (; i + 16 <= len; i += 16) {
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p + i)));
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+#else
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        if (w & 0x8080808080808080ULL) break;
+    }
+#endif
+    for (; i < len; i++) {
+        if (p[i] >= 0x80) return i;
+    }
+    return len;
+}
+
+/* Number of UTF-8 codepoints in p[0..len): every byte that is not a
+ * continuation byte (10xxxxxx) starts one. */
+#ifdef STRADA_SIMD_X86
+__attribute__((target("avx2")))
+static size_t strada_utf8_count_avx2(const unsigned char *p, size_t len, size_t *done) {
+    /* Continuation bytes 0x80..0xBF are -128..-65 as int8. */
+    const __m256i lim = _mm256_set1_epi8(-64);
+    size_t conts = 0, i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        conts += (size_t)__builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(lim, v)));
+    }
+    *done = i;
+    return i - conts;
+}
+#endif
+
+static size_t strada_utf8_count(const unsigned char *p, size_t len) {
+    size_t count = 0, i = 0;
+#ifdef STRADA_SIMD_X86
+    if (len >= 64 && strada_cpu_avx2()) count = strada_utf8_count_avx2(p, len, &i);
+    const __m128i lim = _mm_set1_epi8(-64);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        count += 16 - (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(lim, v)));
+    }
+#endif
+    for (; i < len; i++) {
+        if ((p[i] & 0xC0) != 0x80) count++;
+    }
+    return count;
+}
+
+#ifdef STRADA_SIMD_X86
+/* Strict UTF-8 validation, 32 bytes per step (the Keiser-Lemire lookup
+ * method): three 16-entry nibble tables classify each byte pair, and a
+ * saturating-subtract test checks that 3- and 4-byte leads are followed by
+ * the right number of continuations. Same acceptance as the scalar
+ * strada_utf8_is_valid: no overlongs, surrogates, or codepoints past
+ * U+10FFFF. */
+#define STRADA_U8_TOO_SHORT  1
+#define STRADA_U8_TOO_LONG   2
+#define STRADA_U8_OVERLONG_3 4
+#define STRADA_U8_TOO_LARGE  8
+#define STRADA_U8_SURROGATE  16
+#define STRADA_U8_OVERLONG_2 32
+#define STRADA_U8_TOO_LARGE_1000 64
+#define STRADA_U8_OVERLONG_4 64
+#define STRADA_U8_TWO_CONTS  128
+#define STRADA_U8_CARRY (STRADA_U8_TOO_SHORT | STRADA_U8_TOO_LONG | STRADA_U8_TWO_CONTS)
+
+__attribute__((target("avx2")))
+static inline __m256i strada_u8_prev(__m256i in, __m256i prev, int n) {
+    __m256i joined = _mm256_permute2x128_si256(prev, in, 0x21);
+    switch (n) {
+        case 1: return _mm256_alignr_epi8(in, joined, 15);
+        case 2: return _mm256_alignr_epi8(in, joined, 14);
+        default: return _mm256_alignr_epi8(in, joined, 13);
+    }
+}
+
+#define STRADA_U8_TABLE(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p) \
+    _mm256_setr_epi8((char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h), \
+                     (char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p), \
+                     (char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h), \
+                     (char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p))
+
+__attribute__((target("avx2")))
+static int strada_utf8_valid_avx2(const unsigned char *p, size_t len) {
+    const __m256i byte_1_high = STRADA_U8_TABLE(
+        STRADA_U8_TOO_LONG, STRADA_U8_TOO_LONG, STRADA_U8_TOO_LONG, STRADA_U8_TOO_LONG,
+        STRADA_U8_TOO_LONG, STRADA_U8_TOO_LONG, STRADA_U8_TOO_LONG, STRADA_U8_TOO_LONG,
+        STRADA_U8_TWO_CONTS, STRADA_U8_TWO_CONTS, STRADA_U8_TWO_CONTS, STRADA_U8_TWO_CONTS,
+        STRADA_U8_TOO_SHORT | STRADA_U8_OVERLONG_2,
+        STRADA_U8_TOO_SHORT,
+        STRADA_U8_TOO_SHORT | STRADA_U8_OVERLONG_3 | STRADA_U8_SURROGATE,
+        STRADA_U8_TOO_SHORT | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000 | STRADA_U8_OVERLONG_4);
+    const __m256i byte_1_low = STRADA_U8_TABLE(
+        STRADA_U8_CARRY | STRADA_U8_OVERLONG_3 | STRADA_U8_OVERLONG_2 | STRADA_U8_OVERLONG_4,
+        STRADA_U8_CARRY | STRADA_U8_OVERLONG_2,
+        STRADA_U8_CARRY,
+        STRADA_U8_CARRY,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000 | STRADA_U8_SURROGATE,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000,
+        STRADA_U8_CARRY | STRADA_U8_TOO_LARGE | STRADA_U8_TOO_LARGE_1000);
+    const __m256i byte_2_high = STRADA_U8_TABLE(
+        STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT,
+        STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT,
+        STRADA_U8_TOO_LONG | STRADA_U8_OVERLONG_2 | STRADA_U8_TWO_CONTS | STRADA_U8_OVERLONG_3
+            | STRADA_U8_TOO_LARGE_1000 | STRADA_U8_OVERLONG_4,
+        STRADA_U8_TOO_LONG | STRADA_U8_OVERLONG_2 | STRADA_U8_TWO_CONTS | STRADA_U8_OVERLONG_3
+            | STRADA_U8_TOO_LARGE,
+        STRADA_U8_TOO_LONG | STRADA_U8_OVERLONG_2 | STRADA_U8_TWO_CONTS | STRADA_U8_SURROGATE
+            | STRADA_U8_TOO_LARGE,
+        STRADA_U8_TOO_LONG | STRADA_U8_OVERLONG_2 | STRADA_U8_TWO_CONTS | STRADA_U8_SURROGATE
+            | STRADA_U8_TOO_LARGE,
+        STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT, STRADA_U8_TOO_SHORT);
+    /* A lead byte in the last three positions still owes continuations. */
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    __m256i prev = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    __m256i err = _mm256_setzero_si256();
+    for (size_t i = 0; i < len; i += 32) {
+        __m256i in;
+        if (i + 32 <= len) {
+            in = _mm256_loadu_si256((const __m256i *)(p + i));
+        } else {
+            /* Zero padding is ASCII: a sequence cut off by the end
+             * shows up as TOO_SHORT against it. */
+            unsigned char tail[32] = {0};
+            memcpy(tail, p + i, len - i);
+            in = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        if (_mm256_movemask_epi8(in) == 0) {
+            err = _mm256_or_si256(err, prev_incomplete);
+        } else {
+            __m256i prev1 = strada_u8_prev(in, prev, 1);
+            __m256i sc = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nib)),
+                    _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nib))),
+                _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(in, 4), nib)));
+            __m256i third = _mm256_subs_epu8(strada_u8_prev(in, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+            __m256i fourth = _mm256_subs_epu8(strada_u8_prev(in, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+            __m256i must23_80 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+            err = _mm256_or_si256(err, _mm256_xor_si256(must23_80, sc));
+            prev_incomplete = _mm256_subs_epu8(in, incomplete_max);
+        }
+        if (!_mm256_testz_si256(err, err)) return 0;
+        prev = in;
+    }
+    err = _mm256_or_si256(err, prev_incomplete);
+    return _mm256_testz_si256(err, err);
+}
+#endif
+
+#ifdef STRADA_SIMD_X86
+__attribute__((target("avx2")))
+static size_t strada_ascii_case_copy_avx2(unsigned char *dst, const unsigned char *src, size_t n, int to_upper) {
+    const __m256i lo = _mm256_set1_epi8(to_upper ? 'a' - 1 : 'A' - 1);
+    const __m256i hi = _mm256_set1_epi8(to_upper ? 'z' + 1 : 'Z' + 1);
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(v, _mm256_and_si256(in_range, bit)));
+    }
+    return i;
+}
+#endif
+
+/* ASCII case mapping of n bytes (a-z <-> A-Z; every other byte, including
+ * UTF-8 sequence bytes, copied unchanged). dst may equal src. */
+static void strada_ascii_case_copy(unsigned char *dst, const unsigned char *src, size_t n, int to_upper) {
+    size_t i = 0;
+#ifdef STRADA_SIMD_X86
+    if (n >= 64 && strada_cpu_avx2()) i = strada_ascii_case_copy_avx2(dst, src, n, to_upper);
+    /* Signed compares: bytes >= 0x80 are negative and never in range. */
+    const __m128i lo = _mm_set1_epi8(to_upper ? 'a' - 1 : 'A' - 1);
+    const __m128i hi = _mm_set1_epi8(to_upper ? 'z' + 1 : 'Z' + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmpgt_epi8(hi, v));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, _mm_and_si128(in_range, bit)));
+    }
+#endif
+    for (; i < n; i++) {
+        unsigned char c = src[i];
+        if (to_upper) { if (c >= 'a' && c <= 'z') c = (unsigned char)(c - 32); }
+        else          { if (c >= 'A' && c <= 'Z') c = (unsigned char)(c + 32); }
+        dst[i] = c;
+    }
+}
+
+/* ===== Substring search =====
+ * A literal needle is located by testing two of its bytes (the anchors) at
+ * 16 (SSE2) or 32 (AVX2) haystack positions per step; only positions where
+ * both anchors match are confirmed with memcmp. strada_memmem anchors on the
+ * first and last byte. A StradaSearcher, built once per literal call site,
+ * anchors on the needle's two rarest bytes instead, so text full of its
+ * common letters is skipped just as fast. Several needles at once use Teddy:
+ * nibble tables looked up with pshufb (SSSE3) flag the positions where the
+ * first two bytes could start some needle, and each candidate is confirmed
+ * against the needles beginning with that byte, in the caller's order.
+ * Other targets use memmem and a first-byte table. */
+#define STRADA_NOT_FOUND ((size_t)-1)
+
+#ifdef STRADA_SIMD_X86
+__attribute__((target("avx2")))
+static size_t strada_find_anchored_avx2(const unsigned char *h, size_t last, size_t *from,
+                                        const unsigned char *n, size_t nl, size_t a1, size_t a2) {
+    const __m256i c1 = _mm256_set1_epi8((char)n[a1]);
+    const __m256i c2 = _mm256_set1_epi8((char)n[a2]);
+    size_t i = *from;
+    for (; i + 31 <= last; i += 32) {
+        __m256i e = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(h + i + a1)), c1),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(h + i + a2)), c2));
+        unsigned m = (unsigned)_mm256_movemask_epi8(e);
+        while (m) {
+            size_t p = i + (size_t)__builtin_ctz(m);
+            if (memcmp(h + p, n, nl) == 0) return p;
+            m &= m - 1;
+        }
+    }
+    *from = i;
+    return STRADA_NOT_FOUND;
+}
+#endif
+
+/* First position >= from where n[0..nl) occurs in h[0..hl), anchoring on
+ * bytes a1 != a2 of the needle (nl >= 2). */
+static size_t strada_find_anchored(const unsigned char *h, size_t hl, size_t from,
+                                   const unsigned char *n, size_t nl, size_t a1, size_t a2) {
+    if (nl > hl || from > hl - nl) return STRADA_NOT_FOUND;
+    size_t last = hl - nl, i = from;
+#ifdef STRADA_SIMD_X86
+    if (last - i >= 64 && strada_cpu_avx2()) {
+        size_t r = strada_find_anchored_avx2(h, last, &i, n, nl, a1, a2);
+        if (r != STRADA_NOT_FOUND) return r;
+    }
+    const __m128i c1 = _mm_set1_epi8((char)n[a1]);
+    const __m128i c2 = _mm_set1_epi8((char)n[a2]);
+    for (; i + 15 <= last; i += 16) {
+        __m128i e = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(h + i + a1)), c1),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(h + i + a2)), c2));
+        unsigned m = (unsigned)_mm_movemask_epi8(e);
+        while (m) {
+            size_t p = i + (size_t)__builtin_ctz(m);
+            if (memcmp(h + p, n, nl) == 0) return p;
+            m &= m - 1;
+        }
+    }
+    for (; i <= last; i++) {
+        if (h[i + a1] == n[a1] && h[i + a2] == n[a2] && memcmp(h + i, n, nl) == 0) return i;
+    }
+    return STRADA_NOT_FOUND;
+#else
+    (void)a1; (void)a2; (void)last;
+    const void *p = memmem(h + i, hl - i, n, nl);
+    return p ? (size_t)((const unsigned char *)p - h) : STRADA_NOT_FOUND;
+#endif
+}
+
+/* Last position where n[0..nl) occurs in h[0..hl), same anchoring. */
+static size_t strada_rfind_anchored(const unsigned char *h, size_t hl,
+                                    const unsigned char *n, size_t nl, size_t a1, size_t a2) {
+    if (nl > hl) return STRADA_NOT_FOUND;
+    size_t end = hl - nl + 1;   /* candidate positions are [0, end) */
+#ifdef STRADA_SIMD_X86
+    const __m128i c1 = _mm_set1_epi8((char)n[a1]);
+    const __m128i c2 = _mm_set1_epi8((char)n[a2]);
+    while (end >= 16) {
+        size_t i = end - 16;
+        __m128i e = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(h + i + a1)), c1),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(h + i + a2)), c2));
+        unsigned m = (unsigned)_mm_movemask_epi8(e);
+        while (m) {
+            int bit = 31 - __builtin_clz(m);
+            if (memcmp(h + i + bit, n, nl) == 0) return i + (size_t)bit;
+            m &= ~(1u << bit);
+        }
+        end = i;
+    }
+#endif
+    while (end > 0) {
+        size_t i = --end;
+        if (h[i + a1] == n[a1] && h[i + a2] == n[a2] && memcmp(h + i, n, nl) == 0) return i;
+    }
+    return STRADA_NOT_FOUND;
+}
+
+/* memmem/memrchr-style search by byte range; STRADA_NOT_FOUND on a miss,
+ * `from` (or hl for the reverse search) for an empty needle. */
+static size_t strada_memmem(const char *h, size_t hl, size_t from, const char *n, size_t nl) {
+    if (nl == 0) return from <= hl ? from : STRADA_NOT_FOUND;
+    if (from >= hl) return STRADA_NOT_FOUND;
+    if (nl == 1) {
+        const char *p = memchr(h + from, n[0], hl - from);
+        return p ? (size_t)(p - h) : STRADA_NOT_FOUND;
+    }
+    return strada_find_anchored((const unsigned char *)h, hl, from,
+                                (const unsigned char *)n, nl, 0, nl - 1);
+}
+
+static size_t strada_memrmem(const char *h, size_t hl, const char *n, size_t nl) {
+    if (nl == 0) return hl;
+    return strada_rfind_anchored((const unsigned char *)h, hl, (const unsigned char *)n, nl,
+                                 0, nl - 1);
+}
+
+/* Rough frequency class of a byte in text, most common highest; the
+ * searcher anchors on the needle bytes with the lowest class. */
+static int strada_byte_rank(unsigned char c) {
+    if (c == ' ' || c == 'e' || c == 't' || c == 'a' || c == 'o' || c == 'i' || c == 'n') return 7;
+    if (c >= 'a' && c <= 'z') return 6;
+    if ((c >= '0' && c <= '9') || c == ',' || c == '.' || c == '\n' || c == '"') return 5;
+    if (c >= 'A' && c <= 'Z') return 4;
+    if (c >= 0x20 && c < 0x7F) return 3;
+    if (c >= 0x80) return 2;
+    return 1;
+}
+
+struct StradaSearcher {
+    size_t count;              /* needles, in the caller's order */
+    char **needle;
+    size_t *len;
+    int has_empty;             /* an empty needle matches everywhere */
+    size_t a1, a2;             /* one needle of 2+ bytes: anchor offsets */
+    uint32_t first_at[257];    /* several: by_first[first_at[c]..first_at[c+1]) */
+    uint32_t *by_first;        /* needle indices grouped by first byte, ascending */
+    int teddy;                 /* nibble tables below are usable */
+    unsigned char lo0[16], hi0[16], lo1[16], hi1[16];
+};
+
+StradaSearcher *strada_searcher_new_multi(size_t count, const char *const *needles, const size_t *lens) {
+    StradaSearcher *s = calloc(1, sizeof(StradaSearcher));
+    if (!s) return NULL;
+    s->count = count;
+    s->needle = malloc((count ? count : 1) * sizeof(char *));
+    s->len = malloc((count ? count : 1) * sizeof(size_t));
+    s->by_first = malloc((count ? count : 1) * sizeof(uint32_t));
+    for (size_t k = 0; k < count; k++) {
+        s->len[k] = lens[k];
+        s->needle[k] = malloc(lens[k] + 1);
+        memcpy(s->needle[k], needles[k], lens[k]);
+        s->needle[k][lens[k]] = '\0';
+        if (lens[k] == 0) s->has_empty = 1;
+    }
+    if (count == 1 && lens[0] >= 2) {
+        /* Rarest byte first; the second anchor prefers a different value. */
+        const unsigned char *n = (const unsigned char *)s->needle[0];
+        size_t a1 = 0;
+        for (size_t i = 1; i < lens[0]; i++)
+            if (strada_byte_rank(n[i]) < strada_byte_rank(n[a1])) a1 = i;
+        size_t a2 = a1 == 0 ? 1 : 0;
+        int best = 99;
+        for (size_t i = 0; i < lens[0]; i++) {
+            int key = (n[i] == n[a1]) * 8 + strada_byte_rank(n[i]);
+            if (i != a1 && key < best) { best = key; a2 = i; }
+        }
+        s->a1 = a1 < a2 ? a1 : a2;
+        s->a2 = a1 < a2 ? a2 : a1;
+    }
+    /* Counting sort by first byte keeps each group in caller order. */
+    for (size_t k = 0; k < count; k++)
+        if (lens[k]) s->first_at[(unsigned char)needles[k][0] + 1]++;
+    for (int c = 0; c < 256; c++) s->first_at[c + 1] += s->first_at[c];
+    uint32_t fill[256];
+    memcpy(fill, s->first_at, sizeof(fill));
+    for (size_t k = 0; k < count; k++)
+        if (lens[k]) s->by_first[fill[(unsigned char)needles[k][0]]++] = (uint32_t)k;
+    /* Teddy: needle k lands in bucket k % 8. A one-byte needle accepts any
+     * second byte. Past 64 needles the buckets stop filtering usefully. */
+    s->teddy = count >= 2 && count <= 64 && !s->has_empty;
+    for (size_t k = 0; s->teddy && k < count; k++) {
+        unsigned char bit = (unsigned char)(1u << (k % 8));
+        unsigned char b0 = (unsigned char)s->needle[k][0];
+        s->lo0[b0 & 15] |= bit;
+        s->hi0[b0 >> 4] |= bit;
+        if (lens[k] == 1) {
+            for (int j = 0; j < 16; j++) { s->lo1[j] |= bit; s->hi1[j] |= bit; }
+        } else {
+            unsigned char b1 = (unsigned char)s->needle[k][1];
+            s->lo1[b1 & 15] |= bit;
+            s->hi1[b1 >> 4] |= bit;
+        }
+    }
+    return s;
+}
+
+StradaSearcher *strada_searcher_new(const char *needle, size_t len) {
+    return strada_searcher_new_multi(1, &needle, &len);
+}
+
+void strada_searcher_free(StradaSearcher *s) {
+    if (!s) return;
+    for (size_t k = 0; k < s->count; k++) free(s->needle[k]);
+    free(s->needle);
+    free(s->len);
+    free(s->by_first);
+    free(s);
+}
+
+/* Install a freshly built searcher in a call site's static slot. par::
+ * workers can reach the same site together; the first one wins and the
+ * others free their copy and use it. */
+StradaSearcher *strada_searcher_publish(StradaSearcher **slot, StradaSearcher *s) {
+    StradaSearcher *cur = NULL;
+    if (__atomic_compare_exchange_n(slot, &cur, s, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return s;
+    strada_searcher_free(s);
+    return cur;
+}
+
+/* The lowest-numbered needle starting at h[p], if any. */
+static inline int strada_searcher_at(const StradaSearcher *s, const unsigned char *h, size_t hl,
+                                     size_t p, size_t *which) {
+    unsigned c = h[p];
+    for (uint32_t j = s->first_at[c]; j < s->first_at[c + 1]; j++) {
+        uint32_t k = s->by_first[j];
+        if (s->len[k] <= hl - p && memcmp(h + p, s->needle[k], s->len[k]) == 0) {
+            *which = k;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#ifdef STRADA_SIMD_X86
+static int strada_simd_ssse3 = -1;   /* -1 = not probed yet */
+
+static inline int strada_cpu_ssse3(void) {
+    int v = __atomic_load_n(&strada_simd_ssse3, __ATOMIC_RELAXED);
+    if (v < 0) {
+        __builtin_cpu_init();
+        v = __builtin_cpu_supports("ssse3") ? 1 : 0;
+        __atomic_store_n(&strada_simd_ssse3, v, __ATOMIC_RELAXED);
+    }
+    return v;
+}
+
+__attribute__((target("ssse3")))
+static size_t strada_teddy_ssse3(const StradaSearcher *s, const unsigned char *h, size_t hl,
+                                 size_t *from, size_t *which) {
+    const __m128i lo0 = _mm_loadu_si128((const __m128i *)s->lo0);
+    const __m128i hi0 = _mm_loadu_si128((const __m128i *)s->hi0);
+    const __m128i lo1 = _mm_loadu_si128((const __m128i *)s->lo1);
+    const __m128i hi1 = _mm_loadu_si128((const __m128i *)s->hi1);
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = *from;
+    for (; i + 17 <= hl; i += 16) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(h + i + 1));
+        __m128i r0 = _mm_and_si128(_mm_shuffle_epi8(lo0, _mm_and_si128(v0, nib)),
+                                   _mm_shuffle_epi8(hi0, _mm_and_si128(_mm_srli_epi16(v0, 4), nib)));
+        __m128i r1 = _mm_and_si128(_mm_shuffle_epi8(lo1, _mm_and_si128(v1, nib)),
+                                   _mm_shuffle_epi8(hi1, _mm_and_si128(_mm_srli_epi16(v1, 4), nib)));
+        unsigned m = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(r0, r1), zero)) & 0xFFFF;
+        while (m) {
+            size_t p = i + (size_t)__builtin_ctz(m);
+            if (strada_searcher_at(s, h, hl, p, which)) return p;
+            m &= m - 1;
+        }
+    }
+    *from = i;
+    return STRADA_NOT_FOUND;
+}
+#endif
+
+/* Leftmost match at or after `from` in h[0..hl); when several needles
+ * match there, the first in the caller's order wins (like a regex
+ * alternation). *which receives the needle's index. */
+static size_t strada_searcher_find(const StradaSearcher *s, const char *hs, size_t hl,
+                                   size_t from, size_t *which) {
+    const unsigned char *h = (const unsigned char *)hs;
+    *which = 0;
+    if (from > hl || s->count == 0) return STRADA_NOT_FOUND;
+    if (s->count == 1) {
+        size_t nl = s->len[0];
+        if (nl < 2) return strada_memmem(hs, hl, from, s->needle[0], nl);
+        return strada_find_anchored(h, hl, from, (const unsigned char *)s->needle[0], nl, s->a1, s->a2);
+    }
+    if (s->has_empty) {
+        /* Matches right here: a needle listed before the empty one wins. */
+        for (size_t k = 0; k < s->count; k++) {
+            if (s->len[k] <= hl - from && memcmp(h + from, s->needle[k], s->len[k]) == 0) {
+                *which = k;
+                return from;
+            }
+        }
+    }
+    size_t i = from;
+#ifdef STRADA_SIMD_X86
+    if (s->teddy && hl - i >= 32 && strada_cpu_ssse3()) {
+        size_t r = strada_teddy_ssse3(s, h, hl, &i, which);
+        if (r != STRADA_NOT_FOUND) return r;
+    }
+#endif
+    for (; i < hl; i++) {
+        if (s->first_at[h[i]] != s->first_at[h[i] + 1] && strada_searcher_at(s, h, hl, i, which))
+            return i;
+    }
+    return STRADA_NOT_FOUND;
+}
+
 /* Check if a string is pure ASCII (no bytes >= 0x80) */
 static inline size_t _str_flags(const char *s, size_t len) {
     const unsigned char *p = (const unsigned char *)s;
+    if (len >= 16) {
+        return strada_ascii_run(p, len) == len ? (len | ((size_t)1 << 63)) : len;
+    }
     for (size_t i = 0; i < len; i++) {
         if (p[i] >= 0x80) return len; /* non-ASCII: no flag */
     }
@@ -935,18 +2271,9 @@ static inline size_t _str_flags(const char *s, size_t len) {
 }
 
 StradaValue* strada_new_str(const char *s) {
-    StradaValue *sv = strada_value_alloc();
-    sv->type = STRADA_STR;
-    sv->refcount = 1;
     size_t len = s ? strlen(s) : 0;
-    /* StradaString stores its length in a uint32_t; a >4GB string would store a
-     * truncated length while ss_alloc_pv copies the full buffer, desyncing the
-     * two. Abort (mirrors the >UINT32_MAX concat guards). */
-    if (len > UINT32_MAX) {
-        fprintf(stderr, "strada: string length exceeds 4GB limit (%zu bytes)\n", len);
-        abort();
-    }
-    sv->value.pv = ss_alloc_pv(s ? s : "", len);
+    StradaValue *sv = strada_str_value_uninit(len);
+    memcpy(sv->value.pv, s ? s : "", len);
     sv->struct_size = s ? _str_flags(s, len) : ((size_t)1 << 63);
     strada_memprof_alloc(STRADA_STR, sizeof(StradaValue) + sizeof(StradaString) + len + 1);
     return sv;
@@ -970,27 +2297,76 @@ static StradaValue* strada_new_str_share_ss(StradaString *ss) {
     return sv;
 }
 
-/* Dualvar: build a STRADA_STR whose string form is `s` but whose numeric
- * form (strada_to_int/num) returns `iv` instead. Used for $! (errno +
- * strerror), $? (child status), and similar Perl special variables that
- * have both a meaningful string and integer representation. */
-StradaValue* strada_new_dualvar(int64_t iv, const char *s) {
-    StradaValue *sv = strada_new_str(s);
-    StradaMetadata *meta = strada_ensure_meta(sv);
-    if (meta) {
-        meta->iv_override = iv;
-        meta->has_iv_override = 1;
-    }
+/* Wrap a StradaString the caller just filled in (refcount 1, ss->len set)
+ * in a new STR value, taking over its reference. `flags` are the
+ * struct_size flag bits (ASCII/UTF-8) for the bytes written. */
+static StradaValue* strada_new_str_take_ss(StradaString *ss, size_t flags) {
+    StradaValue *sv = strada_value_alloc();
+    sv->type = STRADA_STR;
+    sv->refcount = 1;
+    ss->data[ss->len] = '\0';
+    sv->value.pv = ss->data;
+    sv->struct_size = (size_t)ss->len | flags;
+    strada_memprof_alloc(STRADA_STR, sizeof(StradaValue) + sizeof(StradaString) + ss->len + 1);
+    return sv;
+}
+
+/* core::intern(s): a string value sharing the interned copy of s (see
+ * strada_ss_intern). Used as a hash key it is shared, not copied, by the
+ * entry (sv_key_ss). Non-strings intern their string form. */
+StradaValue* strada_intern_sv(StradaValue *sv) {
+    char _tb[256];
+    char *heap = NULL;
+    const char *s;
+    size_t len;
+    int utf8 = 0;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv) {
+        s = sv->value.pv;
+        len = STRADA_STR_BYTELEN(sv);
+        if (len == 0) len = strlen(s);
+        utf8 = STRADA_STR_IS_UTF8(sv);
+    } else if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_REF) {
+        s = heap = strada_to_str(sv);
+        len = s ? strlen(s) : 0;
+    } else {
+        s = strada_to_str_buf(sv, _tb, sizeof(_tb));
+        len = strlen(s);
+    }
+    StradaString *ss = strada_ss_intern(s ? s : "", len);
+    free(heap);
+    StradaValue *r = strada_value_alloc();
+    r->type = STRADA_STR;
+    r->refcount = 1;
+    r->value.pv = ss->data;
+    r->struct_size = _str_flags(ss->data, len) | (utf8 ? STRADA_UTF8_FLAG : 0);
+    strada_memprof_alloc(STRADA_STR, sizeof(StradaValue));
+    return r;
+}
+
+/* core::intern_count(): strings currently live in the intern table */
+int64_t strada_intern_count(void) {
+    return (int64_t)ss_intern_count;
+}
+
+/* Dualvar: build a STRADA_STR whose string form is `s` but whose numeric
+ * form (strada_to_int/num) returns `iv` instead. Used for $! (errno +
+ * strerror), $? (child status), and similar Perl special variables that
+ * have both a meaningful string and integer representation. */
+StradaValue* strada_new_dualvar(int64_t iv, const char *s) {
+    StradaValue *sv = strada_new_str(s);
+    StradaMetadata *meta = strada_ensure_meta(sv);
+    if (meta) {
+        meta->iv_override = iv;
+        meta->has_iv_override = 1;
+    }
     return sv;
 }
 
 /* Take ownership of a malloc'd string — wrap in StradaString then free original */
 StradaValue* strada_new_str_take(char *s) {
-    StradaValue *sv = strada_value_alloc();
-    sv->type = STRADA_STR;
-    sv->refcount = 1;
     size_t len = s ? strlen(s) : 0;
-    sv->value.pv = ss_alloc_pv(s ? s : "", len);
+    StradaValue *sv = strada_str_value_uninit(len);
+    memcpy(sv->value.pv, s ? s : "", len);
     sv->struct_size = s ? _str_flags(s, len) : ((size_t)1 << 63);
     if (s) free(s);  /* free the original — we copied into StradaString */
     return sv;
@@ -998,14 +2374,12 @@ StradaValue* strada_new_str_take(char *s) {
 
 /* Create string from binary data with explicit length (may contain embedded NULLs) */
 StradaValue* strada_new_str_len(const char *s, size_t len) {
-    StradaValue *sv = strada_value_alloc();
-    sv->type = STRADA_STR;
-    sv->refcount = 1;
-    if (s && len > 0) {
-        sv->value.pv = ss_alloc_pv(s, len);
+    if (!s) len = 0;
+    StradaValue *sv = strada_str_value_uninit(len);
+    if (len > 0) {
+        memcpy(sv->value.pv, s, len);
         sv->struct_size = _str_flags(s, len);
     } else {
-        sv->value.pv = ss_alloc_pv("", 0);
         sv->struct_size = (size_t)1 << 63; /* empty string is ASCII */
     }
     return sv;
@@ -1024,6 +2398,34 @@ StradaValue* strada_new_str_len_utf8(const char *s, size_t len) {
     return sv;
 }
 
+/* Slices below this size are always copied — a copy is cheaper than the
+ * extra reference, and small strings come from the SS pool anyway. */
+#define STRADA_STR_VIEW_MIN 256
+
+/* Suffix of `src` starting at byte `off` (len bytes, running to its end):
+ * a substring view sharing src's StradaString when that pays off, otherwise
+ * an ordinary copy. A view of a view points at the root, so chains never
+ * form. A slice shorter than half the root is copied, so a view never pins
+ * more than twice its own size, and a parser that keeps chopping the front
+ * off one buffer copies O(n) bytes in total instead of O(n^2). The ASCII
+ * flag is inherited; the caller adds the UTF-8 flag when it applies. */
+static StradaValue* strada_str_suffix(StradaValue *src, size_t off, size_t len) {
+    StradaString *root = strada_str_owner(src);
+    size_t root_off = (STRADA_STR_IS_VIEW(src) ? STRADA_STR_VIEW_OFF(src) : 0) + off;
+    if (len < STRADA_STR_VIEW_MIN || len < root->len / 2 || root_off > STRADA_STR_VIEW_MAX_OFF
+        || len > UINT32_MAX)
+        return strada_new_str_len(src->value.pv + off, len);
+    StradaValue *sv = strada_value_alloc();
+    sv->type = STRADA_STR;
+    sv->refcount = 1;
+    ss_incref(root);
+    sv->value.pv = src->value.pv + off;
+    sv->struct_size = len | (src->struct_size & STRADA_ASCII_FLAG) | STRADA_STR_VIEW
+                    | (root_off << STRADA_STR_VIEW_SHIFT);
+    strada_memprof_alloc(STRADA_STR, sizeof(StradaValue));
+    return sv;
+}
+
 void strada_set_utf8_flag(StradaValue *sv, int on) {
     if (!sv || STRADA_IS_TAGGED_INT(sv) || sv->type != STRADA_STR) return;
     if (on) sv->struct_size |= STRADA_UTF8_FLAG;
@@ -1042,7 +2444,7 @@ void strada_array_set_utf8_flag(StradaValue *arr_sv, int on) {
              && arr_sv->value.rv->type == STRADA_ARRAY) {
         av = arr_sv->value.rv->value.av;
     }
-    if (!av) return;
+    if (!av || av->kind) return;
     for (size_t i = 0; i < av->size; i++) {
         StradaValue *e = av->elements[av->head + i];
         if (e && !STRADA_IS_TAGGED_INT(e) && e->type == STRADA_STR) {
@@ -1088,7 +2490,7 @@ size_t strada_str_len(StradaValue *sv) {
     }
     if (sv->type == STRADA_NUM) {
         char buf[64];
-        return (size_t)snprintf(buf, sizeof(buf), "%.15g", sv->value.nv);
+        return (size_t)strada_format_double(sv->value.nv, buf, sizeof(buf));
     }
     /* Fallback: stringify and measure. Costs an allocation but rare path. */
     char *s = strada_to_str(sv);
@@ -1237,7 +2639,7 @@ void strada_break_self_cycle_impl(StradaValue *sv) {
         }
     } else {
         StradaArray *av = sv->value.av;
-        if (!av) return;
+        if (!av || av->kind) return;
         for (size_t i = 0; i < av->size; i++) {
             StradaValue *v = av->elements[av->head + i];
             if (!v || STRADA_IS_TAGGED_INT(v)) continue;
@@ -1687,7 +3089,7 @@ static void strada_close_fh_meta(FILE *fh) {
                 StradaValue *target = ref->value.rv;
                 if (target && !STRADA_IS_TAGGED_INT(target)) {
                     if (target->type == STRADA_STR) {
-                        ss_free_pv(target->value.pv);
+                        strada_str_free_pv(target);
                         target->value.pv = ss_alloc_pv(meta->mem_buf, meta->mem_size);
                         /* _str_flags computes the ASCII flag (bit 63); raw
                          * mem_size would clear it on an all-ASCII buffer. */
@@ -1734,7 +3136,7 @@ static void strada_fh_writeback_sync(FILE *fh) {
         StradaValue *target = ref->value.rv;
         if (target && !STRADA_IS_TAGGED_INT(target)) {
             if (target->type == STRADA_STR) {
-                ss_free_pv(target->value.pv);
+                strada_str_free_pv(target);
                 target->value.pv = ss_alloc_pv(meta->mem_buf, meta->mem_size);
                 target->struct_size = _str_flags(meta->mem_buf, meta->mem_size);
             } else if (target->type == STRADA_UNDEF) {
@@ -1752,19 +3154,8 @@ static unsigned int strada_hash_string(const char *str);
 void strada_weaken_hv_entry(StradaHash *hv, const char *key) {
     if (!hv || !key) return;
     unsigned int hash = strada_hash_string(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) return;
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && strcmp(e->key->data, key) == 0) {
-                strada_weaken(&e->value);
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-    }
+    StradaHashEntry *e = hv_find(hv, key, (uint32_t)strlen(key), hash);
+    if (e) strada_weaken(&e->value);
 }
 
 /* ===== TYPE CONVERSION ===== */
@@ -1871,7 +3262,7 @@ int perl_looks_like_number_c(const char *s) {
  * NOT parse hex literals (`"0x5"` → 0, not 5) or hex floats. It DOES still
  * accept `inf`/`nan` words (strtod handles those, and Perl returns the
  * corresponding double for them). */
-static double perl_atof(const char *s) {
+static double perl_atof(const char *s, size_t len) {
     if (!s) return 0.0;
     const char *p = s;
     while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\v' || *p == '\f') p++;
@@ -1881,7 +3272,12 @@ static double perl_atof(const char *s) {
     if ((after_sign[0] == '0') && (after_sign[1] == 'x' || after_sign[1] == 'X')) {
         return 0.0;
     }
-    /* Let strtod handle decimals, exponents, "inf", "infinity", "nan" */
+    if (len == 0) len = strlen(s);
+    double d;
+    size_t used;
+    if ((size_t)(p - s) < len && strada_parse_decimal(p, len - (size_t)(p - s), &d, &used) == 1)
+        return d;
+    /* strtod handles the rest: long mantissas, "inf", "infinity", "nan" */
     return strtod(s, NULL);
 }
 
@@ -1906,7 +3302,7 @@ double strada_to_num(StradaValue *sv) {
         case STRADA_NUM:
             return sv->value.nv;
         case STRADA_STR:
-            return sv->value.pv ? perl_atof(sv->value.pv) : 0.0;
+            return sv->value.pv ? perl_atof(sv->value.pv, STRADA_STR_BYTELEN(sv)) : 0.0;
         case STRADA_ARRAY:
             return (double)strada_array_length(sv->value.av);
         case STRADA_HASH:
@@ -2131,7 +3527,9 @@ char* strada_to_str(StradaValue *sv) {
 
 /* strada_to_str_ss — always returns StradaString-backed pointer.
  * For STRADA_STR: zero copy (incref + return data pointer).
- * For other types: creates new StradaString.
+ * For substring views, embedded small strings and other types: creates new
+ * StradaString (a view's pv has no header of its own for strada_cstr_free to
+ * find, and embedded bytes die with their value).
  * Caller MUST free with strada_cstr_free(). */
 char* strada_to_str_ss(StradaValue *sv) {
     if (!sv) return ss_alloc_pv("", 0);
@@ -2141,6 +3539,8 @@ char* strada_to_str_ss(StradaValue *sv) {
         return ss_alloc_pv(buf, len);
     }
     if (sv->type == STRADA_STR && sv->value.pv) {
+        if (STRADA_STR_IS_VIEW(sv) || STRADA_STR_IS_EMBEDDED(sv))
+            return ss_alloc_pv(sv->value.pv, STRADA_STR_BYTELEN(sv));
         ss_incref(SS_FROM_PV(sv->value.pv));
         return sv->value.pv;  /* zero copy — shared with the StradaValue */
     }
@@ -2537,6 +3937,411 @@ static inline void array_free_backbone(StradaArray *av) {
     free(av);
 }
 
+/* ===== Bulk moves =====
+ * push/unshift of a list, list assignment and splice move whole runs of
+ * element pointers with memmove/memcpy and then take the references in
+ * one pass, instead of a capacity check and a call per element.
+ *
+ * av_open_gap makes n unfilled slots at logical index at and counts them
+ * in the size; the caller fills them. It moves whichever side of the
+ * live range is shorter into the free room on that side. When that side
+ * has no room the array is laid out again with at least half its size
+ * again as slack: in front for an insert into the front half (so a run of
+ * unshifts is amortized O(1) like a run of pushes), behind otherwise. The
+ * buffer grows geometrically only when the slack doesn't fit, so head
+ * room left by shift is reused instead of reallocating. Boxed arrays. */
+static void av_open_gap(StradaArray *av, size_t at, size_t n) {
+    size_t size = av->size;
+    size_t head = av->head;
+    StradaValue **e = av->elements;
+    int front = at * 2 < size;
+    if (front && head >= n) {
+        memmove(e + head - n, e + head, at * sizeof(StradaValue*));
+        av->head = head - n;
+        av->size = size + n;
+        return;
+    }
+    if (!front && head + size + n <= av->capacity) {
+        memmove(e + head + at + n, e + head + at, (size - at) * sizeof(StradaValue*));
+        av->size = size + n;
+        return;
+    }
+    size_t need = size + n;
+    size_t slack = need / 2 < 4 ? 4 : need / 2;
+    if (need > SIZE_MAX / sizeof(StradaValue*) / 4) {
+        fprintf(stderr, "strada: array too large (%zu elements)\n", need);
+        abort();
+    }
+    size_t cap = av->capacity;
+    if (cap < need + slack) {
+        size_t newcap = cap * 2;
+        if (newcap < need + slack) newcap = need + slack;
+        e = av->elements = array_grow_elems(av, newcap);
+        av->capacity = cap = newcap;
+    }
+    size_t g = front ? (cap - need) / 2 : 0;
+    /* Move the run whose destination can't overlap the other's source first */
+    if (g <= head) {
+        memmove(e + g, e + head, at * sizeof(StradaValue*));
+        memmove(e + g + at + n, e + head + at, (size - at) * sizeof(StradaValue*));
+    } else {
+        memmove(e + g + at + n, e + head + at, (size - at) * sizeof(StradaValue*));
+        memmove(e + g, e + head, at * sizeof(StradaValue*));
+    }
+    av->head = g;
+    av->size = need;
+}
+
+/* Drop n slots at logical index at without touching their references,
+ * moving the shorter side over them. Boxed arrays. */
+static void av_close_gap(StradaArray *av, size_t at, size_t n) {
+    StradaValue **e = av->elements + av->head;
+    size_t tail = av->size - at - n;
+    if (at < tail) {
+        memmove(e + n, e, at * sizeof(StradaValue*));
+        av->head += n;
+    } else {
+        memmove(e + at, e + at + n, tail * sizeof(StradaValue*));
+    }
+    av->size -= n;
+}
+
+/* Take a reference to each of n element pointers: one threading check
+ * for the run, then plain increments (holes and tagged ints skipped). */
+static inline void av_incref_run(StradaValue **e, size_t n) {
+    if (strada_threading_active) {
+        for (size_t i = 0; i < n; i++) strada_incref(e[i]);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        StradaValue *sv = e[i];
+        if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->refcount <= 1000000000) sv->refcount++;
+    }
+}
+
+/* ===== Packed arrays =====
+ * A packed array stores raw int64_t / double / uint8_t slots in `elements`,
+ * positioned by head/size/capacity exactly like the boxed layout, and is
+ * never compact or pooled. Ints in tagged range and bytes read back as
+ * tagged ints. Anything else that must be lent out as a borrowed
+ * StradaValue* is boxed once and parked in `boxes` (same indexing) until
+ * the slot is written or leaves the array, so a borrowed element lives
+ * exactly as long as it would in a boxed array. boxes[p] is NULL for every
+ * p outside [head, head + size). */
+static inline size_t av_slot_size(int kind) {
+    return kind == STRADA_AV_BYTE ? 1 : sizeof(int64_t);
+}
+
+/* A fresh owned value for the slot at absolute position pos */
+static StradaValue *av_packed_box(const StradaArray *av, size_t pos) {
+    switch (av->kind) {
+    case STRADA_AV_INT: return strada_new_int(STRADA_AV_I64(av)[pos]);
+    case STRADA_AV_NUM: return strada_new_num(STRADA_AV_F64(av)[pos]);
+    default:            return STRADA_MAKE_TAGGED_INT(STRADA_AV_U8(av)[pos]);
+    }
+}
+
+/* Borrowed read: the array keeps the box */
+static StradaValue *av_packed_lend(StradaArray *av, size_t pos) {
+    if (av->kind == STRADA_AV_BYTE) return STRADA_MAKE_TAGGED_INT(STRADA_AV_U8(av)[pos]);
+    if (av->kind == STRADA_AV_INT) {
+        int64_t v = STRADA_AV_I64(av)[pos];
+        if (v >= STRADA_TAGGED_INT_MIN && v <= STRADA_TAGGED_INT_MAX) return STRADA_MAKE_TAGGED_INT(v);
+    }
+    if (!av->boxes) {
+        av->boxes = calloc(av->capacity ? av->capacity : 1, sizeof(StradaValue*));
+        if (!av->boxes) { fprintf(stderr, "strada: out of memory\n"); abort(); }
+    }
+    if (!av->boxes[pos]) av->boxes[pos] = av_packed_box(av, pos);
+    return av->boxes[pos];
+}
+
+/* Owned read */
+static inline StradaValue *av_packed_take(StradaArray *av, size_t pos) {
+    if (av->boxes && av->boxes[pos]) {
+        strada_incref(av->boxes[pos]);
+        return av->boxes[pos];
+    }
+    return av_packed_box(av, pos);
+}
+
+/* Owned read of a slot that is leaving the array (pop/shift/splice) */
+static inline StradaValue *av_packed_remove(StradaArray *av, size_t pos) {
+    if (av->boxes && av->boxes[pos]) {
+        StradaValue *b = av->boxes[pos];
+        av->boxes[pos] = NULL;
+        return b;
+    }
+    return av_packed_box(av, pos);
+}
+
+/* Format the slot as print would, into buf (>= 64 bytes); returns length */
+static int av_packed_fmt(const StradaArray *av, size_t pos, char *buf) {
+    switch (av->kind) {
+    case STRADA_AV_INT: return strada_fast_itoa(STRADA_AV_I64(av)[pos], buf);
+    case STRADA_AV_NUM: return strada_format_double(STRADA_AV_F64(av)[pos], buf, 64);
+    default:            return strada_fast_itoa(STRADA_AV_U8(av)[pos], buf);
+    }
+}
+
+/* Borrowed element i of any array (NULL for a boxed hole) */
+static inline StradaValue *av_at(StradaArray *av, size_t i) {
+    if (__builtin_expect(av->kind, 0)) return av_packed_lend(av, av->head + i);
+    return av->elements[av->head + i];
+}
+
+static inline void av_packed_unlend(StradaArray *av, size_t pos) {
+    if (av->boxes && av->boxes[pos]) {
+        strada_decref(av->boxes[pos]);
+        av->boxes[pos] = NULL;
+    }
+}
+
+/* Store sv (borrowed) into the slot, coerced to the element type */
+static void av_packed_store(StradaArray *av, size_t pos, StradaValue *sv) {
+    switch (av->kind) {
+    case STRADA_AV_INT: STRADA_AV_I64(av)[pos] = strada_to_int(sv); break;
+    case STRADA_AV_NUM: STRADA_AV_F64(av)[pos] = strada_to_num(sv); break;
+    default:            STRADA_AV_U8(av)[pos] = (uint8_t)strada_to_int(sv); break;
+    }
+    av_packed_unlend(av, pos);
+}
+
+/* Resize the slot (and box) buffers to exactly cap slots */
+static void av_packed_realloc(StradaArray *av, size_t cap) {
+    size_t es = av_slot_size(av->kind);
+    if (cap < 1) cap = 1;
+    if (cap > SIZE_MAX / sizeof(StradaValue*)) {
+        fprintf(stderr, "strada: packed array too large (%zu slots)\n", cap);
+        abort();
+    }
+    av->elements = sr_xrealloc(av->elements, cap * es);
+    if (av->boxes) {
+        av->boxes = sr_xrealloc(av->boxes, cap * sizeof(StradaValue*));
+        if (cap > av->capacity)
+            memset(av->boxes + av->capacity, 0, (cap - av->capacity) * sizeof(StradaValue*));
+    }
+    av->capacity = cap;
+}
+
+/* Close the front gap: the live range moves to position 0 */
+static void av_packed_compact(StradaArray *av) {
+    if (av->head == 0) return;
+    size_t es = av_slot_size(av->kind);
+    memmove(av->elements, (char *)av->elements + av->head * es, av->size * es);
+    if (av->boxes) {
+        memmove(av->boxes, av->boxes + av->head, av->size * sizeof(StradaValue*));
+        memset(av->boxes + av->size, 0, av->head * sizeof(StradaValue*));
+    }
+    av->head = 0;
+}
+
+/* Make room for `need` slots from position 0 of the live range: closes
+ * the front gap first, then doubles. */
+static void av_packed_fit(StradaArray *av, size_t need) {
+    if (av->head + need <= av->capacity) return;
+    if (av->head > 0) {
+        av_packed_compact(av);
+        if (need <= av->capacity) return;
+    }
+    size_t cap = av->capacity ? av->capacity : 8;
+    while (cap < need) cap = cap > SIZE_MAX / 2 ? need : cap * 2;
+    av_packed_realloc(av, cap);
+}
+
+/* Turn an empty boxed array into a packed one with room for cap slots */
+static void av_make_packed(StradaArray *av, int kind, size_t cap) {
+    if (!array_elems_inline(av)) free(av->elements);
+    if (cap < 1) cap = 1;
+    av->kind = kind;
+    av->elements = sr_xmalloc(cap * av_slot_size(kind));
+    av->boxes = NULL;
+    av->capacity = cap;
+    av->size = 0;
+    av->head = 0;
+}
+
+static void av_packed_free(StradaArray *av) {
+    if (av->boxes) {
+        for (size_t i = 0; i < av->size; i++) strada_decref(av->boxes[av->head + i]);
+        free(av->boxes);
+    }
+    free(av->elements);
+    free(av);
+}
+
+/* Give a packed array ordinary boxed storage, in place. Boxes already lent
+ * out become the elements, so borrowed pointers stay valid. */
+void strada_array_unpack_slow(StradaArray *av) {
+    size_t cap = av->capacity ? av->capacity : 1;
+    StradaValue **el = calloc(cap, sizeof(StradaValue*));
+    if (!el) { fprintf(stderr, "strada: out of memory\n"); abort(); }
+    for (size_t i = 0; i < av->size; i++) {
+        size_t p = av->head + i;
+        el[p] = av->boxes && av->boxes[p] ? av->boxes[p] : av_packed_box(av, p);
+    }
+    free(av->boxes);
+    free(av->elements);
+    av->boxes = NULL;
+    av->elements = el;
+    av->capacity = cap;
+    av->kind = STRADA_AV_BOXED;
+}
+
+void strada_array_unlend_slow(StradaArray *av, int64_t idx) {
+    if (idx >= 0 && (size_t)idx < av->size) av_packed_unlend(av, av->head + (size_t)idx);
+}
+
+/* Pack the array held by sv (an array or array ref) to `kind` in place,
+ * coercing every element. Used by typed declarations (`my array<int> @a`)
+ * after each whole-array assignment; untyped arrays pass STRADA_AV_BOXED
+ * so a packed result (nsort, reverse, ...) gets boxed storage. Tied
+ * arrays are left alone. */
+void strada_array_pack(StradaValue *sv, int kind) {
+    if (!sv || STRADA_IS_TAGGED_INT(sv) || kind < STRADA_AV_BOXED || kind > STRADA_AV_BYTE) return;
+    if (sv->meta && sv->meta->is_tied) return;
+    StradaArray *av = strada_deref_array(sv);
+    if (!av || av->kind == kind) return;
+    if (av->kind) strada_array_unpack_slow(av);
+    if (kind == STRADA_AV_BOXED) return;
+    size_t n = av->size;
+    size_t cap = av->capacity > n ? av->capacity : n;
+    StradaValue **old = av->elements;
+    size_t old_head = av->head;
+    int old_inline = array_elems_inline(av);
+    av->kind = kind;
+    av->elements = sr_xmalloc((cap ? cap : 1) * av_slot_size(kind));
+    av->boxes = NULL;
+    av->capacity = cap ? cap : 1;
+    av->head = 0;
+    for (size_t i = 0; i < n; i++) {
+        StradaValue *e = old[old_head + i];
+        if (kind == STRADA_AV_NUM) STRADA_AV_F64(av)[i] = e ? strada_to_num(e) : 0.0;
+        else {
+            int64_t v = e ? strada_to_int(e) : 0;
+            if (kind == STRADA_AV_INT) STRADA_AV_I64(av)[i] = v;
+            else STRADA_AV_U8(av)[i] = (uint8_t)v;
+        }
+        if (e) strada_decref(e);
+    }
+    /* a compact block's inline slots just go unused until the array is freed */
+    if (!old_inline) free(old);
+}
+
+/* A fresh packed array of n zeroed slots: core::packed_int_array(n) etc. */
+StradaValue* strada_packed_array_new(int kind, int64_t n) {
+    StradaValue *sv = strada_new_array();
+    if (kind <= STRADA_AV_BOXED || kind > STRADA_AV_BYTE) return sv;
+    if (n < 0) n = 0;
+    if ((uint64_t)n > SIZE_MAX / sizeof(StradaValue*)) {
+        strada_die("packed array too large");
+        return sv;
+    }
+    av_make_packed(sv->value.av, kind, (size_t)n);
+    memset(sv->value.av->elements, 0, (size_t)n * av_slot_size(kind));
+    sv->value.av->size = (size_t)n;
+    return sv;
+}
+
+/* core::packed_kind(@a): 0 boxed, 1 int, 2 num, 3 byte */
+int strada_packed_kind(StradaValue *sv) {
+    StradaArray *av = strada_deref_array(sv);
+    return av ? av->kind : 0;
+}
+
+/* core::sum / core::min / core::max over an array or array ref. Packed
+ * arrays reduce over the raw slots; boxed ones follow the `+` / `<`
+ * operators element by element (ints stay ints until a non-int or an
+ * overflow turns the total into a num). min/max of an empty list is
+ * undef. */
+StradaValue* strada_list_sum(StradaValue *sv) {
+    StradaArray *av = strada_deref_array(sv);
+    if (!av || av->size == 0) return STRADA_MAKE_TAGGED_INT(0);
+    size_t n = av->size;
+    if (av->kind == STRADA_AV_NUM) {
+        const double *d = STRADA_AV_F64(av) + av->head;
+        double t = 0.0;
+        for (size_t i = 0; i < n; i++) t += d[i];
+        return strada_new_num(t);
+    }
+    if (av->kind == STRADA_AV_BYTE) {
+        const uint8_t *b = STRADA_AV_U8(av) + av->head;
+        uint64_t t = 0;
+        for (size_t i = 0; i < n; i++) t += b[i];
+        return strada_new_int((int64_t)t);
+    }
+    int64_t acc = 0;
+    double dacc = 0.0;
+    int is_int = 1;
+    size_t i = 0;
+    if (av->kind == STRADA_AV_INT) {
+        const int64_t *v = STRADA_AV_I64(av) + av->head;
+        for (; i < n; i++) {
+            int64_t t;
+            if (__builtin_add_overflow(acc, v[i], &t)) break;
+            acc = t;
+        }
+        if (i == n) return strada_new_int(acc);
+        dacc = (double)acc;
+        for (; i < n; i++) dacc += (double)v[i];
+        return strada_new_num(dacc);
+    }
+    for (; i < n; i++) {
+        StradaValue *e = av->elements[av->head + i];
+        int64_t t;
+        if (is_int && e && STRADA_IS_TAGGED_INT(e)
+            && !__builtin_add_overflow(acc, STRADA_TAGGED_INT_VAL(e), &t)) { acc = t; continue; }
+        if (is_int) { dacc = (double)acc; is_int = 0; }
+        dacc += e ? strada_to_num(e) : 0.0;
+    }
+    return is_int ? strada_new_int(acc) : strada_new_num(dacc);
+}
+
+static StradaValue *strada_list_minmax(StradaValue *sv, int want_max) {
+    StradaArray *av = strada_deref_array(sv);
+    if (!av || av->size == 0) return strada_new_undef();
+    size_t n = av->size;
+    if (av->kind == STRADA_AV_INT) {
+        const int64_t *v = STRADA_AV_I64(av) + av->head;
+        int64_t best = v[0];
+        for (size_t i = 1; i < n; i++)
+            best = want_max ? (v[i] > best ? v[i] : best) : (v[i] < best ? v[i] : best);
+        return strada_new_int(best);
+    }
+    if (av->kind == STRADA_AV_BYTE) {
+        const uint8_t *b = STRADA_AV_U8(av) + av->head;
+        uint8_t best = b[0];
+        for (size_t i = 1; i < n; i++)
+            best = want_max ? (b[i] > best ? b[i] : best) : (b[i] < best ? b[i] : best);
+        return STRADA_MAKE_TAGGED_INT(best);
+    }
+    if (av->kind == STRADA_AV_NUM) {
+        /* same rule as the boxed loop: replace while the candidate compares
+         * strictly better, so a NaN never wins past the first slot */
+        const double *d = STRADA_AV_F64(av) + av->head;
+        double best = d[0];
+        for (size_t i = 1; i < n; i++)
+            if (want_max ? d[i] > best : d[i] < best) best = d[i];
+        return strada_new_num(best);
+    }
+    StradaValue *best = NULL;
+    double bn = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        StradaValue *e = av->elements[av->head + i];
+        int best_def = best && (STRADA_IS_TAGGED_INT(best) || best->type != STRADA_UNDEF);
+        double en = e ? strada_to_num(e) : 0.0;
+        if (!best_def || (want_max ? en > bn : en < bn)) {
+            best = e ? e : strada_undef_static();
+            bn = en;
+        }
+    }
+    strada_incref(best);
+    return best;
+}
+
+StradaValue* strada_list_min(StradaValue *sv) { return strada_list_minmax(sv, 0); }
+StradaValue* strada_list_max(StradaValue *sv) { return strada_list_minmax(sv, 1); }
+
 static void strada_array_pool_cleanup(void) {
     for (int i = 0; i < strada_array_pool_count; i++) {
         array_free_backbone(strada_array_pool[i]);
@@ -2558,6 +4363,8 @@ StradaArray* strada_array_new(void) {
     av->head = 0;
     av->elements = calloc(av->capacity, sizeof(StradaValue*));
     av->refcount = 1;
+    av->kind = STRADA_AV_BOXED;
+    av->boxes = NULL;
     return av;
 }
 
@@ -2594,6 +4401,8 @@ StradaArray* strada_array_new_cap(size_t cap) {
         av->size = 0;
         av->head = 0;
         av->refcount = 1;
+        av->kind = STRADA_AV_BOXED;
+        av->boxes = NULL;
         return av;
     }
     StradaArray *av = malloc(sizeof(StradaArray));
@@ -2602,22 +4411,24 @@ StradaArray* strada_array_new_cap(size_t cap) {
     av->head = 0;
     av->elements = calloc(cap, sizeof(StradaValue*));
     av->refcount = 1;
+    av->kind = STRADA_AV_BOXED;
+    av->boxes = NULL;
     return av;
 }
 
 void strada_array_push(StradaArray *av, StradaValue *sv) {
     if (!av) return;
+    if (__builtin_expect(av->kind, 0)) {
+        av_packed_fit(av, av->size + 1);
+        av_packed_store(av, av->head + av->size++, sv);
+        return;
+    }
 
     if (av->head + av->size >= av->capacity) {
-        if (av->head > 0) {
-            /* Compact: move elements to start before growing */
-            memmove(av->elements, av->elements + av->head, av->size * sizeof(StradaValue*));
-            av->head = 0;
-        }
-        if (av->size >= av->capacity) {
-            av->capacity *= 2;
-            av->elements = array_grow_elems(av, av->capacity);
-        }
+        av_open_gap(av, av->size, 1);
+        av->elements[av->head + av->size - 1] = sv;
+        strada_incref(sv);
+        return;
     }
 
     av->elements[av->head + av->size] = sv;
@@ -2626,8 +4437,17 @@ void strada_array_push(StradaArray *av, StradaValue *sv) {
 }
 
 /* Deep copy an array - creates a new StradaValue wrapping a new StradaArray
-   with incref'd copies of each element. Follows references. Caller owns the returned value. */
+   with incref'd copies of each element. Follows references. Caller owns the returned value.
+   The copy is boxed: an untyped destination must accept any value, so a
+   packed source is boxed element by element. */
 StradaValue* strada_array_copy(StradaValue *src) {
+    return strada_array_copy_kind(src, STRADA_AV_BOXED);
+}
+
+/* Copy for a destination declared with element kind `kind` (my array<int>
+ * @c = @a): a packed source of the same kind is copied raw, anything else
+ * is copied boxed and then packed to the destination's kind. */
+StradaValue* strada_array_copy_kind(StradaValue *src, int kind) {
     StradaValue *dst = strada_new_array();
     if (!src || STRADA_IS_TAGGED_INT(src)) return dst;
     /* Follow reference chain to find the array */
@@ -2638,37 +4458,49 @@ StradaValue* strada_array_copy(StradaValue *src) {
     if (!current || STRADA_IS_TAGGED_INT(current) || current->type != STRADA_ARRAY || !current->value.av) return dst;
     StradaArray *sav = current->value.av;
     StradaArray *dav = dst->value.av;
+    if (sav->kind && sav->kind == kind) {
+        /* Same packed kind: one memcpy of the raw slots */
+        size_t es = av_slot_size(sav->kind);
+        av_make_packed(dav, sav->kind, sav->size);
+        memcpy(dav->elements, (char *)sav->elements + sav->head * es, sav->size * es);
+        dav->size = sav->size;
+        return dst;
+    }
     if (sav->size > 0) {
         if (sav->size > dav->capacity) {
             dav->capacity = sav->size;
             dav->elements = array_grow_elems(dav, dav->capacity);
         }
-        for (size_t i = 0; i < sav->size; i++) {
-            dav->elements[i] = sav->elements[sav->head + i];
-            strada_incref(sav->elements[sav->head + i]);
+        if (sav->kind) {
+            for (size_t i = 0; i < sav->size; i++)
+                dav->elements[i] = av_packed_box(sav, sav->head + i);
+        } else {
+            memcpy(dav->elements, sav->elements + sav->head, sav->size * sizeof(StradaValue*));
+            av_incref_run(dav->elements, sav->size);
         }
         dav->size = sav->size;
     }
+    if (kind > STRADA_AV_BOXED) strada_array_pack(dst, kind);
     return dst;
 }
 
 /* Push without incref - caller donates ownership of newly created value */
 void strada_array_push_take(StradaArray *av, StradaValue *sv) {
     if (!av) return;
+    if (__builtin_expect(av->kind, 0)) {
+        strada_array_push(av, sv);
+        strada_decref(sv);
+        return;
+    }
     if (!av->elements || av->capacity == 0) {
         av->capacity = 16;
         av->elements = calloc(av->capacity, sizeof(StradaValue*));
     }
 
     if (av->head + av->size >= av->capacity) {
-        if (av->head > 0) {
-            memmove(av->elements, av->elements + av->head, av->size * sizeof(StradaValue*));
-            av->head = 0;
-        }
-        if (av->size >= av->capacity) {
-            av->capacity *= 2;
-            av->elements = array_grow_elems(av, av->capacity);
-        }
+        av_open_gap(av, av->size, 1);
+        av->elements[av->head + av->size - 1] = sv;
+        return;
     }
 
     av->elements[av->head + av->size] = sv;
@@ -2679,11 +4511,16 @@ void strada_array_push_take(StradaArray *av, StradaValue *sv) {
 StradaValue* strada_array_pop(StradaArray *av) {
     if (!av || av->size == 0) return strada_new_undef();
     av->size--;
+    if (__builtin_expect(av->kind, 0)) return av_packed_remove(av, av->head + av->size);
     return av->elements[av->head + av->size];
 }
 
 StradaValue* strada_array_shift(StradaArray *av) {
     if (!av || av->size == 0) return strada_new_undef();
+    if (__builtin_expect(av->kind, 0)) {
+        av->size--;
+        return av_packed_remove(av, av->head++);
+    }
     StradaValue *result = av->elements[av->head];
     av->head++;
     av->size--;
@@ -2692,24 +4529,86 @@ StradaValue* strada_array_shift(StradaArray *av) {
 
 void strada_array_unshift(StradaArray *av, StradaValue *sv) {
     if (!av) return;
-
-    if (av->head > 0) {
-        /* O(1) path: use head space */
+    if (__builtin_expect(av->kind, 0)) {
+        if (av->head == 0) {
+            /* Open a front gap proportional to the size so a run of
+             * unshifts stays amortized O(1) per element. */
+            size_t es = av_slot_size(av->kind);
+            size_t gap = av->size < 8 ? 8 : av->size;
+            if (av->size + gap > av->capacity) av_packed_realloc(av, av->size + gap);
+            memmove((char *)av->elements + gap * es, av->elements, av->size * es);
+            if (av->boxes) {
+                memmove(av->boxes + gap, av->boxes, av->size * sizeof(StradaValue*));
+                memset(av->boxes, 0, gap * sizeof(StradaValue*));
+            }
+            av->head = gap;
+        }
         av->head--;
-        av->elements[av->head] = sv;
         av->size++;
-        strada_incref(sv);
+        av_packed_store(av, av->head, sv);
+        return;
+    }
+
+    /* Head room makes this O(1); av_open_gap leaves fresh head room
+     * proportional to the size when it runs out. */
+    av_open_gap(av, 0, 1);
+    av->elements[av->head] = sv;
+    strada_incref(sv);
+}
+
+static StradaValue *av_packed_splice(StradaArray *av, size_t off, size_t len, StradaValue *repl_sv);
+
+/* Insert n elements of src, from its index from, at logical index at of
+ * the boxed array av (src != av). */
+static void av_insert_run(StradaArray *av, size_t at, StradaArray *src, size_t from, size_t n) {
+    av_open_gap(av, at, n);
+    StradaValue **dst = av->elements + av->head + at;
+    if (src->kind) {
+        for (size_t i = 0; i < n; i++) dst[i] = av_at(src, from + i);
     } else {
-        /* Fallback: need to memmove */
-        if (av->head + av->size >= av->capacity) {
-            av->capacity *= 2;
-            av->elements = array_grow_elems(av, av->capacity);
+        memcpy(dst, src->elements + src->head + from, n * sizeof(StradaValue*));
+    }
+    av_incref_run(dst, n);
+}
+
+/* Insert the elements of src before logical index at of av (clamped to
+ * the size), taking a reference to each. src may be av itself. */
+void strada_array_insert_av(StradaArray *av, size_t at, StradaArray *src) {
+    if (!av || !src || src->size == 0) return;
+    size_t n = src->size;
+    if (at > av->size) at = av->size;
+    if (__builtin_expect(av->kind, 0)) {
+        if (at == av->size) {
+            av_packed_fit(av, av->size + n);
+            for (size_t i = 0; i < n; i++)
+                av_packed_store(av, av->head + av->size + i, av_at(src, i));
+            av->size += n;
+        } else {
+            StradaValue *tmp = strada_new_array();
+            strada_array_insert_av(tmp->value.av, 0, src);
+            strada_decref(av_packed_splice(av, at, 0, tmp));
+            strada_decref(tmp);
         }
-        memmove(av->elements + 1, av->elements, av->size * sizeof(StradaValue*));
-        av->elements[0] = sv;
-        av->size++;
-        strada_incref(sv);
+        return;
+    }
+    if (src == av) {
+        /* The originals sit on both sides of the gap: copy each run in */
+        av_open_gap(av, at, n);
+        StradaValue **e = av->elements + av->head;
+        memcpy(e + at, e, at * sizeof(StradaValue*));
+        memcpy(e + 2 * at, e + at + n, (n - at) * sizeof(StradaValue*));
+        av_incref_run(e + at, n);
+        return;
     }
+    av_insert_run(av, at, src, 0, n);
+}
+
+void strada_array_append_av(StradaArray *av, StradaArray *src) {
+    if (av) strada_array_insert_av(av, av->size, src);
+}
+
+void strada_array_prepend_av(StradaArray *av, StradaArray *src) {
+    strada_array_insert_av(av, 0, src);
 }
 
 StradaValue* strada_array_get(StradaArray *av, int64_t idx) {
@@ -2729,6 +4628,7 @@ StradaValue* strada_array_get(StradaArray *av, int64_t idx) {
 
     /* Check bounds */
     if (idx < 0 || (size_t)idx >= av->size) return strada_undef_static();
+    if (__builtin_expect(av->kind, 0)) return av_packed_lend(av, av->head + idx);
 
     StradaValue *e = av->elements[av->head + idx];
     /* NULL slot = deleted (via strada_array_delete_idx). Return the
@@ -2752,6 +4652,7 @@ StradaValue* strada_array_get_owned(StradaArray *av, int64_t idx) {
         idx = (int64_t)av->size + idx;
     }
     if (idx < 0 || (size_t)idx >= av->size) return strada_new_undef();
+    if (__builtin_expect(av->kind, 0)) return av_packed_take(av, av->head + idx);
     StradaValue *e = av->elements[av->head + idx];
     if (!e) return strada_undef_static();
     strada_incref(e);
@@ -2764,6 +4665,7 @@ int strada_array_exists_idx(StradaArray *av, int64_t idx) {
     if (!av) return 0;
     if (idx < 0) idx = (int64_t)av->size + idx;
     if (idx < 0 || (size_t)idx >= av->size) return 0;
+    if (av->kind) return 1;  /* packed arrays have no holes */
     return av->elements[av->head + idx] != NULL ? 1 : 0;
 }
 
@@ -2776,6 +4678,15 @@ StradaValue* strada_array_delete_idx(StradaArray *av, int64_t idx) {
     if (!av) return strada_undef_static();
     if (idx < 0) idx = (int64_t)av->size + idx;
     if (idx < 0 || (size_t)idx >= av->size) return strada_undef_static();
+    if (av->kind) {
+        /* No holes in packed storage: the slot reads back as 0, and
+         * deleting the last element shortens the array. */
+        size_t pos = av->head + idx;
+        StradaValue *old = av_packed_remove(av, pos);
+        if ((size_t)idx == av->size - 1) av->size--;
+        else memset((char *)av->elements + pos * av_slot_size(av->kind), 0, av_slot_size(av->kind));
+        return old;
+    }
     StradaValue *old = av->elements[av->head + idx];
     av->elements[av->head + idx] = NULL;
     /* If we deleted the last live element, shrink — and trim any
@@ -2796,47 +4707,10 @@ StradaValue* strada_hash_delete_take(StradaHash *hv, const char *key) {
     if (!hv || !key) return strada_undef_static();
 
     unsigned int hash = strada_hash_string(key);
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            if (hash_linear_find(hv, key, key_len, hash) < 0) return strada_undef_static();
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-            continue;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                StradaValue *val = e->value;
-                hv->hash_index[pos] = HASH_TOMBSTONE;
-                ss_decref(e->key);
-                e->key = NULL; e->value = NULL;
-                e->next = hv->free_head; hv->free_head = idx;
-                hv->num_entries--;
-                hv->num_tombstones++;
-                return val ? val : strada_undef_static();
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            if (hash_linear_find(hv, key, key_len, hash) < 0) return strada_undef_static();
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-        }
-    }
-}
-
-StradaValue* strada_hash_delete_take_sv(StradaHash *hv, StradaValue *key_sv) {
-    if (!hv || !key_sv) return strada_undef_static();
-    char *ks = strada_to_str(key_sv);
-    StradaValue *v = strada_hash_delete_take(hv, ks);
-    free(ks);
-    return v;
+    int64_t b = hv_find_bucket(hv, key, (uint32_t)strlen(key), hash);
+    if (b < 0) return strada_undef_static();
+    StradaValue *val = hv_remove_bucket(hv, (size_t)b);
+    return val ? val : strada_undef_static();
 }
 
 /* Get array element from StradaValue* - safe for destructuring.
@@ -2862,6 +4736,7 @@ StradaValue* strada_array_get_safe(StradaValue *arr, int64_t idx) {
     if (real_idx < 0 || real_idx >= (int64_t)av->size) {
         return strada_new_undef();
     }
+    if (av->kind) return av_packed_take(av, av->head + real_idx);
 
     StradaValue *elem = av->elements[av->head + real_idx];
     strada_incref(elem);
@@ -2881,6 +4756,17 @@ void strada_array_set(StradaArray *av, int64_t idx, StradaValue *sv) {
 
     size_t uidx = (size_t)idx;
 
+    if (__builtin_expect(av->kind, 0)) {
+        if (uidx >= av->size) {
+            size_t es = av_slot_size(av->kind);
+            av_packed_fit(av, uidx + 1);
+            memset((char *)av->elements + (av->head + av->size) * es, 0, (uidx + 1 - av->size) * es);
+            av->size = uidx + 1;
+        }
+        av_packed_store(av, av->head + uidx, sv);
+        return;
+    }
+
     /* Extend array if necessary */
     while (av->head + uidx >= av->capacity) {
         if (av->head > 0 && uidx < av->capacity) {
@@ -2922,6 +4808,23 @@ size_t strada_array_length(StradaArray *av) {
 /* Reverse array in-place */
 void strada_array_reverse(StradaArray *av) {
     if (!av || av->size < 2) return;
+    if (av->kind) {
+        size_t l = av->head, r = av->head + av->size - 1;
+        for (; l < r; l++, r--) {
+            if (av->kind == STRADA_AV_BYTE) {
+                uint8_t t = STRADA_AV_U8(av)[l];
+                STRADA_AV_U8(av)[l] = STRADA_AV_U8(av)[r]; STRADA_AV_U8(av)[r] = t;
+            } else {
+                int64_t t = STRADA_AV_I64(av)[l];
+                STRADA_AV_I64(av)[l] = STRADA_AV_I64(av)[r]; STRADA_AV_I64(av)[r] = t;
+            }
+            if (av->boxes) {
+                StradaValue *b = av->boxes[l];
+                av->boxes[l] = av->boxes[r]; av->boxes[r] = b;
+            }
+        }
+        return;
+    }
 
     size_t left = av->head;
     size_t right = av->head + av->size - 1;
@@ -2957,9 +4860,23 @@ void strada_set_hash_default_capacity(int64_t capacity) {
     }
 }
 
-/* Reserve capacity for an existing array (pre-allocate without changing size) */
+/* Reserve capacity for an existing array (pre-allocate without changing size).
+ * Head room left by shift doesn't count: it's given back first, so
+ * `capacity` elements fit without reallocating. */
 void strada_array_reserve(StradaArray *av, size_t capacity) {
-    if (!av || capacity <= av->capacity) return;
+    if (!av || capacity <= av->capacity - av->head) return;
+    if (av->kind) {
+        if (capacity <= SIZE_MAX / sizeof(StradaValue*)) {
+            av_packed_compact(av);
+            if (capacity > av->capacity) av_packed_realloc(av, capacity);
+        }
+        return;
+    }
+    if (av->head > 0) {
+        memmove(av->elements, av->elements + av->head, av->size * sizeof(StradaValue*));
+        av->head = 0;
+        if (capacity <= av->capacity) return;
+    }
 
     /* Guard the multiplication: for capacity >= SIZE_MAX/sizeof(ptr) the size
      * arg wraps and realloc returns a tiny buffer while the zero-fill loop
@@ -3004,6 +4921,38 @@ void strada_reserve_sv(StradaValue *sv, int64_t capacity) {
     }
 }
 
+/* Give back unused capacity: the live range moves to position 0 and the
+ * buffer is cut to the size (one slot when empty). A compact array's
+ * inline buffer is part of its header block and stays. */
+void strada_array_shrink(StradaArray *av) {
+    if (!av) return;
+    size_t cap = av->size ? av->size : 1;
+    if (av->kind) {
+        av_packed_compact(av);
+        if (cap < av->capacity) av_packed_realloc(av, cap);
+        return;
+    }
+    if (array_elems_inline(av)) return;
+    if (av->head > 0) {
+        memmove(av->elements, av->elements + av->head, av->size * sizeof(StradaValue*));
+        av->head = 0;
+    }
+    if (cap < av->capacity) {
+        av->elements = sr_xrealloc(av->elements, cap * sizeof(StradaValue*));
+        av->capacity = cap;
+    }
+}
+
+/* shrink_to_fit(@arr) (handles refs) */
+void strada_shrink_to_fit_sv(StradaValue *sv) {
+    if (!sv || STRADA_IS_TAGGED_INT(sv)) return;
+    if (sv->type == STRADA_REF && sv->value.rv && sv->value.rv->type == STRADA_ARRAY) {
+        strada_array_shrink(sv->value.rv->value.av);
+    } else if (sv->type == STRADA_ARRAY && sv->value.av) {
+        strada_array_shrink(sv->value.av);
+    }
+}
+
 /* Generic size function - works with arrays, hashes, and references to them */
 int64_t strada_size(StradaValue *sv) {
     if (!sv || STRADA_IS_TAGGED_INT(sv)) return 0;
@@ -3025,6 +4974,10 @@ int64_t strada_size(StradaValue *sv) {
     }
 }
 
+/* Parallel merge sort over the thread pool (defined with the pool) */
+static int strada_par_sort_wanted(size_t n);
+static int strada_par_sort(void **base, size_t n, int (*cmp)(const void *, const void *));
+
 /* Comparison function for qsort - alphabetical (string) sort */
 static int strada_sort_cmp_str(const void *a, const void *b) {
     StradaValue *va = *(StradaValue **)a;
@@ -3083,6 +5036,10 @@ static int strada_sort_cmp_decor(const void *a, const void *b) {
     return 0;
 }
 
+static int strada_sort_cmp_decor_ptr(const void *a, const void *b) {
+    return strada_sort_cmp_decor(*(StradaSortDecor *const *)a, *(StradaSortDecor *const *)b);
+}
+
 static void strada_sort_str_inplace(StradaArray *av) {
     size_t n = av->size;
     if (n < 2) return;
@@ -3095,7 +5052,8 @@ static void strada_sort_str_inplace(StradaArray *av) {
         }
     }
     if (all_str) {
-        qsort(av->elements + av->head, n, sizeof(StradaValue*), strada_sort_cmp_str);
+        if (!strada_par_sort((void **)(av->elements + av->head), n, strada_sort_cmp_str))
+            qsort(av->elements + av->head, n, sizeof(StradaValue*), strada_sort_cmp_str);
         return;
     }
     StradaSortDecor *d = sr_xmalloc(n * sizeof(StradaSortDecor));
@@ -3112,11 +5070,19 @@ static void strada_sort_str_inplace(StradaArray *av) {
             d[i].len = strlen(d[i].owned);
         }
     }
-    qsort(d, n, sizeof(StradaSortDecor), strada_sort_cmp_decor);
-    for (size_t i = 0; i < n; i++) {
-        av->elements[av->head + i] = d[i].sv;
-        if (d[i].owned) free(d[i].owned);
+    if (strada_par_sort_wanted(n)) {
+        /* The parallel sort moves pointer-sized slots: sort record pointers */
+        StradaSortDecor **dp = sr_xmalloc(n * sizeof(StradaSortDecor *));
+        for (size_t i = 0; i < n; i++) dp[i] = &d[i];
+        strada_par_sort((void **)dp, n, strada_sort_cmp_decor_ptr);
+        for (size_t i = 0; i < n; i++) av->elements[av->head + i] = dp[i]->sv;
+        free(dp);
+    } else {
+        qsort(d, n, sizeof(StradaSortDecor), strada_sort_cmp_decor);
+        for (size_t i = 0; i < n; i++) av->elements[av->head + i] = d[i].sv;
     }
+    for (size_t i = 0; i < n; i++)
+        if (d[i].owned) free(d[i].owned);
     free(d);
 }
 
@@ -3194,9 +5160,15 @@ StradaValue* strada_sort(StradaValue *arr) {
     StradaValue *result = strada_new_array();
     StradaArray *result_av = result->value.av;
 
-    /* Copy elements to result */
-    for (size_t i = 0; i < av->size; i++) {
-        strada_array_push(result_av, av->elements[av->head + i]);
+    /* Copy elements to result (a packed source boxes each slot: string
+     * order needs the formatted values anyway) */
+    if (av->kind) {
+        for (size_t i = 0; i < av->size; i++)
+            strada_array_push_take(result_av, av_packed_take(av, av->head + i));
+    } else {
+        for (size_t i = 0; i < av->size; i++) {
+            strada_array_push(result_av, av->elements[av->head + i]);
+        }
     }
 
     /* Sort in place — decorate-sort-undecorate when any element needs
@@ -3207,6 +5179,43 @@ StradaValue* strada_sort(StradaValue *arr) {
     return result;
 }
 
+static int strada_sort_cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int strada_sort_cmp_f64(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Numeric sort of a packed array: the result is a packed array of the same
+ * kind, sorted on the raw slots (bytes by counting). */
+static StradaValue *strada_nsort_packed(StradaArray *av) {
+    StradaValue *result = strada_new_array();
+    StradaArray *rav = result->value.av;
+    size_t n = av->size;
+    av_make_packed(rav, av->kind, n);
+    rav->size = n;
+    if (av->kind == STRADA_AV_BYTE) {
+        size_t count[256] = {0};
+        const uint8_t *src = STRADA_AV_U8(av) + av->head;
+        for (size_t i = 0; i < n; i++) count[src[i]]++;
+        uint8_t *dst = STRADA_AV_U8(rav);
+        for (int b = 0; b < 256; b++) {
+            memset(dst, b, count[b]);
+            dst += count[b];
+        }
+        return result;
+    }
+    memcpy(rav->elements, STRADA_AV_I64(av) + av->head, n * sizeof(int64_t));
+    int (*cmp)(const void *, const void *) =
+        av->kind == STRADA_AV_INT ? strada_sort_cmp_i64 : strada_sort_cmp_f64;
+    if (sizeof(int64_t) != sizeof(void *) || !strada_par_sort((void **)rav->elements, n, cmp))
+        qsort(rav->elements, n, sizeof(int64_t), cmp);
+    return result;
+}
+
 /* Sort array numerically */
 StradaValue* strada_nsort(StradaValue *arr) {
     if (!arr || STRADA_IS_TAGGED_INT(arr)) {
@@ -3224,6 +5233,7 @@ StradaValue* strada_nsort(StradaValue *arr) {
     if (!av || av->size == 0) {
         return strada_new_array();
     }
+    if (av->kind) return strada_nsort_packed(av);
 
     /* Create a new array with sorted elements */
     StradaValue *result = strada_new_array();
@@ -3234,12 +5244,172 @@ StradaValue* strada_nsort(StradaValue *arr) {
         strada_array_push(result_av, av->elements[av->head + i]);
     }
 
-    /* Sort in place */
-    qsort(result_av->elements + result_av->head, result_av->size, sizeof(StradaValue*), strada_sort_cmp_num);
+    /* Sort in place. Only plain numbers and strings go parallel:
+     * strada_to_num on a tied or overloaded value runs Strada code. */
+    StradaValue **el = result_av->elements + result_av->head;
+    size_t n = result_av->size;
+    int plain = strada_par_sort_wanted(n);
+    for (size_t i = 0; plain && i < n; i++) {
+        StradaValue *v = el[i];
+        if (v && !STRADA_IS_TAGGED_INT(v) && (v->meta || (v->type != STRADA_INT &&
+                v->type != STRADA_NUM && v->type != STRADA_STR)))
+            plain = 0;
+    }
+    if (!plain || !strada_par_sort((void **)el, n, strada_sort_cmp_num))
+        qsort(el, n, sizeof(StradaValue*), strada_sort_cmp_num);
 
     return result;
 }
 
+/* Key-extraction sort: the compiled form of comparator blocks that only
+ * compare one function of each element — `KEY($a) <=> KEY($b)`, `cmp`,
+ * the reversed `KEY($b) <=> KEY($a)`, and `||` chains of those. The
+ * generated code evaluates every KEY once per element into cols[k], then
+ * calls this to reorder result's elements. spec has one letter per key:
+ * 'n' (double) and 'i' (int64) columns are strada_sortbuf_new buffers of
+ * 8-byte slots, 's' is an array of string keys; upper case sorts that key
+ * descending. Keys are applied last to first, each by a stable pass, so
+ * elements equal on every key keep their input order like the merge sort
+ * they replace. */
+typedef struct {
+    uint64_t key;
+    size_t idx;
+} StradaKeyRadix;
+
+typedef struct {
+    const char *p;
+    size_t len;
+    size_t pos;    /* position before this pass: the tie-break */
+    size_t idx;
+    char *owned;
+} StradaKeyStr;
+
+/* LSD radix sort of perm by a numeric column. Keys map to uint64 images
+ * that order like the numbers (sign bit flipped for int64; for doubles,
+ * negatives inverted and positives sign-flagged), so each pass is a
+ * stable byte-wise counting sort. Passes whose byte is the same for every
+ * key are skipped: small ints cost two or three passes, not eight. */
+static void strada_keysort_radix(size_t *perm, size_t n, const void *col, char kind) {
+    StradaKeyRadix *a = sr_xmalloc(n * sizeof(StradaKeyRadix));
+    StradaKeyRadix *b = sr_xmalloc(n * sizeof(StradaKeyRadix));
+    size_t count[8][256];
+    memset(count, 0, sizeof(count));
+    int desc = kind == 'N' || kind == 'I';
+    for (size_t j = 0; j < n; j++) {
+        size_t idx = perm[j];
+        uint64_t u;
+        if (kind == 'i' || kind == 'I') {
+            u = (uint64_t)((const int64_t *)col)[idx] ^ ((uint64_t)1 << 63);
+        } else {
+            double d = ((const double *)col)[idx];
+            if (d == 0) d = 0.0;   /* -0.0 ties with 0.0, as with <=> */
+            memcpy(&u, &d, sizeof(u));
+            u = (u >> 63) ? ~u : u | ((uint64_t)1 << 63);
+        }
+        if (desc) u = ~u;
+        a[j].key = u;
+        a[j].idx = idx;
+        for (int d = 0; d < 8; d++) count[d][(u >> (8 * d)) & 0xff]++;
+    }
+    for (int d = 0; d < 8; d++) {
+        size_t *c = count[d];
+        if (c[(a[0].key >> (8 * d)) & 0xff] == n) continue;
+        size_t off = 0;
+        for (int v = 0; v < 256; v++) {
+            size_t k = c[v];
+            c[v] = off;
+            off += k;
+        }
+        for (size_t j = 0; j < n; j++) b[c[(a[j].key >> (8 * d)) & 0xff]++] = a[j];
+        StradaKeyRadix *t = a; a = b; b = t;
+    }
+    for (size_t j = 0; j < n; j++) perm[j] = a[j].idx;
+    free(a);
+    free(b);
+}
+
+static int strada_keysort_cmp_str(const void *a, const void *b) {
+    const StradaKeyStr *ka = (const StradaKeyStr *)a;
+    const StradaKeyStr *kb = (const StradaKeyStr *)b;
+    size_t n = ka->len < kb->len ? ka->len : kb->len;
+    int r = memcmp(ka->p, kb->p, n);
+    if (r == 0) r = (ka->len > kb->len) - (ka->len < kb->len);
+    if (r == 0) r = (ka->pos > kb->pos) - (ka->pos < kb->pos);
+    return r;
+}
+
+static int strada_keysort_cmp_str_desc(const void *a, const void *b) {
+    const StradaKeyStr *ka = (const StradaKeyStr *)a;
+    const StradaKeyStr *kb = (const StradaKeyStr *)b;
+    size_t n = ka->len < kb->len ? ka->len : kb->len;
+    int r = memcmp(kb->p, ka->p, n);
+    if (r == 0) r = (kb->len > ka->len) - (kb->len < ka->len);
+    if (r == 0) r = (ka->pos > kb->pos) - (ka->pos < kb->pos);
+    return r;
+}
+
+static int strada_keysort_cmp_str_ptr(const void *a, const void *b) {
+    return strada_keysort_cmp_str(*(StradaKeyStr *const *)a, *(StradaKeyStr *const *)b);
+}
+
+static int strada_keysort_cmp_str_desc_ptr(const void *a, const void *b) {
+    return strada_keysort_cmp_str_desc(*(StradaKeyStr *const *)a, *(StradaKeyStr *const *)b);
+}
+
+/* Sort perm by a string column: memcmp order, then input position, which
+ * makes qsort (and the parallel sort) stable. */
+static void strada_keysort_str(size_t *perm, size_t n, StradaArray *col, int desc) {
+    StradaKeyStr *k = sr_xmalloc(n * sizeof(StradaKeyStr));
+    for (size_t j = 0; j < n; j++) {
+        StradaValue *sv = col->elements[col->head + perm[j]];
+        k[j].pos = j;
+        k[j].idx = perm[j];
+        if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv) {
+            k[j].p = sv->value.pv;
+            k[j].len = STRADA_STR_BYTELEN(sv);
+            k[j].owned = NULL;
+        } else {
+            k[j].owned = strada_to_str(sv);
+            k[j].p = k[j].owned;
+            k[j].len = strlen(k[j].owned);
+        }
+    }
+    if (strada_par_sort_wanted(n)) {
+        StradaKeyStr **kp = sr_xmalloc(n * sizeof(StradaKeyStr *));
+        for (size_t j = 0; j < n; j++) kp[j] = &k[j];
+        strada_par_sort((void **)kp, n, desc ? strada_keysort_cmp_str_desc_ptr : strada_keysort_cmp_str_ptr);
+        for (size_t j = 0; j < n; j++) perm[j] = kp[j]->idx;
+        free(kp);
+    } else {
+        qsort(k, n, sizeof(StradaKeyStr), desc ? strada_keysort_cmp_str_desc : strada_keysort_cmp_str);
+        for (size_t j = 0; j < n; j++) perm[j] = k[j].idx;
+    }
+    for (size_t j = 0; j < n; j++)
+        if (k[j].owned) free(k[j].owned);
+    free(k);
+}
+
+void strada_keysort(StradaValue *result, const char *spec, StradaValue **cols) {
+    StradaArray *rav = strada_deref_array(result);
+    size_t n = rav ? rav->size : 0;
+    if (n < 2) return;
+    size_t *perm = sr_xmalloc(n * sizeof(size_t));
+    for (size_t j = 0; j < n; j++) perm[j] = j;
+    for (int k = (int)strlen(spec) - 1; k >= 0; k--) {
+        char kind = spec[k];
+        if (kind == 's' || kind == 'S')
+            strada_keysort_str(perm, n, cols[k]->value.av, kind == 'S');
+        else
+            strada_keysort_radix(perm, n, cols[k]->value.ptr, kind);
+    }
+    StradaValue **el = rav->elements + rav->head;
+    StradaValue **orig = sr_xmalloc(n * sizeof(StradaValue *));
+    memcpy(orig, el, n * sizeof(StradaValue *));
+    for (size_t j = 0; j < n; j++) el[j] = orig[perm[j]];
+    free(orig);
+    free(perm);
+}
+
 /* Create array from range (start..end) */
 StradaValue* strada_range(StradaValue *start, StradaValue *end) {
     StradaValue *result = strada_new_array();
@@ -3528,18 +5698,23 @@ static unsigned int strada_hash_string(const char *str) {
     return hash;
 }
 
-/* Resize hash table when load factor exceeds threshold */
+/* Resize hash table when live + deleted buckets pass the 7/8 load limit */
 static void strada_hash_resize(StradaHash *hv) {
     if (!hv) return;
-    size_t new_buckets = hv->num_buckets * 2;
-    /* Check if hash_index is part of a compact block (can't realloc) */
-    int is_compact = (hv->hash_index == (uint32_t*)((char*)hv + sizeof(StradaHash)));
-    if (is_compact) {
-        hv->hash_index = malloc(new_buckets * sizeof(uint32_t));
-    } else {
-        hv->hash_index = sr_xrealloc(hv->hash_index, new_buckets * sizeof(uint32_t));
+    /* With live entries under half the limit it was DELETED markers that
+     * filled the table; a same-size rebuild clears them. */
+    if (hv->num_entries * 16 > hv->num_buckets * 7) {
+        size_t new_buckets = hv->num_buckets * 2;
+        if (hv_idx_in_block(hv) && new_buckets <= HASH_SMALL_BUCKETS) {
+            /* The compact block has room for HASH_SMALL_BUCKETS */
+            hv_index_attach(hv, hv->ctrl, new_buckets);
+        } else {
+            void *block = sr_xmalloc(hv_index_bytes(new_buckets));
+            /* The compact block's index can't be freed on its own */
+            if (!hv_idx_in_block(hv)) free(hv->ctrl);
+            hv_index_attach(hv, block, new_buckets);
+        }
     }
-    hv->num_buckets = new_buckets;
     hash_rebuild_index(hv);
 }
 
@@ -3555,15 +5730,13 @@ static void strada_hash_pool_cleanup(void) {
 }
 
 static inline void strada_hash_init(StradaHash *hv, size_t nbuckets) {
-    hv->num_buckets = nbuckets;
     hv->num_entries = 0;
     hv->num_tombstones = 0;
     hv->entries = NULL;
     hv->capacity = 0;
     hv->next_slot = 0;
     hv->free_head = HASH_EMPTY;
-    hv->hash_index = malloc(nbuckets * sizeof(uint32_t));
-    memset(hv->hash_index, 0xFF, nbuckets * sizeof(uint32_t));
+    hv_index_attach(hv, sr_xmalloc(hv_index_bytes(nbuckets)), nbuckets);
     hv->refcount = 1;
     hv->iter_index = 0;
     hv->index_dirty = 0;
@@ -3583,6 +5756,7 @@ static void strada_register_pool_atexits(void) {
     atexit(strada_intern_cleanup);
     atexit(ss_pool_cleanup);
     atexit(strada_sv_pool_cleanup);
+    atexit(strada_sso_pool_cleanup);
     atexit(strada_array_pool_cleanup);
     atexit(strada_meta_pool_cleanup);
     atexit(strada_hash_pool_cleanup);
@@ -3600,6 +5774,11 @@ StradaHash* strada_hash_new(void) {
     /* Fallback for callers reached before the constructor (extremely rare —
      * a static initializer in another TU calling into our runtime). */
     strada_register_pool_atexits();
+    /* At the default size a new hash is one compact block: struct, an
+     * 8-bucket index (a single group, so a lookup is one 16-byte tag
+     * compare over inline control bytes) and 4 inline entries. */
+    if (strada_default_hash_capacity <= HASH_SMALL_BUCKETS)
+        return strada_hash_new_presized(HASH_SMALL_BUCKETS * 7 / 8);
     StradaHash *hv = malloc(sizeof(StradaHash));
     strada_hash_init(hv, strada_default_hash_capacity);
     return hv;
@@ -3618,10 +5797,10 @@ static void hv_release_storage_and_struct(StradaHash *hv) {
     int idx_in = hv_idx_in_block(hv);
     int ent_in = hv_ent_in_block(hv);
     if (hv->entries && !ent_in) free(hv->entries);
-    if (hv->hash_index && !idx_in) free(hv->hash_index);
+    if (hv->ctrl && !idx_in) free(hv->ctrl);
     if (idx_in && hash_pool_small_count < HASH_POOL_MAX) {
         hv->entries = (StradaHashEntry*)((char*)hv + sizeof(StradaHash)
-                                         + HASH_SMALL_BUCKETS * sizeof(uint32_t));
+                                         + HASH_COMPACT_INDEX_BYTES);
         hv->capacity = HASH_COMPACT_ENTRIES;
 #ifdef STRADA_POOL_POISON
         /* CC-HUNT: poison everything EXCEPT the fields reuse re-derives, so
@@ -3632,7 +5811,7 @@ static void hv_release_storage_and_struct(StradaHash *hv) {
         hv->num_tombstones = 0xDDDDDDDD;
         hv->free_head = 0xDDDDDDDD;
         hv->iter_index = 0xDDDDDDDD;
-        memset(hv->hash_index, 0xDD, HASH_SMALL_BUCKETS * sizeof(uint32_t));
+        memset(hv->ctrl, 0xDD, HASH_COMPACT_INDEX_BYTES);
         memset(hv->entries, 0xDD, HASH_COMPACT_ENTRIES * sizeof(StradaHashEntry));
 #endif
         hash_pool_small[hash_pool_small_count++] = hv;
@@ -3644,24 +5823,17 @@ static void hv_release_storage_and_struct(StradaHash *hv) {
 
 StradaHash* strada_hash_new_presized(int capacity) {
     StradaHash *hv;
-    /* With open addressing (50% load factor), need at least 2x capacity for buckets */
-    int min_buckets = capacity * 2;
-    if (min_buckets < 4) min_buckets = 4;
-    /* Round up to next power of 2 */
-    int nbuckets = 4;
-    while (nbuckets < min_buckets) nbuckets *= 2;
+    size_t nbuckets = hv_buckets_for(capacity > 0 ? (size_t)capacity : 0);
 
     if (nbuckets <= HASH_SMALL_BUCKETS && hash_pool_small_count > 0) {
         hv = hash_pool_small[--hash_pool_small_count];
         /* Pooled hashes already have their compact block — just reinit.
          * Defensively re-derive the in-block pointers (free_hash restores
          * them when entries had been realloc'd out; keep both sides safe). */
-        hv->hash_index = (uint32_t*)((char*)hv + sizeof(StradaHash));
+        hv_index_attach(hv, (char*)hv + sizeof(StradaHash), nbuckets);
         hv->entries = (StradaHashEntry*)((char*)hv + sizeof(StradaHash)
-                                         + HASH_SMALL_BUCKETS * sizeof(uint32_t));
+                                         + HASH_COMPACT_INDEX_BYTES);
         hv->capacity = HASH_COMPACT_ENTRIES;
-        memset(hv->hash_index, 0xFF, nbuckets * sizeof(uint32_t));
-        hv->num_buckets = nbuckets;
         hv->num_entries = 0;
         hv->num_tombstones = 0;
         hv->next_slot = 0;
@@ -3672,20 +5844,18 @@ StradaHash* strada_hash_new_presized(int capacity) {
         return hv;
     }
 
-    /* Single allocation: StradaHash + index[HASH_SMALL_BUCKETS] + entries[COMPACT_ENTRIES].
-     * Always allocate at the max compact size so any pooled block is reusable
-     * for any request <= HASH_SMALL_BUCKETS — pop-shape-mismatch is impossible. */
+    /* Single allocation: StradaHash + ctrl[16] + index[HASH_SMALL_BUCKETS] +
+     * entries[COMPACT_ENTRIES]. Always allocate at the max compact size so
+     * any pooled block is reusable for any request <= HASH_SMALL_BUCKETS —
+     * pop-shape-mismatch is impossible. */
     if (nbuckets <= HASH_SMALL_BUCKETS) {
-        size_t idx_size = HASH_SMALL_BUCKETS * sizeof(uint32_t);
         size_t ent_size = HASH_COMPACT_ENTRIES * sizeof(StradaHashEntry);
-        char *block = malloc(sizeof(StradaHash) + idx_size + ent_size);
+        char *block = sr_xmalloc(sizeof(StradaHash) + HASH_COMPACT_INDEX_BYTES + ent_size);
         hv = (StradaHash*)block;
-        hv->hash_index = (uint32_t*)(block + sizeof(StradaHash));
-        hv->entries = (StradaHashEntry*)(block + sizeof(StradaHash) + idx_size);
+        hv_index_attach(hv, block + sizeof(StradaHash), nbuckets);
+        hv->entries = (StradaHashEntry*)(block + sizeof(StradaHash) + HASH_COMPACT_INDEX_BYTES);
         hv->capacity = HASH_COMPACT_ENTRIES;
-        memset(hv->hash_index, 0xFF, nbuckets * sizeof(uint32_t));
         memset(hv->entries, 0, ent_size);
-        hv->num_buckets = nbuckets;
         hv->num_entries = 0;
         hv->num_tombstones = 0;
         hv->next_slot = 0;
@@ -3707,68 +5877,15 @@ void strada_hash_set(StradaHash *hv, const char *key, StradaValue *sv) {
 
     unsigned int hash = strada_hash_string(key);
     uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    uint32_t first_tombstone = HASH_EMPTY;
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            /* Self-heal: linear-scan in case the key already exists in
-             * entries[] but hash_index lost track (cross-boundary
-             * dispatch corruption). Without this, set on an existing key
-             * inserts a duplicate, leaving the old entry orphaned. */
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-        if (idx == HASH_TOMBSTONE) {
-            if (first_tombstone == HASH_EMPTY) first_tombstone = pos;
-        } else {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-    }
-
-    /* Insert at first tombstone if found, else at empty slot */
-    uint32_t insert_pos = (first_tombstone != HASH_EMPTY) ? first_tombstone : pos;
-    if (first_tombstone != HASH_EMPTY) hv->num_tombstones--;
-
-    uint32_t slot = hash_get_slot(hv);
-    StradaHashEntry *e = &hv->entries[slot];
-    e->key = ss_new(key, key_len, hash);
-    e->value = sv;
+    size_t ins;
+    StradaHashEntry *e = hv_find_for_insert(hv, key, key_len, hash, &ins);
     strada_incref(sv);
-    hv->hash_index[insert_pos] = slot;
-    hv->num_entries++;
-
-    if ((hv->num_entries + hv->num_tombstones) * 2 > hv->num_buckets) {
-        strada_hash_resize(hv);
+    if (e) {
+        strada_decref(e->value);
+        e->value = sv;
+        return;
     }
+    hv_insert_at(hv, ins, ss_new(key, key_len, hash), sv);
 }
 
 /* strada_hash_set_take - set hash entry, taking ownership (no incref on new value) */
@@ -3777,56 +5894,15 @@ void strada_hash_set(StradaHash *hv, const char *key, StradaValue *sv) {
 void strada_hash_set_take_ph(StradaHash *hv, const char *key, unsigned int hash, StradaValue *sv) {
     if (!hv || !key) return;
 
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    uint32_t first_tombstone = HASH_EMPTY;
     uint32_t key_len = (uint32_t)strlen(key);
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-        if (idx == HASH_TOMBSTONE) {
-            if (first_tombstone == HASH_EMPTY) first_tombstone = pos;
-        } else {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && strcmp(e->key->data, key) == 0) {
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-    }
-    uint32_t insert_pos = (first_tombstone != HASH_EMPTY) ? first_tombstone : pos;
-    if (first_tombstone != HASH_EMPTY) hv->num_tombstones--;
-    uint32_t slot = hash_get_slot(hv);
-    StradaHashEntry *e = &hv->entries[slot];
-    e->key = ss_new(key, strlen(key), hash);
-    e->value = sv;
-    hv->hash_index[insert_pos] = slot;
-    hv->num_entries++;
-    if ((hv->num_entries + hv->num_tombstones) * 2 > hv->num_buckets) {
-        strada_hash_resize(hv);
+    size_t ins;
+    StradaHashEntry *e = hv_find_for_insert(hv, key, key_len, hash, &ins);
+    if (e) {
+        strada_decref(e->value);
+        e->value = sv;
+        return;
     }
+    hv_insert_at(hv, ins, ss_new(key, key_len, hash), sv);
 }
 
 /* Single-probe lvalue lookup: returns a pointer to the value slot of the
@@ -3835,54 +5911,20 @@ void strada_hash_set_take_ph(StradaHash *hv, const char *key, unsigned int hash,
  * do ONE probe + ONE key-hash instead of a separate fetch then store.
  *
  * Pointer stability: hash_get_slot may realloc `entries` (handled — the slot
- * pointer is taken AFTER it), and strada_hash_resize only reallocs the bucket
- * index, never `entries`, so the returned pointer survives an insert-triggered
- * resize. The caller must NOT mutate this hash between getting the pointer and
+ * pointer is taken AFTER it, in hv_insert_at), and strada_hash_resize only
+ * replaces the bucket index, never `entries`, so the returned pointer
+ * survives an insert-triggered resize. The caller must NOT mutate this hash between getting the pointer and
  * using it (perla only uses it with a side-effect-free RHS). Mirrors the
  * find-or-insert of strada_hash_set_take_ph. */
 StradaValue **strada_hv_fetch_lvalue(StradaHash *hv, const char *key, int autoviv) {
     if (!hv || !key) return NULL;
     unsigned int hash = strada_hash_string(key);
     uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    uint32_t first_tombstone = HASH_EMPTY;
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) return &hv->entries[slot].value;
-            break;
-        }
-        if (idx == HASH_TOMBSTONE) {
-            if (first_tombstone == HASH_EMPTY) first_tombstone = pos;
-        } else {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && strcmp(e->key->data, key) == 0)
-                return &e->value;
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) return &hv->entries[slot].value;
-            break;
-        }
-    }
+    size_t ins;
+    StradaHashEntry *e = hv_find_for_insert(hv, key, key_len, hash, &ins);
+    if (e) return &e->value;
     if (!autoviv) return NULL;
-    uint32_t insert_pos = (first_tombstone != HASH_EMPTY) ? first_tombstone : pos;
-    if (first_tombstone != HASH_EMPTY) hv->num_tombstones--;
-    uint32_t slot = hash_get_slot(hv);          /* may realloc entries[] */
-    StradaHashEntry *e = &hv->entries[slot];    /* taken AFTER the realloc */
-    e->key = ss_new(key, key_len, hash);
-    e->value = strada_new_undef();
-    hv->hash_index[insert_pos] = slot;
-    hv->num_entries++;
-    StradaValue **result = &e->value;
-    if ((hv->num_entries + hv->num_tombstones) * 2 > hv->num_buckets) {
-        strada_hash_resize(hv);                 /* reallocs hash_index only, not entries */
-    }
-    return result;
+    return &hv_insert_at(hv, ins, ss_new(key, key_len, hash), strada_new_undef())->value;
 }
 
 StradaValue **strada_hv_fetch_lvalue_sv(StradaValue *sv, const char *key, int autoviv) {
@@ -3898,58 +5940,14 @@ void strada_hash_set_take(StradaHash *hv, const char *key, StradaValue *sv) {
 
     unsigned int hash = strada_hash_string(key);
     uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    uint32_t first_tombstone = HASH_EMPTY;
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-        if (idx == HASH_TOMBSTONE) {
-            if (first_tombstone == HASH_EMPTY) first_tombstone = pos;
-        } else {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && strcmp(e->key->data, key) == 0) {
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-    }
-
-    uint32_t insert_pos = (first_tombstone != HASH_EMPTY) ? first_tombstone : pos;
-    if (first_tombstone != HASH_EMPTY) hv->num_tombstones--;
-    uint32_t slot = hash_get_slot(hv);
-    StradaHashEntry *e = &hv->entries[slot];
-    e->key = ss_new(key, strlen(key), hash);
-    e->value = sv;
-    hv->hash_index[insert_pos] = slot;
-    hv->num_entries++;
-
-    if ((hv->num_entries + hv->num_tombstones) * 2 > hv->num_buckets) {
-        strada_hash_resize(hv);
+    size_t ins;
+    StradaHashEntry *e = hv_find_for_insert(hv, key, key_len, hash, &ins);
+    if (e) {
+        strada_decref(e->value);
+        e->value = sv;
+        return;
     }
+    hv_insert_at(hv, ins, ss_new(key, key_len, hash), sv);
 }
 
 /* Fast hash set with pre-built StradaString key — no allocation, no hashing.
@@ -3957,95 +5955,45 @@ void strada_hash_set_take(StradaHash *hv, const char *key, StradaValue *sv) {
 void strada_hash_set_ss_take(StradaHash *hv, StradaString *key_ss, StradaValue *sv) {
     if (!hv || !key_ss) return;
 
-    uint32_t pos = key_ss->hash & (hv->num_buckets - 1);
-    uint32_t first_tombstone = HASH_EMPTY;
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, (const char*)key_ss->data, key_ss->len, key_ss->hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-        if (idx == HASH_TOMBSTONE) {
-            if (first_tombstone == HASH_EMPTY) first_tombstone = pos;
-        } else {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key == key_ss || (e->key->hash == key_ss->hash && e->key->len == key_ss->len && memcmp(e->key->data, key_ss->data, key_ss->len) == 0)) {
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, (const char*)key_ss->data, key_ss->len, key_ss->hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
+    size_t ins;
+    StradaHashEntry *e = hv_find_for_insert(hv, (const char*)key_ss->data, key_ss->len,
+                                            key_ss->hash, &ins);
+    if (e) {
+        strada_decref(e->value);
+        e->value = sv;
+        return;
     }
-
-    uint32_t insert_pos = (first_tombstone != HASH_EMPTY) ? first_tombstone : pos;
-    if (first_tombstone != HASH_EMPTY) hv->num_tombstones--;
-    uint32_t slot = hash_get_slot(hv);
-    StradaHashEntry *e = &hv->entries[slot];
     ss_incref(key_ss);
-    e->key = key_ss;
-    e->value = sv;
-    hv->hash_index[insert_pos] = slot;
-    hv->num_entries++;
-
-    if ((hv->num_entries + hv->num_tombstones) * 2 > hv->num_buckets) {
-        strada_hash_resize(hv);
+    hv_insert_at(hv, ins, key_ss, sv);
+}
+
+/* strada_hash_set_take with an interned key (strada_ss_intern): for
+ * decoders that build many records with the same keys (JSON objects, DBI
+ * rows), so every record shares one copy of each key. Takes sv. */
+void strada_hash_set_interned(StradaHash *hv, const char *key, size_t len, StradaValue *sv) {
+    if (!hv || !key) { strada_decref(sv); return; }
+    StradaString *ss = strada_ss_intern(key, len);
+    if (ss->hash == 0) {
+        /* Embedded NUL: keep the C-string key semantics of hash_set */
+        ss_decref(ss);
+        strada_hash_set_take(hv, key, sv);
+        return;
     }
+    strada_hash_set_ss_take(hv, ss, sv);
+    ss_decref(ss);
 }
 
 StradaValue* strada_hash_get(StradaHash *hv, const char *key) {
     if (!hv || !key) return strada_undef_static();
 
+    /* hv_find falls back to a linear scan when the index is dirty
+     * (observed crossing the perla_method_dispatch boundary: same
+     * StradaHash* address, caller's `$h->{key}` works, callee's
+     * `$params->{key}` returned undef though keys/values iterated fine)
+     * and rebuilds the index in place. Self-healing. */
     unsigned int hash = strada_hash_string(key);
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            /* hash_index miss — but if entries are populated the hash
-             * may have a corrupted index (observed crossing the
-             * perla_method_dispatch boundary: same StradaHash* address,
-             * caller's `$h->{key}` works, callee's `$params->{key}`
-             * returns undef even though keys/values iterate fine). Fall
-             * back to linear scan over entries; if found, rebuild the
-             * index in place. Self-healing. */
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0)
-                return e->value;
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            /* Index walk wrapped without finding HASH_EMPTY — corruption.
-             * Last-resort linear scan. */
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-        }
-    }
+    StradaHashEntry *e = hv_find(hv, key, (uint32_t)strlen(key), hash);
+    return e ? e->value : strada_undef_static();
 }
 
 /* Autovivification: fetch a hash value, auto-creating an empty hash if key doesn't exist.
@@ -4057,25 +6005,13 @@ StradaValue* strada_autoviv_hash(StradaValue *sv, const char *key) {
     if (!hv || !key) return strada_new_hash();
 
     unsigned int hash = strada_hash_string(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) break;
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && strcmp(e->key->data, key) == 0) {
-                StradaValue *val = e->value;
-                if (!val || STRADA_IS_TAGGED_INT(val) ||
-                    (val->type != STRADA_HASH && val->type != STRADA_REF)) {
-                    StradaValue *new_hash = strada_new_hash();
-                    strada_hash_set_take(hv, key, new_hash);
-                    return new_hash;
-                }
-                return val;
-            }
+    StradaHashEntry *e = hv_find(hv, key, (uint32_t)strlen(key), hash);
+    if (e) {
+        StradaValue *val = e->value;
+        if (val && !STRADA_IS_TAGGED_INT(val) &&
+            (val->type == STRADA_HASH || val->type == STRADA_REF)) {
+            return val;
         }
-        pos = (pos + 1) & (hv->num_buckets - 1);
     }
 
     StradaValue *new_hash = strada_new_hash();
@@ -4093,25 +6029,13 @@ StradaValue* strada_autoviv_array(StradaValue *sv, const char *key) {
     if (!hv || !key) return strada_new_array();
 
     unsigned int hash = strada_hash_string(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) break;
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && strcmp(e->key->data, key) == 0) {
-                StradaValue *val = e->value;
-                if (!val || STRADA_IS_TAGGED_INT(val) ||
-                    (val->type != STRADA_ARRAY && val->type != STRADA_REF)) {
-                    StradaValue *new_arr = strada_new_array();
-                    strada_hash_set_take(hv, key, new_arr);
-                    return new_arr;
-                }
-                return val;
-            }
+    StradaHashEntry *e = hv_find(hv, key, (uint32_t)strlen(key), hash);
+    if (e) {
+        StradaValue *val = e->value;
+        if (val && !STRADA_IS_TAGGED_INT(val) &&
+            (val->type == STRADA_ARRAY || val->type == STRADA_REF)) {
+            return val;
         }
-        pos = (pos + 1) & (hv->num_buckets - 1);
     }
 
     StradaValue *new_arr = strada_new_array();
@@ -4128,6 +6052,7 @@ static StradaValue* autoviv_elem(StradaValue *arr_sv, int64_t idx, int want_arra
     StradaArray *av = (arr_sv && !STRADA_IS_TAGGED_INT(arr_sv))
                           ? strada_deref_array(arr_sv) : NULL;
     if (!av) return want_array ? strada_new_array() : strada_new_hash();
+    strada_array_unpack(av);  /* a packed slot can't hold a container */
     /* Resolve negative indices here: an out-of-range negative index makes
      * strada_array_set silently drop the store, which would leave the
      * fresh container with refcount 0 after the decref below. */
@@ -4159,74 +6084,18 @@ int strada_hash_exists(StradaHash *hv, const char *key) {
     if (!hv || !key) return 0;
 
     unsigned int hash = strada_hash_string(key);
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            /* Self-heal on hash_index corruption — see strada_hash_get
-             * comment. Index says "not present" but entries[] may have
-             * the key (cross-boundary dispatch corruption). */
-            return hash_linear_find(hv, key, key_len, hash) >= 0 ? 1 : 0;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                return 1;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            return hash_linear_find(hv, key, key_len, hash) >= 0 ? 1 : 0;
-        }
-    }
+    return hv_find(hv, key, (uint32_t)strlen(key), hash) != NULL;
 }
 
 void strada_hash_delete(StradaHash *hv, const char *key) {
     if (!hv || !key) return;
 
+    /* hv_find_bucket re-probes after a self-healing scan, so a corrupt
+     * index can't turn delete into a no-op while get/exists still see
+     * the entry. */
     unsigned int hash = strada_hash_string(key);
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            /* Self-heal: linear-scan, and if found re-probe with the
-             * rebuilt index so we can write the tombstone at the right
-             * slot. Without this a corrupt index made delete a no-op
-             * but `exists`/`get` (post-fix) still returned the value —
-             * caller saw the entry leak. */
-            if (hash_linear_find(hv, key, key_len, hash) < 0) return;
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-            continue;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                hv->hash_index[pos] = HASH_TOMBSTONE;
-                ss_decref(e->key);
-                strada_decref(e->value);
-                e->key = NULL; e->value = NULL;
-                e->next = hv->free_head; hv->free_head = idx;
-                hv->num_entries--;
-                hv->num_tombstones++;
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            if (hash_linear_find(hv, key, key_len, hash) < 0) return;
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-        }
-    }
+    int64_t b = hv_find_bucket(hv, key, (uint32_t)strlen(key), hash);
+    if (b >= 0) strada_decref(hv_remove_bucket(hv, (size_t)b));
 }
 
 /* ===== _sv variants: accept StradaValue* key directly ===== */
@@ -4273,6 +6142,25 @@ static inline const char *sv_key_extract_buf(StradaValue *key_sv,
 }
 
 
+/* Entry key for an insert through a StradaValue key. A STR key whose own
+ * StradaString already carries this key's hash (a core::intern result,
+ * or a keys()/each() share) is shared instead of copied, so every hash
+ * built from the same interned name holds one copy and lookups with it
+ * hit the pointer compare. Views and strings embedded in their value
+ * have no standalone StradaString to share. */
+static inline StradaString *sv_key_ss(StradaValue *key_sv, const char *key,
+                                      uint32_t key_len, unsigned int hash) {
+    if (key_sv && !STRADA_IS_TAGGED_INT(key_sv) && key_sv->type == STRADA_STR
+        && key == key_sv->value.pv && !STRADA_STR_IS_VIEW(key_sv) && !STRADA_STR_IS_EMBEDDED(key_sv)) {
+        StradaString *ss = SS_FROM_PV(key_sv->value.pv);
+        if (ss->hash == hash && ss->len == key_len) {
+            ss_incref(ss);
+            return ss;
+        }
+    }
+    return ss_new(key, key_len, hash);
+}
+
 StradaValue **strada_hv_fetch_lvalue_sv_key(StradaValue *sv, StradaValue *key_sv, int autoviv) {
     if (!sv || STRADA_IS_TAGGED_INT(sv)) return NULL;
     if (sv->meta && sv->meta->is_tied) return NULL;   /* tied → caller uses fetch/store */
@@ -4296,64 +6184,14 @@ void strada_hash_set_sv(StradaHash *hv, StradaValue *key_sv, StradaValue *sv) {
 
     unsigned int hash = strada_hash_string(key);
     uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    uint32_t first_tombstone = HASH_EMPTY;
-
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                if (key_alloc) free(key_alloc);
-                return;
-            }
-            break;
-        }
-        if (idx == HASH_TOMBSTONE) {
-            if (first_tombstone == HASH_EMPTY) first_tombstone = pos;
-        } else {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                if (key_alloc) free(key_alloc);
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                if (key_alloc) free(key_alloc);
-                return;
-            }
-            break;
-        }
-    }
-
-    uint32_t insert_pos = (first_tombstone != HASH_EMPTY) ? first_tombstone : pos;
-    if (first_tombstone != HASH_EMPTY) hv->num_tombstones--;
-    uint32_t slot = hash_get_slot(hv);
-    StradaHashEntry *e = &hv->entries[slot];
-    e->key = ss_new(key, key_len, hash);
-    e->value = sv;
+    size_t ins;
+    StradaHashEntry *e = hv_find_for_insert(hv, key, key_len, hash, &ins);
     strada_incref(sv);
-    hv->hash_index[insert_pos] = slot;
-    hv->num_entries++;
-
-    if ((hv->num_entries + hv->num_tombstones) * 2 > hv->num_buckets) {
-        strada_hash_resize(hv);
+    if (e) {
+        strada_decref(e->value);
+        e->value = sv;
+    } else {
+        hv_insert_at(hv, ins, sv_key_ss(key_sv, key, key_len, hash), sv);
     }
     if (key_alloc) free(key_alloc);
 }
@@ -4366,34 +6204,9 @@ StradaValue* strada_hash_get_sv(StradaHash *hv, StradaValue *key_sv) {
     if (!key) { if (key_alloc) free(key_alloc); return strada_undef_static(); }
 
     unsigned int hash = strada_hash_string(key);
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            StradaValue *r = (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-            if (key_alloc) free(key_alloc);
-            return r;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                if (key_alloc) free(key_alloc);
-                return e->value;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            StradaValue *r = (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-            if (key_alloc) free(key_alloc);
-            return r;
-        }
-    }
+    StradaHashEntry *e = hv_find(hv, key, (uint32_t)strlen(key), hash);
+    if (key_alloc) free(key_alloc);
+    return e ? e->value : strada_undef_static();
 }
 
 /* ===== SINGLE-LOOKUP HASH-ELEMENT COMPOUND ASSIGNMENT ===== */
@@ -4405,33 +6218,13 @@ StradaValue* strada_hash_get_sv(StradaHash *hv, StradaValue *key_sv) {
 /* Find the value slot for `key`, or NULL if the key is absent. The pointer
  * is valid only until the next structural modification (insert/delete/
  * resize) — callers must not call back into hash mutation while holding it.
- * Probe logic mirrors strada_hash_get_sv, including the linear-scan
- * fallback for a dirty index. */
+ * Same lookup as strada_hash_get_sv, including the linear-scan fallback
+ * for a dirty index. */
 static StradaValue** hash_lvalue_slot(StradaHash *hv, const char *key,
                                       uint32_t key_len, unsigned int hash) {
     if (!hv) return NULL;
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? &hv->entries[slot].value : NULL;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key && e->key->hash == hash && e->key->len == key_len
-                && memcmp(e->key->data, key, key_len) == 0) {
-                return &e->value;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? &hv->entries[slot].value : NULL;
-        }
-    }
+    StradaHashEntry *e = hv_find(hv, key, key_len, hash);
+    return e ? &e->value : NULL;
 }
 
 /* Compute old OP rhs as an owned value. `old` may be NULL or undef
@@ -4545,6 +6338,39 @@ void strada_array_compound(StradaValue *arr_sv, int64_t idx, StradaValue *rhs, i
         strada_decref(nv);
         return;
     }
+    if (__builtin_expect(av->kind, 0)) {
+        /* Packed: arithmetic straight on the raw slot, no boxing */
+        size_t pos = av->head + (size_t)idx;
+        if (op == '.') {
+            StradaValue *old = av_packed_take(av, pos);
+            StradaValue *nv = strada_concat_sv(old, rhs);
+            av_packed_store(av, pos, nv);
+            strada_decref(nv);
+            strada_decref(old);
+            return;
+        }
+        if (av->kind == STRADA_AV_NUM) {
+            double a = STRADA_AV_F64(av)[pos], b = strada_to_num(rhs);
+            STRADA_AV_F64(av)[pos] = (op == '+') ? a + b : (op == '-') ? a - b
+                                   : (op == '*') ? a * b : a / b;
+        } else {
+            int64_t a = av->kind == STRADA_AV_INT ? STRADA_AV_I64(av)[pos] : STRADA_AV_U8(av)[pos];
+            int64_t r;
+            if (op != '/' && rhs && STRADA_IS_TAGGED_INT(rhs)) {
+                uint64_t ua = (uint64_t)a, ub = (uint64_t)STRADA_TAGGED_INT_VAL(rhs);
+                r = (int64_t)((op == '+') ? ua + ub : (op == '-') ? ua - ub : ua * ub);
+            } else {
+                double b = strada_to_num(rhs);
+                double d = (op == '+') ? a + b : (op == '-') ? a - b
+                         : (op == '*') ? a * b : a / b;
+                r = (int64_t)d;  /* as strada_to_int does for a num */
+            }
+            if (av->kind == STRADA_AV_INT) STRADA_AV_I64(av)[pos] = r;
+            else STRADA_AV_U8(av)[pos] = (uint8_t)r;
+        }
+        av_packed_unlend(av, pos);
+        return;
+    }
     StradaValue **slot = &av->elements[av->head + (size_t)idx];
     StradaValue *old = *slot;  /* may be NULL (hole) — treated as undef */
     if (op == '.') {
@@ -4567,32 +6393,9 @@ int strada_hash_exists_sv(StradaHash *hv, StradaValue *key_sv) {
     if (!key) { if (key_alloc) free(key_alloc); return 0; }
 
     unsigned int hash = strada_hash_string(key);
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int r = hash_linear_find(hv, key, key_len, hash) >= 0 ? 1 : 0;
-            if (key_alloc) free(key_alloc);
-            return r;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                if (key_alloc) free(key_alloc);
-                return 1;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int r = hash_linear_find(hv, key, key_len, hash) >= 0 ? 1 : 0;
-            if (key_alloc) free(key_alloc);
-            return r;
-        }
-    }
+    int r = hv_find(hv, key, (uint32_t)strlen(key), hash) != NULL;
+    if (key_alloc) free(key_alloc);
+    return r;
 }
 
 void strada_hash_delete_sv(StradaHash *hv, StradaValue *key_sv) {
@@ -4603,46 +6406,24 @@ void strada_hash_delete_sv(StradaHash *hv, StradaValue *key_sv) {
     if (!key) { if (key_alloc) free(key_alloc); return; }
 
     unsigned int hash = strada_hash_string(key);
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
+    int64_t b = hv_find_bucket(hv, key, (uint32_t)strlen(key), hash);
+    if (key_alloc) free(key_alloc);
+    if (b >= 0) strada_decref(hv_remove_bucket(hv, (size_t)b));
+}
 
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            if (hash_linear_find(hv, key, key_len, hash) < 0) {
-                if (key_alloc) free(key_alloc);
-                return;
-            }
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-            continue;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                hv->hash_index[pos] = HASH_TOMBSTONE;
-                ss_decref(e->key);
-                strada_decref(e->value);
-                e->key = NULL; e->value = NULL;
-                e->next = hv->free_head; hv->free_head = idx;
-                hv->num_entries--;
-                hv->num_tombstones++;
-                if (key_alloc) free(key_alloc);
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            if (hash_linear_find(hv, key, key_len, hash) < 0) {
-                if (key_alloc) free(key_alloc);
-                return;
-            }
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-        }
-    }
+StradaValue* strada_hash_delete_take_sv(StradaHash *hv, StradaValue *key_sv) {
+    if (!hv || !key_sv) return strada_undef_static();
+    char key_buf[SV_KEYBUF_LEN];
+    char *key_alloc;
+    const char *key = sv_key_extract_buf(key_sv, key_buf, sizeof(key_buf), &key_alloc);
+    if (!key) { if (key_alloc) free(key_alloc); return strada_undef_static(); }
+
+    unsigned int hash = strada_hash_string(key);
+    int64_t b = hv_find_bucket(hv, key, (uint32_t)strlen(key), hash);
+    if (key_alloc) free(key_alloc);
+    if (b < 0) return strada_undef_static();
+    StradaValue *val = hv_remove_bucket(hv, (size_t)b);
+    return val ? val : strada_undef_static();
 }
 
 /* ===== CONCAT KEY HASH OPERATIONS ===== */
@@ -4712,155 +6493,39 @@ static size_t build_concat_key(
 StradaValue* strada_hash_get_with_hash(StradaHash *hv, const char *key, unsigned int hash) {
     if (!hv || !key) return strada_undef_static();
 
-    uint32_t key_len = (uint32_t)strlen(key);
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            /* Length + memcmp: cheap length early-out on (rare) 32-bit hash
-             * collisions, and no trailing-NUL scan on the matching key. key_len
-             * is already computed above for hash_linear_find. */
-            if (e->key->hash == hash && e->key->len == key_len &&
-                memcmp(e->key->data, key, key_len) == 0)
-                return e->value;
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-        }
-    }
+    StradaHashEntry *e = hv_find(hv, key, (uint32_t)strlen(key), hash);
+    return e ? e->value : strada_undef_static();
 }
 
 /* Length-aware get: uses length check + memcmp for faster rejection */
 static inline StradaValue* strada_hash_get_with_hash_len(StradaHash *hv, const char *key, uint32_t key_len, unsigned int hash) {
     if (!hv || !key) return strada_undef_static();
 
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0)
-                return e->value;
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            return (slot >= 0) ? hv->entries[slot].value : strada_undef_static();
-        }
-    }
+    StradaHashEntry *e = hv_find(hv, key, key_len, hash);
+    return e ? e->value : strada_undef_static();
 }
 
 /* Length-aware delete */
 static void strada_hash_delete_with_hash_len(StradaHash *hv, const char *key, uint32_t key_len, unsigned int hash) {
     if (!hv || !key) return;
 
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            if (hash_linear_find(hv, key, key_len, hash) < 0) return;
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-            continue;
-        }
-        if (idx != HASH_TOMBSTONE) {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                hv->hash_index[pos] = HASH_TOMBSTONE;
-                ss_decref(e->key);
-                strada_decref(e->value);
-                e->key = NULL; e->value = NULL;
-                e->next = hv->free_head; hv->free_head = idx;
-                hv->num_entries--;
-                hv->num_tombstones++;
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            if (hash_linear_find(hv, key, key_len, hash) < 0) return;
-            pos = hash & (hv->num_buckets - 1);
-            iters = 0;
-        }
-    }
+    int64_t b = hv_find_bucket(hv, key, key_len, hash);
+    if (b >= 0) strada_decref(hv_remove_bucket(hv, (size_t)b));
 }
 
 /* Length-aware hash set: avoids strlen, uses memcmp with fast length reject */
 static void strada_hash_set_with_hash_len(StradaHash *hv, const char *key, uint32_t key_len, unsigned int hash, StradaValue *sv) {
     if (!hv || !key) return;
 
-    uint32_t pos = hash & (hv->num_buckets - 1);
-    uint32_t first_tombstone = HASH_EMPTY;
-    int iters = 0;
-    while (1) {
-        uint32_t idx = hv->hash_index[pos];
-        if (idx == HASH_EMPTY) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-        if (idx == HASH_TOMBSTONE) {
-            if (first_tombstone == HASH_EMPTY) first_tombstone = pos;
-        } else {
-            StradaHashEntry *e = &hv->entries[idx];
-            if (e->key->hash == hash && e->key->len == key_len && memcmp(e->key->data, key, key_len) == 0) {
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-        }
-        pos = (pos + 1) & (hv->num_buckets - 1);
-        iters++;
-        if (iters > (int)hv->num_buckets) {
-            int32_t slot = hash_linear_find(hv, key, key_len, hash);
-            if (slot >= 0) {
-                StradaHashEntry *e = &hv->entries[slot];
-                strada_incref(sv);
-                strada_decref(e->value);
-                e->value = sv;
-                return;
-            }
-            break;
-        }
-    }
-
-    uint32_t insert_pos = (first_tombstone != HASH_EMPTY) ? first_tombstone : pos;
-    if (first_tombstone != HASH_EMPTY) hv->num_tombstones--;
-    uint32_t slot = hash_get_slot(hv);
-    StradaHashEntry *e = &hv->entries[slot];
-    e->key = ss_new(key, key_len, hash);
-    e->value = sv;
+    size_t ins;
+    StradaHashEntry *e = hv_find_for_insert(hv, key, key_len, hash, &ins);
     strada_incref(sv);
-    hv->hash_index[insert_pos] = slot;
-    hv->num_entries++;
-
-    if ((hv->num_entries + hv->num_tombstones) * 2 > hv->num_buckets) {
-        strada_hash_resize(hv);
+    if (e) {
+        strada_decref(e->value);
+        e->value = sv;
+        return;
     }
+    hv_insert_at(hv, ins, ss_new(key, key_len, hash), sv);
 }
 
 /* High-level concat key operations */
@@ -5095,32 +6760,29 @@ StradaArray* strada_hash_values(StradaHash *hv) {
     return av;
 }
 
-/* Reserve capacity for hash entries, keeping the runtime's 50% max load. */
+/* Reserve capacity for hash entries, keeping the runtime's 7/8 max load. */
 void strada_hash_reserve(StradaHash *hv, size_t capacity) {
     if (!hv || capacity == 0) return;
 
-    size_t num_buckets = strada_next_pow2(capacity * 2);
+    size_t num_buckets = hv_buckets_for(capacity);
     if (num_buckets <= hv->num_buckets) return;
 
-    hv->num_buckets = num_buckets;
-    if (hv_idx_in_block(hv)) {
-        /* index lives in the compact block — can't realloc an interior
-         * pointer; contents are rebuilt below anyway */
-        hv->hash_index = malloc(num_buckets * sizeof(uint32_t));
-    } else {
-        hv->hash_index = sr_xrealloc(hv->hash_index, num_buckets * sizeof(uint32_t));
-    }
+    void *block = sr_xmalloc(hv_index_bytes(num_buckets));
+    /* the compact block's index can't be freed on its own; contents are
+     * rebuilt below anyway */
+    if (!hv_idx_in_block(hv)) free(hv->ctrl);
+    hv_index_attach(hv, block, num_buckets);
 
     /* Also reserve entry capacity */
-    if (num_buckets > hv->capacity) {
+    if (capacity > hv->capacity) {
         if (hv_ent_in_block(hv)) {
-            StradaHashEntry *ne = malloc(num_buckets * sizeof(StradaHashEntry));
+            StradaHashEntry *ne = sr_xmalloc(capacity * sizeof(StradaHashEntry));
             if (hv->capacity > 0) memcpy(ne, hv->entries, hv->capacity * sizeof(StradaHashEntry));
             hv->entries = ne;
         } else {
-            hv->entries = sr_xrealloc(hv->entries, num_buckets * sizeof(StradaHashEntry));
+            hv->entries = sr_xrealloc(hv->entries, capacity * sizeof(StradaHashEntry));
         }
-        hv->capacity = num_buckets;
+        hv->capacity = capacity;
     }
 
     hash_rebuild_index(hv);
@@ -5166,12 +6828,15 @@ static int utf8_is_continuation(unsigned char c) {
  * positions, breaking `pack("H4", "abcd")` access via substr/ord. */
 static int utf8_is_valid(const char *s, size_t len) {
     if (!s) return 1;
+    /* Well-formed (strict) UTF-8 is always acceptable here; only data that
+     * fails the vectorised strict check takes the lenient byte loop. */
+    if (strada_utf8_is_valid(s, len)) return 1;
     const unsigned char *p = (const unsigned char *)s;
     size_t i = 0;
     while (i < len) {
         unsigned char c = p[i];
         int needed;
-        if (c < 0x80) { i++; continue; }
+        if (c < 0x80) { i += strada_ascii_run(p + i, len - i); continue; }
         else if ((c & 0xE0) == 0xC0) needed = 1;
         else if ((c & 0xF0) == 0xE0) needed = 2;
         else if ((c & 0xF8) == 0xF0) needed = 3;
@@ -5188,15 +6853,7 @@ static int utf8_is_valid(const char *s, size_t len) {
 /* Count UTF-8 codepoints in a string */
 static size_t utf8_strlen(const char *s) {
     if (!s) return 0;
-    size_t count = 0;
-    const unsigned char *p = (const unsigned char *)s;
-    while (*p) {
-        if (!utf8_is_continuation(*p)) {
-            count++;
-        }
-        p++;
-    }
-    return count;
+    return strada_utf8_count((const unsigned char *)s, strlen(s));
 }
 
 /* Get byte offset for the nth UTF-8 character (0-indexed) */
@@ -5215,6 +6872,96 @@ static size_t utf8_offset(const char *s, size_t char_index) {
     return bytes;
 }
 
+/* ===== Codepoint index =====
+ * substr/index/length on a UTF-8-flagged string count codepoints, and
+ * finding codepoint N means scanning from the start: O(n) per call, O(n^2)
+ * for a loop over a string's characters. A string of STRADA_U8_INDEX_MIN
+ * bytes or more gets a breadcrumb table on first use instead — the byte
+ * offset of every STRADA_U8_STEP-th codepoint plus the total count and the
+ * validity verdict — so a lookup walks at most STRADA_U8_STEP codepoints.
+ * The table hangs off meta->u8_index, is keyed by (pv, byte length), and
+ * is dropped by strada_str_free_pv and the in-place mutators. */
+#define STRADA_U8_INDEX_MIN 1024
+#define STRADA_U8_STEP 64
+
+typedef struct StradaU8Index {
+    const char *pv;        /* bytes this index describes */
+    size_t len;
+    size_t chars;          /* codepoints (non-continuation bytes) */
+    int valid;             /* utf8_is_valid(pv, len); no crumbs when 0 */
+    size_t ncrumbs;
+    uint32_t crumbs[];     /* byte offset of codepoint i * STRADA_U8_STEP */
+} StradaU8Index;
+
+static StradaU8Index *strada_u8_index_build(const char *s, size_t len) {
+    int valid = utf8_is_valid(s, len);
+    size_t chars = valid ? strada_utf8_count((const unsigned char *)s, len) : 0;
+    size_t ncrumbs = (chars + STRADA_U8_STEP - 1) / STRADA_U8_STEP;
+    StradaU8Index *ix = malloc(sizeof(StradaU8Index) + ncrumbs * sizeof(uint32_t));
+    if (!ix) return NULL;
+    ix->pv = s;
+    ix->len = len;
+    ix->chars = chars;
+    ix->valid = valid;
+    ix->ncrumbs = ncrumbs;
+    const unsigned char *p = (const unsigned char *)s;
+    size_t c = 0;
+    for (size_t i = 0; i < len && ncrumbs; i++) {
+        if (utf8_is_continuation(p[i])) continue;
+        if (c % STRADA_U8_STEP == 0) ix->crumbs[c / STRADA_U8_STEP] = (uint32_t)i;
+        c++;
+    }
+    return ix;
+}
+
+/* Index for sv's current bytes (s/len = its pv and byte length), built on
+ * first use. NULL when the string is short enough to scan, or once threads
+ * are running — meta is not safe to attach from concurrent readers, so
+ * threaded programs keep the scanning paths. */
+static const StradaU8Index *strada_u8_index(StradaValue *sv, const char *s, size_t len) {
+    if (len < STRADA_U8_INDEX_MIN || len > UINT32_MAX || strada_threading_active) return NULL;
+    StradaU8Index *ix = sv->meta ? (StradaU8Index *)sv->meta->u8_index : NULL;
+    if (ix && ix->pv == s && ix->len == len) return ix;
+    StradaMetadata *m = strada_ensure_meta(sv);
+    if (!m) return NULL;
+    free(m->u8_index);
+    m->u8_index = ix = strada_u8_index_build(s, len);
+    return ix;
+}
+
+/* In-place writers change the bytes under an unchanged (pv, len) key. */
+static inline void strada_u8_index_drop(StradaValue *sv) {
+    if (sv->meta && sv->meta->u8_index) {
+        free(sv->meta->u8_index);
+        sv->meta->u8_index = NULL;
+    }
+}
+
+/* Byte offset of codepoint ci (the end of the string when ci >= chars). */
+static size_t strada_u8_char_to_byte(const StradaU8Index *ix, const char *s, size_t ci) {
+    if (ci >= ix->chars) return ix->len;
+    const unsigned char *p = (const unsigned char *)s;
+    size_t b = ix->crumbs[ci / STRADA_U8_STEP];
+    for (size_t k = ci % STRADA_U8_STEP; k > 0; k--) {
+        b++;
+        while (b < ix->len && utf8_is_continuation(p[b])) b++;
+    }
+    return b;
+}
+
+/* Codepoints before byte offset bo. */
+static size_t strada_u8_byte_to_char(const StradaU8Index *ix, const char *s, size_t bo) {
+    if (bo >= ix->len) return ix->chars;
+    size_t lo = 0, hi = ix->ncrumbs;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ix->crumbs[mid] <= bo) lo = mid; else hi = mid;
+    }
+    size_t from = ix->crumbs[lo];
+    return lo * STRADA_U8_STEP
+         + strada_utf8_count((const unsigned char *)s + from, bo - from);
+}
+
 /* Decode a UTF-8 sequence to a Unicode codepoint */
 static uint32_t utf8_decode(const char *s, int *bytes_read) {
     const unsigned char *p = (const unsigned char *)s;
@@ -5428,17 +7175,11 @@ StradaValue* strada_concat_sv(StradaValue *a, StradaValue *b) {
         }
     }
 
-    /* Single allocation for result */
-    char *result = sr_xmalloc(len_a + len_b + 1);
-    if (len_a > 0) memcpy(result, str_a, len_a);
-    if (len_b > 0) memcpy(result + len_a, str_b, len_b);
-    result[len_a + len_b] = '\0';
-
-    /* Create result StradaValue directly */
-    StradaValue *sv = strada_value_alloc();
-    sv->type = STRADA_STR;
-    sv->refcount = 1;
-    sv->value.pv = ss_alloc_pv(result, len_a + len_b);
+    /* Build the result in place — single allocation (none extra for a
+     * small result, which is embedded in its value). */
+    StradaValue *sv = strada_str_value_uninit(len_a + len_b);
+    if (len_a > 0) memcpy(sv->value.pv, str_a, len_a);
+    if (len_b > 0) memcpy(sv->value.pv + len_a, str_b, len_b);
     /* Compute ASCII flag (bit 63) from the operands instead of rescanning
      * the combined buffer: STR operands already carry the flag, numeric
      * conversions are always ASCII, and only strada_to_str results
@@ -5463,7 +7204,6 @@ StradaValue* strada_concat_sv(StradaValue *a, StradaValue *b) {
     if (a_utf8 || b_utf8) {
         sv->struct_size |= STRADA_UTF8_FLAG;
     }
-    free(result);
     if (heap_a) free(heap_a);
     if (heap_b) free(heap_b);
     if (a_fetched) strada_decref(a_fetched);
@@ -5522,27 +7262,11 @@ StradaValue* strada_concat_cstr_sv(const char *prefix, size_t prefix_len, Strada
         }
     }
 
-    /* Build directly into StradaString — single allocation.
-     * Guard the 32-bit truncation: ss_new_uninit takes a uint32_t length, but
-     * the memcpys below use the full size_t prefix_len/len_b. Without this, a
-     * combined length > UINT32_MAX wrapped `total` to a small value, undersized
-     * the allocation, and the memcpy overran the heap. Mirrors the in-place
-     * concat helpers' 4GB guard. */
-    size_t total64 = prefix_len + len_b;
-    if (total64 > UINT32_MAX) {
-        fprintf(stderr, "strada: string concat exceeds 4GB limit\n");
-        abort();
-    }
-    uint32_t total = (uint32_t)total64;
-    StradaString *ss = ss_new_uninit(total);
-    if (prefix_len > 0) memcpy(ss->data, prefix, prefix_len);
-    if (len_b > 0) memcpy(ss->data + prefix_len, str_b, len_b);
-    ss->data[total] = '\0';
-
-    StradaValue *sv = strada_value_alloc();
-    sv->type = STRADA_STR;
-    sv->refcount = 1;
-    sv->value.pv = ss->data;
+    /* Build directly into the result — single allocation. */
+    size_t total = prefix_len + len_b;
+    StradaValue *sv = strada_str_value_uninit(total);
+    if (prefix_len > 0) memcpy(sv->value.pv, prefix, prefix_len);
+    if (len_b > 0) memcpy(sv->value.pv + prefix_len, str_b, len_b);
     /* ASCII flag: scan only the (short, literal) prefix; the RHS either
      * already carries the flag (STR), is a numeric conversion (always
      * ASCII), or is a strada_to_str result needing its own scan. Avoids
@@ -5569,6 +7293,43 @@ StradaValue* strada_concat_cstr_sv(const char *prefix, size_t prefix_len, Strada
  * CONSUMES a (reuses if refcount==1, otherwise decrefs after creating new).
  * BORROWS b (caller handles cleanup).
  * Returns owned StradaValue*. */
+/* Grow an unshared StradaString for an in-place append of len_a -> new_len
+ * bytes. Doubling keeps small appends amortized O(1); past
+ * SS_GROW_LINEAR_MIN the slack shrinks to a quarter, because realloc of a
+ * block that size remaps pages instead of copying them and doubling a
+ * multi-GB buffer would reserve more address space than the box can back. */
+#define SS_GROW_LINEAR_MIN ((size_t)256 << 20)
+/* An embedded small string (owned by `a`) moves out to a heap StradaString
+ * instead; its old bytes stay readable until the value dies. */
+static StradaString *ss_regrow(StradaValue *a, StradaString *ss, size_t len_a, size_t new_len) {
+    size_t new_cap = len_a < 64 ? 128
+                   : len_a + (len_a < SS_GROW_LINEAR_MIN ? len_a : len_a / 4);
+    if (new_cap < new_len + 1) new_cap = new_len + 1;
+    StradaString *grown;
+    if (STRADA_STR_IS_EMBEDDED(a)) {
+        grown = malloc(sizeof(StradaString) + new_cap);
+        if (grown) memcpy(grown, ss, sizeof(StradaString) + len_a);
+    } else {
+        grown = realloc(ss, sizeof(StradaString) + new_cap);
+    }
+    if (!grown) {
+        fprintf(stderr, "strada: out of memory growing a %zu-byte string\n", new_len);
+        abort();
+    }
+    return grown;
+}
+
+/* Bytes (excluding the NUL) the unshared StradaString behind STR value `a`
+ * can hold without growing. */
+static inline size_t ss_capacity(StradaValue *a, StradaString *ss) {
+    if (STRADA_STR_IS_EMBEDDED(a)) return STRADA_SSO_MAX;
+#ifdef __linux__
+    return malloc_usable_size(ss) - sizeof(StradaString) - 1;
+#else
+    return ss->len;
+#endif
+}
+
 StradaValue* strada_concat_inplace(StradaValue *a, StradaValue *b) {
     /* Get string pointer and length for b */
     const char *str_b = "";
@@ -5609,19 +7370,13 @@ StradaValue* strada_concat_inplace(StradaValue *a, StradaValue *b) {
     /* Fast path: realloc in place when a is a string with refcount 1.
      * Also require the underlying StradaString to be unshared (refcount 1) —
      * keys()/each() hand out zero-copy SS shares, and mutating or realloc'ing
-     * a shared SS would corrupt the hash key it came from. */
+     * a shared SS would corrupt the hash key it came from. A substring view
+     * shares its root's bytes, so it always takes the copying path. */
     if (a && !STRADA_IS_TAGGED_INT(a) && a->type == STRADA_STR && a->refcount == 1 && a->value.pv
-        && SS_FROM_PV(a->value.pv)->refcount == 1) {
+        && !STRADA_STR_IS_VIEW(a) && SS_FROM_PV(a->value.pv)->refcount == 1) {
         size_t len_a = STRADA_STR_BYTELEN(a);
         size_t new_len = len_a + len_b;
-        /* StradaString.len is uint32_t — bail loudly rather than silently
-         * truncate the cached length (which would desync from the buffer). */
-        if (new_len > UINT32_MAX) {
-            fprintf(stderr,
-                    "strada: string concat exceeds 4GB limit (%zu + %zu = %zu)\n",
-                    len_a, len_b, new_len);
-            abort();
-        }
+        strada_u8_index_drop(a);
         /* Compute ASCII flag incrementally: only scan the NEW bytes.
          * If both the existing string and appended bytes are ASCII, result is ASCII.
          * This avoids O(n) rescan of the entire string on every append. */
@@ -5641,18 +7396,15 @@ StradaValue* strada_concat_inplace(StradaValue *a, StradaValue *b) {
             new_flags |= STRADA_UTF8_FLAG;
         }
         StradaString *ss = SS_FROM_PV(a->value.pv);
-#ifdef __linux__
         /* Check if existing StradaString allocation has room */
-        size_t usable = malloc_usable_size(ss);
-        if (usable >= sizeof(StradaString) + new_len + 1) {
+        if (ss_capacity(a, ss) >= new_len) {
             if (len_b > 0) memcpy(ss->data + len_a, str_b, len_b);
             ss->data[new_len] = '\0';
-            ss->len = (uint32_t)new_len;
+            ss->len = new_len;
             a->struct_size = new_flags;
             if (heap_b) free(heap_b);
             return a;
         }
-#endif
         /* Need to grow — realloc the StradaString. If str_b aliases into
          * a's own buffer (e.g., `$s .= $s` with refcount 1), realloc may
          * move the buffer and leave str_b dangling. Detect this and
@@ -5661,13 +7413,11 @@ StradaValue* strada_concat_inplace(StradaValue *a, StradaValue *b) {
                         (str_b >= (const char *)ss->data &&
                          str_b <= (const char *)ss->data + len_a);
         size_t alias_offset = aliases_a ? (size_t)(str_b - (const char *)ss->data) : 0;
-        size_t new_cap = len_a < 64 ? 128 : len_a * 2;
-        if (new_cap < new_len + 1) new_cap = new_len + 1;
-        ss = realloc(ss, sizeof(StradaString) + new_cap);
+        ss = ss_regrow(a, ss, len_a, new_len);
         if (aliases_a) str_b = (const char *)ss->data + alias_offset;
         if (len_b > 0) memcpy(ss->data + len_a, str_b, len_b);
         ss->data[new_len] = '\0';
-        ss->len = (uint32_t)new_len;
+        ss->len = new_len;
         a->value.pv = ss->data;  /* update in case realloc moved */
         a->struct_size = new_flags;
         if (heap_b) free(heap_b);
@@ -5685,18 +7435,12 @@ StradaValue* strada_concat_inplace(StradaValue *a, StradaValue *b) {
  * Used by codegen for $s .= "literal" optimization. */
 StradaValue* strada_concat_inplace_cstr(StradaValue *a, const char *str_b, size_t len_b) {
     /* SS refcount check: see strada_concat_inplace — never mutate a shared
-     * StradaString (zero-copy keys()/each() shares). */
+     * StradaString (zero-copy keys()/each() shares, substring views). */
     if (a && !STRADA_IS_TAGGED_INT(a) && a->type == STRADA_STR && a->refcount == 1 && a->value.pv
-        && SS_FROM_PV(a->value.pv)->refcount == 1) {
+        && !STRADA_STR_IS_VIEW(a) && SS_FROM_PV(a->value.pv)->refcount == 1) {
         size_t len_a = STRADA_STR_BYTELEN(a);
         size_t new_len = len_a + len_b;
-        /* StradaString.len is uint32_t — abort cleanly rather than truncate. */
-        if (new_len > UINT32_MAX) {
-            fprintf(stderr,
-                    "strada: string concat exceeds 4GB limit (%zu + %zu = %zu)\n",
-                    len_a, len_b, new_len);
-            abort();
-        }
+        strada_u8_index_drop(a);
         /* Incremental ASCII flag — only scan appended bytes */
         int was_ascii = STRADA_STR_IS_ASCII(a);
         size_t new_flags;
@@ -5712,22 +7456,17 @@ StradaValue* strada_concat_inplace_cstr(StradaValue *a, const char *str_b, size_
          * below (both assign a->struct_size = new_flags). */
         if (STRADA_STR_IS_UTF8(a)) new_flags |= STRADA_UTF8_FLAG;
         StradaString *ss = SS_FROM_PV(a->value.pv);
-#ifdef __linux__
-        size_t usable = malloc_usable_size(ss);
-        if (usable >= sizeof(StradaString) + new_len + 1) {
+        if (ss_capacity(a, ss) >= new_len) {
             memcpy(ss->data + len_a, str_b, len_b);
             ss->data[new_len] = '\0';
-            ss->len = (uint32_t)new_len;
+            ss->len = new_len;
             a->struct_size = new_flags;
             return a;
         }
-#endif
-        size_t new_cap = len_a < 64 ? 128 : len_a * 2;
-        if (new_cap < new_len + 1) new_cap = new_len + 1;
-        ss = realloc(ss, sizeof(StradaString) + new_cap);
+        ss = ss_regrow(a, ss, len_a, new_len);
         memcpy(ss->data + len_a, str_b, len_b);
         ss->data[new_len] = '\0';
-        ss->len = (uint32_t)new_len;
+        ss->len = new_len;
         a->value.pv = ss->data;
         a->struct_size = new_flags;
         return a;
@@ -5841,27 +7580,14 @@ StradaValue* strada_concat_multi(int nparts, ...) {
     }
     va_end(ap);
 
-    /* StradaString.len is uint32_t — abort cleanly rather than truncate
-     * (mirrors the concat/join 4GB guards). */
-    if (total > UINT32_MAX) {
-        fprintf(stderr, "strada: string concat exceeds 4GB limit (%zu bytes)\n", total);
-        abort();
-    }
-
-    StradaString *oss = ss_new_uninit((uint32_t)total);
-    char *w = oss->data;
+    StradaValue *rv = strada_str_value_uninit(total);
+    char *w = rv->value.pv;
     for (int i = 0; i < nparts; i++) {
         CMPart *pt = &parts[i];
         if (pt->len > 0) { memcpy(w, pt->p, pt->len); w += pt->len; }
         if (pt->heap) free(pt->heap);
         if (pt->fetched) strada_decref(pt->fetched);
     }
-    *w = '\0';
-
-    StradaValue *rv = strada_value_alloc();
-    rv->type = STRADA_STR;
-    rv->refcount = 1;
-    rv->value.pv = oss->data;
     rv->struct_size = total
                     | (all_ascii ? STRADA_ASCII_FLAG : 0)
                     | (any_utf8 ? STRADA_UTF8_FLAG : 0);
@@ -5887,6 +7613,293 @@ StradaValue* strada_byte_at(StradaValue *str, StradaValue *index) {
     return strada_char_at(str, index);
 }
 
+/* ===== Native scanner for the self-hosted lexer (core::lex_scan) =====
+ *
+ * lex_tokenize() in compiler/Lexer.strada calls this to produce runs of
+ * plain tokens (words, numbers, operators, punctuation, non-interpolating
+ * string literals) straight into token hashes, skipping whitespace and #
+ * comments. It stops at the first thing that needs the full Strada lexer:
+ * ${...} strings, regex and quote-like operators, heredocs, diamonds, POD,
+ * block comments, a bare % (sigil vs modulo is decided by lex_tokenize),
+ * __C__, words not yet in word_types, and EOF. The lexer state
+ * (pos/line/column/expect_regex/after_sigil) is written back as of the
+ * stop point, so lex_next_token resumes exactly where the scan left off
+ * and the token stream is the one lex_next_token alone would produce.
+ * word_types maps a word to its keyword/IDENT token type; the caller
+ * fills it from lex_keyword_or_ident, so the keyword table stays in one
+ * place. Returns the number of tokens appended. */
+static void lex_scan_push(StradaArray *out, StradaValue *type_sv, const unsigned char *s,
+                          int64_t n, int64_t line, int is_word) {
+    StradaValue *tok = strada_new_hash();
+    strada_hash_set_take(tok->value.hv, "type", type_sv);
+    strada_hash_set_take(tok->value.hv, "value", strada_new_str_len((const char *)s, (size_t)n));
+    strada_hash_set_take(tok->value.hv, "line", strada_new_int(line));
+    if (is_word) strada_hash_set_take(tok->value.hv, "is_word", strada_new_int(1));
+    strada_array_push_take(out, strada_new_ref(tok, '%'));
+    strada_decref(tok);
+}
+
+static int lex_scan_word_char(unsigned c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/* Operator/punctuation token at s[0..]: sets *n and may set *re (the next
+ * token may be a regex) or *sig (the next word is a variable name).
+ * Returns NULL for anything lex_next_token must handle. Same precedence as
+ * the comparison chain in lex_next_token. */
+static const char *lex_scan_op(unsigned c, unsigned c2, unsigned c3, int64_t *n, int64_t *re, int64_t *sig) {
+    *n = 2;
+    if (c == '=' && c2 == '=') return "EQ";
+    if (c == '!' && c2 == '=') return "NE";
+    if (c == '<' && ((c2 >= 'A' && c2 <= 'Z') || (c2 >= 'a' && c2 <= 'z') || c2 == '$')) return NULL;
+    if (c == '<' && c2 == '=') {
+        if (c3 == '>') { *n = 3; return "SPACESHIP"; }
+        return "LE";
+    }
+    if (c == '>' && c2 == '=') return "GE";
+    if (c == '&' && c2 == '&') return "AND";
+    if (c == '|' && c2 == '|') return "OR";
+    if (c == '/' && c2 == '/' && c3 == '=') { *n = 3; return "DOR_ASSIGN"; }
+    if (c == '/' && c2 == '/') return "DEFINED_OR";
+    if (c == '<' && c2 == '<') return NULL;  /* shift or heredoc */
+    if (c == '>' && c2 == '>') return "RSHIFT";
+    if (c == ':' && c2 == ':') return "DOUBLE_COLON";
+    if (c == '-' && c2 == '>') return "ARROW";
+    if (c == '=' && c2 == '>') return "FAT_ARROW";
+    if (c == '+' && c2 == '=') return "PLUS_ASSIGN";
+    if (c == '-' && c2 == '=') return "MINUS_ASSIGN";
+    if (c == '+' && c2 == '+') return "PLUSPLUS";
+    if (c == '-' && c2 == '-') return "MINUSMINUS";
+    if (c == '*' && c2 == '*' && c3 == '=') { *n = 3; return "POWER_ASSIGN"; }
+    if (c == '*' && c2 == '*') return "POWER";
+    if (c == '%' && c2 == '=') return "MOD_ASSIGN";
+    if (c == '*' && c2 == '=') return "STAR_ASSIGN";
+    if (c == '/' && c2 == '=') return "SLASH_ASSIGN";
+    if (c == '.' && c2 == '=') return "DOT_ASSIGN";
+    if (c == '=' && c2 == '~') { *re = 1; return "MATCH_OP"; }
+    if (c == '!' && c2 == '~') { *re = 1; return "NOT_MATCH_OP"; }
+    if (c == '.' && c2 == '.') {
+        if (c3 == '.') { *n = 3; return "ELLIPSIS"; }
+        return "RANGE";
+    }
+    *n = 1;
+    switch (c) {
+        case '(': *re = 1; return "LPAREN";
+        case ')': return "RPAREN";
+        case '{': *re = 1; return "LBRACE";
+        case '}': return "RBRACE";
+        case '[': return "LBRACKET";
+        case ']': return "RBRACKET";
+        case ';': *re = 1; return "SEMI";
+        case ',': *re = 1; return "COMMA";
+        case ':': return "COLON";
+        case '$': *sig = 1; return "DOLLAR";
+        case '@': *sig = 1; return "AT";
+        case '+': return "PLUS";
+        case '-': return "MINUS";
+        case '*': return "MULT";
+        case '/': return "DIV";
+        case '.': return "DOT";
+        case '=': return "ASSIGN";
+        case '<': return "LT";
+        case '>': return "GT";
+        case '!': return "NOT";
+        case '\\': return "BACKSLASH";
+        case '&': return "AMPERSAND";
+        case '|': return "PIPE";
+        case '^': return "CARET";
+        case '~': return "TILDE";
+        case '?': return "QUESTION";
+        default: return NULL;  /* a bare %, non-ASCII, stray bytes */
+    }
+}
+
+/* Plain "..." or '...' literal starting at s[pos]: decodes it the way
+ * lex_dq_content / lex_read_sq_string do into a STR_LITERAL value and
+ * returns the index just past the closing quote, or -1 when the literal
+ * needs the Strada lexer (${...} interpolation, \x escapes, EOF). */
+static int64_t lex_scan_string(const unsigned char *s, int64_t len, int64_t pos, StradaValue **val) {
+    unsigned q = s[pos];
+    int64_t e = pos + 1;
+    while (1) {
+        if (e >= len || s[e] == 0) return -1;
+        if (s[e] == q) break;
+        if (s[e] == '\\') {
+            if (e + 1 >= len || s[e + 1] == 0) return -1;
+            if (q == '"' && s[e + 1] == 'x') return -1;
+            e += 2;
+            continue;
+        }
+        if (q == '"' && s[e] == '$' && e + 1 < len && s[e + 1] == '{') return -1;
+        e++;
+    }
+    char *buf = malloc((size_t)(e - pos) + 1);
+    size_t o = 0;
+    for (int64_t i = pos + 1; i < e; i++) {
+        unsigned c = s[i];
+        if (c != '\\') { buf[o++] = (char)c; continue; }
+        unsigned d = s[++i];
+        if (q == '\'') {
+            if (d != '\'' && d != '\\') buf[o++] = '\\';
+            buf[o++] = (char)d;
+            continue;
+        }
+        switch (d) {
+            case 'n': buf[o++] = '\n'; break;
+            case 't': buf[o++] = '\t'; break;
+            case 'r': buf[o++] = '\r'; break;
+            case '0': buf[o++] = 0; break;
+            case 'a': buf[o++] = 7; break;
+            case 'b': buf[o++] = 8; break;
+            case 'f': buf[o++] = 12; break;
+            case 'v': buf[o++] = 11; break;
+            case 'e': buf[o++] = 27; break;
+            default: buf[o++] = (char)d; break;  /* \\ \" \$ and unknown */
+        }
+    }
+    *val = strada_new_str_len(buf, o);
+    free(buf);
+    return e + 1;
+}
+
+StradaValue* strada_lex_scan(StradaValue *lexer, StradaValue *tokens, StradaValue *word_types) {
+    StradaHash *lx = strada_deref_hash(lexer);
+    StradaValue *src_sv = strada_hash_get(lx, "source");
+    if (STRADA_IS_TAGGED_INT(src_sv) || src_sv->type != STRADA_STR || !src_sv->value.pv
+        || strada_to_int(strada_hash_get(lx, "heredoc_pending_semi")) != 0) {
+        return strada_new_int(0);
+    }
+    const unsigned char *s = (const unsigned char *)src_sv->value.pv;
+    int64_t len = (int64_t)STRADA_STR_BYTELEN(src_sv);
+    int64_t pos = strada_to_int(strada_hash_get(lx, "pos"));
+    int64_t line = strada_to_int(strada_hash_get(lx, "line"));
+    int64_t column = strada_to_int(strada_hash_get(lx, "column"));
+    int64_t re = strada_to_int(strada_hash_get(lx, "expect_regex"));
+    int64_t sig = strada_to_int(strada_hash_get(lx, "after_sigil"));
+    StradaArray *out = strada_deref_array(tokens);
+    StradaHash *wt = strada_deref_hash(word_types);
+    int64_t count = 0;
+
+    while (1) {
+        /* Whitespace and line comments. A comment restarts lex_next_token,
+         * which has already dropped the after_sigil flag. */
+        while (pos < len) {
+            unsigned c = s[pos];
+            if (c == '\n') { line++; column = 1; pos++; }
+            else if (c == ' ' || c == '\t' || c == '\r') { column++; pos++; }
+            else if (c == '#') {
+                int64_t e = pos + 1;
+                while (e < len && s[e] != '\n') e++;
+                column += e - pos;
+                pos = e;
+                sig = 0;
+            } else break;
+        }
+        if (pos >= len || s[pos] == 0) break;
+
+        unsigned c = s[pos];
+        unsigned c2 = pos + 1 < len ? s[pos + 1] : 0;
+        unsigned c3 = pos + 2 < len ? s[pos + 2] : 0;
+        if (c == '/' && c2 == '*') break;
+        if (c == '=' && (pos == 0 || s[pos - 1] == '\n')) break;  /* maybe POD */
+
+        int64_t tre = re, tsig = 0, n;
+        if (tre) {
+            if (c == '/' || (c == 's' && c2 == '/') || (c == 'y' && c2 == '/')
+                || (c == 't' && c2 == 'r' && c3 == '/')) break;
+            tre = 0;
+        }
+
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+            int64_t e = pos + 1;
+            while (e < len && lex_scan_word_char(s[e])) e++;
+            n = e - pos;
+            if (sig == 0 && c == 'q' && (n == 1 || (n == 2 && (c2 == 'q' || c2 == 'w')))) break;
+            if (n == 5 && memcmp(s + pos, "__C__", 5) == 0) break;
+            char wbuf[128];
+            if (n >= (int64_t)sizeof(wbuf)) break;
+            memcpy(wbuf, s + pos, (size_t)n);
+            wbuf[n] = '\0';
+            StradaValue *wty = strada_hash_get(wt, wbuf);
+            if (STRADA_IS_TAGGED_INT(wty) || wty->type != STRADA_STR) break;
+            StradaValue *type_sv;
+            if (e + 1 < len && s[e] == ':' && s[e + 1] == ':') {
+                /* Namespace qualifier (str::replace): never a keyword. */
+                type_sv = STRADA_NEW_STR_LIT("IDENT");
+            } else {
+                strada_incref(wty);
+                type_sv = wty;
+            }
+            lex_scan_push(out, type_sv, s + pos, n, line, 1);
+        } else if (c >= '0' && c <= '9') {
+            /* Mirrors lex_read_number: 0x hex, digits, one '.' unless it
+             * starts a '..' range. */
+            int64_t e = pos;
+            int is_hex = 0, is_float = 0;
+            if (c == '0') {
+                e++;
+                if (e < len && (s[e] == 'x' || s[e] == 'X')) { is_hex = 1; e++; }
+            }
+            while (e < len && s[e] != 0) {
+                unsigned d = s[e];
+                if (is_hex) {
+                    if (!isxdigit(d)) break;
+                } else if (d == '.' && !is_float) {
+                    if (e + 1 < len && s[e + 1] == '.') break;
+                    is_float = 1;
+                } else if (d < '0' || d > '9') {
+                    break;
+                }
+                e++;
+            }
+            n = e - pos;
+            lex_scan_push(out, is_float ? STRADA_NEW_STR_LIT("NUM_LITERAL") : STRADA_NEW_STR_LIT("INT_LITERAL"),
+                          s + pos, n, line, 0);
+        } else if (c == '"' || c == '\'') {
+            StradaValue *val;
+            int64_t e = lex_scan_string(s, len, pos, &val);
+            if (e < 0) break;
+            StradaValue *tok = strada_new_hash();
+            strada_hash_set_take(tok->value.hv, "type", STRADA_NEW_STR_LIT("STR_LITERAL"));
+            strada_hash_set_take(tok->value.hv, "value", val);
+            strada_hash_set_take(tok->value.hv, "line", strada_new_int(line));
+            strada_array_push_take(out, strada_new_ref(tok, '%'));
+            strada_decref(tok);
+            /* Literals may span lines; track line/column like lex_advance. */
+            for (int64_t i = pos; i < e; i++) {
+                if (s[i] == '\n') { line++; column = 1; } else { column++; }
+            }
+            pos = e;
+            re = tre;
+            sig = tsig;
+            count++;
+            continue;
+        } else {
+            const char *ty = lex_scan_op(c, c2, c3, &n, &tre, &tsig);
+            if (!ty) break;
+            lex_scan_push(out, strada_new_str_len(ty, strlen(ty)), s + pos, n, line, 0);
+        }
+        pos += n;
+        column += n;
+        re = tre;
+        sig = tsig;
+        count++;
+    }
+
+    strada_hash_set_take(lx, "pos", strada_new_int(pos));
+    strada_hash_set_take(lx, "line", strada_new_int(line));
+    strada_hash_set_take(lx, "column", strada_new_int(column));
+    strada_hash_set_take(lx, "expect_regex", strada_new_int(re));
+    strada_hash_set_take(lx, "after_sigil", strada_new_int(sig));
+    return strada_new_int(count);
+}
+
+/* Alias for the bootstrap codegen path, which emits core::lex_scan as a
+   literal sys_lex_scan(...) call (see sys_file_mtime). */
+StradaValue* sys_lex_scan(StradaValue *lexer, StradaValue *tokens, StradaValue *word_types) {
+    return strada_lex_scan(lexer, tokens, word_types);
+}
+
 /* Returns length in UTF-8 codepoints (characters), not bytes */
 size_t strada_length(const char *s) {
     return utf8_strlen(s);
@@ -5912,16 +7925,11 @@ size_t strada_length_chars_sv(StradaValue *sv) {
          * non-flagged byte string holding valid UTF-8 it disagreed with substr.
          * (Also O(1) for the common ASCII/non-flagged case instead of an O(n)
          * continuation-byte scan.) */
-        if (STRADA_STR_IS_ASCII(sv) || !STRADA_STR_IS_UTF8(sv)
-            || !utf8_is_valid(sv->value.pv, n)) {
-            return n;
-        }
-        const unsigned char *p = (const unsigned char *)sv->value.pv;
-        size_t chars = 0;
-        for (size_t i = 0; i < n; i++) {
-            if ((p[i] & 0xC0) != 0x80) chars++;
-        }
-        return chars;
+        if (STRADA_STR_IS_ASCII(sv) || !STRADA_STR_IS_UTF8(sv)) return n;
+        const StradaU8Index *ix = strada_u8_index(sv, sv->value.pv, n);
+        if (ix) return ix->valid ? ix->chars : n;
+        if (!utf8_is_valid(sv->value.pv, n)) return n;
+        return strada_utf8_count((const unsigned char *)sv->value.pv, n);
     }
     char _tb[256];
     const char *s = strada_to_str_buf(sv, _tb, sizeof(_tb));
@@ -5969,8 +7977,10 @@ StradaValue* strada_substr(StradaValue *str, int64_t offset, int64_t length) {
     const char *s;
     size_t byte_len;
     char _tb[256];
+    /* A real string source; a slice running to its end can be a view. */
+    int src_sv = str && !STRADA_IS_TAGGED_INT(str) && str->type == STRADA_STR && str->value.pv;
 
-    if (str && !STRADA_IS_TAGGED_INT(str) && str->type == STRADA_STR && str->value.pv) {
+    if (src_sv) {
         s = str->value.pv;
         byte_len = STRADA_STR_BYTELEN(str);  /* Binary-safe: masked struct_size */
     } else {
@@ -6011,6 +8021,8 @@ StradaValue* strada_substr(StradaValue *str, int64_t offset, int64_t length) {
              * (the codegen does this for the 2-arg form of substr). */
             length = slen - offset;
         }
+        if (src_sv && offset + length == (int64_t)byte_len)
+            return strada_str_suffix(str, (size_t)offset, (size_t)length);
         return strada_new_str_len(s + offset, (size_t)length);
     }
 
@@ -6019,8 +8031,10 @@ StradaValue* strada_substr(StradaValue *str, int64_t offset, int64_t length) {
      * with raw bytes, etc.) — without the fallback, substr counted
      * orphan continuations as skipped and ended up returning the
      * wrong byte, e.g. `substr(pack("CC", 0xab, 0xcd), 0, 1)` gave
-     * "\xcd" instead of "\xab". */
-    if (!utf8_is_valid(s, byte_len)) {
+     * "\xcd" instead of "\xab". Long strings answer this (and the
+     * codepoint positions below) from their codepoint index. */
+    const StradaU8Index *ix = src_sv ? strada_u8_index(str, s, byte_len) : NULL;
+    if (ix ? !ix->valid : !utf8_is_valid(s, byte_len)) {
         int64_t slen = (int64_t)byte_len;
         if (offset < 0) {
             offset = slen + offset;
@@ -6034,6 +8048,8 @@ StradaValue* strada_substr(StradaValue *str, int64_t offset, int64_t length) {
         } else if (length > slen - offset) {
             length = slen - offset;
         }
+        if (src_sv && offset + length == (int64_t)byte_len)
+            return strada_str_suffix(str, (size_t)offset, (size_t)length);
         return strada_new_str_len(s + offset, (size_t)length);
     }
 
@@ -6046,15 +8062,7 @@ StradaValue* strada_substr(StradaValue *str, int64_t offset, int64_t length) {
                     && str->type == STRADA_STR && STRADA_STR_IS_UTF8(str));
 
     /* UTF-8 path: calculate character length */
-    const unsigned char *p = (const unsigned char *)s;
-    size_t char_len = 0;
-    size_t i = 0;
-    while (i < byte_len) {
-        if (!utf8_is_continuation(p[i])) {
-            char_len++;
-        }
-        i++;
-    }
+    size_t char_len = ix ? ix->chars : strada_utf8_count((const unsigned char *)s, byte_len);
 
     /* Handle negative offset (count from end) — UTF-8 path. Same Perl
      * semantics as ASCII fast path: out-of-bounds → undef, == length → "". */
@@ -6073,38 +8081,48 @@ StradaValue* strada_substr(StradaValue *str, int64_t offset, int64_t length) {
         /* Avoid signed overflow when callers pass INT64_MAX (sentinel). */
         length = char_len - offset;
     }
+    /* The scan below never reaches `offset` when length is 0 and used to
+     * return the string from its start. */
+    if (length == 0) return strada_new_str("");
 
-    /* Find byte positions using binary-safe UTF-8 scanning */
+    /* Find byte positions: from the index, or by binary-safe scanning */
     size_t start_byte = 0;
     size_t end_byte = 0;
-    size_t char_count = 0;
-    p = (const unsigned char *)s;
-    i = 0;
-    while (i < byte_len && char_count < (size_t)(offset + length)) {
-        if (!utf8_is_continuation(p[i])) {
-            if (char_count == (size_t)offset) {
-                start_byte = i;
-            }
-            char_count++;
-            if (char_count == (size_t)(offset + length)) {
-                /* Find the start of the next character */
-                i++;
-                while (i < byte_len && utf8_is_continuation(p[i])) i++;
-                end_byte = i;
-                break;
+    if (ix) {
+        start_byte = strada_u8_char_to_byte(ix, s, (size_t)offset);
+        end_byte = strada_u8_char_to_byte(ix, s, (size_t)(offset + length));
+    } else {
+        const unsigned char *p = (const unsigned char *)s;
+        size_t char_count = 0;
+        size_t i = 0;
+        while (i < byte_len && char_count < (size_t)(offset + length)) {
+            if (!utf8_is_continuation(p[i])) {
+                if (char_count == (size_t)offset) {
+                    start_byte = i;
+                }
+                char_count++;
+                if (char_count == (size_t)(offset + length)) {
+                    /* Find the start of the next character */
+                    i++;
+                    while (i < byte_len && utf8_is_continuation(p[i])) i++;
+                    end_byte = i;
+                    break;
+                }
             }
+            i++;
+        }
+        if (end_byte == 0 && char_count > 0) {
+            end_byte = byte_len;
         }
-        i++;
-    }
-    if (end_byte == 0 && char_count > 0) {
-        end_byte = byte_len;
     }
 
     /* Extract result */
     size_t result_len = end_byte - start_byte;
 
     /* Use strada_new_str_len for binary safety */
-    StradaValue *res = strada_new_str_len(s + start_byte, result_len);
+    StradaValue *res = (src_sv && end_byte == byte_len)
+        ? strada_str_suffix(str, start_byte, result_len)
+        : strada_new_str_len(s + start_byte, result_len);
     /* Inherit the source's char-orientation so length()/further substr on
      * the result count characters, not bytes. */
     if (src_utf8 && res && res->type == STRADA_STR) {
@@ -6120,8 +8138,10 @@ StradaValue* strada_substr_bytes(StradaValue *str, int64_t offset, int64_t lengt
     const char *s;
     size_t byte_len;
     char _tb[256];
+    /* A real string source; a slice running to its end can be a view. */
+    int src_sv = str && !STRADA_IS_TAGGED_INT(str) && str->type == STRADA_STR && str->value.pv;
 
-    if (str && !STRADA_IS_TAGGED_INT(str) && str->type == STRADA_STR && str->value.pv) {
+    if (src_sv) {
         s = str->value.pv;
         byte_len = STRADA_STR_BYTELEN(str);  /* Binary-safe: masked struct_size */
     } else {
@@ -6140,6 +8160,8 @@ StradaValue* strada_substr_bytes(StradaValue *str, int64_t offset, int64_t lengt
     }
 
     /* Extract bytes - use strada_new_str_len for binary safety */
+    if (src_sv && offset + length == (int64_t)byte_len)
+        return strada_str_suffix(str, (size_t)offset, (size_t)length);
     return strada_new_str_len(s + offset, (size_t)length);
 }
 
@@ -6220,18 +8242,7 @@ StradaValue* strada_new_str_like(const char *s, StradaValue *flag_src) {
 size_t byte_to_char_offset(const char *s, size_t byte_offset);
 size_t byte_to_char_offset(const char *s, size_t byte_offset) {
     if (!s) return 0;
-    const unsigned char *p = (const unsigned char *)s;
-    size_t chars = 0;
-    size_t bytes = 0;
-
-    while (*p && bytes < byte_offset) {
-        if (!utf8_is_continuation(*p)) {
-            chars++;
-        }
-        p++;
-        bytes++;
-    }
-    return chars;
+    return strada_utf8_count((const unsigned char *)s, strnlen(s, byte_offset));
 }
 
 /* Returns character position (not byte position) */
@@ -6248,7 +8259,7 @@ int strada_index(const char *haystack, const char *needle) {
 
 /* StradaValue-native index: avoids strada_to_str extraction and skips
  * byte-to-char conversion for ASCII strings (byte offset == char offset).
- * Uses memmem with the explicit byte length so NUL bytes embedded in
+ * Uses strada_memmem with the explicit byte length so NUL bytes embedded in
  * the haystack don't terminate the search early (Perl-compat). */
 int64_t strada_index_sv(StradaValue *haystack_sv, const char *needle) {
     if (!haystack_sv || STRADA_IS_TAGGED_INT(haystack_sv) || !needle) return -1;
@@ -6259,9 +8270,8 @@ int64_t strada_index_sv(StradaValue *haystack_sv, const char *needle) {
     size_t needle_len = strlen(needle);
     /* Empty needle: index returns 0 (matches Perl). */
     if (needle_len == 0) return 0;
-    void *pos = memmem(haystack, haystack_len, needle, needle_len);
-    if (!pos) return -1;
-    size_t byte_off = (size_t)((char *)pos - haystack);
+    size_t byte_off = strada_memmem(haystack, haystack_len, 0, needle, needle_len);
+    if (byte_off == STRADA_NOT_FOUND) return -1;
     /* Char-vs-byte offset must mirror strada_substr's flag-governed model so
      * that substr($s, index($s,$needle), $n) round-trips. substr returns a
      * BYTE-indexed slice unless the string is non-ASCII AND UTF-8-flagged AND
@@ -6271,10 +8281,11 @@ int64_t strada_index_sv(StradaValue *haystack_sv, const char *needle) {
      * string whose bytes happen to form valid UTF-8 it returned a CHARACTER
      * offset while substr expected a BYTE offset — the two disagreed and the
      * slice was shifted. */
-    if (STRADA_STR_IS_ASCII(haystack_sv) || !STRADA_STR_IS_UTF8(haystack_sv)
-        || !utf8_is_valid(haystack, haystack_len)) {
+    if (STRADA_STR_IS_ASCII(haystack_sv) || !STRADA_STR_IS_UTF8(haystack_sv))
         return (int64_t)byte_off;
-    }
+    const StradaU8Index *ix = strada_u8_index(haystack_sv, haystack, haystack_len);
+    if (ix) return ix->valid ? (int64_t)strada_u8_byte_to_char(ix, haystack, byte_off) : (int64_t)byte_off;
+    if (!utf8_is_valid(haystack, haystack_len)) return (int64_t)byte_off;
     return (int64_t)byte_to_char_offset(haystack, byte_off);
 }
 
@@ -6300,14 +8311,16 @@ int64_t strada_index_sv2(StradaValue *haystack_sv, StradaValue *needle_sv, int64
      * model so index offsets are in the same unit substr expects (see the
      * note in strada_index_sv). Byte-oriented otherwise (offset == byte). */
     int haystack_char_oriented = 0;
+    const StradaU8Index *ix = NULL;
     if (!STRADA_IS_TAGGED_INT(haystack_sv) && haystack_sv->type == STRADA_STR && haystack_sv->value.pv) {
         haystack = haystack_sv->value.pv;
         haystack_len = STRADA_STR_BYTELEN(haystack_sv);
         if (haystack_len == 0) haystack_len = strlen(haystack);
         haystack_is_ascii = STRADA_STR_IS_ASCII(haystack_sv);
-        haystack_char_oriented = (!haystack_is_ascii
-            && STRADA_STR_IS_UTF8(haystack_sv)
-            && utf8_is_valid(haystack, haystack_len));
+        if (!haystack_is_ascii && STRADA_STR_IS_UTF8(haystack_sv)) {
+            ix = strada_u8_index(haystack_sv, haystack, haystack_len);
+            haystack_char_oriented = ix ? ix->valid : utf8_is_valid(haystack, haystack_len);
+        }
     } else {
         haystack_tmp = strada_to_str(haystack_sv);
         if (!haystack_tmp) return -1;
@@ -6335,15 +8348,17 @@ int64_t strada_index_sv2(StradaValue *haystack_sv, StradaValue *needle_sv, int64
         if (offset > 0) {
             if (!haystack_char_oriented) {
                 start_byte = (size_t)offset;
+            } else if (ix) {
+                start_byte = strada_u8_char_to_byte(ix, haystack, (size_t)offset);
             } else {
                 start_byte = utf8_offset(haystack, (size_t)offset);
             }
             if (start_byte >= haystack_len) goto done;
         }
-        void *pos = memmem(haystack + start_byte, haystack_len - start_byte, needle, needle_len);
-        if (pos) {
-            size_t byte_off = (size_t)((char *)pos - haystack);
+        size_t byte_off = strada_memmem(haystack, haystack_len, start_byte, needle, needle_len);
+        if (byte_off != STRADA_NOT_FOUND) {
             if (!haystack_char_oriented) result = (int64_t)byte_off;
+            else if (ix) result = (int64_t)strada_u8_byte_to_char(ix, haystack, byte_off);
             else result = (int64_t)byte_to_char_offset(haystack, byte_off);
         }
     }
@@ -6353,6 +8368,152 @@ done:
     return result;
 }
 
+/* rindex over StradaValues: binary-safe and flag-governed like
+ * strada_index_sv2, searching backwards from the end so the common
+ * "last separator" case touches only the tail of the haystack. */
+int64_t strada_rindex_sv(StradaValue *haystack_sv, StradaValue *needle_sv) {
+    if (!haystack_sv || !needle_sv) return -1;
+    char *haystack_tmp = NULL;
+    char *needle_tmp = NULL;
+    const char *haystack;
+    size_t haystack_len;
+    int haystack_char_oriented = 0;
+    const StradaU8Index *ix = NULL;
+    if (!STRADA_IS_TAGGED_INT(haystack_sv) && haystack_sv->type == STRADA_STR && haystack_sv->value.pv) {
+        haystack = haystack_sv->value.pv;
+        haystack_len = STRADA_STR_BYTELEN(haystack_sv);
+        if (haystack_len == 0) haystack_len = strlen(haystack);
+        if (!STRADA_STR_IS_ASCII(haystack_sv) && STRADA_STR_IS_UTF8(haystack_sv)) {
+            ix = strada_u8_index(haystack_sv, haystack, haystack_len);
+            haystack_char_oriented = ix ? ix->valid : utf8_is_valid(haystack, haystack_len);
+        }
+    } else {
+        haystack_tmp = strada_to_str(haystack_sv);
+        if (!haystack_tmp) return -1;
+        haystack = haystack_tmp;
+        haystack_len = strlen(haystack);
+    }
+    const char *needle;
+    size_t needle_len;
+    if (!STRADA_IS_TAGGED_INT(needle_sv) && needle_sv->type == STRADA_STR && needle_sv->value.pv) {
+        needle = needle_sv->value.pv;
+        needle_len = STRADA_STR_BYTELEN(needle_sv);
+        if (needle_len == 0) needle_len = strlen(needle);
+    } else {
+        needle_tmp = strada_to_str(needle_sv);
+        if (!needle_tmp) { if (haystack_tmp) free(haystack_tmp); return -1; }
+        needle = needle_tmp;
+        needle_len = strlen(needle);
+    }
+    int64_t result = -1;
+    size_t byte_off = haystack_len;
+    int found = 0;
+    if (needle_len == 0) {
+        /* Empty needle matches past the end (Perl) */
+        found = 1;
+    } else if (needle_len <= haystack_len) {
+        byte_off = strada_memrmem(haystack, haystack_len, needle, needle_len);
+        found = byte_off != STRADA_NOT_FOUND;
+    }
+    if (found) {
+        if (!haystack_char_oriented) result = (int64_t)byte_off;
+        else if (ix) result = (int64_t)strada_u8_byte_to_char(ix, haystack, byte_off);
+        else result = (int64_t)byte_to_char_offset(haystack, byte_off);
+    }
+    if (haystack_tmp) free(haystack_tmp);
+    if (needle_tmp) free(needle_tmp);
+    return result;
+}
+
+/* Bytes to search for the StradaSearcher entry points: a STR's own bytes,
+ * otherwise its string form in *tmp (caller frees). */
+static const char *strada_search_subject(StradaValue *sv, size_t *len, char **tmp) {
+    *tmp = NULL;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv) {
+        *len = STRADA_STR_BYTELEN(sv);
+        if (*len == 0) *len = strlen(sv->value.pv);   /* as strada_index_sv2 */
+        return sv->value.pv;
+    }
+    *tmp = sv ? strada_to_str(sv) : NULL;
+    *len = *tmp ? strlen(*tmp) : 0;
+    return *tmp ? *tmp : "";
+}
+
+/* index() through a precompiled searcher: the literal-needle call sites
+ * build one once and keep it. Offsets are in the units strada_index_sv2
+ * uses, and a multi-needle searcher reports the leftmost match of any. */
+int64_t strada_index_searcher(StradaValue *haystack_sv, StradaSearcher *s, int64_t offset) {
+    if (!haystack_sv || !s) return -1;
+    size_t hl;
+    char *tmp;
+    const char *h = strada_search_subject(haystack_sv, &hl, &tmp);
+    int char_oriented = 0;
+    const StradaU8Index *ix = NULL;
+    if (!tmp && !STRADA_STR_IS_ASCII(haystack_sv) && STRADA_STR_IS_UTF8(haystack_sv)) {
+        ix = strada_u8_index(haystack_sv, h, hl);
+        char_oriented = ix ? ix->valid : utf8_is_valid(h, hl);
+    }
+    size_t start = 0;
+    if (offset > 0) {
+        if (!char_oriented) start = (size_t)offset;
+        else if (ix) start = strada_u8_char_to_byte(ix, h, (size_t)offset);
+        else start = utf8_offset(h, (size_t)offset);
+    }
+    int64_t result = -1;
+    size_t which;
+    size_t at = strada_searcher_find(s, h, hl, start, &which);
+    if (at != STRADA_NOT_FOUND) {
+        if (!char_oriented) result = (int64_t)at;
+        else if (ix) result = (int64_t)strada_u8_byte_to_char(ix, h, at);
+        else result = (int64_t)byte_to_char_offset(h, at);
+    }
+    if (tmp) free(tmp);
+    return result;
+}
+
+/* core::index_any(str, \@needles [, offset]): leftmost position of any of
+ * the needles, or -1. The searcher is built per call; literal needle lists
+ * get a cached one from the code generator instead. */
+int64_t strada_index_any(StradaValue *haystack_sv, StradaValue *needles_sv, int64_t offset) {
+    StradaArray *av = needles_sv ? strada_deref_array(needles_sv) : NULL;
+    size_t count = av ? strada_array_length(av) : 0;
+    if (count == 0) return -1;
+    const char **needles = malloc(count * sizeof(char *));
+    size_t *lens = malloc(count * sizeof(size_t));
+    char **tmps = malloc(count * sizeof(char *));
+    for (size_t k = 0; k < count; k++)
+        needles[k] = strada_search_subject(strada_array_get(av, (int64_t)k), &lens[k], &tmps[k]);
+    StradaSearcher *s = strada_searcher_new_multi(count, needles, lens);
+    for (size_t k = 0; k < count; k++) if (tmps[k]) free(tmps[k]);
+    free(needles);
+    free(lens);
+    free(tmps);
+    int64_t result = strada_index_searcher(haystack_sv, s, offset);
+    strada_searcher_free(s);
+    return result;
+}
+
+/* split() on literal separators (one, or an alternation of several) through
+ * the call site's searcher. Binary-safe; pieces keep the subject's UTF-8
+ * flag. Same shape as strada_string_split: trailing empty fields stay. */
+StradaArray* strada_split_searcher(StradaValue *str_sv, StradaSearcher *s) {
+    StradaArray *parts = strada_array_new();
+    size_t hl;
+    char *tmp;
+    const char *h = strada_search_subject(str_sv, &hl, &tmp);
+    int utf8 = !tmp && str_sv && STRADA_STR_IS_UTF8(str_sv);
+    size_t p = 0, at, which;
+    while (s && !s->has_empty && (at = strada_searcher_find(s, h, hl, p, &which)) != STRADA_NOT_FOUND) {
+        strada_array_push_take(parts, utf8 ? strada_new_str_len_utf8(h + p, at - p)
+                                           : strada_new_str_len(h + p, at - p));
+        p = at + s->len[which];
+    }
+    strada_array_push_take(parts, utf8 ? strada_new_str_len_utf8(h + p, hl - p)
+                                       : strada_new_str_len(h + p, hl - p));
+    if (tmp) free(tmp);
+    return parts;
+}
+
 int strada_index_offset(const char *haystack, const char *needle, int offset) {
     if (!haystack || !needle) return -1;
     if (offset < 0) offset = 0;
@@ -6372,6 +8533,63 @@ int strada_index_offset(const char *haystack, const char *needle, int offset) {
 
 /* ===== I/O FUNCTIONS ===== */
 
+/* Payloads at least this large skip the stdio / socket buffers: whatever is
+ * pending is flushed and the payload goes to the descriptor with writev, so
+ * a multi-GB string is written straight from its own bytes (no 8 KB socket
+ * copies, and say's newline rides in the same syscall). */
+#define STRADA_DIRECT_WRITE_MIN (64 * 1024)
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* Write every byte of iov[0..n) to fd, retrying short writes (Linux caps a
+ * single write near 2 GiB) and EINTR. Consumes iov. Returns bytes written,
+ * or -1 when the first write fails. */
+static ssize_t strada_writev_all(int fd, struct iovec *iov, int n) {
+    size_t total = 0;
+    while (n > 0) {
+        if (iov->iov_len == 0) { iov++; n--; continue; }
+        ssize_t w = writev(fd, iov, n > IOV_MAX ? IOV_MAX : n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return total ? (ssize_t)total : -1;
+        }
+        total += (size_t)w;
+        while (n > 0 && (size_t)w >= iov->iov_len) { w -= (ssize_t)iov->iov_len; iov++; n--; }
+        if (n > 0) { iov->iov_base = (char *)iov->iov_base + w; iov->iov_len -= (size_t)w; }
+    }
+    return (ssize_t)total;
+}
+
+/* Large write to a stdio stream: flush what is buffered, then writev the
+ * payload (plus an optional trailer such as say's "\n") to the descriptor.
+ * Returns 0 when the stream has no descriptor (open_memstream, tied
+ * in-memory handles) so the caller falls back to fwrite. */
+static int strada_stream_write_direct(FILE *fp, const char *data, size_t len,
+                                      const char *trailer, size_t trailer_len) {
+    int fd = fileno(fp);
+    if (fd < 0 || fflush(fp) != 0) return 0;
+    struct iovec iov[2] = {
+        { (void *)data, len },
+        { (void *)trailer, trailer_len },
+    };
+    strada_writev_all(fd, iov, trailer_len ? 2 : 1);
+    return 1;
+}
+
+/* Large write to a buffered socket: pending bytes, payload and trailer go
+ * out in one writev instead of being copied through the 8 KB buffer. */
+static void socket_write_direct(StradaSocketBuffer *sb, const char *data, size_t len,
+                                const char *trailer, size_t trailer_len) {
+    struct iovec iov[3] = {
+        { sb->write_buf, sb->write_len },
+        { (void *)data, len },
+        { (void *)trailer, trailer_len },
+    };
+    strada_writev_all(sb->fd, iov, 3);
+    sb->write_len = 0;
+}
+
 /* Print/say drop the per-call fflush(stdout). Perl's stdout is fully
  * buffered when stdout is not a tty (the libc default), and warning
  * output to stderr therefore appears *before* the buffered stdout
@@ -6417,7 +8635,7 @@ void strada_print(StradaValue *sv) {
         if (av) {
             for (size_t i = 0; i < av->size; i++) {
                 if (i > 0 && sep_len > 0) { fwrite(sep, 1, sep_len, stdout); }
-                StradaValue *e = av->elements[av->head + i];
+                StradaValue *e = av_at(av, i);
                 if (e && !STRADA_IS_TAGGED_INT(e) && e->type == STRADA_REF) {
                     char *es = strada_to_str(e);
                     if (es) { fputs(es, stdout); free(es); }
@@ -6439,6 +8657,8 @@ void strada_print(StradaValue *sv) {
          * the UTF-8 byte payload mid-multibyte. */
         size_t bl = STRADA_STR_BYTELEN(sv);
         if (bl == 0) bl = strlen(sv->value.pv);
+        if (bl >= STRADA_DIRECT_WRITE_MIN && strada_stream_write_direct(stdout, sv->value.pv, bl, NULL, 0))
+            return;
         fwrite(sv->value.pv, 1, bl, stdout);
         return;
     }
@@ -6464,6 +8684,10 @@ void strada_say(StradaValue *sv) {
         putchar('\n');
         return;
     }
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv
+        && STRADA_STR_BYTELEN(sv) >= STRADA_DIRECT_WRITE_MIN
+        && strada_stream_write_direct(stdout, sv->value.pv, STRADA_STR_BYTELEN(sv), "\n", 1))
+        return;
     char _tb[256];
     const char *str = strada_to_str_buf(sv, _tb, sizeof(_tb));
     printf("%s\n", str);
@@ -6529,11 +8753,14 @@ void strada_print_fh(StradaValue *sv, StradaValue *fh) {
     }
 
     if (redir_stream) {
+        if (len >= STRADA_DIRECT_WRITE_MIN && strada_stream_write_direct(redir_stream, str, len, NULL, 0))
+            return;
         fwrite(str, 1, len, redir_stream);
         return;
     }
     if (fh->type == STRADA_FILEHANDLE && fh->value.fh) {
-        fwrite(str, 1, len, fh->value.fh);
+        if (len < STRADA_DIRECT_WRITE_MIN || !strada_stream_write_direct(fh->value.fh, str, len, NULL, 0))
+            fwrite(str, 1, len, fh->value.fh);
         /* For `open my $fh, ">", \$scalar` filehandles, mirror the
          * write to the backing scalar so the user sees the latest
          * content before close(). Perl's PerlIO::scalar layer flushes
@@ -6541,6 +8768,10 @@ void strada_print_fh(StradaValue *sv, StradaValue *fh) {
          * defers the buffer pointer update until fflush. */
         strada_fh_writeback_sync(fh->value.fh);
     } else if (fh->type == STRADA_SOCKET && fh->value.sock) {
+        if (len >= STRADA_DIRECT_WRITE_MIN) {
+            socket_write_direct(fh->value.sock, str, len, NULL, 0);
+            return;
+        }
         socket_buffered_write(fh->value.sock, str, len);
         /* Flush if data ends with newline (line-buffered behavior) */
         if (len > 0 && str[len - 1] == '\n') {
@@ -6564,16 +8795,31 @@ void strada_say_fh(StradaValue *sv, StradaValue *fh) {
     }
 
     char _tb[256];
-    const char *str = strada_to_str_buf(sv, _tb, sizeof(_tb));
-    size_t len = strlen(str);
+    const char *str;
+    size_t len;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv) {
+        /* Binary-safe BYTE length, as in strada_print_fh */
+        str = sv->value.pv;
+        len = STRADA_STR_BYTELEN(sv);
+        if (len == 0) len = strlen(str);
+    } else {
+        str = strada_to_str_buf(sv, _tb, sizeof(_tb));
+        len = strlen(str);
+    }
 
     if (fh->type == STRADA_FILEHANDLE && fh->value.fh) {
-        fputs(str, fh->value.fh);
-        fputs("\n", fh->value.fh);
-        fflush(fh->value.fh);
+        if (len < STRADA_DIRECT_WRITE_MIN || !strada_stream_write_direct(fh->value.fh, str, len, "\n", 1)) {
+            fwrite(str, 1, len, fh->value.fh);
+            fputc('\n', fh->value.fh);
+            fflush(fh->value.fh);
+        }
         /* Sync backing scalar for in-memory `open ..., \$scalar`. */
         strada_fh_writeback_sync(fh->value.fh);
     } else if (fh->type == STRADA_SOCKET && fh->value.sock) {
+        if (len >= STRADA_DIRECT_WRITE_MIN) {
+            socket_write_direct(fh->value.sock, str, len, "\n", 1);
+            return;
+        }
         socket_buffered_write(fh->value.sock, str, len);
         socket_buffered_write(fh->value.sock, "\n", 1);
         /* Flush on newline for line-buffered behavior */
@@ -6868,11 +9114,10 @@ static int strada_spf_fast_fixed(const char *spec_buf, double v, char *dst) {
 }
 
 /* Fast formatter for simple %e/%E/%g/%G specs (optional '-'/'0' flags,
- * width, precision <= 16). Same ambiguity-guard discipline as
- * strada_spf_fast_fixed: long-double scaling with margins wide enough to
- * cover powl/divide rounding; any close call (rounding ties, exponent-
- * boundary values) returns -1 and the caller uses snprintf, so emitted
- * output is bit-identical to glibc. */
+ * width, precision <= 16). Digits come from strada_round_digits, which
+ * is exact; any close call it cannot settle (rounding ties, subnormals)
+ * returns -1 and the caller uses snprintf, so emitted output is
+ * bit-identical to glibc. */
 static int strada_spf_fast_efg(const char *spec_buf, double v, char *dst) {
     const char *p = spec_buf;
     if (*p++ != '%') return -1;
@@ -6909,36 +9154,9 @@ static int strada_spf_fast_efg(const char *spec_buf, double v, char *dst) {
     int neg = signbit(v) ? 1 : 0;
     double a = fabs(v);
     if (a == 0.0) return -1;         /* zero has its own formatting rules; rare — snprintf */
-    if (a < 1e-290 || a > 1e290) return -1;   /* keep the error analysis honest */
-
-    /* decimal exponent estimate + correction */
-    int e10 = (int)floor(log10(a));
-    long double scaled = 0.0L;
-    uint64_t lo = 0, hi = 0;
-    for (int tries = 0; tries < 3; tries++) {
-        long double factor = powl(10.0L, mdigits - e10);
-        scaled = (long double)a * factor;
-        lo = 1; for (int k = 0; k < mdigits; k++) lo *= 10;       /* 10^mdigits */
-        hi = lo * 10;
-        if (scaled < (long double)lo) { e10--; continue; }
-        if (scaled >= (long double)hi) { e10++; continue; }
-        break;
-    }
-    if (scaled < (long double)lo || scaled >= (long double)hi) return -1;
-    /* boundary guard: if scaled sits within margin of lo or hi, the
-     * exponent itself is ambiguous — decline */
-    long double bmargin = scaled * 0x1p-56L;
-    if (scaled - (long double)lo < bmargin || (long double)hi - scaled < bmargin) return -1;
-
-    long double fl = floorl(scaled);
-    long double frac = scaled - fl;
-    long double dist = frac > 0.5L ? frac - 0.5L : 0.5L - frac;
-    if (dist <= scaled * 0x1p-56L + 0x1p-56L) return -1;
-    uint64_t r = (uint64_t)fl + (frac > 0.5L ? 1 : 0);
-    if (r >= hi) { /* rounding carried into a new digit */
-        if (r % 10 != 0) return -1;   /* shouldn't happen; be safe */
-        r /= 10; e10++;
-    }
+    uint64_t r;
+    int e10;
+    if (!strada_round_digits(a, mdigits + 1, &r, &e10)) return -1;
 
     /* r has exactly mdigits+1 digits: d.ddd... with exponent e10 */
     char digs[20] = {0};
@@ -6951,32 +9169,7 @@ static int strada_spf_fast_efg(const char *spec_buf, double v, char *dst) {
     char body[STRADA_SPF_FASTINT_MAX];
     char *o = body;
     if (is_g) {
-        /* choose %f-style or %e-style per C rules: e-style when
-         * e10 < -4 or e10 >= gprec; strip trailing zeros (no '#'). */
-        int lastnz = nd - 1;
-        while (lastnz > 0 && digs[lastnz] == '0') lastnz--;
-        if (e10 < -4 || e10 >= gprec) {
-            *o++ = digs[0];
-            if (lastnz >= 1) {
-                *o++ = '.';
-                for (int k = 1; k <= lastnz; k++) *o++ = digs[k];
-            }
-            *o++ = upper ? 'E' : 'e';
-            int ae = e10 < 0 ? -e10 : e10;
-            *o++ = e10 < 0 ? '-' : '+';
-            if (ae >= 100) { *o++ = (char)('0' + ae / 100); ae %= 100; *o++ = (char)('0' + ae / 10); *o++ = (char)('0' + ae % 10); }
-            else { *o++ = (char)('0' + ae / 10); *o++ = (char)('0' + ae % 10); }
-        } else if (e10 >= 0) {
-            for (int k = 0; k <= e10; k++) *o++ = k < nd ? digs[k] : '0';
-            if (lastnz > e10) {
-                *o++ = '.';
-                for (int k = e10 + 1; k <= lastnz; k++) *o++ = digs[k];
-            }
-        } else {
-            *o++ = '0'; *o++ = '.';
-            for (int k = 0; k < -e10 - 1; k++) *o++ = '0';
-            for (int k = 0; k <= lastnz; k++) *o++ = digs[k];
-        }
+        o = strada_g_body(o, digs, nd, e10, gprec, upper);
     } else {
         *o++ = digs[0];
         if (mdigits > 0) {
@@ -7183,19 +9376,134 @@ static void spf_op_spec(const SpfOp *op, char *spec) {
     *o = '\0';
 }
 
-static StradaValue* strada_sprintf_sv_args(StradaValue *format_sv,
-                                           StradaValue **arg_arr,
-                                           int collected) {
-    char _tb[256];
-    const char *format = format_sv ? strada_to_str_buf(format_sv, _tb, sizeof(_tb)) : NULL;
-    if (!format) return strada_new_str("");
-
-    /* Growable heap output buffer — the old fixed 64KB stack buffer
-     * silently truncated wider results (e.g. `%99999d`, long %s args).
-     * SPRINTF_GROW(n) guarantees room for n more bytes plus the NUL.
-     *
-     * Throw safety: stringifying an argument can run a '""' overload that
-     * throws (longjmp past this frame). Wrap the buffer in a CSTRUCT guard
+/* ===== Output sinks =====
+ * `print(sprintf(...))`, `say($fh, join(...))` and `$s .= sprintf(...)`
+ * used to build a fresh result string only to copy it once more into the
+ * stream or the target string. The streaming entry points below
+ * (strada_printf_fh, strada_join_to, strada_sprintf_append,
+ * strada_join_append) format into a sink instead: a stdio stream, a
+ * socket buffer, a string appended in place, or a StringBuilder.
+ * strada_sink_open_fh declines handles with extra write semantics (the
+ * SSL write hook, string handles under say); callers then take the
+ * ordinary print path so behavior stays identical. */
+enum { STRADA_SINK_FILE, STRADA_SINK_SOCK, STRADA_SINK_STR, STRADA_SINK_SB };
+
+typedef struct StradaSink {
+    int kind;
+    FILE *fp;                   /* FILE */
+    StradaValue *fh;            /* FILE/SOCK: handle (NULL for plain stdout/stderr) */
+    StradaSocketBuffer *sock;   /* SOCK */
+    StradaValue *dst;           /* STR: current value, replaced as it grows */
+    StradaStringBuilder *sb;    /* SB */
+    int last;                   /* last byte written, -1 if none */
+    int utf8;                   /* some piece was char-oriented (SVf_UTF8) */
+} StradaSink;
+
+static int strada_sink_open_fh(StradaSink *k, StradaValue *fh, int newline) {
+    memset(k, 0, sizeof(*k));
+    k->last = -1;
+    if (!fh) fh = strada_default_output;
+    if (!fh) { k->kind = STRADA_SINK_FILE; k->fp = stdout; return 1; }
+    if (STRADA_IS_TAGGED_INT(fh) || strada_fh_write_hook) return 0;
+    if (fh->type == STRADA_FILEHANDLE && fh->value.fh) {
+        k->kind = STRADA_SINK_FILE; k->fp = fh->value.fh; k->fh = fh;
+        return 1;
+    }
+    if (fh->type == STRADA_SOCKET && fh->value.sock) {
+        k->kind = STRADA_SINK_SOCK; k->sock = fh->value.sock; k->fh = fh;
+        return 1;
+    }
+    if (!newline && fh->type == STRADA_STR && fh->value.pv) {
+        if (strcmp(fh->value.pv, "STDOUT") == 0) { k->kind = STRADA_SINK_FILE; k->fp = stdout; return 1; }
+        if (strcmp(fh->value.pv, "STDERR") == 0) { k->kind = STRADA_SINK_FILE; k->fp = stderr; return 1; }
+    }
+    return 0;
+}
+
+static void strada_sink_open_append(StradaSink *k, StradaValue *dst) {
+    memset(k, 0, sizeof(*k));
+    k->last = -1;
+    if (dst && !STRADA_IS_TAGGED_INT(dst) && dst->type == STRADA_CPOINTER && dst->value.ptr
+        && dst->meta && dst->meta->struct_name && strcmp(dst->meta->struct_name, "StringBuilder") == 0) {
+        k->kind = STRADA_SINK_SB;
+        k->sb = (StradaStringBuilder*)dst->value.ptr;
+    } else {
+        k->kind = STRADA_SINK_STR;
+    }
+    k->dst = dst;
+}
+
+static void strada_sink_write(StradaSink *k, const char *p, size_t n) {
+    if (n == 0) return;
+    k->last = (unsigned char)p[n - 1];
+    switch (k->kind) {
+    case STRADA_SINK_FILE:
+        if (n < STRADA_DIRECT_WRITE_MIN || !strada_stream_write_direct(k->fp, p, n, NULL, 0))
+            fwrite(p, 1, n, k->fp);
+        break;
+    case STRADA_SINK_SOCK:
+        if (n >= STRADA_DIRECT_WRITE_MIN) socket_write_direct(k->sock, p, n, NULL, 0);
+        else socket_buffered_write(k->sock, p, n);
+        break;
+    case STRADA_SINK_STR:
+        k->dst = strada_concat_inplace_cstr(k->dst, p, n);
+        break;
+    case STRADA_SINK_SB: {
+        StradaStringBuilder *sb = k->sb;
+        if (sb->length + n + 1 > sb->capacity) {
+            while (sb->length + n + 1 > sb->capacity) sb->capacity *= 2;
+            sb->buffer = sr_xrealloc(sb->buffer, sb->capacity);
+        }
+        memcpy(sb->buffer + sb->length, p, n);
+        sb->length += n;
+        sb->buffer[sb->length] = '\0';
+        break;
+    }
+    }
+}
+
+/* Finish a write: the newline for say, then the same flushing the
+ * print/say entry points do for this kind of handle. A STR sink picks up
+ * SVf_UTF8 when any formatted piece was char-oriented. */
+static void strada_sink_close(StradaSink *k, int newline) {
+    if (newline) strada_sink_write(k, "\n", 1);
+    switch (k->kind) {
+    case STRADA_SINK_FILE:
+        if (k->fh) {
+            if (newline) fflush(k->fp);
+            strada_fh_writeback_sync(k->fp);
+        }
+        break;
+    case STRADA_SINK_SOCK:
+        if (k->last == '\n' && k->sock->write_len > 0) {
+            send(k->sock->fd, k->sock->write_buf, k->sock->write_len, 0);
+            k->sock->write_len = 0;
+        }
+        break;
+    case STRADA_SINK_STR:
+        /* Nothing appended still yields a string, as `.=` would */
+        if (k->last < 0) k->dst = strada_concat_inplace_cstr(k->dst, "", 0);
+        if (k->utf8 && k->dst && !STRADA_IS_TAGGED_INT(k->dst) && k->dst->type == STRADA_STR)
+            k->dst->struct_size |= STRADA_UTF8_FLAG;
+        break;
+    }
+}
+
+/* With a sink the result is written there and NULL is returned. */
+static StradaValue* strada_sprintf_sv_args(StradaValue *format_sv,
+                                           StradaValue **arg_arr,
+                                           int collected,
+                                           StradaSink *sink) {
+    char _tb[256];
+    const char *format = format_sv ? strada_to_str_buf(format_sv, _tb, sizeof(_tb)) : NULL;
+    if (!format) return sink ? NULL : strada_new_str("");
+
+    /* Growable heap output buffer — the old fixed 64KB stack buffer
+     * silently truncated wider results (e.g. `%99999d`, long %s args).
+     * SPRINTF_GROW(n) guarantees room for n more bytes plus the NUL.
+     *
+     * Throw safety: stringifying an argument can run a '""' overload that
+     * throws (longjmp past this frame). Wrap the buffer in a CSTRUCT guard
      * on the cleanup stack — strada_free_value frees value.ptr — so the
      * catch handler's drain reclaims it (same pattern as strada_sortbuf_new
      * for the inlined sort). The guard's ptr is re-synced after realloc. */
@@ -7232,7 +9540,7 @@ static StradaValue* strada_sprintf_sv_args(StradaValue *format_sv,
             if (!spg_nb) { \
                 if (buf_guard) { strada_cleanup_pop(); strada_decref(buf_guard); } \
                 free(spec_res); \
-                return strada_new_str(""); \
+                return sink ? NULL : strada_new_str(""); \
             } \
             if (!buf_guard) { \
                 buf_guard = (StradaValue*)malloc(sizeof(StradaValue)); \
@@ -8061,7 +10369,11 @@ spf_finalize:
     /* Use _len constructor so embedded NULs (e.g. `sprintf("a%cb", 0)`)
      * survive. The NUL terminator is appended by strada_new_str_len. */
     StradaValue *result_sv;
-    if (any_utf8) {
+    if (sink) {
+        strada_sink_write(sink, buffer, (size_t)(out - buffer));
+        if (any_utf8) sink->utf8 = 1;
+        result_sv = NULL;
+    } else if (any_utf8) {
         result_sv = strada_new_str_len_utf8(buffer, (size_t)(out - buffer));
     } else {
         result_sv = strada_new_str_len(buffer, (size_t)(out - buffer));
@@ -8074,32 +10386,35 @@ spf_finalize:
 #undef SPRINTF_GROW
 }
 
-/* Public varargs wrapper. */
-StradaValue* strada_sprintf_sv(StradaValue *format_sv, int arg_count, ...) {
-    StradaValue *arg_arr[256];
+/* Gather varargs into arg_arr, flattening any STRADA_ARRAY arg into its
+ * elements. Perl: sprintf("%d %d %d", @a) expands @a in list context.
+ * Without this, @a was passed as one arg (the whole array) and printed
+ * as nothing or the array's bogus string. */
+static int strada_sprintf_collect(StradaValue **arg_arr, int max, int arg_count, va_list ap) {
     int collected = 0;
-    {
-        va_list collect;
-        va_start(collect, arg_count);
-        for (int i = 0; i < arg_count && collected < (int)(sizeof(arg_arr)/sizeof(arg_arr[0])); i++) {
-            StradaValue *a = va_arg(collect, StradaValue*);
-            /* Flatten any STRADA_ARRAY arg into individual elements.
-             * Perl: sprintf("%d %d %d", @a) expands @a in list context.
-             * Without this, @a was passed as one arg (the whole array)
-             * and printed as nothing or the array's bogus string. */
-            if (a && !STRADA_IS_TAGGED_INT(a) && a->type == STRADA_ARRAY) {
-                StradaArray *av = a->value.av;
-                int n = av ? (int)strada_array_length(av) : 0;
-                for (int j = 0; j < n && collected < (int)(sizeof(arg_arr)/sizeof(arg_arr[0])); j++) {
-                    arg_arr[collected++] = strada_array_get(av, j);
-                }
-            } else {
-                arg_arr[collected++] = a;
+    for (int i = 0; i < arg_count && collected < max; i++) {
+        StradaValue *a = va_arg(ap, StradaValue*);
+        if (a && !STRADA_IS_TAGGED_INT(a) && a->type == STRADA_ARRAY) {
+            StradaArray *av = a->value.av;
+            int n = av ? (int)strada_array_length(av) : 0;
+            for (int j = 0; j < n && collected < max; j++) {
+                arg_arr[collected++] = strada_array_get(av, j);
             }
+        } else {
+            arg_arr[collected++] = a;
         }
-        va_end(collect);
     }
-    return strada_sprintf_sv_args(format_sv, arg_arr, collected);
+    return collected;
+}
+
+/* Public varargs wrapper. */
+StradaValue* strada_sprintf_sv(StradaValue *format_sv, int arg_count, ...) {
+    StradaValue *arg_arr[256];
+    va_list ap;
+    va_start(ap, arg_count);
+    int collected = strada_sprintf_collect(arg_arr, 256, arg_count, ap);
+    va_end(ap);
+    return strada_sprintf_sv_args(format_sv, arg_arr, collected, NULL);
 }
 
 /* Public flat-array wrapper — flattens any STRADA_ARRAY entries into the
@@ -8123,7 +10438,51 @@ StradaValue* strada_sprintf_sv_arr(StradaValue *format_sv, StradaValue *args_sv)
             }
         }
     }
-    return strada_sprintf_sv_args(format_sv, arg_arr, collected);
+    return strada_sprintf_sv_args(format_sv, arg_arr, collected, NULL);
+}
+
+/* print/say of an already built string, for handles no sink covers. */
+static void strada_print_result(StradaValue *sv, StradaValue *fh, int newline) {
+    if (newline) {
+        if (fh) strada_say_fh(sv, fh); else strada_say(sv);
+    } else {
+        if (fh) strada_print_fh(sv, fh); else strada_print(sv);
+    }
+}
+
+/* `print($fh, sprintf(fmt, ...))` / `say(...)` / `printf(fmt, ...)`:
+ * format straight into the handle (NULL = default output). */
+void strada_printf_fh(StradaValue *fh, int newline, StradaValue *format_sv, int arg_count, ...) {
+    StradaValue *arg_arr[256];
+    va_list ap;
+    va_start(ap, arg_count);
+    int collected = strada_sprintf_collect(arg_arr, 256, arg_count, ap);
+    va_end(ap);
+    StradaSink k;
+    if (strada_sink_open_fh(&k, fh, newline)) {
+        strada_sprintf_sv_args(format_sv, arg_arr, collected, &k);
+        strada_sink_close(&k, newline);
+        return;
+    }
+    StradaValue *res = strada_sprintf_sv_args(format_sv, arg_arr, collected, NULL);
+    strada_print_result(res, fh, newline);
+    strada_decref(res);
+}
+
+/* `$s .= sprintf(fmt, ...)`: append to dst in place. Ownership follows
+ * strada_concat_inplace (consumes dst, returns the result); a
+ * StringBuilder dst is appended to and returned as is. */
+StradaValue* strada_sprintf_append(StradaValue *dst, StradaValue *format_sv, int arg_count, ...) {
+    StradaValue *arg_arr[256];
+    va_list ap;
+    va_start(ap, arg_count);
+    int collected = strada_sprintf_collect(arg_arr, 256, arg_count, ap);
+    va_end(ap);
+    StradaSink k;
+    strada_sink_open_append(&k, dst);
+    strada_sprintf_sv_args(format_sv, arg_arr, collected, &k);
+    strada_sink_close(&k, 0);
+    return k.dst;
 }
 
 /* ===== FILE I/O FUNCTIONS ===== */
@@ -8806,7 +11165,7 @@ static void strada_dump_rec(StradaValue *sv, int indent, int depth, StradaValue
                 printf("[\n");
                 for (size_t i = 0; i < av->size; i++) {
                     printf("%s  ", ind);
-                    strada_dump_rec(av->elements[av->head + i], indent + 1, depth + 1, path);
+                    strada_dump_rec(av_at(av, i), indent + 1, depth + 1, path);
                     if (i < av->size - 1) printf(",");
                     printf("\n");
                 }
@@ -8960,7 +11319,7 @@ static void strada_dump_buf_rec(StradaValue *sv, int indent, char **buf, size_t
                 APPEND("[\n");
                 for (size_t i = 0; i < av->size; i++) {
                     APPEND("%s  ", ind);
-                    strada_dump_buf_rec(av->elements[av->head + i], indent + 1, buf, len, cap, depth + 1, path);
+                    strada_dump_buf_rec(av_at(av, i), indent + 1, buf, len, cap, depth + 1, path);
                     if (i < av->size - 1) APPEND(",");
                     APPEND("\n");
                 }
@@ -9123,6 +11482,8 @@ StradaValue *strada_exception_value = NULL;  /* Typed exception support */
 static char *strada_exception_trace = NULL;  /* lazily formatted from the snapshot below */
 static StradaStackFrame strada_exc_snapshot[STRADA_MAX_CALL_DEPTH + 1];  /* frames at last throw */
 static int strada_exc_snapshot_depth = 0;
+static void *strada_exc_snapshot_pcs[STRADA_MAX_CALL_DEPTH];  /* unwind mode: return addresses */
+static int strada_exc_snapshot_npcs = 0;
 #else
 __thread StradaTryContext strada_try_stack[STRADA_MAX_TRY_DEPTH];
 __thread int strada_try_depth = 0;
@@ -9131,6 +11492,8 @@ __thread StradaValue *strada_exception_value = NULL;  /* Typed exception support
 static __thread char *strada_exception_trace = NULL;  /* lazily formatted from the snapshot below */
 static __thread StradaStackFrame strada_exc_snapshot[STRADA_MAX_CALL_DEPTH + 1];  /* frames at last throw */
 static __thread int strada_exc_snapshot_depth = 0;
+static __thread void *strada_exc_snapshot_pcs[STRADA_MAX_CALL_DEPTH];  /* unwind mode: return addresses */
+static __thread int strada_exc_snapshot_npcs = 0;
 #endif
 
 /* Format `depth` call-stack frames (innermost-last) into a "  at fn (file:line)"
@@ -9160,6 +11523,179 @@ static char *strada_format_trace(const StradaStackFrame *frames, int depth) {
     return buf;
 }
 
+/* ===== Unwind-mode stack traces (stradac --stack-trace=unwind) =====
+ * Modules compiled in this mode push no frames; they register their
+ * STRADA_TRACE_LINE records (see strada_runtime.h) and the trace
+ * functions below rebuild frames from return addresses instead. The
+ * records are decoded and sorted the first time a trace is needed, so
+ * startup only pays for the registration call. */
+typedef struct {
+    uintptr_t pc;
+    int line;
+    int func;
+} StradaTraceSite;
+
+typedef struct {
+    const StradaTraceFunc *funcs;
+    int nfuncs;
+    const StradaTraceLine *start, *end;
+    StradaTraceSite *sites;         /* sorted by pc; NULL until first use */
+    size_t nsites;
+} StradaTraceModule;
+
+#define STRADA_TRACE_MAX_MODULES 64
+static StradaTraceModule strada_trace_modules[STRADA_TRACE_MAX_MODULES];
+static int strada_trace_nmodules = 0;
+static pthread_mutex_t strada_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static void *(*strada_trace_find_fn)(void *) = NULL;
+static int strada_trace_find_fn_loaded = 0;
+
+void strada_trace_register(const StradaTraceFunc *funcs, int nfuncs,
+                           const StradaTraceLine *start, const StradaTraceLine *end) {
+    if (!funcs || !start || !end || end <= start) return;
+    pthread_mutex_lock(&strada_trace_lock);
+    if (strada_trace_nmodules < STRADA_TRACE_MAX_MODULES) {
+        StradaTraceModule *m = &strada_trace_modules[strada_trace_nmodules];
+        m->funcs = funcs;
+        m->nfuncs = nfuncs;
+        m->start = start;
+        m->end = end;
+        m->sites = NULL;
+        m->nsites = 0;
+        __atomic_store_n(&strada_trace_nmodules, strada_trace_nmodules + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&strada_trace_lock);
+}
+
+static int strada_trace_site_cmp(const void *a, const void *b) {
+    uintptr_t x = ((const StradaTraceSite *)a)->pc, y = ((const StradaTraceSite *)b)->pc;
+    return x < y ? -1 : x > y;
+}
+
+/* Nonzero when unwind-mode code is linked in: traces then come from the
+ * machine stack rather than strada_call_stack. */
+static int strada_trace_unwind_active(void) {
+    return __atomic_load_n(&strada_trace_nmodules, __ATOMIC_ACQUIRE) > 0;
+}
+
+/* Build a module's sorted site list on first use. Called with the lock held. */
+static int strada_trace_load_sites(StradaTraceModule *m) {
+    if (m->sites) return 1;
+    size_t n = (size_t)(m->end - m->start);
+    m->sites = malloc(n * sizeof(StradaTraceSite));
+    if (!m->sites) return 0;
+    for (size_t i = 0; i < n; i++) {
+        const StradaTraceLine *r = &m->start[i];
+        m->sites[i].pc = (uintptr_t)&r->pc_rel + (uintptr_t)(intptr_t)r->pc_rel;
+        m->sites[i].line = r->line;
+        m->sites[i].func = r->func;
+    }
+    qsort(m->sites, n, sizeof(StradaTraceSite), strada_trace_site_cmp);
+    m->nsites = n;
+    return 1;
+}
+
+/* Index of the first site with pc > q (or >= q when `incl`). */
+static size_t strada_trace_upper(const StradaTraceModule *m, uintptr_t q, int incl) {
+    size_t lo = 0, hi = m->nsites;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (incl ? m->sites[mid].pc < q : m->sites[mid].pc <= q) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/* Resolve one return address to Strada frames, innermost first, into
+ * out[0..STRADA_TRACE_MAX_INLINE-1]; returns how many. Called with the
+ * lock held.
+ *
+ * The frame is the nearest record at or below the return address, which
+ * must belong to the same machine function (FDE) — otherwise a runtime or
+ * libc frame would borrow the nearest Strada record below it. gcc inlines
+ * small Strada functions, so one machine function can hold several Strada
+ * frames: walking back from that record, the entry record of the current
+ * function is preceded by the call-site record of the function it was
+ * inlined into, and so on up to the machine function's own entry. That
+ * relies on gcc laying the inlined code out in source order, which
+ * recursive self-inlining does not keep — so the walk stops at a function
+ * already in the chain, dropping a frame rather than inventing several.
+ * Without libgcc_s the FDE bounds are unknown: every nearest record is
+ * accepted and inlined frames are not expanded. */
+#define STRADA_TRACE_MAX_INLINE 16
+static int strada_trace_resolve(void *ret, StradaStackFrame *out) {
+    uintptr_t q = (uintptr_t)ret - 1;   /* inside the call instruction */
+    const StradaTraceModule *bm = NULL;
+    size_t bi = 0;
+    for (int mi = 0; mi < strada_trace_nmodules; mi++) {
+        StradaTraceModule *m = &strada_trace_modules[mi];
+        if (!strada_trace_load_sites(m)) continue;
+        size_t i = strada_trace_upper(m, q, 0);
+        if (i > 0 && (!bm || m->sites[i - 1].pc > bm->sites[bi].pc)) {
+            bm = m;
+            bi = i - 1;
+        }
+    }
+    if (!bm) return 0;
+    if (!strada_trace_find_fn_loaded) {
+        void *h = dlopen("libgcc_s.so.1", RTLD_LAZY);
+        if (h) strada_trace_find_fn = (void *(*)(void *))dlsym(h, "_Unwind_FindEnclosingFunction");
+        strada_trace_find_fn_loaded = 1;
+    }
+    size_t first = bi;
+    if (strada_trace_find_fn) {
+        void *fq = strada_trace_find_fn((void *)q);
+        if (!fq || fq != strada_trace_find_fn((void *)bm->sites[bi].pc)) return 0;
+        first = strada_trace_upper(bm, (uintptr_t)fq, 1);
+    }
+    const StradaTraceSite *site = &bm->sites[bi];
+    int n = 0;
+    size_t i = bi;
+    while (site->func >= 0 && site->func < bm->nfuncs) {
+        out[n].func_name = bm->funcs[site->func].func_name;
+        out[n].file_name = bm->funcs[site->func].file_name;
+        out[n].line = site->line;
+        if (++n == STRADA_TRACE_MAX_INLINE) break;
+        /* Back to this function's entry; the call site before it is the
+         * caller's, unless the entry opens the machine function. */
+        int func = site->func;
+        while (i > first && !(bm->sites[i].func == func && bm->sites[i].line == 0)) i--;
+        if (i <= first || bm->sites[i - 1].line == 0) break;
+        site = &bm->sites[--i];
+        for (int k = 0; k < n; k++) {
+            if (out[k].func_name == bm->funcs[site->func].func_name) return n;
+        }
+    }
+    return n;
+}
+
+/* Turn return addresses (innermost first, as backtrace() gives them) into
+ * frames at 1..depth, innermost-last like strada_call_stack. */
+static int strada_trace_resolve_pcs(void **pcs, int npcs, StradaStackFrame *frames) {
+    StradaStackFrame tmp[STRADA_MAX_CALL_DEPTH + STRADA_TRACE_MAX_INLINE];
+    int n = 0;
+    pthread_mutex_lock(&strada_trace_lock);
+    for (int i = 0; i < npcs && n < STRADA_MAX_CALL_DEPTH; i++) {
+        n += strada_trace_resolve(pcs[i], &tmp[n]);
+    }
+    pthread_mutex_unlock(&strada_trace_lock);
+    if (n > STRADA_MAX_CALL_DEPTH) n = STRADA_MAX_CALL_DEPTH;
+    for (int i = 0; i < n; i++) frames[n - i] = tmp[i];
+    return n;
+}
+
+/* Frames of the live stack: the bookkeeping stack, or in unwind mode
+ * frames rebuilt into buf (STRADA_MAX_CALL_DEPTH + 1 slots). */
+static const StradaStackFrame *strada_trace_live_frames(StradaStackFrame *buf, int *depth) {
+    if (!strada_trace_unwind_active()) {
+        *depth = strada_call_depth;
+        return strada_call_stack;
+    }
+    void *pcs[STRADA_MAX_CALL_DEPTH];
+    int npcs = backtrace(pcs, STRADA_MAX_CALL_DEPTH);
+    *depth = strada_trace_resolve_pcs(pcs, npcs, buf);
+    return buf;
+}
+
 /* core::exception_trace() — the Strada call stack captured at the moment
  * of the most recent throw in THIS thread (empty string when stack
  * tracing is disabled or nothing has thrown). Survives the catch, so an
@@ -9168,6 +11704,12 @@ static char *strada_format_trace(const StradaStackFrame *frames, int depth) {
  * the first time it's read — so a catch that ignores the trace (the common
  * case) pays nothing for it. */
 StradaValue* strada_exception_trace_get(void) {
+    if (!strada_exception_trace && strada_exc_snapshot_npcs > 0) {
+        /* Unwind mode: the throw kept only return addresses. */
+        strada_exc_snapshot_depth = strada_trace_resolve_pcs(strada_exc_snapshot_pcs,
+                                                             strada_exc_snapshot_npcs, strada_exc_snapshot);
+        strada_exc_snapshot_npcs = 0;
+    }
     if (!strada_exception_trace && strada_exc_snapshot_depth > 0) {
         strada_exception_trace = strada_format_trace(strada_exc_snapshot, strada_exc_snapshot_depth);
     }
@@ -9181,6 +11723,7 @@ StradaValue* strada_exception_trace_get(void) {
 jmp_buf *strada_try_push_slot(void) {
     if (strada_try_depth >= STRADA_MAX_TRY_DEPTH) return NULL;
     strada_try_stack[strada_try_depth].active = 1;
+    strada_try_stack[strada_try_depth].builtin = 0;
     return &strada_try_stack[strada_try_depth++].buf;
 }
 int strada_try_pop_slot(void) {
@@ -9291,11 +11834,14 @@ StradaValue* strada_caller_info(StradaValue *level_sv) {
     /* Frames live at 1..depth (slot 0 is the sentinel). Top frame is the
      * function that called caller(); its caller is one below — so level 0
      * is depth-1, preserving the old "skip caller() itself" semantics. */
-    int frame_idx = strada_call_depth - 1 - level;
-    if (frame_idx < 1 || frame_idx > strada_call_depth) {
+    StradaStackFrame buf[STRADA_MAX_CALL_DEPTH + 1];
+    int depth;
+    const StradaStackFrame *frames = strada_trace_live_frames(buf, &depth);
+    int frame_idx = depth - 1 - level;
+    if (frame_idx < 1 || frame_idx > depth) {
         return strada_new_undef();
     }
-    StradaStackFrame *frame = &strada_call_stack[frame_idx];
+    const StradaStackFrame *frame = &frames[frame_idx];
     StradaValue *result = strada_new_hash();
     strada_hash_set_take(result->value.hv, "function",
         strada_new_str(frame->func_name ? frame->func_name : ""));
@@ -9307,12 +11853,15 @@ StradaValue* strada_caller_info(StradaValue *level_sv) {
 }
 
 void strada_print_stack_trace(FILE *out) {
-    if (strada_call_depth == 0) {
+    StradaStackFrame buf[STRADA_MAX_CALL_DEPTH + 1];
+    int depth;
+    const StradaStackFrame *frames = strada_trace_live_frames(buf, &depth);
+    if (depth == 0) {
         return;
     }
     fprintf(out, "Stack trace:\n");
-    for (int i = strada_call_depth; i >= 1; i--) {
-        StradaStackFrame *frame = &strada_call_stack[i];
+    for (int i = depth; i >= 1; i--) {
+        const StradaStackFrame *frame = &frames[i];
         if (frame->line > 0) {
             fprintf(out, "  at %s (%s:%d)\n",
                     frame->func_name ? frame->func_name : "?",
@@ -9327,7 +11876,10 @@ void strada_print_stack_trace(FILE *out) {
 }
 
 char* strada_capture_stack_trace(void) {
-    return strada_format_trace(strada_call_stack, strada_call_depth);
+    StradaStackFrame buf[STRADA_MAX_CALL_DEPTH + 1];
+    int depth;
+    const StradaStackFrame *frames = strada_trace_live_frames(buf, &depth);
+    return strada_format_trace(frames, depth);
 }
 
 /* Cheap throw-time trace capture: copy the live call-stack frames into a
@@ -9338,6 +11890,14 @@ char* strada_capture_stack_trace(void) {
  * deep-unwind: a 50-frame throw is now a ~600-byte memcpy, not 50 snprintfs). */
 static void strada_snapshot_exception_trace(void) {
     if (strada_exception_trace) { free(strada_exception_trace); strada_exception_trace = NULL; }
+    if (strada_trace_unwind_active()) {
+        /* Unwind mode: the stack is about to be longjmp'd away, so grab the
+         * return addresses now; symbolizing waits for exception_trace(). */
+        strada_exc_snapshot_npcs = backtrace(strada_exc_snapshot_pcs, STRADA_MAX_CALL_DEPTH);
+        strada_exc_snapshot_depth = 0;
+        return;
+    }
+    strada_exc_snapshot_npcs = 0;
     int d = strada_call_depth;
     if (d < 0) d = 0;
     if (d > STRADA_MAX_CALL_DEPTH) d = STRADA_MAX_CALL_DEPTH;
@@ -9402,6 +11962,18 @@ int strada_in_try_block(void) {
     return strada_try_depth > 0 && strada_try_stack[strada_try_depth - 1].active;
 }
 
+/* Resume the innermost try frame. Frames entered through STRADA_TRY_ENTER
+ * on gcc were set with __builtin_setjmp and must be resumed with its
+ * counterpart; noinline keeps that __builtin_longjmp out of any function
+ * holding the matching setjmp, even after LTO inlines strada_throw. */
+static __attribute__((noinline, noreturn)) void strada_try_resume(void) {
+    StradaTryContext *tc = &strada_try_stack[strada_try_depth - 1];
+#if defined(__GNUC__) && !defined(__clang__)
+    if (tc->builtin) __builtin_longjmp((void **)tc->buf, 1);
+#endif
+    longjmp(tc->buf, 1);
+}
+
 void strada_throw(const char *msg) {
     /* Capture where this throw happened (see strada_throw_value). */
     strada_snapshot_exception_trace();
@@ -9422,7 +11994,7 @@ void strada_throw(const char *msg) {
             strada_die_trace_hook(strada_exception_msg, strada_try_depth);
         }
         /* Jump to the nearest catch block */
-        longjmp(strada_try_stack[strada_try_depth - 1].buf, 1);
+        strada_try_resume();
     } else {
         /* No try block - fatal error with stack trace */
         fprintf(stderr, "Uncaught exception: %s\n", strada_exception_msg);
@@ -9451,7 +12023,7 @@ void strada_throw_value(StradaValue *sv) {
     strada_exception_msg = msg;  /* Take ownership directly */
 
     if (strada_in_try_block()) {
-        longjmp(strada_try_stack[strada_try_depth - 1].buf, 1);
+        strada_try_resume();
     } else {
         fprintf(stderr, "Uncaught exception: %s\n", msg);
         strada_print_stack_trace(stderr);
@@ -10075,7 +12647,7 @@ StradaValue* strada_socket_select(StradaValue *sockets, int timeout_ms) {
 
     /* Add all socket fds to the set */
     for (int i = 0; i < count; i++) {
-        StradaValue *sock = arr->elements[arr->head + i];
+        StradaValue *sock = av_at(arr, i);
         if (sock && sock->type == STRADA_SOCKET && sock->value.sock && sock->value.sock->fd >= 0) {
             FD_SET(sock->value.sock->fd, &readfds);
             if (sock->value.sock->fd > maxfd) {
@@ -10106,7 +12678,7 @@ StradaValue* strada_socket_select(StradaValue *sockets, int timeout_ms) {
 
     if (result > 0) {
         for (int i = 0; i < count; i++) {
-            StradaValue *sock = arr->elements[arr->head + i];
+            StradaValue *sock = av_at(arr, i);
             if (sock && sock->type == STRADA_SOCKET && sock->value.sock && sock->value.sock->fd >= 0) {
                 if (FD_ISSET(sock->value.sock->fd, &readfds)) {
                     strada_array_push(ready->value.av, sock);
@@ -10185,7 +12757,7 @@ StradaValue* strada_select_fds(StradaValue *fds, int timeout_ms) {
 
     /* Add all fds to the set */
     for (int i = 0; i < count; i++) {
-        StradaValue *fdval = arr->elements[arr->head + i];
+        StradaValue *fdval = av_at(arr, i);
         if (fdval) {
             int fd = (int)strada_to_int(fdval);
             if (fd >= 0) {
@@ -10219,7 +12791,7 @@ StradaValue* strada_select_fds(StradaValue *fds, int timeout_ms) {
 
     if (result > 0) {
         for (int i = 0; i < count; i++) {
-            StradaValue *fdval = arr->elements[arr->head + i];
+            StradaValue *fdval = av_at(arr, i);
             if (fdval) {
                 int fd = (int)strada_to_int(fdval);
                 if (fd >= 0 && FD_ISSET(fd, &readfds)) {
@@ -12986,17 +15558,15 @@ StradaArray* strada_string_split(const char *str, const char *delim) {
         return parts;
     }
 
-    /* Multi-character delimiter — use strstr */
-    const char *p = str;
-    const char *found;
-
-    while ((found = strstr(p, delim)) != NULL) {
-        strada_array_push_take(parts, strada_new_str_len(p, found - p));
+    /* Multi-character delimiter — SIMD anchored search over the byte range */
+    size_t p = 0, found;
+    while ((found = strada_memmem(str, str_len, p, delim, delim_len)) != STRADA_NOT_FOUND) {
+        strada_array_push_take(parts, strada_new_str_len(str + p, found - p));
         p = found + delim_len;
     }
 
     /* Add remaining part */
-    strada_array_push_take(parts, strada_new_str(p));
+    strada_array_push_take(parts, strada_new_str_len(str + p, str_len - p));
 
     return parts;
 }
@@ -13098,9 +15668,11 @@ void strada_free_value(StradaValue *sv) {
         }
     }
 
+    int sso_block = 0;
     switch (sv->type) {
         case STRADA_STR:
-            ss_free_pv(sv->value.pv);
+            sso_block = sv->value.pv && STRADA_STR_IS_EMBEDDED(sv);
+            strada_str_free_pv(sv);
             break;
         case STRADA_ARRAY:
             strada_free_array(sv->value.av);
@@ -13179,6 +15751,9 @@ void strada_free_value(StradaValue *sv) {
                      * fd) leaked whenever the SV was freed without an
                      * explicit closedir. */
                     closedir((DIR*)sv->value.ptr);
+                } else if (!strada_coll_free(sn, sv->value.ptr, 1)
+                           && !strada_sketch_free(sn, sv->value.ptr)) {
+                    strada_iter_free(sn, sv->value.ptr, 1);
                 }
             }
             /* Free the strdup'd struct_name. The CSTRUCT branch above
@@ -13312,6 +15887,14 @@ void strada_free_value(StradaValue *sv) {
         }
         sv->meta = NULL;
     }
+    if (sso_block) {
+        if (!strada_threading_active && sso_pool_count < SSO_POOL_MAX) {
+            sv->refcount = 2000000000;
+            sso_pool_stack[sso_pool_count++] = sv;
+        } else
+            free(sv);
+        return;
+    }
     if (!strada_threading_active && sv_pool_count < SV_POOL_MAX) {
         sv->refcount = 2000000000;
         sv_pool_stack[sv_pool_count++] = sv;
@@ -13325,6 +15908,10 @@ void strada_free_array(StradaArray *av) {
     av->refcount--;
     if (av->refcount > 0) return;
 
+    if (av->kind) {
+        av_packed_free(av);
+        return;
+    }
     for (size_t i = 0; i < av->size; i++) {
         strada_decref(av->elements[av->head + i]);
     }
@@ -13481,7 +16068,8 @@ static void cc_each_child(StradaValue *sv, cc_visit fn) {
     switch (sv->type) {
         case STRADA_ARRAY: {
             StradaArray *av = sv->value.av;
-            if (av) for (size_t i = 0; i < av->size; i++) {
+            /* packed slots hold no references */
+            if (av && !av->kind) for (size_t i = 0; i < av->size; i++) {
                 StradaValue *c = av->elements[av->head + i];
                 if (cc_child_visit(c, cw)) fn(c);
             }
@@ -13540,7 +16128,7 @@ static void cc_free_shell(StradaValue *sv) {
     }
     switch (sv->type) {
         case STRADA_STR:
-            ss_free_pv(sv->value.pv);
+            strada_str_free_pv(sv);
             break;
         case STRADA_ARRAY: {
             StradaArray *av = sv->value.av;
@@ -13822,7 +16410,7 @@ static void arena_release_backbone(StradaValue *sv) {
     }
     switch (sv->type) {
         case STRADA_STR:
-            ss_free_pv(sv->value.pv);
+            strada_str_free_pv(sv);
             break;
         case STRADA_ARRAY: {
             StradaArray *av = sv->value.av;
@@ -13840,7 +16428,7 @@ static void arena_release_backbone(StradaValue *sv) {
                         int idx_in = hv_idx_in_block(hv);
                         int ent_in = hv_ent_in_block(hv);
                         if (hv->entries && !ent_in) free(hv->entries);
-                        if (hv->hash_index && !idx_in) free(hv->hash_index);
+                        if (hv->ctrl && !idx_in) free(hv->ctrl);
                         free(hv);
                     }
                 }
@@ -13883,6 +16471,9 @@ static void arena_release_backbone(StradaValue *sv) {
                     StradaCond *c = (StradaCond*)sv->value.ptr; pthread_cond_destroy(&c->cond); free(c);
                 } else if (strcmp(sn, "DIR") == 0) {
                     closedir((DIR*)sv->value.ptr);
+                } else if (!strada_coll_free(sn, sv->value.ptr, 0)
+                           && !strada_sketch_free(sn, sv->value.ptr)) {
+                    strada_iter_free(sn, sv->value.ptr, 0);
                 }
             }
             if (SV_STRUCT_NAME(sv)) { free(sv->meta->struct_name); sv->meta->struct_name = NULL; }
@@ -15098,6 +17689,7 @@ static void strada_thread_state_cleanup(void) {
     if (strada_exception_value) { strada_decref(strada_exception_value); strada_exception_value = NULL; }
     if (strada_exception_trace) { free(strada_exception_trace); strada_exception_trace = NULL; }
     strada_exc_snapshot_depth = 0;
+    strada_exc_snapshot_npcs = 0;
 }
 
 static void* strada_thread_wrapper(void *arg) {
@@ -15311,10 +17903,16 @@ StradaThreadPool *strada_thread_pool = NULL;
 /* Default pool size */
 #define STRADA_DEFAULT_POOL_SIZE 4
 
+/* Set on pool workers: a job that would wait on other pool jobs (a
+ * parallel sort inside an async task) runs them inline instead, so a
+ * fully busy pool cannot deadlock on itself. */
+static __thread int strada_pool_in_worker = 0;
+
 /* Worker thread function */
 static void* strada_pool_worker(void *arg) {
     StradaThreadPool *pool = (StradaThreadPool *)arg;
     cc_thread_register();   /* count this worker for stop-the-world */
+    strada_pool_in_worker = 1;
 
     while (1) {
         StradaTask *task = NULL;
@@ -15349,6 +17947,12 @@ static void* strada_pool_worker(void *arg) {
         }
         pthread_mutex_unlock(&pool->queue_mutex);
 
+        if (task && task->fn) {
+            task->fn(task->arg);
+            free(task);
+            continue;
+        }
+
         if (task) {
             StradaFuture *f = task->future;
 
@@ -15370,7 +17974,7 @@ static void* strada_pool_worker(void *arg) {
             StradaValue * volatile error = NULL;
 
             strada_current_future = f;   /* async::sleep / async::cancelled */
-            if (setjmp(*STRADA_TRY_PUSH()) == 0) {
+            if (STRADA_TRY_ENTER()) {
                 result = strada_closure_call(f->closure, 0);
                 STRADA_TRY_POP();
             } else {
@@ -15411,13 +18015,16 @@ static void strada_pool_atexit(void) {
     }
 }
 
-/* Initialize thread pool */
-void strada_pool_init(int num_workers) {
+/* Start the workers. Native jobs (strada_pool_run) only need this; Strada
+ * code on the workers needs strada_pool_init's atomic refcounting too. */
+static void strada_pool_start(int num_workers) {
+    static pthread_mutex_t start_mutex = PTHREAD_MUTEX_INITIALIZER;
     if (strada_thread_pool != NULL) return;  /* Already initialized */
-
-    /* Enable atomic refcounting now that we're multi-threaded */
-    if (!strada_threading_active) strada_threading_active = 1;
-    cc_thread_register();   /* register the caller (e.g. main) as a mutator thread */
+    pthread_mutex_lock(&start_mutex);
+    if (strada_thread_pool != NULL) {
+        pthread_mutex_unlock(&start_mutex);
+        return;
+    }
 
     if (num_workers <= 0) {
         num_workers = STRADA_DEFAULT_POOL_SIZE;
@@ -15448,6 +18055,41 @@ void strada_pool_init(int num_workers) {
         atexit(strada_pool_atexit);
         registered = 1;
     }
+    pthread_mutex_unlock(&start_mutex);
+}
+
+/* Initialize thread pool */
+void strada_pool_init(int num_workers) {
+    /* Enable atomic refcounting now that we're multi-threaded. Done even
+     * when the pool already runs: a parallel sort may have started it for
+     * native jobs only. */
+    if (!strada_threading_active) strada_threading_active = 1;
+    cc_thread_register();   /* register the caller (e.g. main) as a mutator thread */
+    strada_pool_start(num_workers);
+}
+
+/* Queue a native job. Runs fn(arg) on a worker with no future attached;
+ * the caller tracks completion itself. */
+static void strada_pool_run(void (*fn)(void *), void *arg) {
+    StradaThreadPool *pool = strada_thread_pool;
+    StradaTask *task = malloc(sizeof(StradaTask));
+    task->closure = NULL;
+    task->future = NULL;
+    task->fn = fn;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->queue_mutex);
+    if (pool->queue_tail) {
+        pool->queue_tail->next = task;
+        pool->queue_tail = task;
+    } else {
+        pool->queue_head = task;
+        pool->queue_tail = task;
+    }
+    pool->queue_size++;
+    pthread_cond_signal(&pool->queue_cond);
+    pthread_mutex_unlock(&pool->queue_mutex);
 }
 
 /* Shutdown thread pool */
@@ -15487,6 +18129,8 @@ void strada_pool_submit(StradaFuture *future) {
     StradaTask *task = malloc(sizeof(StradaTask));
     task->closure = future->closure;
     task->future = future;
+    task->fn = NULL;
+    task->arg = NULL;
     task->next = NULL;
 
     pthread_mutex_lock(&pool->queue_mutex);
@@ -15502,96 +18146,636 @@ void strada_pool_submit(StradaFuture *future) {
     pthread_mutex_unlock(&pool->queue_mutex);
 }
 
-/* Create a new future. Takes ownership of `closure` — caller transfers
- * its single reference and must NOT decref. The future's eventual
- * destruction will run the matching decref on f->closure. */
-StradaValue* strada_future_new(StradaValue *closure) {
-    StradaFuture *f = malloc(sizeof(StradaFuture));
-    f->result = NULL;
-    f->error = NULL;
-    f->closure = closure;
-    /* Ownership transfer — no incref. The codegen wrapper allocates a
-     * fresh closure with refcount 1 and hands it directly to us.
-     * Previously we increfed here, leaving the closure stuck at
-     * refcount 1 after future teardown (every async() leaked). */
-    f->state = FUTURE_PENDING;
-    f->cancel_requested = 0;
-    f->has_deadline = 0;
-    memset(&f->deadline, 0, sizeof(f->deadline));
-
-    pthread_mutex_init(&f->mutex, NULL);
-    pthread_cond_init(&f->cond, NULL);
-
-    StradaValue *sv = strada_value_alloc();
-    sv->type = STRADA_FUTURE;
-    sv->refcount = 1;
-    sv->value.ptr = f;
-
-    /* Submit to thread pool */
-    strada_pool_submit(f);
-
-    return sv;
-}
-
-/* Await: block until future completes */
-StradaValue* strada_future_await(StradaValue *future) {
-    /* If not a future, pass through the value as-is (makes await idempotent) */
-    if (!future) {
-        return strada_new_undef();
+/* ===== PARALLEL MERGE SORT =====
+ *
+ * Large sorts fan out over the thread pool. The input (an array of
+ * pointer-sized slots) is cut into one run per worker, a pool job
+ * merge-sorts each run, and the runs are then merged pairwise in rounds.
+ * Each round's output is cut into one segment per worker, and a job finds
+ * where its segment starts in both input runs by binary search (co-rank).
+ * So the final merges keep every worker busy rather than leaving one
+ * thread to merge all n slots. On ties the left run goes first, so the
+ * sort is stable.
+ *
+ * sort and nsort use it above STRADA_PAR_SORT_MIN elements. Their
+ * comparators only read the slots, so the jobs run with the caller's
+ * refcounting unchanged and count as blocked for the cycle collector.
+ * sort_par { ... } calls the block on the workers, which needs
+ * strada_pool_init's atomic refcounts (see strada_sort_par). */
+#define STRADA_PAR_SORT_MIN      100000
+#define STRADA_PAR_SORT_MIN_CMP  10000
+#define STRADA_PAR_SORT_MAX_RUNS 64
+#define STRADA_PAR_SORT_INSERTION 16
+
+typedef struct StradaParSort {
+    void **data;                 /* n slots, sorted in place */
+    void **scratch;              /* n slots */
+    size_t n;
+    int (*cmp)(const void *, const void *);  /* qsort-style, on slot addresses */
+    StradaValue *closure;        /* sort_par: comparator called as ($a, $b) */
+    StradaValue *error;          /* first exception the comparator threw */
+    int failed;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int pending;                 /* jobs of the current phase still running */
+} StradaParSort;
+
+typedef struct StradaParSortJob {
+    StradaParSort *ps;
+    void **src, **dst;
+    size_t lo, mid, hi;          /* run [lo,hi) to sort, or runs [lo,mid) [mid,hi) to merge */
+    size_t out_lo, out_hi;       /* merge: the part of dst[lo,hi) this job fills */
+    int merge;
+} StradaParSortJob;
+
+static inline int ps_cmp(StradaParSort *ps, void *const *a, void *const *b) {
+    if (!ps->closure) return ps->cmp(a, b);
+    if (__atomic_load_n(&ps->failed, __ATOMIC_RELAXED)) return 0;
+    StradaValue *r = strada_closure_call(ps->closure, 2, (StradaValue *)*a, (StradaValue *)*b);
+    int64_t c = strada_to_int(r);
+    strada_decref(r);
+    return (c > 0) - (c < 0);
+}
+
+/* Number of elements of run a (length m) among the first i outputs of the
+ * stable merge of a and b (length k). */
+static size_t ps_corank(StradaParSort *ps, void **a, size_t m, void **b, size_t k, size_t i) {
+    size_t lo = i > k ? i - k : 0;
+    size_t hi = i < m ? i : m;
+    while (lo < hi) {
+        size_t j = lo + (hi - lo) / 2;
+        /* b[i-j-1] precedes a[j]: no more than j elements come from a */
+        if (ps_cmp(ps, &a[j], &b[i - j - 1]) > 0) hi = j;
+        else lo = j + 1;
+    }
+    return lo;
+}
+
+/* Write outputs [out_lo,out_hi) of merging src[lo,mid) and src[mid,hi)
+ * to the same positions of dst. */
+static void ps_merge(StradaParSort *ps, void **src, void **dst, size_t lo, size_t mid,
+                     size_t hi, size_t out_lo, size_t out_hi) {
+    void **a = src + lo, **b = src + mid;
+    size_t m = mid - lo, k = hi - mid;
+    size_t i = ps_corank(ps, a, m, b, k, out_lo - lo);
+    size_t j = out_lo - lo - i;
+    size_t i_end = ps_corank(ps, a, m, b, k, out_hi - lo);
+    size_t j_end = out_hi - lo - i_end;
+    void **out = dst + out_lo;
+    while (i < i_end && j < j_end) {
+        if (ps_cmp(ps, &a[i], &b[j]) > 0) *out++ = b[j++];
+        else *out++ = a[i++];
+    }
+    while (i < i_end) *out++ = a[i++];
+    while (j < j_end) *out++ = b[j++];
+}
+
+/* Stable sort of data[lo,hi), using scratch[lo,hi) */
+static void ps_run_sort(StradaParSort *ps, void **data, void **scratch, size_t lo, size_t hi) {
+    for (size_t s = lo; s < hi; s += STRADA_PAR_SORT_INSERTION) {
+        size_t e = s + STRADA_PAR_SORT_INSERTION < hi ? s + STRADA_PAR_SORT_INSERTION : hi;
+        for (size_t i = s + 1; i < e; i++) {
+            void *x = data[i];
+            size_t j = i;
+            while (j > s && ps_cmp(ps, &data[j - 1], &x) > 0) {
+                data[j] = data[j - 1];
+                j--;
+            }
+            data[j] = x;
+        }
     }
-    if (future->type != STRADA_FUTURE) {
-        strada_incref(future);
-        return future;
+    void **src = data, **dst = scratch;
+    for (size_t w = STRADA_PAR_SORT_INSERTION; w < hi - lo; w *= 2) {
+        for (size_t s = lo; s < hi; s += 2 * w) {
+            size_t mid = s + w < hi ? s + w : hi;
+            size_t e = s + 2 * w < hi ? s + 2 * w : hi;
+            ps_merge(ps, src, dst, s, mid, e, s, e);
+        }
+        void **t = src; src = dst; dst = t;
     }
+    if (src != data) memcpy(data + lo, src + lo, (hi - lo) * sizeof(void *));
+}
 
-    StradaFuture *f = (StradaFuture*)future->value.ptr;
+static void ps_job_body(StradaParSortJob *j) {
+    if (j->merge) ps_merge(j->ps, j->src, j->dst, j->lo, j->mid, j->hi, j->out_lo, j->out_hi);
+    else ps_run_sort(j->ps, j->src, j->dst, j->lo, j->hi);
+}
 
-    pthread_mutex_lock(&f->mutex);
-    while (f->state == FUTURE_PENDING || f->state == FUTURE_RUNNING) {
-        cc_blocking_enter();          /* safe while awaiting */
-        pthread_cond_wait(&f->cond, &f->mutex);
+static void ps_job(void *arg) {
+    StradaParSortJob *j = (StradaParSortJob *)arg;
+    StradaParSort *ps = j->ps;
+    if (!ps->closure) {
+        cc_blocking_enter();   /* reads slots only: safe for the collector */
+        ps_job_body(j);
         cc_blocking_leave();
+    } else {
+        int mark = strada_cleanup_mark();
+        if (STRADA_TRY_ENTER()) {
+            ps_job_body(j);
+            STRADA_TRY_POP();
+        } else {
+            STRADA_TRY_POP();
+            strada_cleanup_drain_to(mark);
+            StradaValue *err = strada_get_exception();
+            pthread_mutex_lock(&ps->mutex);
+            if (!ps->error) ps->error = err;
+            else strada_decref(err);
+            __atomic_store_n(&ps->failed, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&ps->mutex);
+        }
     }
+    pthread_mutex_lock(&ps->mutex);
+    if (--ps->pending == 0) pthread_cond_signal(&ps->cond);
+    pthread_mutex_unlock(&ps->mutex);
+}
 
-    StradaFutureState state = f->state;
-    StradaValue *result = f->result;
-    StradaValue *error = f->error;
-    pthread_mutex_unlock(&f->mutex);
-
-    /* Handle different states */
-    if (state == FUTURE_CANCELLED) {
-        strada_throw("Future was cancelled");
-        return strada_new_undef();
-    }
+/* Run jobs[0..count) on the pool and wait for all of them */
+static void ps_phase(StradaParSort *ps, StradaParSortJob *jobs, int count) {
+    ps->pending = count;
+    for (int i = 0; i < count; i++) strada_pool_run(ps_job, &jobs[i]);
+    cc_blocking_enter();
+    pthread_mutex_lock(&ps->mutex);
+    while (ps->pending > 0) pthread_cond_wait(&ps->cond, &ps->mutex);
+    pthread_mutex_unlock(&ps->mutex);
+    cc_blocking_leave();
+}
 
-    if (error) {
-        /* The future still owns f->error and will decref it when freed.
-         * strada_throw_value takes ownership of the value passed to it
-         * (no incref on its side) — so we must incref here to keep both
-         * sides balanced. */
-        strada_incref(error);
-        strada_throw_value(error);
-        return strada_new_undef();
-    }
+/* Workers a parallel sort of n slots should use; below 2 sort inline.
+ * Starts the pool (native jobs only) on first use. STRADA_SORT_THREADS
+ * overrides the CPU count (1 keeps every sort on the calling thread). */
+static int ps_workers(size_t n, size_t min) {
+    static long ncpu = 0;
+    if (n < min || strada_pool_in_worker) return 1;
+    if (ncpu == 0) {
+        const char *env = getenv("STRADA_SORT_THREADS");
+        ncpu = env && *env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+        if (ncpu < 1) ncpu = 1;
+    }
+    if (ncpu < 2) return 1;
+    strada_pool_start(ncpu > STRADA_DEFAULT_POOL_SIZE ? (int)ncpu : STRADA_DEFAULT_POOL_SIZE);
+    int w = strada_thread_pool->worker_count;
+    if (w > ncpu) w = (int)ncpu;
+    if (w > STRADA_PAR_SORT_MAX_RUNS) w = STRADA_PAR_SORT_MAX_RUNS;
+    return w;
+}
+
+static void ps_sort(StradaParSort *ps, int workers) {
+    size_t n = ps->n;
+    pthread_mutex_init(&ps->mutex, NULL);
+    pthread_cond_init(&ps->cond, NULL);
+    if (workers < 2) {
+        StradaParSortJob job = { ps, ps->data, ps->scratch, 0, 0, n, 0, 0, 0 };
+        ps->pending = 1;
+        ps_job(&job);
+    } else {
+        /* Power-of-two run count, so every merge round pairs all runs */
+        size_t runs = 1;
+        while (runs < (size_t)workers) runs *= 2;
+        StradaParSortJob jobs[2 * STRADA_PAR_SORT_MAX_RUNS];
+        size_t bound[STRADA_PAR_SORT_MAX_RUNS + 1];
+        for (size_t r = 0; r <= runs; r++) bound[r] = n / runs * r + (n % runs) * r / runs;
+        for (size_t r = 0; r < runs; r++)
+            jobs[r] = (StradaParSortJob){ ps, ps->data, ps->scratch, bound[r], 0, bound[r + 1], 0, 0, 0 };
+        ps_phase(ps, jobs, (int)runs);
+
+        size_t seg = (n + (size_t)workers - 1) / (size_t)workers;
+        void **src = ps->data, **dst = ps->scratch;
+        for (size_t w = 1; w < runs && !ps->failed; w *= 2) {
+            int count = 0;
+            for (size_t r = 0; r < runs; r += 2 * w) {
+                size_t lo = bound[r], mid = bound[r + w], hi = bound[r + 2 * w];
+                for (size_t o = lo; o < hi; o += seg)
+                    jobs[count++] = (StradaParSortJob){ ps, src, dst, lo, mid, hi, o,
+                                                        o + seg < hi ? o + seg : hi, 1 };
+            }
+            ps_phase(ps, jobs, count);
+            void **t = src; src = dst; dst = t;
+        }
+        if (src != ps->data) memcpy(ps->data, src, n * sizeof(void *));
+    }
+    pthread_mutex_destroy(&ps->mutex);
+    pthread_cond_destroy(&ps->cond);
+}
+
+static int strada_par_sort_wanted(size_t n) {
+    return ps_workers(n, STRADA_PAR_SORT_MIN) >= 2;
+}
+
+/* Stable parallel sort of n pointer-sized slots with a qsort-style
+ * comparator. Returns 0, leaving base untouched, when n is too small or
+ * there is a single CPU: the caller sorts on its own thread. */
+static int strada_par_sort(void **base, size_t n, int (*cmp)(const void *, const void *)) {
+    int workers = ps_workers(n, STRADA_PAR_SORT_MIN);
+    if (workers < 2) return 0;
+    StradaParSort ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.data = base;
+    ps.scratch = sr_xmalloc(n * sizeof(void *));
+    ps.n = n;
+    ps.cmp = cmp;
+    ps_sort(&ps, workers);
+    free(ps.scratch);
+    return 1;
+}
 
-    if (result) {
-        strada_incref(result);  /* Return a reference that the caller owns */
+/* sort_par { ... } @arr — sort with a comparator block, in parallel above
+ * STRADA_PAR_SORT_MIN_CMP elements. The block becomes a two-argument
+ * closure that the workers call concurrently, so it must not modify
+ * shared data. The first exception it throws is rethrown here once every
+ * job has stopped, and the input array is left as it was. */
+StradaValue* strada_sort_par(StradaValue *arr, StradaValue *cmp) {
+    StradaArray *av = strada_deref_array(arr);
+    StradaValue *result = strada_new_array();
+    if (!av) return result;
+    StradaArray *rav = result->value.av;
+    size_t n = av->size;
+    for (size_t i = 0; i < n; i++) strada_array_push(rav, strada_array_get(av, (int64_t)i));
+    if (n < 2) return result;
+
+    int workers = ps_workers(n, STRADA_PAR_SORT_MIN_CMP);
+    if (workers >= 2) strada_pool_init(0);   /* comparator runs Strada code on the workers */
+    StradaParSort ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.data = sr_xmalloc(n * sizeof(void *));
+    ps.scratch = sr_xmalloc(n * sizeof(void *));
+    memcpy(ps.data, rav->elements + rav->head, n * sizeof(void *));
+    ps.n = n;
+    ps.closure = cmp;
+    ps_sort(&ps, workers);
+    if (!ps.error) memcpy(rav->elements + rav->head, ps.data, n * sizeof(void *));
+    free(ps.data);
+    free(ps.scratch);
+    if (ps.error) {
+        strada_decref(result);
+        strada_throw_value(ps.error);
     }
-    return result ? result : strada_new_undef();
+    return result;
 }
 
-/* Await with timeout (throws on timeout) */
-StradaValue* strada_future_await_timeout(StradaValue *future, int64_t timeout_ms) {
-    /* If not a future, pass through the value as-is */
-    if (!future) {
-        return strada_new_undef();
-    }
-    if (future->type != STRADA_FUTURE) {
-        strada_incref(future);
-        return future;
+/* ===== par::map / par::grep / par::reduce — chunked data parallelism =====
+ *
+ * The items are split into contiguous chunks that the pool workers and the
+ * caller claim through a shared cursor. Chunks start at about 1/(4*workers)
+ * of what is left and shrink as the work runs out (guided scheduling), so
+ * uneven per-element cost still balances at the end without one atomic
+ * per element. Each chunk runs under a single try frame. Results land in
+ * per-index slots, so the output keeps input order. The callback runs on
+ * several threads at once and must not modify shared data. The first
+ * exception stops the other chunks at their next element and is rethrown
+ * in the caller once every job has stopped. */
+#define STRADA_PAR_MIN_CHUNK 16
+
+enum { PAR_MAP, PAR_GREP, PAR_REDUCE };
+
+typedef struct StradaPar {
+    int op;
+    StradaValue *fn;
+    StradaArray *items;
+    size_t n;
+    int workers;
+    size_t next;                 /* next unclaimed index (atomic) */
+    StradaValue **out;           /* map: one result per index; reduce: one per chunk start */
+    unsigned char *keep;         /* grep: 1 where the callback was true */
+    StradaValue *error;          /* first exception thrown by the callback */
+    int failed;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int pending;                 /* pool jobs still running */
+} StradaPar;
+
+/* Claim the next chunk; returns 0 when the items are used up */
+static int par_claim(StradaPar *p, size_t *lo, size_t *hi) {
+    size_t cur = __atomic_load_n(&p->next, __ATOMIC_RELAXED);
+    for (;;) {
+        if (cur >= p->n || __atomic_load_n(&p->failed, __ATOMIC_RELAXED)) return 0;
+        size_t len = (p->n - cur) / (size_t)(4 * p->workers);
+        if (len < STRADA_PAR_MIN_CHUNK) len = STRADA_PAR_MIN_CHUNK;
+        if (len > p->n - cur) len = p->n - cur;
+        if (__atomic_compare_exchange_n(&p->next, &cur, cur + len, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *lo = cur;
+            *hi = cur + len;
+            return 1;
+        }
     }
+}
 
-    StradaFuture *f = (StradaFuture*)future->value.ptr;
+/* Packed input: box a private copy, the shared slot cache is not
+ * thread-safe (see strada_map_worker) */
+static inline StradaValue *par_item(StradaArray *items, size_t i) {
+    return items->kind ? av_packed_box(items, items->head + i) : items->elements[items->head + i];
+}
+
+static void par_chunk(StradaPar *p, size_t lo, size_t hi) {
+    StradaArray *items = p->items;
+    StradaValue *acc = NULL;
+    for (size_t i = lo; i < hi; i++) {
+        if (__atomic_load_n(&p->failed, __ATOMIC_RELAXED)) break;
+        StradaValue *item = par_item(items, i);
+        if (items->kind) strada_cleanup_push(item);
+        if (p->op == PAR_REDUCE) {
+            if (!acc) {
+                strada_incref(item);
+                acc = item;
+            } else {
+                StradaValue *r = strada_closure_call(p->fn, 2, acc, item);
+                strada_decref(acc);
+                acc = r;
+            }
+            p->out[lo] = acc;    /* kept current so a throw can release it */
+        } else {
+            StradaValue *r = strada_closure_call(p->fn, 1, item);
+            if (p->op == PAR_MAP) {
+                p->out[i] = r;
+            } else {
+                p->keep[i] = (unsigned char)strada_to_bool(r);
+                strada_decref(r);
+            }
+        }
+        if (items->kind) {
+            strada_cleanup_pop();
+            strada_decref(item);
+        }
+    }
+}
+
+static void par_job(void *arg) {
+    StradaPar *p = (StradaPar *)arg;
+    size_t lo, hi;
+    while (par_claim(p, &lo, &hi)) {
+        int mark = strada_cleanup_mark();
+        if (STRADA_TRY_ENTER()) {
+            par_chunk(p, lo, hi);
+            STRADA_TRY_POP();
+        } else {
+            STRADA_TRY_POP();
+            strada_cleanup_drain_to(mark);
+            StradaValue *err = strada_get_exception();
+            pthread_mutex_lock(&p->mutex);
+            if (!p->error) p->error = err;
+            else strada_decref(err);
+            __atomic_store_n(&p->failed, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&p->mutex);
+            break;
+        }
+    }
+}
+
+static void par_pool_job(void *arg) {
+    StradaPar *p = (StradaPar *)arg;
+    par_job(p);
+    pthread_mutex_lock(&p->mutex);
+    if (--p->pending == 0) pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+static void par_check_fn(StradaValue *fn, const char *what) {
+    if (!fn || STRADA_IS_TAGGED_INT(fn)
+        || (fn->type != STRADA_CLOSURE && fn->type != STRADA_CPOINTER)) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "%s: first argument must be a function", what);
+        strada_throw(msg);
+    }
+}
+
+/* Run p over its items on the pool, with the caller claiming chunks too.
+ * Returns the first exception (owned), or NULL. */
+static StradaValue *par_run(StradaPar *p) {
+    p->workers = ps_workers(p->n, 2 * STRADA_PAR_MIN_CHUNK);
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    if (p->workers < 2) {
+        p->workers = 1;
+        par_job(p);
+    } else {
+        strada_pool_init(0);     /* the callback runs Strada code on the workers */
+        p->pending = p->workers - 1;
+        for (int i = 1; i < p->workers; i++) strada_pool_run(par_pool_job, p);
+        par_job(p);
+        cc_blocking_enter();
+        pthread_mutex_lock(&p->mutex);
+        while (p->pending > 0) pthread_cond_wait(&p->cond, &p->mutex);
+        pthread_mutex_unlock(&p->mutex);
+        cc_blocking_leave();
+    }
+    pthread_mutex_destroy(&p->mutex);
+    pthread_cond_destroy(&p->cond);
+    return p->error;
+}
+
+static void par_release(StradaPar *p) {
+    if (p->out) {
+        for (size_t i = 0; i < p->n; i++)
+            if (p->out[i]) strada_decref(p->out[i]);
+        free(p->out);
+    }
+    free(p->keep);
+}
+
+/* par::map($fn, \@items) — $fn($x) for every item, results in input order.
+ * Unlike map { }, an array ref result is kept as one element. */
+StradaValue* strada_par_map(StradaValue *fn, StradaValue *items_ref) {
+    par_check_fn(fn, "par::map");
+    StradaArray *items = strada_deref_array(items_ref);
+    StradaValue *result = strada_new_array();
+    if (!items || items->size == 0) return result;
+    StradaPar p;
+    memset(&p, 0, sizeof(p));
+    p.op = PAR_MAP;
+    p.fn = fn;
+    p.items = items;
+    p.n = items->size;
+    p.out = calloc(p.n, sizeof(StradaValue *));
+    StradaValue *err = par_run(&p);
+    if (err) {
+        par_release(&p);
+        strada_decref(result);
+        strada_throw_value(err);
+    }
+    StradaArray *rav = result->value.av;
+    strada_array_reserve(rav, (int64_t)p.n);
+    for (size_t i = 0; i < p.n; i++)
+        strada_array_push_take(rav, p.out[i] ? p.out[i] : strada_new_undef());
+    free(p.out);
+    return result;
+}
+
+/* par::grep($fn, \@items) — the items for which $fn($x) is true, in input
+ * order. */
+StradaValue* strada_par_grep(StradaValue *fn, StradaValue *items_ref) {
+    par_check_fn(fn, "par::grep");
+    StradaArray *items = strada_deref_array(items_ref);
+    StradaValue *result = strada_new_array();
+    if (!items || items->size == 0) return result;
+    StradaPar p;
+    memset(&p, 0, sizeof(p));
+    p.op = PAR_GREP;
+    p.fn = fn;
+    p.items = items;
+    p.n = items->size;
+    p.keep = calloc(p.n, 1);
+    StradaValue *err = par_run(&p);
+    if (err) {
+        par_release(&p);
+        strada_decref(result);
+        strada_throw_value(err);
+    }
+    StradaArray *rav = result->value.av;
+    for (size_t i = 0; i < p.n; i++)
+        if (p.keep[i]) strada_array_push(rav, strada_array_get(items, (int64_t)i));
+    free(p.keep);
+    return result;
+}
+
+/* par::reduce($fn, \@items [, $init]) — fold with $fn($acc, $x). Each
+ * chunk folds its own items and the chunk results are then folded left to
+ * right on the caller, so $fn must be associative; $init, when given, is
+ * folded in first. Returns undef for no items and no $init. */
+StradaValue* strada_par_reduce(StradaValue *fn, StradaValue *items_ref, StradaValue *init) {
+    par_check_fn(fn, "par::reduce");
+    StradaArray *items = strada_deref_array(items_ref);
+    size_t n = items ? items->size : 0;
+    StradaValue *acc = NULL;
+    if (init) {
+        strada_incref(init);
+        acc = init;
+    }
+    if (n > 0) {
+        StradaPar p;
+        memset(&p, 0, sizeof(p));
+        p.op = PAR_REDUCE;
+        p.fn = fn;
+        p.items = items;
+        p.n = n;
+        p.out = calloc(n, sizeof(StradaValue *));
+        StradaValue *err = par_run(&p);
+        if (err) {
+            par_release(&p);
+            if (acc) strada_decref(acc);
+            strada_throw_value(err);
+        }
+        /* Chunk results sit at their chunk's first index */
+        int mark = strada_cleanup_mark();
+        if (STRADA_TRY_ENTER()) {
+            for (size_t i = 0; i < n; i++) {
+                StradaValue *part = p.out[i];
+                if (!part) continue;
+                p.out[i] = NULL;
+                if (!acc) {
+                    acc = part;
+                    continue;
+                }
+                strada_cleanup_push(part);
+                strada_cleanup_push(acc);
+                StradaValue *r = strada_closure_call(fn, 2, acc, part);
+                strada_cleanup_pop();
+                strada_cleanup_pop();
+                strada_decref(acc);
+                strada_decref(part);
+                acc = r;
+            }
+            STRADA_TRY_POP();
+        } else {
+            STRADA_TRY_POP();
+            strada_cleanup_drain_to(mark);
+            par_release(&p);
+            strada_throw_value(strada_get_exception());
+        }
+        free(p.out);
+    }
+    return acc ? acc : strada_new_undef();
+}
+
+/* Create a new future. Takes ownership of `closure` — caller transfers
+ * its single reference and must NOT decref. The future's eventual
+ * destruction will run the matching decref on f->closure. */
+StradaValue* strada_future_new(StradaValue *closure) {
+    StradaFuture *f = malloc(sizeof(StradaFuture));
+    f->result = NULL;
+    f->error = NULL;
+    f->closure = closure;
+    /* Ownership transfer — no incref. The codegen wrapper allocates a
+     * fresh closure with refcount 1 and hands it directly to us.
+     * Previously we increfed here, leaving the closure stuck at
+     * refcount 1 after future teardown (every async() leaked). */
+    f->state = FUTURE_PENDING;
+    f->cancel_requested = 0;
+    f->has_deadline = 0;
+    memset(&f->deadline, 0, sizeof(f->deadline));
+
+    pthread_mutex_init(&f->mutex, NULL);
+    pthread_cond_init(&f->cond, NULL);
+
+    StradaValue *sv = strada_value_alloc();
+    sv->type = STRADA_FUTURE;
+    sv->refcount = 1;
+    sv->value.ptr = f;
+
+    /* Submit to thread pool */
+    strada_pool_submit(f);
+
+    return sv;
+}
+
+/* Await: block until future completes */
+StradaValue* strada_future_await(StradaValue *future) {
+    /* If not a future, pass through the value as-is (makes await idempotent) */
+    if (!future) {
+        return strada_new_undef();
+    }
+    if (future->type != STRADA_FUTURE) {
+        strada_incref(future);
+        return future;
+    }
+
+    StradaFuture *f = (StradaFuture*)future->value.ptr;
+
+    pthread_mutex_lock(&f->mutex);
+    while (f->state == FUTURE_PENDING || f->state == FUTURE_RUNNING) {
+        cc_blocking_enter();          /* safe while awaiting */
+        pthread_cond_wait(&f->cond, &f->mutex);
+        cc_blocking_leave();
+    }
+
+    StradaFutureState state = f->state;
+    StradaValue *result = f->result;
+    StradaValue *error = f->error;
+    pthread_mutex_unlock(&f->mutex);
+
+    /* Handle different states */
+    if (state == FUTURE_CANCELLED) {
+        strada_throw("Future was cancelled");
+        return strada_new_undef();
+    }
+
+    if (error) {
+        /* The future still owns f->error and will decref it when freed.
+         * strada_throw_value takes ownership of the value passed to it
+         * (no incref on its side) — so we must incref here to keep both
+         * sides balanced. */
+        strada_incref(error);
+        strada_throw_value(error);
+        return strada_new_undef();
+    }
+
+    if (result) {
+        strada_incref(result);  /* Return a reference that the caller owns */
+    }
+    return result ? result : strada_new_undef();
+}
+
+/* Await with timeout (throws on timeout) */
+StradaValue* strada_future_await_timeout(StradaValue *future, int64_t timeout_ms) {
+    /* If not a future, pass through the value as-is */
+    if (!future) {
+        return strada_new_undef();
+    }
+    if (future->type != STRADA_FUTURE) {
+        strada_incref(future);
+        return future;
+    }
+
+    StradaFuture *f = (StradaFuture*)future->value.ptr;
 
     /* Calculate deadline */
     struct timespec deadline;
@@ -15717,7 +18901,7 @@ StradaValue* strada_future_all(StradaValue *futures_ref) {
 
     /* Await each future in order */
     for (size_t i = 0; i < count; i++) {
-        StradaValue *future = arr->elements[arr->head + i];
+        StradaValue *future = av_at(arr, i);
         StradaValue *result = strada_future_await(future);
         strada_array_push_take(results->value.av, result);
     }
@@ -15743,12 +18927,12 @@ StradaValue* strada_future_race(StradaValue *futures_ref) {
     /* Poll until one completes */
     while (1) {
         for (size_t i = 0; i < count; i++) {
-            StradaValue *future = arr->elements[arr->head + i];
+            StradaValue *future = av_at(arr, i);
             if (strada_future_is_done(future)) {
                 /* Cancel the others */
                 for (size_t j = 0; j < count; j++) {
                     if (j != i) {
-                        strada_future_cancel(arr->elements[arr->head + j]);
+                        strada_future_cancel(av_at(arr, j));
                     }
                 }
                 return strada_future_await(future);
@@ -16094,7 +19278,7 @@ StradaValue* strada_channel_select(StradaValue *channels_ref, StradaValue *timeo
         int all_closed = 1;
         for (size_t i = 0; i < chans->size; i++) {
             int closed_empty = 0;
-            StradaValue *v = strada_channel_poll_one(chans->elements[chans->head + i], &closed_empty);
+            StradaValue *v = strada_channel_poll_one(av_at(chans, i), &closed_empty);
             if (v) {
                 strada_select_waiters--;
                 pthread_mutex_unlock(&strada_select_mutex);
@@ -16204,12 +19388,19 @@ static void *strada_map_worker(void *arg) {
         int64_t i = __sync_fetch_and_add(&job->next, 1);
         if (i >= (int64_t)job->items->size) break;
         StradaValue * volatile result = NULL;
-        if (setjmp(*STRADA_TRY_PUSH()) == 0) {
-            result = strada_closure_call(job->fn, 1, job->items->elements[job->items->head + i]);
+        /* Packed input: box a private copy, the shared slot cache is not
+         * thread-safe */
+        StradaArray *items = job->items;
+        StradaValue *item = items->kind ? av_packed_box(items, items->head + i)
+                                        : items->elements[items->head + i];
+        if (STRADA_TRY_ENTER()) {
+            result = strada_closure_call(job->fn, 1, item);
             STRADA_TRY_POP();
             job->results[i] = (StradaValue *)result;
+            if (items->kind) strada_decref(item);
         } else {
             STRADA_TRY_POP();
+            if (items->kind) strada_decref(item);
             StradaValue *err = strada_get_exception();
             pthread_mutex_lock(&job->err_mutex);
             if (!job->error) {
@@ -16564,21 +19755,22 @@ static uint32_t strada_unicode_to_lower(uint32_t cp) {
     return cp;
 }
 
-/* Apply a codepoint-level case-mapping function across a UTF-8 string.
- * Returns a newly-allocated NUL-terminated string; caller frees. */
-static char* strada_case_map(const char *str, uint32_t (*map_fn)(uint32_t)) {
-    if (!str) return strdup("");
-    size_t in_len = strlen(str);
-    /* Worst-case growth: U+00DF (2 bytes) -> U+1E9E (3 bytes). That's a
-     * 1.5x growth per char, but since only that specific char triggers
-     * growth, allocating 2x the input is always safe.
-     * Overflow guard: in_len * 2 + 4 must not exceed SIZE_MAX. */
-    if (in_len > (SIZE_MAX - 4) / 2) return strdup("");
-    char *out = malloc(in_len * 2 + 4);
-    if (!out) return strdup("");
+/* Apply the codepoint-level case mapping across str[0..in_len) into out,
+ * which must hold 2 * in_len bytes (U+00DF -> U+1E9E is the one mapping
+ * that grows, 2 bytes to 3). Returns the bytes written; no NUL is added.
+ * ASCII runs map 16 or 32 bytes at a time. */
+static size_t strada_case_map_into(char *out, const char *str, size_t in_len, int to_upper) {
     size_t oi = 0;
     size_t i = 0;
+    uint32_t (*map_fn)(uint32_t) = to_upper ? strada_unicode_to_upper : strada_unicode_to_lower;
     while (i < in_len) {
+        if ((unsigned char)str[i] < 0x80) {
+            size_t run = strada_ascii_run((const unsigned char *)str + i, in_len - i);
+            strada_ascii_case_copy((unsigned char *)out + oi, (const unsigned char *)str + i, run, to_upper);
+            oi += run;
+            i += run;
+            continue;
+        }
         int char_len = utf8_char_len((unsigned char)str[i]);
         /* Bound-check: incomplete sequence near end -> treat remaining
          * bytes as raw (copy through unchanged, do no case mapping). */
@@ -16591,10 +19783,62 @@ static char* strada_case_map(const char *str, uint32_t (*map_fn)(uint32_t)) {
         oi += utf8_encode(mapped, out + oi);
         i += char_len;
     }
+    return oi;
+}
+
+/* Apply a codepoint-level case-mapping function across a UTF-8 string.
+ * Returns a newly-allocated NUL-terminated string; caller frees. */
+static char* strada_case_map(const char *str, uint32_t (*map_fn)(uint32_t)) {
+    if (!str) return strdup("");
+    size_t in_len = strlen(str);
+    /* Overflow guard: in_len * 2 + 4 must not exceed SIZE_MAX. */
+    if (in_len > (SIZE_MAX - 4) / 2) return strdup("");
+    char *out = malloc(in_len * 2 + 4);
+    if (!out) return strdup("");
+    size_t oi = strada_case_map_into(out, str, in_len, map_fn == strada_unicode_to_upper);
     out[oi] = '\0';
     return out;
 }
 
+/* uc()/lc() on a value, binary-safe. An ASCII string is mapped straight
+ * into the result's buffer; other strings go through the codepoint
+ * mapping. SVf_UTF8 carries over to the result. */
+static StradaValue* strada_case_map_sv(StradaValue *sv, int to_upper) {
+    char _tb[256];
+    const char *s;
+    size_t len;
+    size_t utf8 = 0;
+    int ascii = 0;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv
+        && !(sv->meta && sv->meta->is_tied)) {
+        s = sv->value.pv;
+        len = STRADA_STR_BYTELEN(sv);
+        if (len == 0) len = strlen(s);
+        utf8 = sv->struct_size & STRADA_UTF8_FLAG;
+        ascii = STRADA_STR_IS_ASCII(sv);
+    } else {
+        s = strada_to_str_buf(sv, _tb, sizeof(_tb));
+        len = strlen(s);
+    }
+    if (ascii || strada_ascii_run((const unsigned char *)s, len) == len) {
+        StradaValue *res = strada_str_value_uninit(len);
+        strada_ascii_case_copy((unsigned char *)res->value.pv, (const unsigned char *)s, len, to_upper);
+        res->struct_size = len | STRADA_ASCII_FLAG | utf8;
+        return res;
+    }
+    if (len > (SIZE_MAX - 4) / 2) return strada_new_str("");
+    char *out = malloc(len * 2 + 4);
+    if (!out) return strada_new_str("");
+    size_t n = strada_case_map_into(out, s, len, to_upper);
+    StradaValue *res = strada_new_str_len(out, n);
+    free(out);
+    res->struct_size |= utf8;
+    return res;
+}
+
+StradaValue* strada_uc_sv(StradaValue *sv) { return strada_case_map_sv(sv, 1); }
+StradaValue* strada_lc_sv(StradaValue *sv) { return strada_case_map_sv(sv, 0); }
+
 char* strada_uc(const char *str) {
     return strada_case_map(str, strada_unicode_to_upper);
 }
@@ -16614,12 +19858,7 @@ static char* strada_case_map_ascii(const char *str, int to_upper) {
     size_t len = strlen(str);
     char *out = (char *)malloc(len + 1);
     if (!out) return strdup("");
-    for (size_t i = 0; i < len; i++) {
-        unsigned char c = (unsigned char)str[i];
-        if (to_upper)      { if (c >= 'a' && c <= 'z') c = (unsigned char)(c - 32); }
-        else               { if (c >= 'A' && c <= 'Z') c = (unsigned char)(c + 32); }
-        out[i] = (char)c;
-    }
+    strada_ascii_case_copy((unsigned char *)out, (const unsigned char *)str, len, to_upper);
     out[len] = '\0';
     return out;
 }
@@ -16831,52 +20070,56 @@ char* strada_rtrim(const char *str) {
     return result;
 }
 
+#ifdef STRADA_SIMD_X86
+/* Reverse src[0..n) into dst[0..n) 16 bytes per shuffle; returns the
+ * bytes done (a multiple of 16, taken from the front of src). */
+__attribute__((target("ssse3")))
+static size_t strada_reverse_bytes_ssse3(unsigned char *dst, const unsigned char *src, size_t n) {
+    const __m128i rev = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + n - i - 16), _mm_shuffle_epi8(v, rev));
+    }
+    return i;
+}
+#endif
+
+/* Reverse src[0..n) by characters into dst (n bytes, not overlapping src):
+ * the bytes of a UTF-8 sequence keep their order, and a stray or truncated
+ * sequence byte moves on its own. ASCII runs are reversed 16 bytes at a
+ * time. */
+static void strada_reverse_into(char *dst, const char *src, size_t n) {
+    const unsigned char *s = (const unsigned char *)src;
+    unsigned char *d = (unsigned char *)dst;
+    size_t i = 0;
+    while (i < n) {
+        if (s[i] < 0x80) {
+            size_t run = strada_ascii_run(s + i, n - i);
+            unsigned char *to = d + n - i - run;
+            size_t k = 0;
+#ifdef STRADA_SIMD_X86
+            if (run >= 16 && strada_cpu_ssse3()) k = strada_reverse_bytes_ssse3(to, s + i, run);
+#endif
+            for (; k < run; k++) to[run - 1 - k] = s[i + k];
+            i += run;
+            continue;
+        }
+        int clen = utf8_char_len(s[i]);
+        if (clen <= 0 || i + (size_t)clen > n) clen = 1;
+        memcpy(d + n - i - (size_t)clen, s + i, (size_t)clen);
+        i += (size_t)clen;
+    }
+}
+
 /* UTF-8 aware reverse - reverses characters, not bytes */
 char* strada_reverse(const char *str) {
     if (!str) return strdup("");
-
     size_t byte_len = strlen(str);
-    size_t char_count = utf8_strlen(str);
-
-    if (char_count == 0) return strdup("");
-
-    /* Collect character byte offsets and lengths */
-    size_t *offsets = malloc(char_count * sizeof(size_t));
-    size_t *lengths = malloc(char_count * sizeof(size_t));
-
-    const unsigned char *p = (const unsigned char *)str;
-    size_t char_idx = 0;
-    size_t byte_idx = 0;
-
-    while (*p && char_idx < char_count) {
-        offsets[char_idx] = byte_idx;
-        int clen = utf8_char_len(*p);
-        /* Clamp to bytes remaining: a truncated/invalid trailing sequence
-         * (e.g. a lone 0xF0 lead byte, or binary/pack() data) would otherwise
-         * set lengths[]/byte_idx past byte_len, and the reverse memcpy below
-         * would over-read str and over-write the byte_len-sized result.
-         * Mirrors the clamp in strada_case_map / strada_tr_utf8. */
-        if (clen <= 0 || byte_idx + (size_t)clen > byte_len) clen = 1;
-        lengths[char_idx] = clen;
-        p += clen;
-        byte_idx += clen;
-        char_idx++;
-    }
-
-    /* Build reversed string */
     char *result = malloc(byte_len + 1);
-    char *out = result;
-
-    for (size_t i = char_count; i > 0; i--) {
-        size_t idx = i - 1;
-        memcpy(out, str + offsets[idx], lengths[idx]);
-        out += lengths[idx];
-    }
-    *out = '\0';
-
-    free(offsets);
-    free(lengths);
-
+    if (!result) return strdup("");
+    strada_reverse_into(result, str, byte_len);
+    result[byte_len] = '\0';
     return result;
 }
 
@@ -16902,6 +20145,13 @@ StradaValue* strada_reverse_sv(StradaValue *sv) {
     } else if (sv->type == STRADA_ARRAY) {
         src = sv->value.av;
     }
+    if (src && src->kind) {
+        /* Packed: a boxed copy (the result may land in an untyped
+         * array), flipped in place */
+        StradaValue *copy = strada_array_copy(sv);
+        strada_array_reverse(copy->value.av);
+        return copy;
+    }
     if (src) {
         StradaValue *out = strada_new_array();
         StradaArray *dst = out->value.av;
@@ -16943,19 +20193,25 @@ StradaValue* strada_reverse_sv(StradaValue *sv) {
         return out;
     }
 
-    /* For strings and other types, reverse as string */
+    /* For strings and other types, reverse as string, straight into the
+     * result's buffer. Reversal keeps UTF-8 char boundaries, so the ASCII
+     * and SVf_UTF8 flags carry over unchanged. */
     char _tb[256];
-    const char *str = strada_to_str_buf(sv, _tb, sizeof(_tb));
-    char *reversed = strada_reverse(str);
-    /* Preserve SVf_UTF8 — strada_reverse already handles UTF-8 char
-     * boundaries, so the result is a valid char-oriented string when
-     * the input was. */
-    int is_utf8 = (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR
-                   && STRADA_STR_IS_UTF8(sv));
-    StradaValue *result = is_utf8
-        ? strada_new_str_len_utf8(reversed, strlen(reversed))
-        : strada_new_str(reversed);
-    free(reversed);
+    const char *str;
+    size_t n, flags;
+    if (sv->type == STRADA_STR && sv->value.pv && !(sv->meta && sv->meta->is_tied)) {
+        str = sv->value.pv;
+        n = STRADA_STR_BYTELEN(sv);
+        if (n == 0) n = strlen(str);
+        flags = sv->struct_size & STRADA_STR_FLAGS_MASK;
+    } else {
+        str = strada_to_str_buf(sv, _tb, sizeof(_tb));
+        n = strlen(str);
+        flags = _str_flags(str, n) & STRADA_STR_FLAGS_MASK;
+    }
+    StradaValue *result = strada_str_value_uninit(n);
+    strada_reverse_into(result->value.pv, str, n);
+    result->struct_size = n | flags;
     return result;
 }
 
@@ -17041,11 +20297,19 @@ int strada_ord(const char *str) {
 /* utf8::is_utf8 / utf8::valid - validate if string is well-formed UTF-8 */
 int strada_utf8_is_valid(const char *str, size_t len) {
     if (!str) return 1;  /* NULL/empty is trivially valid */
+#ifdef STRADA_SIMD_X86
+    if (len >= 32 && strada_cpu_avx2()) return strada_utf8_valid_avx2((const unsigned char *)str, len);
+#endif
     size_t i = 0;
     while (i < len) {
         unsigned char c = (unsigned char)str[i];
+        if (c < 0x80) {
+            i += strada_ascii_run((const unsigned char *)str + i, len - i);
+            continue;
+        }
+        /* Invalid start byte (utf8_char_len maps these to 1) */
+        if (utf8_is_continuation(c) || c >= 0xF8) return 0;
         int char_len = utf8_char_len(c);
-        if (char_len == 0) return 0;  /* Invalid start byte */
         if (i + char_len > len) return 0;  /* Truncated sequence */
         for (int j = 1; j < char_len; j++) {
             if (!utf8_is_continuation((unsigned char)str[i + j])) return 0;
@@ -17603,9 +20867,8 @@ int64_t strada_vec_get(StradaValue *sv, int64_t offset, int bits) {
 void strada_vec_set(StradaValue *sv, int64_t offset, int bits, int64_t value) {
     if (!sv || STRADA_IS_TAGGED_INT(sv) || offset < 0) return;
     /* Cap the offset so (offset+1)*nbytes can't overflow size_t. Without this a
-     * huge offset overflows the 64-bit product (wrapping it small) or, combined
-     * with the (uint32_t) cast on ss_new_uninit below, truncates the allocation
-     * length while the memset/writes use the full value -> heap overflow. */
+     * huge offset overflows the 64-bit product (wrapping it small), undersizing
+     * the allocation while the memset/writes use the full value -> heap overflow. */
     if (offset > (int64_t)UINT32_MAX) return;
     if (bits != 1 && bits != 2 && bits != 4 && bits != 8
         && bits != 16 && bits != 32 && bits != 64) return;
@@ -17619,10 +20882,6 @@ void strada_vec_set(StradaValue *sv, int64_t offset, int bits, int64_t value) {
         size_t bit_end = (size_t)(offset + 1) * (size_t)bits;
         needed_bytes = (bit_end + 7) / 8;
     }
-    /* The StradaString length field is 32-bit (ss_new_uninit takes uint32_t);
-     * reject anything that wouldn't fit, mirroring the concat 4GB guard. */
-    if (needed_bytes > UINT32_MAX) return;
-
     /* Convert sv to a mutable STRADA_STR, growing if needed. */
     size_t cur_len = 0;
     char *cur_pv = NULL;
@@ -17640,7 +20899,7 @@ void strada_vec_set(StradaValue *sv, int64_t offset, int bits, int64_t value) {
 #endif
         /* Re-allocate the StradaString to hold needed_bytes (+ NUL).
          * Allocate a fresh ss; copy existing bytes; zero-fill new tail. */
-        StradaString *ss = ss_new_uninit((uint32_t)needed_bytes);
+        StradaString *ss = ss_new_uninit(needed_bytes);
         if (!ss) return;
         if (cur_len > 0 && cur_pv) {
             memcpy(ss->data, cur_pv, cur_len);
@@ -17650,24 +20909,23 @@ void strada_vec_set(StradaValue *sv, int64_t offset, int bits, int64_t value) {
         }
         ss->data[needed_bytes] = '\0';
         /* Free old StradaString if any. */
-        if (sv->type == STRADA_STR && sv->value.pv) {
-            StradaString *old_ss = SS_FROM_PV(sv->value.pv);
-            ss_decref(old_ss);
-        }
+        if (sv->type == STRADA_STR && sv->value.pv) strada_str_free_pv(sv);
         sv->type = STRADA_STR;
         sv->value.pv = ss->data;
         sv->struct_size = _str_flags(ss->data, needed_bytes);
-    } else if (cur_pv && SS_FROM_PV(cur_pv)->refcount > 1) {
-        /* COW: the StradaString is shared (zero-copy keys()/each() share) —
-         * clone before writing so we don't mutate a live hash key. */
-        StradaString *ss = ss_new_uninit((uint32_t)cur_len);
+    } else if (cur_pv && (STRADA_STR_IS_VIEW(sv) || SS_FROM_PV(cur_pv)->refcount > 1)) {
+        /* COW: the StradaString is shared (zero-copy keys()/each() share,
+         * or a substring view into another string) — clone before writing
+         * so we don't mutate a live hash key or the view's root. */
+        StradaString *ss = ss_new_uninit(cur_len);
         if (!ss) return;
         memcpy(ss->data, cur_pv, cur_len);
         ss->data[cur_len] = '\0';
-        ss_decref(SS_FROM_PV(cur_pv));
+        strada_str_free_pv(sv);
         sv->value.pv = ss->data;
     }
 
+    strada_u8_index_drop(sv);
     unsigned char *data = (unsigned char *)sv->value.pv;
 
     if (bits >= 8) {
@@ -19147,6 +22405,14 @@ int strada_strncmp(const char *s1, const char *s2, int n) {
 char* strada_join(const char *sep, StradaArray *arr) {
     if (!arr || arr->size == 0) return strdup("");
     if (!sep) sep = "";
+    if (arr->kind) {
+        StradaValue *sep_sv = strada_new_str(sep);
+        StradaValue *res = strada_join_sv(sep_sv, arr);
+        char *out = strdup(res->value.pv);
+        strada_decref(res);
+        strada_decref(sep_sv);
+        return out;
+    }
 
     size_t sep_len = strlen(sep);
     size_t n = arr->size;
@@ -19191,6 +22457,8 @@ char* strada_join(const char *sep, StradaArray *arr) {
  * preserved. Returns a StradaValue* with the byte-accurate length set. */
 StradaValue* strada_join_sv(StradaValue *sep_sv, StradaArray *arr) {
     if (!arr || arr->size == 0) return strada_new_str_len("", 0);
+    /* Packed slots format straight into the sink's buffer */
+    if (arr->kind) return strada_join_append(strada_new_str_len("", 0), sep_sv, arr);
 
     const char *sep = "";
     size_t sep_len = 0;
@@ -19247,17 +22515,10 @@ StradaValue* strada_join_sv(StradaValue *sep_sv, StradaArray *arr) {
         if (i < arr->size - 1) total_len += sep_len;
     }
 
-    /* StradaString.len is uint32_t — abort cleanly rather than truncate
-     * (mirrors the concat 4GB guards). */
-    if (total_len > UINT32_MAX) {
-        fprintf(stderr, "strada: join result exceeds 4GB limit (%zu bytes)\n", total_len);
-        abort();
-    }
-
     /* Build DIRECTLY into the result StradaString — previously the parts were
      * assembled in a malloc'd scratch buffer and then strada_new_str_len
      * copied the entire result a second time. */
-    StradaString *oss = ss_new_uninit((uint32_t)total_len);
+    StradaString *oss = ss_new_uninit(total_len);
     char *p = oss->data;
     for (size_t i = 0; i < arr->size; i++) {
         StradaValue *el = arr->elements[arr->head + i];
@@ -19286,6 +22547,89 @@ StradaValue* strada_join_sv(StradaValue *sep_sv, StradaArray *arr) {
     return rv;
 }
 
+/* strada_join_sv into a sink. Pieces are staged in a stack buffer so a
+ * join of many short elements costs a few sink writes, not one per
+ * element. Elements stringify as in strada_join_sv. */
+static void strada_join_sink(StradaSink *k, StradaValue *sep_sv, StradaArray *arr) {
+    if (!arr || arr->size == 0) return;
+    const char *sep = "";
+    size_t sep_len = 0;
+    char *sep_owned = NULL;
+    char _sb[64];
+    if (sep_sv && !STRADA_IS_TAGGED_INT(sep_sv) && sep_sv->type == STRADA_STR && sep_sv->value.pv) {
+        sep = sep_sv->value.pv;
+        sep_len = STRADA_STR_BYTELEN(sep_sv);
+        if (sep_len == 0) sep_len = strlen(sep);
+        if (STRADA_STR_IS_UTF8(sep_sv)) k->utf8 = 1;
+    } else if (sep_sv && !STRADA_IS_TAGGED_INT(sep_sv) && sep_sv->type == STRADA_REF) {
+        sep = sep_owned = strada_to_str(sep_sv);
+        sep_len = sep ? strlen(sep) : 0;
+    } else if (sep_sv) {
+        sep = strada_to_str_buf(sep_sv, _sb, sizeof(_sb));
+        sep_len = strlen(sep);
+    }
+
+    char stage[4096];
+    size_t used = 0;
+#define JOIN_PUT(p, n) do { \
+        size_t jp_n = (n); \
+        if (used + jp_n > sizeof(stage)) { strada_sink_write(k, stage, used); used = 0; } \
+        if (jp_n >= sizeof(stage)) strada_sink_write(k, (p), jp_n); \
+        else { memcpy(stage + used, (p), jp_n); used += jp_n; } \
+    } while (0)
+    if (arr->kind) {
+        for (size_t i = 0; i < arr->size; i++) {
+            char nb[64];
+            if (i > 0 && sep_len > 0) JOIN_PUT(sep, sep_len);
+            JOIN_PUT(nb, (size_t)av_packed_fmt(arr, arr->head + i, nb));
+        }
+    } else {
+        for (size_t i = 0; i < arr->size; i++) {
+            StradaValue *el = arr->elements[arr->head + i];
+            if (i > 0 && sep_len > 0) JOIN_PUT(sep, sep_len);
+            if (el && !STRADA_IS_TAGGED_INT(el) && el->type == STRADA_STR && el->value.pv) {
+                size_t el_len = STRADA_STR_BYTELEN(el);
+                if (el_len == 0) el_len = strlen(el->value.pv);
+                if (STRADA_STR_IS_UTF8(el)) k->utf8 = 1;
+                JOIN_PUT(el->value.pv, el_len);
+            } else if (el && !STRADA_IS_TAGGED_INT(el) && el->type == STRADA_REF) {
+                char *es = strada_to_str(el);
+                if (es) { JOIN_PUT(es, strlen(es)); free(es); }
+            } else {
+                char _tb[256];
+                const char *es = strada_to_str_buf(el, _tb, sizeof(_tb));
+                JOIN_PUT(es, strlen(es));
+            }
+        }
+    }
+#undef JOIN_PUT
+    strada_sink_write(k, stage, used);
+    free(sep_owned);
+}
+
+/* `print($fh, join(sep, @a))` / `say(...)`: write the pieces straight to
+ * the handle (NULL = default output). */
+void strada_join_to(StradaValue *fh, int newline, StradaValue *sep_sv, StradaArray *arr) {
+    StradaSink k;
+    if (strada_sink_open_fh(&k, fh, newline)) {
+        strada_join_sink(&k, sep_sv, arr);
+        strada_sink_close(&k, newline);
+        return;
+    }
+    StradaValue *res = strada_join_sv(sep_sv, arr);
+    strada_print_result(res, fh, newline);
+    strada_decref(res);
+}
+
+/* `$s .= join(sep, @a)`: ownership as strada_sprintf_append. */
+StradaValue* strada_join_append(StradaValue *dst, StradaValue *sep_sv, StradaArray *arr) {
+    StradaSink k;
+    strada_sink_open_append(&k, dst);
+    strada_join_sink(&k, sep_sv, arr);
+    strada_sink_close(&k, 0);
+    return k.dst;
+}
+
 /* ===== STRING BUILDER ===== */
 /* Efficient string building with O(1) amortized append */
 
@@ -19363,52 +22707,1644 @@ void strada_sb_append_str(StradaValue *sb_val, const char *str) {
     StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
     if (!sb) return;
 
-    size_t len = strlen(str);
+    size_t len = strlen(str);
+
+    /* Grow buffer if needed (double capacity) */
+    while (sb->length + len + 1 > sb->capacity) {
+        sb->capacity *= 2;
+        sb->buffer = sr_xrealloc(sb->buffer, sb->capacity);
+    }
+
+    memcpy(sb->buffer + sb->length, str, len);
+    sb->length += len;
+    sb->buffer[sb->length] = '\0';
+}
+
+StradaValue* strada_sb_to_string(StradaValue *sb_val) {
+    if (!sb_val || sb_val->type != STRADA_CPOINTER) return strada_new_str("");
+    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
+    if (!sb) return strada_new_str("");
+
+    return strada_new_str_len(sb->buffer, sb->length);
+}
+
+StradaValue* strada_sb_length(StradaValue *sb_val) {
+    if (!sb_val || sb_val->type != STRADA_CPOINTER) return strada_new_int(0);
+    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
+    if (!sb) return strada_new_int(0);
+
+    return strada_new_int(sb->length);
+}
+
+void strada_sb_clear(StradaValue *sb_val) {
+    if (!sb_val || sb_val->type != STRADA_CPOINTER) return;
+    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
+    if (!sb) return;
+
+    sb->length = 0;
+    sb->buffer[0] = '\0';
+}
+
+void strada_sb_free(StradaValue *sb_val) {
+    if (!sb_val || sb_val->type != STRADA_CPOINTER) return;
+    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
+    if (sb) {
+        free(sb->buffer);
+        free(sb);
+    }
+    sb_val->value.ptr = NULL;
+}
+
+/* ===== NATIVE COLLECTIONS =====
+ *
+ * C-backed containers behind lib/Collections: a hash set, a ring-buffer
+ * deque, a d-ary heap and a B-tree ordered map. Each is a STRADA_CPOINTER
+ * whose struct_name is its kind ("Set", "Deque", "Heap", "OrderedMap"),
+ * reached through a ref blessed into the matching Collections:: package,
+ * so methods dispatch to the library and strada_free_value releases the
+ * container via strada_coll_free(). Containers own references to their
+ * elements; none of them lock, so share one across threads only behind a
+ * mutex. The cycle collector does not look inside them. */
+
+static StradaValue *coll_new(void *p, const char *kind, const char *package) {
+    StradaValue *sv = strada_value_alloc();
+    sv->type = STRADA_CPOINTER;
+    sv->refcount = 1;
+    sv->value.ptr = p;
+    strada_ensure_meta(sv)->struct_name = strdup(kind);
+    StradaValue *ref = strada_new_ref(sv, '$');
+    strada_decref(sv);
+    return strada_bless(ref, package);
+}
+
+static void *coll_get(StradaValue *self, const char *kind) {
+    StradaValue *sv = self;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_REF) sv = sv->value.rv;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_CPOINTER && sv->value.ptr) {
+        const char *sn = SV_STRUCT_NAME(sv);
+        if (sn && strcmp(sn, kind) == 0) return sv->value.ptr;
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "Collections::%s method called on something else", kind);
+    strada_throw(msg);
+}
+
+static StradaValue *coll_bool(int b) {
+    return strada_new_int(b ? 1 : 0);
+}
+
+static StradaValue *coll_owned(StradaValue *sv) {
+    if (!sv) return strada_new_undef();
+    strada_incref(sv);
+    return sv;
+}
+
+/* --- Set: a hash keyed by each member's string form, holding the member --- */
+
+typedef struct StradaCollSet {
+    StradaValue *hv;    /* STRADA_HASH: key → member */
+} StradaCollSet;
+
+static StradaHash *cset_hash(StradaValue *self) {
+    return ((StradaCollSet *)coll_get(self, "Set"))->hv->value.hv;
+}
+
+/* Insert v unless its key is present. Returns 1 if added. */
+static int cset_insert(StradaHash *hv, StradaValue *v) {
+    char key_buf[SV_KEYBUF_LEN];
+    char *key_alloc;
+    const char *key = sv_key_extract_buf(v, key_buf, sizeof(key_buf), &key_alloc);
+    if (!key) { if (key_alloc) free(key_alloc); return 0; }
+    unsigned int hash = strada_hash_string(key);
+    uint32_t key_len = (uint32_t)strlen(key);
+    size_t ins;
+    int added = 0;
+    if (!hv_find_for_insert(hv, key, key_len, hash, &ins)) {
+        strada_incref(v);
+        hv_insert_at(hv, ins, sv_key_ss(v, key, key_len, hash), v);
+        added = 1;
+    }
+    if (key_alloc) free(key_alloc);
+    return added;
+}
+
+/* Copy entry e of another set into hv (key known absent) */
+static void cset_insert_entry(StradaHash *hv, StradaHashEntry *e) {
+    size_t ins;
+    if (hv_find_for_insert(hv, e->key->data, (uint32_t)e->key->len, e->key->hash, &ins)) return;
+    ss_incref(e->key);
+    strada_incref(e->value);
+    hv_insert_at(hv, ins, e->key, e->value);
+}
+
+static int cset_has_entry(StradaHash *hv, StradaHashEntry *e) {
+    return hv_find(hv, e->key->data, (uint32_t)e->key->len, e->key->hash) != NULL;
+}
+
+StradaValue* strada_coll_set_new(StradaValue *items) {
+    StradaCollSet *s = sr_xmalloc(sizeof(StradaCollSet));
+    s->hv = strada_new_hash();
+    StradaArray *av = items ? strada_deref_array(items) : NULL;
+    if (av) {
+        strada_hash_reserve(s->hv->value.hv, av->size);
+        for (size_t i = 0; i < av->size; i++)
+            cset_insert(s->hv->value.hv, strada_array_get(av, (int64_t)i));
+    }
+    return coll_new(s, "Set", "Collections::Set");
+}
+
+StradaValue* strada_coll_set_add(StradaValue *self, StradaValue *v) {
+    return coll_bool(cset_insert(cset_hash(self), v));
+}
+
+StradaValue* strada_coll_set_remove(StradaValue *self, StradaValue *v) {
+    StradaHash *hv = cset_hash(self);
+    char key_buf[SV_KEYBUF_LEN];
+    char *key_alloc;
+    const char *key = sv_key_extract_buf(v, key_buf, sizeof(key_buf), &key_alloc);
+    if (!key) { if (key_alloc) free(key_alloc); return coll_bool(0); }
+    int64_t b = hv_find_bucket(hv, key, (uint32_t)strlen(key), strada_hash_string(key));
+    if (key_alloc) free(key_alloc);
+    if (b < 0) return coll_bool(0);
+    strada_decref(hv_remove_bucket(hv, (size_t)b));
+    return coll_bool(1);
+}
+
+StradaValue* strada_coll_set_contains(StradaValue *self, StradaValue *v) {
+    return coll_bool(strada_hash_exists_sv(cset_hash(self), v));
+}
+
+StradaValue* strada_coll_set_size(StradaValue *self) {
+    return strada_new_int((int64_t)cset_hash(self)->num_entries);
+}
+
+StradaValue* strada_coll_set_clear(StradaValue *self) {
+    StradaCollSet *s = coll_get(self, "Set");
+    strada_decref(s->hv);
+    s->hv = strada_new_hash();
+    return strada_new_undef();
+}
+
+StradaValue* strada_coll_set_members(StradaValue *self) {
+    return strada_new_array_from_av(strada_hash_values(cset_hash(self)));
+}
+
+/* op: 'u' union, 'i' intersection, 'd' difference, 'x' symmetric difference */
+StradaValue* strada_coll_set_algebra(StradaValue *self, StradaValue *other, int o) {
+    StradaHash *a = cset_hash(self);
+    StradaHash *b = cset_hash(other);
+    StradaValue *result = strada_coll_set_new(NULL);
+    StradaHash *r = cset_hash(result);
+    size_t small = a->num_entries < b->num_entries ? a->num_entries : b->num_entries;
+    strada_hash_reserve(r, o == 'i' ? small : o == 'd' ? a->num_entries
+                                              : a->num_entries + b->num_entries);
+    if (o == 'i' && b->num_entries < a->num_entries) {
+        /* Probe the larger set with the smaller one's members */
+        for (size_t i = 0; i < b->next_slot; i++) {
+            StradaHashEntry *e = &b->entries[i];
+            if (e->key && cset_has_entry(a, e)) cset_insert_entry(r, e);
+        }
+        return result;
+    }
+    for (size_t i = 0; i < a->next_slot; i++) {
+        StradaHashEntry *e = &a->entries[i];
+        if (!e->key) continue;
+        int in_b = o == 'u' ? 1 : cset_has_entry(b, e);
+        if (o == 'u' || (o == 'i') == in_b) cset_insert_entry(r, e);
+    }
+    if (o == 'u' || o == 'x') {
+        for (size_t i = 0; i < b->next_slot; i++) {
+            StradaHashEntry *e = &b->entries[i];
+            if (e->key && (o == 'u' || !cset_has_entry(a, e))) cset_insert_entry(r, e);
+        }
+    }
+    return result;
+}
+
+/* Number of self's members that other also has */
+StradaValue* strada_coll_set_common(StradaValue *self, StradaValue *other) {
+    StradaHash *a = cset_hash(self);
+    StradaHash *b = cset_hash(other);
+    if (b->num_entries < a->num_entries) { StradaHash *t = a; a = b; b = t; }
+    int64_t n = 0;
+    for (size_t i = 0; i < a->next_slot; i++) {
+        StradaHashEntry *e = &a->entries[i];
+        if (e->key && cset_has_entry(b, e)) n++;
+    }
+    return strada_new_int(n);
+}
+
+/* --- Deque: a power-of-two ring buffer, O(1) at both ends --- */
+
+typedef struct StradaCollDeque {
+    StradaValue **slots;
+    size_t head;
+    size_t len;
+    size_t cap;         /* power of 2 */
+} StradaCollDeque;
+
+#define DEQ_AT(d, i) ((d)->slots[((d)->head + (i)) & ((d)->cap - 1)])
+
+static void deque_grow(StradaCollDeque *d) {
+    size_t cap = d->cap * 2;
+    StradaValue **slots = sr_xmalloc(cap * sizeof(StradaValue *));
+    for (size_t i = 0; i < d->len; i++) slots[i] = DEQ_AT(d, i);
+    free(d->slots);
+    d->slots = slots;
+    d->head = 0;
+    d->cap = cap;
+}
+
+/* Index i from the front, or from the back when negative; -1 if out of range */
+static int64_t deque_index(StradaCollDeque *d, StradaValue *iv) {
+    int64_t i = strada_to_int(iv);
+    if (i < 0) i += (int64_t)d->len;
+    return (i < 0 || i >= (int64_t)d->len) ? -1 : i;
+}
+
+StradaValue* strada_coll_deque_new(StradaValue *items) {
+    StradaCollDeque *d = sr_xmalloc(sizeof(StradaCollDeque));
+    d->cap = 16;
+    d->head = 0;
+    d->len = 0;
+    StradaArray *av = items ? strada_deref_array(items) : NULL;
+    while (av && d->cap < av->size) d->cap *= 2;
+    d->slots = sr_xmalloc(d->cap * sizeof(StradaValue *));
+    for (size_t i = 0; av && i < av->size; i++) {
+        StradaValue *v = strada_array_get(av, (int64_t)i);
+        strada_incref(v);
+        d->slots[d->len++] = v;
+    }
+    return coll_new(d, "Deque", "Collections::Deque");
+}
+
+StradaValue* strada_coll_deque_push_back(StradaValue *self, StradaValue *v) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    if (d->len == d->cap) deque_grow(d);
+    strada_incref(v);
+    DEQ_AT(d, d->len) = v;
+    d->len++;
+    return strada_new_int((int64_t)d->len);
+}
+
+StradaValue* strada_coll_deque_push_front(StradaValue *self, StradaValue *v) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    if (d->len == d->cap) deque_grow(d);
+    strada_incref(v);
+    d->head = (d->head - 1) & (d->cap - 1);
+    d->slots[d->head] = v;
+    d->len++;
+    return strada_new_int((int64_t)d->len);
+}
+
+StradaValue* strada_coll_deque_pop_back(StradaValue *self) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    if (d->len == 0) return strada_new_undef();
+    d->len--;
+    return DEQ_AT(d, d->len);
+}
+
+StradaValue* strada_coll_deque_pop_front(StradaValue *self) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    if (d->len == 0) return strada_new_undef();
+    StradaValue *v = d->slots[d->head];
+    d->head = (d->head + 1) & (d->cap - 1);
+    d->len--;
+    return v;
+}
+
+StradaValue* strada_coll_deque_get(StradaValue *self, StradaValue *index) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    int64_t i = deque_index(d, index);
+    return i < 0 ? strada_new_undef() : coll_owned(DEQ_AT(d, i));
+}
+
+StradaValue* strada_coll_deque_set(StradaValue *self, StradaValue *index, StradaValue *v) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    int64_t i = deque_index(d, index);
+    if (i < 0) strada_throw("Collections::Deque: index out of range");
+    strada_incref(v);
+    strada_decref(DEQ_AT(d, i));
+    DEQ_AT(d, i) = v;
+    return strada_new_undef();
+}
+
+StradaValue* strada_coll_deque_size(StradaValue *self) {
+    return strada_new_int((int64_t)((StradaCollDeque *)coll_get(self, "Deque"))->len);
+}
+
+StradaValue* strada_coll_deque_clear(StradaValue *self) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    while (d->len > 0) {
+        d->len--;
+        strada_decref(DEQ_AT(d, d->len));
+    }
+    d->head = 0;
+    return strada_new_undef();
+}
+
+StradaValue* strada_coll_deque_to_array(StradaValue *self) {
+    StradaCollDeque *d = coll_get(self, "Deque");
+    StradaValue *result = strada_new_array();
+    StradaArray *av = result->value.av;
+    strada_array_reserve(av, d->len);
+    for (size_t i = 0; i < d->len; i++) strada_array_push(av, DEQ_AT(d, i));
+    return result;
+}
+
+/* --- Heap: 4-ary, ordered by a numeric priority or a comparator closure --- */
+
+#define STRADA_HEAP_ARITY 4
+
+typedef struct StradaHeapNode {
+    double prio;        /* numeric heaps only */
+    StradaValue *val;
+} StradaHeapNode;
+
+typedef struct StradaCollHeap {
+    StradaHeapNode *nodes;
+    size_t len;
+    size_t cap;
+    StradaValue *cmp;   /* closure ($a, $b) → <0 when $a comes out first; NULL = numeric */
+    int max;            /* numeric: largest priority first */
+} StradaCollHeap;
+
+static int heap_before(StradaCollHeap *h, StradaHeapNode *a, StradaHeapNode *b) {
+    if (h->cmp) {
+        StradaValue *r = strada_closure_call(h->cmp, 2, a->val, b->val);
+        int64_t c = strada_to_int(r);
+        strada_decref(r);
+        return c < 0;
+    }
+    return h->max ? a->prio > b->prio : a->prio < b->prio;
+}
+
+/* Sifts swap whole nodes, so a comparator that throws part-way leaves every
+ * element in the heap exactly once (possibly out of order), never lost. */
+static void heap_swap(StradaCollHeap *h, size_t i, size_t j) {
+    StradaHeapNode t = h->nodes[i];
+    h->nodes[i] = h->nodes[j];
+    h->nodes[j] = t;
+}
+
+static void heap_sift_up(StradaCollHeap *h, size_t i) {
+    while (i > 0) {
+        size_t p = (i - 1) / STRADA_HEAP_ARITY;
+        if (!heap_before(h, &h->nodes[i], &h->nodes[p])) break;
+        heap_swap(h, i, p);
+        i = p;
+    }
+}
+
+static void heap_sift_down(StradaCollHeap *h, size_t i) {
+    for (;;) {
+        size_t c = i * STRADA_HEAP_ARITY + 1;
+        if (c >= h->len) break;
+        size_t end = c + STRADA_HEAP_ARITY < h->len ? c + STRADA_HEAP_ARITY : h->len;
+        size_t best = c;
+        for (size_t j = c + 1; j < end; j++)
+            if (heap_before(h, &h->nodes[j], &h->nodes[best])) best = j;
+        if (!heap_before(h, &h->nodes[best], &h->nodes[i])) break;
+        heap_swap(h, i, best);
+        i = best;
+    }
+}
+
+static void heap_add(StradaCollHeap *h, double prio, StradaValue *v) {
+    if (h->len == h->cap) {
+        h->cap *= 2;
+        h->nodes = sr_xrealloc(h->nodes, h->cap * sizeof(StradaHeapNode));
+    }
+    strada_incref(v);
+    h->nodes[h->len].prio = prio;
+    h->nodes[h->len].val = v;
+    h->len++;
+    heap_sift_up(h, h->len - 1);
+}
+
+/* max: largest numeric priority first; cmp: comparator closure, or undef */
+StradaValue* strada_coll_heap_new(int max, StradaValue *cmp) {
+    StradaCollHeap *h = sr_xmalloc(sizeof(StradaCollHeap));
+    h->cap = 16;
+    h->len = 0;
+    h->nodes = sr_xmalloc(h->cap * sizeof(StradaHeapNode));
+    h->max = max != 0;
+    h->cmp = NULL;
+    if (cmp && !STRADA_IS_TAGGED_INT(cmp) && cmp->type == STRADA_CLOSURE) {
+        strada_incref(cmp);
+        h->cmp = cmp;
+    }
+    return coll_new(h, "Heap", "Collections::Heap");
+}
+
+StradaValue* strada_coll_heap_push(StradaValue *self, StradaValue *v) {
+    StradaCollHeap *h = coll_get(self, "Heap");
+    heap_add(h, h->cmp ? 0.0 : strada_to_num(v), v);
+    return strada_new_int((int64_t)h->len);
+}
+
+StradaValue* strada_coll_heap_insert(StradaValue *self, StradaValue *prio, StradaValue *v) {
+    StradaCollHeap *h = coll_get(self, "Heap");
+    if (h->cmp) strada_throw("Collections::Heap: insert() needs a numeric heap; use push()");
+    heap_add(h, strada_to_num(prio), v);
+    return strada_new_int((int64_t)h->len);
+}
+
+StradaValue* strada_coll_heap_pop(StradaValue *self) {
+    StradaCollHeap *h = coll_get(self, "Heap");
+    if (h->len == 0) return strada_new_undef();
+    heap_swap(h, 0, h->len - 1);
+    h->len--;
+    StradaValue *top = h->nodes[h->len].val;
+    strada_cleanup_push(top);   /* a throwing comparator must not leak it */
+    heap_sift_down(h, 0);
+    strada_cleanup_pop();
+    return top;
+}
+
+StradaValue* strada_coll_heap_peek(StradaValue *self) {
+    StradaCollHeap *h = coll_get(self, "Heap");
+    return h->len == 0 ? strada_new_undef() : coll_owned(h->nodes[0].val);
+}
+
+StradaValue* strada_coll_heap_peek_priority(StradaValue *self) {
+    StradaCollHeap *h = coll_get(self, "Heap");
+    return (h->len == 0 || h->cmp) ? strada_new_undef() : strada_new_num(h->nodes[0].prio);
+}
+
+StradaValue* strada_coll_heap_size(StradaValue *self) {
+    return strada_new_int((int64_t)((StradaCollHeap *)coll_get(self, "Heap"))->len);
+}
+
+StradaValue* strada_coll_heap_clear(StradaValue *self) {
+    StradaCollHeap *h = coll_get(self, "Heap");
+    while (h->len > 0) strada_decref(h->nodes[--h->len].val);
+    return strada_new_undef();
+}
+
+/* --- OrderedMap: a B-tree keyed by strings (byte order) or numbers --- */
+
+#define STRADA_BT_T 16   /* minimum degree: nodes hold T-1 .. 2T-1 entries */
+
+typedef struct StradaBtEntry {
+    StradaValue *key;   /* private STR (string maps) or number */
+    StradaValue *val;
+    double num;         /* numeric maps: the key's value */
+} StradaBtEntry;
+
+typedef struct StradaBtNode {
+    int n;
+    int leaf;
+    StradaBtEntry e[2 * STRADA_BT_T - 1];
+    struct StradaBtNode *c[2 * STRADA_BT_T];
+} StradaBtNode;
+
+typedef struct StradaCollOMap {
+    StradaBtNode *root;
+    size_t size;
+    int numeric;
+} StradaCollOMap;
+
+/* A key being looked up, in the map's key form */
+typedef struct StradaBtProbe {
+    const char *p;
+    size_t len;
+    double num;
+    char *alloc;
+    char buf[SV_KEYBUF_LEN];
+} StradaBtProbe;
+
+static void bt_probe_init(StradaCollOMap *m, StradaBtProbe *pr, StradaValue *key) {
+    pr->alloc = NULL;
+    pr->p = NULL;
+    pr->len = 0;
+    pr->num = 0;
+    if (m->numeric) {
+        pr->num = strada_to_num(key);
+        if (pr->num == 0) pr->num = 0.0;
+        return;
+    }
+    if (key && !STRADA_IS_TAGGED_INT(key) && key->type == STRADA_STR && key->value.pv) {
+        pr->p = key->value.pv;
+        pr->len = STRADA_STR_BYTELEN(key);
+        return;
+    }
+    pr->p = sv_key_extract_buf(key, pr->buf, sizeof(pr->buf), &pr->alloc);
+    if (!pr->p) pr->p = "";
+    pr->len = strlen(pr->p);
+}
+
+static void bt_probe_done(StradaBtProbe *pr) {
+    if (pr->alloc) free(pr->alloc);
+}
+
+static inline int bt_cmp(StradaCollOMap *m, StradaBtEntry *e, StradaBtProbe *pr) {
+    if (m->numeric) return (e->num > pr->num) - (e->num < pr->num);
+    size_t el = STRADA_STR_BYTELEN(e->key);
+    size_t n = el < pr->len ? el : pr->len;
+    int r = memcmp(e->key->value.pv, pr->p, n);
+    if (r != 0) return r;
+    return (el > pr->len) - (el < pr->len);
+}
+
+/* First index in x whose key is >= the probe */
+static int bt_lower(StradaCollOMap *m, StradaBtNode *x, StradaBtProbe *pr) {
+    int lo = 0, hi = x->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (bt_cmp(m, &x->e[mid], pr) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static StradaBtNode *bt_node_new(int leaf) {
+    StradaBtNode *x = sr_xmalloc(sizeof(StradaBtNode));
+    x->n = 0;
+    x->leaf = leaf;
+    return x;
+}
+
+static void bt_free(StradaBtNode *x, int release) {
+    if (!x) return;
+    if (!x->leaf)
+        for (int i = 0; i <= x->n; i++) bt_free(x->c[i], release);
+    if (release) {
+        for (int i = 0; i < x->n; i++) {
+            strada_decref(x->e[i].key);
+            strada_decref(x->e[i].val);
+        }
+    }
+    free(x);
+}
+
+/* Split the full child x->c[i] around its median */
+static void bt_split(StradaBtNode *x, int i) {
+    StradaBtNode *y = x->c[i];
+    StradaBtNode *z = bt_node_new(y->leaf);
+    z->n = STRADA_BT_T - 1;
+    memcpy(z->e, y->e + STRADA_BT_T, (STRADA_BT_T - 1) * sizeof(StradaBtEntry));
+    if (!y->leaf) memcpy(z->c, y->c + STRADA_BT_T, STRADA_BT_T * sizeof(StradaBtNode *));
+    y->n = STRADA_BT_T - 1;
+    memmove(x->c + i + 2, x->c + i + 1, (size_t)(x->n - i) * sizeof(StradaBtNode *));
+    x->c[i + 1] = z;
+    memmove(x->e + i + 1, x->e + i, (size_t)(x->n - i) * sizeof(StradaBtEntry));
+    x->e[i] = y->e[STRADA_BT_T - 1];
+    x->n++;
+}
+
+/* Merge x->c[i+1] and the separator x->e[i] into x->c[i] */
+static void bt_merge(StradaBtNode *x, int i) {
+    StradaBtNode *y = x->c[i];
+    StradaBtNode *z = x->c[i + 1];
+    y->e[y->n] = x->e[i];
+    memcpy(y->e + y->n + 1, z->e, (size_t)z->n * sizeof(StradaBtEntry));
+    if (!y->leaf) memcpy(y->c + y->n + 1, z->c, (size_t)(z->n + 1) * sizeof(StradaBtNode *));
+    y->n += z->n + 1;
+    memmove(x->e + i, x->e + i + 1, (size_t)(x->n - i - 1) * sizeof(StradaBtEntry));
+    memmove(x->c + i + 1, x->c + i + 2, (size_t)(x->n - i - 1) * sizeof(StradaBtNode *));
+    x->n--;
+    free(z);
+}
+
+/* Give x->c[i] at least T entries before descending into it: borrow from
+ * a sibling through the separator, or merge with one. Returns the index
+ * of the child that now covers the same keys. */
+static int bt_fill(StradaBtNode *x, int i) {
+    StradaBtNode *y = x->c[i];
+    if (y->n >= STRADA_BT_T) return i;
+    if (i > 0 && x->c[i - 1]->n >= STRADA_BT_T) {
+        StradaBtNode *l = x->c[i - 1];
+        memmove(y->e + 1, y->e, (size_t)y->n * sizeof(StradaBtEntry));
+        if (!y->leaf) memmove(y->c + 1, y->c, (size_t)(y->n + 1) * sizeof(StradaBtNode *));
+        y->e[0] = x->e[i - 1];
+        if (!y->leaf) y->c[0] = l->c[l->n];
+        x->e[i - 1] = l->e[l->n - 1];
+        l->n--;
+        y->n++;
+        return i;
+    }
+    if (i < x->n && x->c[i + 1]->n >= STRADA_BT_T) {
+        StradaBtNode *r = x->c[i + 1];
+        y->e[y->n] = x->e[i];
+        if (!y->leaf) y->c[y->n + 1] = r->c[0];
+        y->n++;
+        x->e[i] = r->e[0];
+        memmove(r->e, r->e + 1, (size_t)(r->n - 1) * sizeof(StradaBtEntry));
+        if (!r->leaf) memmove(r->c, r->c + 1, (size_t)r->n * sizeof(StradaBtNode *));
+        r->n--;
+        return i;
+    }
+    if (i < x->n) {
+        bt_merge(x, i);
+        return i;
+    }
+    bt_merge(x, i - 1);
+    return i - 1;
+}
+
+/* Remove from the subtree at x the entry matching pr (which == 0), or its
+ * smallest (which < 0) or largest (which > 0) entry, into *out. x is the
+ * root or holds at least T entries, so a removal never underflows it. */
+static int bt_remove(StradaCollOMap *m, StradaBtNode *x, StradaBtProbe *pr, int which,
+                     StradaBtEntry *out) {
+    for (;;) {
+        int i;
+        int found = 0;
+        if (which == 0) {
+            i = bt_lower(m, x, pr);
+            found = i < x->n && bt_cmp(m, &x->e[i], pr) == 0;
+        } else if (which < 0) {
+            i = 0;
+        } else {
+            i = x->leaf ? x->n - 1 : x->n;
+        }
+        if (x->leaf) {
+            if ((which == 0 && !found) || x->n == 0) return 0;
+            *out = x->e[i];
+            memmove(x->e + i, x->e + i + 1, (size_t)(x->n - i - 1) * sizeof(StradaBtEntry));
+            x->n--;
+            return 1;
+        }
+        if (found) {
+            /* Replace it by its predecessor or successor when the child on
+             * that side can spare an entry; otherwise merge both children
+             * around it and keep looking in the merged node. */
+            if (x->c[i]->n >= STRADA_BT_T) {
+                *out = x->e[i];
+                bt_remove(m, x->c[i], NULL, 1, &x->e[i]);
+                return 1;
+            }
+            if (x->c[i + 1]->n >= STRADA_BT_T) {
+                *out = x->e[i];
+                bt_remove(m, x->c[i + 1], NULL, -1, &x->e[i]);
+                return 1;
+            }
+            bt_merge(x, i);
+            x = x->c[i];
+            continue;
+        }
+        x = x->c[bt_fill(x, i)];
+    }
+}
+
+static void bt_shrink_root(StradaCollOMap *m) {
+    StradaBtNode *r = m->root;
+    if (r->n == 0 && !r->leaf) {
+        m->root = r->c[0];
+        free(r);
+    }
+}
+
+static StradaBtEntry *bt_find(StradaCollOMap *m, StradaBtProbe *pr) {
+    StradaBtNode *x = m->root;
+    for (;;) {
+        int i = bt_lower(m, x, pr);
+        if (i < x->n && bt_cmp(m, &x->e[i], pr) == 0) return &x->e[i];
+        if (x->leaf) return NULL;
+        x = x->c[i];
+    }
+}
+
+static StradaCollOMap *omap_get(StradaValue *self) {
+    return coll_get(self, "OrderedMap");
+}
+
+StradaValue* strada_coll_omap_new(int numeric) {
+    StradaCollOMap *m = sr_xmalloc(sizeof(StradaCollOMap));
+    m->root = bt_node_new(1);
+    m->size = 0;
+    m->numeric = numeric != 0;
+    return coll_new(m, "OrderedMap", "Collections::OrderedMap");
+}
+
+/* Returns 1 if the key was new, 0 if its value was replaced */
+StradaValue* strada_coll_omap_set(StradaValue *self, StradaValue *key, StradaValue *v) {
+    StradaCollOMap *m = omap_get(self);
+    StradaBtProbe pr;
+    bt_probe_init(m, &pr, key);
+    strada_incref(v);
+    if (m->root->n == 2 * STRADA_BT_T - 1) {
+        StradaBtNode *s = bt_node_new(0);
+        s->c[0] = m->root;
+        m->root = s;
+        bt_split(s, 0);
+    }
+    StradaBtNode *x = m->root;
+    for (;;) {
+        int i = bt_lower(m, x, &pr);
+        if (i < x->n && bt_cmp(m, &x->e[i], &pr) == 0) {
+            strada_decref(x->e[i].val);
+            x->e[i].val = v;
+            bt_probe_done(&pr);
+            return coll_bool(0);
+        }
+        if (x->leaf) {
+            memmove(x->e + i + 1, x->e + i, (size_t)(x->n - i) * sizeof(StradaBtEntry));
+            StradaBtEntry *e = &x->e[i];
+            if (m->numeric) {
+                e->num = pr.num;
+                e->key = (STRADA_IS_TAGGED_INT(key) || (key && key->type == STRADA_INT))
+                    ? strada_new_int(strada_to_int(key)) : strada_new_num(pr.num);
+            } else {
+                e->num = 0;
+                e->key = strada_new_str_len(pr.p, pr.len);
+            }
+            e->val = v;
+            x->n++;
+            m->size++;
+            bt_probe_done(&pr);
+            return coll_bool(1);
+        }
+        if (x->c[i]->n == 2 * STRADA_BT_T - 1) {
+            bt_split(x, i);
+            int c = bt_cmp(m, &x->e[i], &pr);
+            if (c == 0) continue;   /* the median moved up: update it above */
+            if (c < 0) i++;
+        }
+        x = x->c[i];
+    }
+}
+
+StradaValue* strada_coll_omap_get(StradaValue *self, StradaValue *key) {
+    StradaCollOMap *m = omap_get(self);
+    StradaBtProbe pr;
+    bt_probe_init(m, &pr, key);
+    StradaBtEntry *e = bt_find(m, &pr);
+    bt_probe_done(&pr);
+    return e ? coll_owned(e->val) : strada_new_undef();
+}
+
+StradaValue* strada_coll_omap_contains(StradaValue *self, StradaValue *key) {
+    StradaCollOMap *m = omap_get(self);
+    StradaBtProbe pr;
+    bt_probe_init(m, &pr, key);
+    StradaBtEntry *e = bt_find(m, &pr);
+    bt_probe_done(&pr);
+    return coll_bool(e != NULL);
+}
+
+/* Remove key; returns its value, or undef if absent */
+StradaValue* strada_coll_omap_remove(StradaValue *self, StradaValue *key) {
+    StradaCollOMap *m = omap_get(self);
+    StradaBtProbe pr;
+    bt_probe_init(m, &pr, key);
+    StradaBtEntry out;
+    int found = bt_find(m, &pr) != NULL && bt_remove(m, m->root, &pr, 0, &out);
+    bt_probe_done(&pr);
+    bt_shrink_root(m);
+    if (!found) return strada_new_undef();
+    m->size--;
+    strada_decref(out.key);
+    return out.val;
+}
+
+/* which < 0: smallest entry, > 0: largest. Returns its key (the entry stays) */
+StradaValue* strada_coll_omap_end_key(StradaValue *self, int which) {
+    StradaCollOMap *m = omap_get(self);
+    if (m->size == 0) return strada_new_undef();
+    StradaBtNode *x = m->root;
+    int last = which > 0;
+    while (!x->leaf) x = x->c[last ? x->n : 0];
+    return coll_owned(x->e[last ? x->n - 1 : 0].key);
+}
+
+/* which < 0: floor (largest key <= key), > 0: ceiling (smallest >= key) */
+StradaValue* strada_coll_omap_near_key(StradaValue *self, StradaValue *key, int which) {
+    StradaCollOMap *m = omap_get(self);
+    int above = which > 0;
+    StradaBtProbe pr;
+    bt_probe_init(m, &pr, key);
+    StradaBtEntry *best = NULL;
+    StradaBtNode *x = m->root;
+    while (x) {
+        int i = bt_lower(m, x, &pr);
+        if (i < x->n && bt_cmp(m, &x->e[i], &pr) == 0) { best = &x->e[i]; break; }
+        if (above && i < x->n) best = &x->e[i];
+        if (!above && i > 0) best = &x->e[i - 1];
+        x = x->leaf ? NULL : x->c[i];
+    }
+    bt_probe_done(&pr);
+    return best ? coll_owned(best->key) : strada_new_undef();
+}
+
+/* In-order walk of the entries in [lo, hi] (NULL = unbounded). what:
+ * 0 keys, 1 values, 2 [key, value] pairs. Returns 0 once past hi. */
+static int bt_collect(StradaCollOMap *m, StradaBtNode *x, StradaBtProbe *lo, StradaBtProbe *hi,
+                      StradaArray *out, int what) {
+    int i = lo ? bt_lower(m, x, lo) : 0;
+    for (; i <= x->n; i++) {
+        if (!x->leaf && !bt_collect(m, x->c[i], lo, hi, out, what)) return 0;
+        if (i == x->n) break;
+        StradaBtEntry *e = &x->e[i];
+        if (hi && bt_cmp(m, e, hi) > 0) return 0;
+        if (what == 0) {
+            strada_array_push(out, e->key);
+        } else if (what == 1) {
+            strada_array_push(out, e->val);
+        } else {
+            StradaValue *pair = strada_new_array();
+            strada_array_push(pair->value.av, e->key);
+            strada_array_push(pair->value.av, e->val);
+            strada_array_push_take(out, strada_new_ref(pair, '@'));
+            strada_decref(pair);
+        }
+    }
+    return 1;
+}
+
+/* what as for bt_collect; lo/hi undef for an open end */
+StradaValue* strada_coll_omap_range(StradaValue *self, StradaValue *lo, StradaValue *hi, int what) {
+    StradaCollOMap *m = omap_get(self);
+    StradaBtProbe plo, phi;
+    int has_lo = lo && (STRADA_IS_TAGGED_INT(lo) || lo->type != STRADA_UNDEF);
+    int has_hi = hi && (STRADA_IS_TAGGED_INT(hi) || hi->type != STRADA_UNDEF);
+    if (has_lo) bt_probe_init(m, &plo, lo);
+    if (has_hi) bt_probe_init(m, &phi, hi);
+    StradaValue *result = strada_new_array();
+    if (!has_lo && !has_hi) strada_array_reserve(result->value.av, m->size);
+    bt_collect(m, m->root, has_lo ? &plo : NULL, has_hi ? &phi : NULL, result->value.av,
+               what);
+    if (has_lo) bt_probe_done(&plo);
+    if (has_hi) bt_probe_done(&phi);
+    return result;
+}
+
+StradaValue* strada_coll_omap_size(StradaValue *self) {
+    return strada_new_int((int64_t)omap_get(self)->size);
+}
+
+StradaValue* strada_coll_omap_clear(StradaValue *self) {
+    StradaCollOMap *m = omap_get(self);
+    bt_free(m->root, 1);
+    m->root = bt_node_new(1);
+    m->size = 0;
+    return strada_new_undef();
+}
+
+/* Release a collection's storage (strada_free_value's CPOINTER branch).
+ * release = 0 frees the structure without dropping element references,
+ * for the arena teardown. Returns 0 if kind isn't a collection. */
+int strada_coll_free(const char *kind, void *p, int release) {
+    if (strcmp(kind, "Set") == 0) {
+        StradaCollSet *s = p;
+        if (release) strada_decref(s->hv);
+        free(s);
+    } else if (strcmp(kind, "Deque") == 0) {
+        StradaCollDeque *d = p;
+        for (size_t i = 0; release && i < d->len; i++) strada_decref(DEQ_AT(d, i));
+        free(d->slots);
+        free(d);
+    } else if (strcmp(kind, "Heap") == 0) {
+        StradaCollHeap *h = p;
+        for (size_t i = 0; release && i < h->len; i++) strada_decref(h->nodes[i].val);
+        if (release && h->cmp) strada_decref(h->cmp);
+        free(h->nodes);
+        free(h);
+    } else if (strcmp(kind, "OrderedMap") == 0) {
+        StradaCollOMap *m = p;
+        bt_free(m->root, release);
+        free(m);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/* ===== LAZY ITERATORS =====
+ *
+ * The iter:: builtins: a pull-based stream behind a STRADA_CPOINTER whose
+ * struct_name is "Iter". Sources (int range, array, file lines, a
+ * generator closure) and adapters (map, grep, take) share one struct;
+ * an adapter owns its upstream iterator. strada_iter_advance() is the
+ * protocol codegen drives — foreach over an iter:: call and fused
+ * map/grep/first/any pipelines whose source is one — and it hands out
+ * a borrowed pointer that stays valid until the next advance, so the
+ * loop holds exactly one element however long the stream is. Anything
+ * else that wants an array (a lone map/grep, sort, join...) gets the
+ * remaining elements collected once via strada_deref_array. */
+
+enum { ITER_RANGE, ITER_ARRAY, ITER_LINES, ITER_FN, ITER_MAP, ITER_GREP, ITER_TAKE };
+
+typedef struct StradaIter {
+    int kind;
+    int done;
+    int64_t pos, end;   /* range cursor / array index / take count */
+    StradaValue *src;   /* array, filehandle, closure or upstream Iter */
+    StradaValue *fn;    /* map/grep callback */
+    StradaValue *cur;   /* value lent out by strada_iter_advance */
+    StradaValue *drained; /* the rest, once used as an array */
+    char *line;         /* getline buffer for ITER_LINES */
+    size_t line_cap;
+} StradaIter;
+
+static StradaValue *iter_new(int kind, StradaValue *src, StradaValue *fn) {
+    StradaIter *it = sr_xmalloc(sizeof(StradaIter));
+    memset(it, 0, sizeof(*it));
+    it->kind = kind;
+    it->src = src;
+    it->fn = fn;
+    if (src) strada_incref(src);
+    if (fn) strada_incref(fn);
+    StradaValue *sv = strada_value_alloc();
+    sv->type = STRADA_CPOINTER;
+    sv->refcount = 1;
+    sv->value.ptr = it;
+    strada_ensure_meta(sv)->struct_name = strdup("Iter");
+    return sv;
+}
+
+static StradaIter *iter_get(StradaValue *sv, const char *fname) {
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_REF) sv = sv->value.rv;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_CPOINTER && sv->value.ptr) {
+        const char *sn = SV_STRUCT_NAME(sv);
+        if (sn && strcmp(sn, "Iter") == 0) return sv->value.ptr;
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%s: argument is not an iterator", fname);
+    strada_throw(msg);
+}
+
+static StradaValue *iter_callback(StradaValue *fn, const char *fname) {
+    if (!fn || STRADA_IS_TAGGED_INT(fn)
+        || (fn->type != STRADA_CLOSURE && fn->type != STRADA_CPOINTER)) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "%s: expected a code reference", fname);
+        strada_throw(msg);
+    }
+    return fn;
+}
+
+/* Produce the next value (owned) into *out; 0 once the stream is over */
+int strada_iter_step(StradaValue *self, StradaValue **out) {
+    StradaIter *it = iter_get(self, "iter::next");
+    if (it->done) return 0;
+    switch (it->kind) {
+        case ITER_RANGE:
+            if (it->pos <= it->end) {
+                *out = strada_new_int(it->pos++);
+                return 1;
+            }
+            break;
+        case ITER_ARRAY: {
+            StradaArray *av = strada_deref_array(it->src);
+            if (av && it->pos < (int64_t)strada_array_length(av)) {
+                StradaValue *v = strada_array_get(av, it->pos++);
+                if (!v) v = strada_new_undef();
+                else strada_incref(v);
+                *out = v;
+                return 1;
+            }
+            break;
+        }
+        case ITER_LINES: {
+            ssize_t n = it->src->value.fh ? getline(&it->line, &it->line_cap, it->src->value.fh) : -1;
+            if (n >= 0) {
+                if (n > 0 && it->line[n - 1] == '\n') n--;
+                *out = strada_new_str_len(it->line, (size_t)n);
+                return 1;
+            }
+            break;
+        }
+        case ITER_FN: {
+            StradaValue *v = strada_closure_call(it->src, 0);
+            if (v && (STRADA_IS_TAGGED_INT(v) || v->type != STRADA_UNDEF)) {
+                *out = v;
+                return 1;
+            }
+            strada_decref(v);
+            break;
+        }
+        case ITER_MAP: {
+            StradaValue *v;
+            if (strada_iter_step(it->src, &v)) {
+                strada_cleanup_push(v);
+                StradaValue *r = strada_closure_call(it->fn, 1, v);
+                strada_cleanup_pop();
+                strada_decref(v);
+                *out = r;
+                return 1;
+            }
+            break;
+        }
+        case ITER_GREP: {
+            StradaValue *v;
+            while (strada_iter_step(it->src, &v)) {
+                strada_cleanup_push(v);
+                StradaValue *c = strada_closure_call(it->fn, 1, v);
+                int keep = strada_to_bool(c);
+                strada_decref(c);
+                strada_cleanup_pop();
+                if (keep) {
+                    *out = v;
+                    return 1;
+                }
+                strada_decref(v);
+            }
+            break;
+        }
+        case ITER_TAKE:
+            if (it->pos < it->end && strada_iter_step(it->src, out)) {
+                it->pos++;
+                return 1;
+            }
+            break;
+    }
+    /* Exhausted: let go of the source now (closes an owned file) */
+    it->done = 1;
+    if (it->kind == ITER_LINES || it->kind == ITER_FN) {
+        strada_decref(it->src);
+        it->src = NULL;
+    }
+    return 0;
+}
+
+StradaValue* strada_iter_advance(StradaValue *self) {
+    StradaIter *it = iter_get(self, "iter::next");
+    StradaValue *v;
+    int more = strada_iter_step(self, &v);
+    if (it->cur) strada_decref(it->cur);
+    it->cur = more ? v : NULL;
+    return it->cur;
+}
+
+/* The Iter behind sv (through a ref), or NULL: lets codegen stream any
+ * source that turns out to be an iterator at run time */
+StradaValue* strada_iter_of(StradaValue *sv) {
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_REF) sv = sv->value.rv;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_CPOINTER && sv->value.ptr) {
+        const char *sn = SV_STRUCT_NAME(sv);
+        if (sn && strcmp(sn, "Iter") == 0) return sv;
+    }
+    return NULL;
+}
+
+StradaValue* strada_iter_range(StradaValue *lo, StradaValue *hi) {
+    StradaValue *sv = iter_new(ITER_RANGE, NULL, NULL);
+    StradaIter *it = sv->value.ptr;
+    it->pos = strada_to_int(lo);
+    it->end = strada_to_int(hi);
+    return sv;
+}
+
+StradaValue* strada_iter_from_array(StradaValue *arr) {
+    if (!strada_deref_array(arr)) strada_throw("iter::from_array: expected an array");
+    return iter_new(ITER_ARRAY, arr, NULL);
+}
+
+/* A filehandle is read where it stands and left open; a path is opened
+ * here and closed when the stream ends or the iterator is freed */
+StradaValue* strada_iter_lines(StradaValue *src) {
+    if (src && !STRADA_IS_TAGGED_INT(src) && src->type == STRADA_FILEHANDLE) {
+        return iter_new(ITER_LINES, src, NULL);
+    }
+    char *path = strada_to_str(src);
+    StradaValue *fh = strada_open(path, "<");
+    if (STRADA_IS_TAGGED_INT(fh) || fh->type != STRADA_FILEHANDLE) {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "iter::lines: cannot open '%s': %s", path, strerror(errno));
+        free(path);
+        strada_decref(fh);
+        strada_throw(msg);
+    }
+    free(path);
+    StradaValue *sv = iter_new(ITER_LINES, fh, NULL);
+    strada_decref(fh);
+    return sv;
+}
+
+StradaValue* strada_iter_from_fn(StradaValue *fn) {
+    return iter_new(ITER_FN, iter_callback(fn, "iter::from_fn"), NULL);
+}
+
+StradaValue* strada_iter_map(StradaValue *src, StradaValue *fn) {
+    iter_get(src, "iter::map");
+    return iter_new(ITER_MAP, src, iter_callback(fn, "iter::map"));
+}
+
+StradaValue* strada_iter_grep(StradaValue *src, StradaValue *fn) {
+    iter_get(src, "iter::grep");
+    return iter_new(ITER_GREP, src, iter_callback(fn, "iter::grep"));
+}
+
+StradaValue* strada_iter_take(StradaValue *src, StradaValue *n) {
+    iter_get(src, "iter::take");
+    StradaValue *sv = iter_new(ITER_TAKE, src, NULL);
+    ((StradaIter *)sv->value.ptr)->end = strada_to_int(n);
+    return sv;
+}
+
+StradaValue* strada_iter_next(StradaValue *self) {
+    StradaValue *v;
+    return strada_iter_step(self, &v) ? v : strada_new_undef();
+}
+
+StradaValue* strada_iter_collect(StradaValue *self) {
+    StradaValue *arr = strada_new_array();
+    strada_cleanup_push(arr);
+    StradaValue *v;
+    while (strada_iter_step(self, &v)) {
+        strada_array_push(arr->value.av, v);
+        strada_decref(v);
+    }
+    strada_cleanup_pop();
+    return arr;
+}
+
+/* strada_deref_array of an iterator: collect what is left, once */
+static StradaArray *iter_drain(StradaValue *sv) {
+    StradaIter *it = sv->value.ptr;
+    if (!it->drained) it->drained = strada_iter_collect(sv);
+    return it->drained->value.av;
+}
+
+int strada_iter_free(const char *kind, void *p, int release) {
+    if (strcmp(kind, "Iter") != 0) return 0;
+    StradaIter *it = p;
+    if (release) {
+        if (it->src) strada_decref(it->src);
+        if (it->fn) strada_decref(it->fn);
+        if (it->cur) strada_decref(it->cur);
+        if (it->drained) strada_decref(it->drained);
+    }
+    free(it->line);
+    free(it);
+    return 1;
+}
+
+/* ===== PROBABILISTIC SKETCHES =====
+ *
+ * Fixed-size summaries of a key stream behind lib/Sketch: a Bloom filter
+ * (membership with a chosen false-positive rate), HyperLogLog (distinct
+ * count) and a count-min sketch (per-key frequency, never under). Each is
+ * one flat block behind a STRADA_CPOINTER whose struct_name is its kind,
+ * wrapped in a blessed ref like the collections. Keys take the string
+ * form hash keys use. Two sketches built with the same parameters merge,
+ * and serialize to a byte string that deserialize reads back, so shards
+ * can be summarized apart and combined. No locking. */
+
+#define SKETCH_BLOOM "Sketch::Bloom"
+#define SKETCH_HLL   "Sketch::HyperLogLog"
+#define SKETCH_CMS   "Sketch::CountMin"
+#define SKETCH_LN2   0.69314718055994530942
+#define SKETCH_E     2.71828182845904523536
+
+typedef struct StradaBloom {
+    uint64_t nbits;              /* multiple of 64 */
+    uint32_t k;                  /* probes per key */
+    uint64_t added;              /* add() calls that set a new bit */
+    uint64_t bits[];
+} StradaBloom;
+
+typedef struct StradaHLL {
+    uint32_t p;                  /* 2^p registers */
+    uint8_t reg[];
+} StradaHLL;
+
+typedef struct StradaCMS {
+    uint32_t width;
+    uint32_t depth;
+    uint64_t total;              /* sum of all counts added */
+    uint64_t cells[];            /* depth rows of width counters */
+} StradaCMS;
+
+/* 64-bit key hash: wyhash (final4, public domain) over the key's full
+ * byte length, so embedded NULs count and djb2's collisions ("Ez" vs
+ * "FY") don't carry over. The seed is fixed: sketches built in separate
+ * processes must hash alike to merge. Probe i of a key is h1 + i*h2
+ * (Kirsch and Mitzenmacher), so one hash serves all k probes and d rows. */
+#define SKETCH_SEED 0x5d1c2b6a9e3779b9ULL
+
+static inline void sk_mum(uint64_t *a, uint64_t *b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t sk_mix(uint64_t a, uint64_t b) {
+    sk_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t sk_r8(const uint8_t *p) {
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24
+         | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static inline uint64_t sk_r4(const uint8_t *p) {
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24;
+}
+
+static uint64_t sk_wyhash(const uint8_t *p, size_t len, uint64_t seed) {
+    static const uint64_t sec[4] = { 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                                     0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL };
+    uint64_t a, b;
+    seed ^= sk_mix(seed ^ sec[0], sec[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (sk_r4(p) << 32) | sk_r4(p + ((len >> 3) << 2));
+            b = (sk_r4(p + len - 4) << 32) | sk_r4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i >= 48) {
+            uint64_t s1 = seed, s2 = seed;
+            do {
+                seed = sk_mix(sk_r8(p) ^ sec[1], sk_r8(p + 8) ^ seed);
+                s1 = sk_mix(sk_r8(p + 16) ^ sec[2], sk_r8(p + 24) ^ s1);
+                s2 = sk_mix(sk_r8(p + 32) ^ sec[3], sk_r8(p + 40) ^ s2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            seed = sk_mix(sk_r8(p) ^ sec[1], sk_r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = sk_r8(p + i - 16);
+        b = sk_r8(p + i - 8);
+    }
+    a ^= sec[1];
+    b ^= seed;
+    sk_mum(&a, &b);
+    return sk_mix(a ^ sec[0] ^ len, b ^ sec[1]);
+}
+
+static uint64_t sketch_hash(StradaValue *key) {
+    char key_buf[SV_KEYBUF_LEN];
+    char *key_alloc;
+    const char *s = sv_key_extract_buf(key, key_buf, sizeof(key_buf), &key_alloc);
+    size_t len = 0;
+    if (s && key && !STRADA_IS_TAGGED_INT(key) && key->type == STRADA_STR && s == key->value.pv) {
+        len = STRADA_STR_BYTELEN(key);   /* binary-safe */
+        if (len == 0) len = strlen(s);
+    } else if (s) {
+        len = strlen(s);
+    }
+    uint64_t h = sk_wyhash((const uint8_t *)(s ? s : ""), len, SKETCH_SEED);
+    if (key_alloc) free(key_alloc);
+    return h;
+}
+
+static inline uint64_t sketch_probe(uint64_t h, uint32_t i, uint64_t n) {
+    uint64_t h1 = h & 0xFFFFFFFFu, h2 = (h >> 32) | 1;
+    return (h1 + (uint64_t)i * h2) % n;
+}
+
+static void *sketch_get(StradaValue *self, const char *kind) {
+    StradaValue *sv = self;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_REF) sv = sv->value.rv;
+    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_CPOINTER && sv->value.ptr) {
+        const char *sn = SV_STRUCT_NAME(sv);
+        if (sn && (!kind || strcmp(sn, kind) == 0)
+            && (strcmp(sn, SKETCH_BLOOM) == 0 || strcmp(sn, SKETCH_HLL) == 0
+                || strcmp(sn, SKETCH_CMS) == 0))
+            return sv->value.ptr;
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%s method called on something else", kind ? kind : "Sketch");
+    strada_throw(msg);
+}
+
+static const char *sketch_kind(StradaValue *self) {
+    sketch_get(self, NULL);
+    StradaValue *sv = self->type == STRADA_REF ? self->value.rv : self;
+    return SV_STRUCT_NAME(sv);
+}
 
-    /* Grow buffer if needed (double capacity) */
-    while (sb->length + len + 1 > sb->capacity) {
-        sb->capacity *= 2;
-        sb->buffer = sr_xrealloc(sb->buffer, sb->capacity);
-    }
+static StradaBloom *bloom_alloc(uint64_t nbits, uint32_t k) {
+    StradaBloom *b = calloc(1, sizeof(StradaBloom) + nbits / 8);
+    if (!b) strada_throw("Sketch::Bloom: out of memory");
+    b->nbits = nbits;
+    b->k = k;
+    return b;
+}
 
-    memcpy(sb->buffer + sb->length, str, len);
-    sb->length += len;
-    sb->buffer[sb->length] = '\0';
+static StradaHLL *hll_alloc(uint32_t p) {
+    StradaHLL *h = calloc(1, sizeof(StradaHLL) + ((size_t)1 << p));
+    if (!h) strada_throw("Sketch::HyperLogLog: out of memory");
+    h->p = p;
+    return h;
 }
 
-StradaValue* strada_sb_to_string(StradaValue *sb_val) {
-    if (!sb_val || sb_val->type != STRADA_CPOINTER) return strada_new_str("");
-    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
-    if (!sb) return strada_new_str("");
+static StradaCMS *cms_alloc(uint32_t width, uint32_t depth) {
+    StradaCMS *c = calloc(1, sizeof(StradaCMS) + (size_t)width * depth * sizeof(uint64_t));
+    if (!c) strada_throw("Sketch::CountMin: out of memory");
+    c->width = width;
+    c->depth = depth;
+    return c;
+}
+
+/* --- Bloom filter --- */
+
+/* Sized for capacity keys at false-positive rate fp: m = -n ln(fp) / ln(2)^2
+ * bits and k = m/n ln(2) probes */
+StradaValue* strada_sketch_bloom_new(StradaValue *capacity, StradaValue *fp_rate) {
+    int64_t n = strada_to_int(capacity);
+    double fp = strada_to_num(fp_rate);
+    if (n < 1) n = 1;
+    if (!(fp > 0.0 && fp < 1.0))
+        strada_throw("Sketch::Bloom::new: false-positive rate must be between 0 and 1");
+    double m = ceil(-(double)n * log(fp) / (SKETCH_LN2 * SKETCH_LN2));
+    if (m > (double)((uint64_t)1 << 40)) strada_throw("Sketch::Bloom::new: filter too large");
+    uint64_t nbits = ((uint64_t)m + 63) & ~(uint64_t)63;
+    if (nbits < 64) nbits = 64;
+    long k = lround((double)nbits / (double)n * SKETCH_LN2);
+    if (k < 1) k = 1;
+    if (k > 30) k = 30;
+    return coll_new(bloom_alloc(nbits, (uint32_t)k), SKETCH_BLOOM, SKETCH_BLOOM);
+}
+
+/* Returns 1 if the key was not in the filter before (some bit was clear) */
+StradaValue* strada_sketch_bloom_add(StradaValue *self, StradaValue *key) {
+    StradaBloom *b = sketch_get(self, SKETCH_BLOOM);
+    uint64_t h = sketch_hash(key);
+    int fresh = 0;
+    for (uint32_t i = 0; i < b->k; i++) {
+        uint64_t bit = sketch_probe(h, i, b->nbits);
+        uint64_t mask = (uint64_t)1 << (bit & 63);
+        if (!(b->bits[bit >> 6] & mask)) {
+            b->bits[bit >> 6] |= mask;
+            fresh = 1;
+        }
+    }
+    if (fresh) b->added++;
+    return coll_bool(fresh);
+}
+
+StradaValue* strada_sketch_bloom_contains(StradaValue *self, StradaValue *key) {
+    StradaBloom *b = sketch_get(self, SKETCH_BLOOM);
+    uint64_t h = sketch_hash(key);
+    for (uint32_t i = 0; i < b->k; i++) {
+        uint64_t bit = sketch_probe(h, i, b->nbits);
+        if (!(b->bits[bit >> 6] & ((uint64_t)1 << (bit & 63)))) return coll_bool(0);
+    }
+    return coll_bool(1);
+}
+
+/* Keys in the filter, estimated from the set bits: -m/k ln(1 - X/m) */
+static double bloom_estimate(StradaBloom *b) {
+    uint64_t set = 0;
+    for (uint64_t w = 0; w < b->nbits / 64; w++) set += (uint64_t)__builtin_popcountll(b->bits[w]);
+    if (set >= b->nbits) return (double)b->nbits;
+    return -(double)b->nbits / b->k * log(1.0 - (double)set / (double)b->nbits);
+}
+
+/* --- HyperLogLog --- */
+
+StradaValue* strada_sketch_hll_new(StradaValue *precision) {
+    int64_t p = precision ? strada_to_int(precision) : 14;
+    if (p < 4 || p > 18) strada_throw("Sketch::HyperLogLog::new: precision must be 4 to 18");
+    return coll_new(hll_alloc((uint32_t)p), SKETCH_HLL, SKETCH_HLL);
+}
+
+/* The top p hash bits pick a register, which keeps the highest
+ * leading-zero rank of the rest. Returns 1 if a register changed. */
+StradaValue* strada_sketch_hll_add(StradaValue *self, StradaValue *key) {
+    StradaHLL *h = sketch_get(self, SKETCH_HLL);
+    uint64_t x = sketch_hash(key);
+    uint64_t idx = x >> (64 - h->p);
+    uint64_t w = x << h->p;
+    uint8_t rank = w ? (uint8_t)(__builtin_clzll(w) + 1) : (uint8_t)(64 - h->p + 1);
+    if (rank > h->reg[idx]) {
+        h->reg[idx] = rank;
+        return coll_bool(1);
+    }
+    return coll_bool(0);
+}
+
+/* Flajolet et al. estimate, with linear counting while registers are
+ * still empty. The 64-bit hash needs no large-range correction. */
+static double hll_estimate(StradaHLL *h) {
+    size_t m = (size_t)1 << h->p;
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < m; i++) {
+        sum += ldexp(1.0, -(int)h->reg[i]);
+        if (!h->reg[i]) zeros++;
+    }
+    double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709
+                 : 0.7213 / (1.0 + 1.079 / (double)m);
+    double e = alpha * (double)m * (double)m / sum;
+    if (e <= 2.5 * (double)m && zeros) e = (double)m * log((double)m / (double)zeros);
+    return e;
+}
 
-    return strada_new_str_len(sb->buffer, sb->length);
+/* --- Count-min sketch --- */
+
+/* width = ceil(e / epsilon), depth = ceil(ln(1 / delta)): an estimate is
+ * at most epsilon * total over the true count with probability 1 - delta */
+StradaValue* strada_sketch_cms_new(StradaValue *epsilon, StradaValue *delta) {
+    double eps = strada_to_num(epsilon), dl = strada_to_num(delta);
+    if (!(eps > 0.0 && eps < 1.0) || !(dl > 0.0 && dl < 1.0))
+        strada_throw("Sketch::CountMin::new: epsilon and delta must be between 0 and 1");
+    double w = ceil(SKETCH_E / eps), d = ceil(log(1.0 / dl));
+    if (w * d > (double)((uint64_t)1 << 32)) strada_throw("Sketch::CountMin::new: sketch too large");
+    return coll_new(cms_alloc((uint32_t)w, d < 1 ? 1 : (uint32_t)d), SKETCH_CMS, SKETCH_CMS);
+}
+
+/* Adds count (default 1) and returns the key's new estimate */
+StradaValue* strada_sketch_cms_add(StradaValue *self, StradaValue *key, StradaValue *count) {
+    StradaCMS *c = sketch_get(self, SKETCH_CMS);
+    int64_t n = count ? strada_to_int(count) : 1;
+    if (n < 0) strada_throw("Sketch::CountMin::add: count must not be negative");
+    uint64_t h = sketch_hash(key);
+    uint64_t est = UINT64_MAX;
+    for (uint32_t r = 0; r < c->depth; r++) {
+        uint64_t *cell = &c->cells[(size_t)r * c->width + sketch_probe(h, r, c->width)];
+        *cell += (uint64_t)n;
+        if (*cell < est) est = *cell;
+    }
+    c->total += (uint64_t)n;
+    return strada_new_int((int64_t)est);
+}
+
+StradaValue* strada_sketch_cms_estimate(StradaValue *self, StradaValue *key) {
+    StradaCMS *c = sketch_get(self, SKETCH_CMS);
+    uint64_t h = sketch_hash(key);
+    uint64_t est = UINT64_MAX;
+    for (uint32_t r = 0; r < c->depth; r++) {
+        uint64_t v = c->cells[(size_t)r * c->width + sketch_probe(h, r, c->width)];
+        if (v < est) est = v;
+    }
+    return strada_new_int((int64_t)est);
+}
+
+/* --- Shared: count, merge, info, serialize --- */
+
+/* Bloom: estimated keys; HyperLogLog: estimated distinct keys;
+ * CountMin: total of all counts */
+StradaValue* strada_sketch_count(StradaValue *self) {
+    const char *kind = sketch_kind(self);
+    void *p = sketch_get(self, kind);
+    if (strcmp(kind, SKETCH_BLOOM) == 0) return strada_new_int((int64_t)llround(bloom_estimate(p)));
+    if (strcmp(kind, SKETCH_HLL) == 0) return strada_new_int((int64_t)llround(hll_estimate(p)));
+    return strada_new_int((int64_t)((StradaCMS *)p)->total);
+}
+
+/* Fold other into self: Bloom ORs the bits, HyperLogLog keeps each
+ * register's maximum, CountMin adds the counters. Both must be the same
+ * kind built with the same parameters. */
+StradaValue* strada_sketch_merge(StradaValue *self, StradaValue *other) {
+    const char *kind = sketch_kind(self);
+    void *a = sketch_get(self, kind);
+    void *b = sketch_get(other, kind);
+    if (strcmp(kind, SKETCH_BLOOM) == 0) {
+        StradaBloom *x = a, *y = b;
+        if (x->nbits != y->nbits || x->k != y->k)
+            strada_throw("Sketch::Bloom::merge: filters differ in size");
+        for (uint64_t w = 0; w < x->nbits / 64; w++) x->bits[w] |= y->bits[w];
+        x->added += y->added;
+    } else if (strcmp(kind, SKETCH_HLL) == 0) {
+        StradaHLL *x = a, *y = b;
+        if (x->p != y->p) strada_throw("Sketch::HyperLogLog::merge: precisions differ");
+        for (size_t i = 0; i < ((size_t)1 << x->p); i++)
+            if (y->reg[i] > x->reg[i]) x->reg[i] = y->reg[i];
+    } else {
+        StradaCMS *x = a, *y = b;
+        if (x->width != y->width || x->depth != y->depth)
+            strada_throw("Sketch::CountMin::merge: sketches differ in size");
+        for (size_t i = 0; i < (size_t)x->width * x->depth; i++) x->cells[i] += y->cells[i];
+        x->total += y->total;
+    }
+    return strada_new_undef();
 }
 
-StradaValue* strada_sb_length(StradaValue *sb_val) {
-    if (!sb_val || sb_val->type != STRADA_CPOINTER) return strada_new_int(0);
-    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
-    if (!sb) return strada_new_int(0);
+static size_t sketch_bytes(const char *kind, void *p) {
+    if (strcmp(kind, SKETCH_BLOOM) == 0) return sizeof(StradaBloom) + ((StradaBloom *)p)->nbits / 8;
+    if (strcmp(kind, SKETCH_HLL) == 0) return sizeof(StradaHLL) + ((size_t)1 << ((StradaHLL *)p)->p);
+    StradaCMS *c = p;
+    return sizeof(StradaCMS) + (size_t)c->width * c->depth * sizeof(uint64_t);
+}
 
-    return strada_new_int(sb->length);
+/* Parameters and size: bits/hashes (Bloom), precision/registers
+ * (HyperLogLog), width/depth (CountMin), plus bytes */
+StradaValue* strada_sketch_info(StradaValue *self) {
+    const char *kind = sketch_kind(self);
+    void *p = sketch_get(self, kind);
+    StradaValue *result = strada_new_hash();
+    StradaHash *r = result->value.hv;
+    if (strcmp(kind, SKETCH_BLOOM) == 0) {
+        StradaBloom *b = p;
+        strada_hash_set_take(r, "bits", strada_new_int((int64_t)b->nbits));
+        strada_hash_set_take(r, "hashes", strada_new_int(b->k));
+    } else if (strcmp(kind, SKETCH_HLL) == 0) {
+        StradaHLL *h = p;
+        strada_hash_set_take(r, "precision", strada_new_int(h->p));
+        strada_hash_set_take(r, "registers", strada_new_int((int64_t)1 << h->p));
+    } else {
+        StradaCMS *c = p;
+        strada_hash_set_take(r, "width", strada_new_int(c->width));
+        strada_hash_set_take(r, "depth", strada_new_int(c->depth));
+    }
+    strada_hash_set_take(r, "bytes", strada_new_int((int64_t)sketch_bytes(kind, p)));
+    return result;
 }
 
-void strada_sb_clear(StradaValue *sb_val) {
-    if (!sb_val || sb_val->type != STRADA_CPOINTER) return;
-    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
-    if (!sb) return;
+/* Serialized form, little-endian: a 4-byte magic ("SKB1", "SKH1" or
+ * "SKC1"), the parameters, then the raw bits, registers or counters.
+ * Bloom: u64 bits, u32 hashes, u64 added. HyperLogLog: u8 precision.
+ * CountMin: u32 width, u32 depth, u64 total. */
+static void sk_put(unsigned char **o, uint64_t v, int n) {
+    for (int i = 0; i < n; i++) *(*o)++ = (unsigned char)(v >> (8 * i));
+}
 
-    sb->length = 0;
-    sb->buffer[0] = '\0';
+static uint64_t sk_get(const unsigned char **s, int n) {
+    uint64_t v = 0;
+    for (int i = 0; i < n; i++) v |= (uint64_t)(*s)[i] << (8 * i);
+    *s += n;
+    return v;
 }
 
-void strada_sb_free(StradaValue *sb_val) {
-    if (!sb_val || sb_val->type != STRADA_CPOINTER) return;
-    StradaStringBuilder *sb = (StradaStringBuilder*)sb_val->value.ptr;
-    if (sb) {
-        free(sb->buffer);
-        free(sb);
-    }
-    sb_val->value.ptr = NULL;
+StradaValue* strada_sketch_serialize(StradaValue *self) {
+    const char *kind = sketch_kind(self);
+    void *p = sketch_get(self, kind);
+    size_t len = 4 + 20 + sketch_bytes(kind, p);
+    unsigned char *buf = sr_xmalloc(len);
+    unsigned char *o = buf;
+    if (strcmp(kind, SKETCH_BLOOM) == 0) {
+        StradaBloom *b = p;
+        memcpy(o, "SKB1", 4); o += 4;
+        sk_put(&o, b->nbits, 8);
+        sk_put(&o, b->k, 4);
+        sk_put(&o, b->added, 8);
+        for (uint64_t w = 0; w < b->nbits / 64; w++) sk_put(&o, b->bits[w], 8);
+    } else if (strcmp(kind, SKETCH_HLL) == 0) {
+        StradaHLL *h = p;
+        memcpy(o, "SKH1", 4); o += 4;
+        sk_put(&o, h->p, 1);
+        memcpy(o, h->reg, (size_t)1 << h->p);
+        o += (size_t)1 << h->p;
+    } else {
+        StradaCMS *c = p;
+        memcpy(o, "SKC1", 4); o += 4;
+        sk_put(&o, c->width, 4);
+        sk_put(&o, c->depth, 4);
+        sk_put(&o, c->total, 8);
+        for (size_t i = 0; i < (size_t)c->width * c->depth; i++) sk_put(&o, c->cells[i], 8);
+    }
+    StradaValue *result = strada_new_str_len((const char *)buf, (size_t)(o - buf));
+    free(buf);
+    return result;
+}
+
+/* Rebuild a sketch from serialize()'s bytes; throws on anything else */
+StradaValue* strada_sketch_deserialize(StradaValue *bytes) {
+    const unsigned char *s = NULL;
+    size_t len = 0;
+    if (bytes && !STRADA_IS_TAGGED_INT(bytes) && bytes->type == STRADA_STR && bytes->value.pv) {
+        s = (const unsigned char *)bytes->value.pv;
+        len = STRADA_STR_BYTELEN(bytes);
+    }
+    const unsigned char *end = s + len;
+    if (len >= 4 + 20 && memcmp(s, "SKB1", 4) == 0) {
+        s += 4;
+        uint64_t nbits = sk_get(&s, 8);
+        uint64_t k = sk_get(&s, 4);
+        uint64_t added = sk_get(&s, 8);
+        if (nbits && nbits % 64 == 0 && k >= 1 && k <= 30 && (uint64_t)(end - s) == nbits / 8) {
+            StradaBloom *b = bloom_alloc(nbits, (uint32_t)k);
+            b->added = added;
+            for (uint64_t w = 0; w < nbits / 64; w++) b->bits[w] = sk_get(&s, 8);
+            return coll_new(b, SKETCH_BLOOM, SKETCH_BLOOM);
+        }
+    } else if (len >= 5 && memcmp(s, "SKH1", 4) == 0) {
+        s += 4;
+        uint32_t p = (uint32_t)sk_get(&s, 1);
+        if (p >= 4 && p <= 18 && (size_t)(end - s) == ((size_t)1 << p)) {
+            StradaHLL *h = hll_alloc(p);
+            memcpy(h->reg, s, (size_t)1 << p);
+            return coll_new(h, SKETCH_HLL, SKETCH_HLL);
+        }
+    } else if (len >= 4 + 16 && memcmp(s, "SKC1", 4) == 0) {
+        s += 4;
+        uint64_t w = sk_get(&s, 4), d = sk_get(&s, 4);
+        uint64_t total = sk_get(&s, 8);
+        if (w && d && (uint64_t)(end - s) == w * d * 8) {
+            StradaCMS *c = cms_alloc((uint32_t)w, (uint32_t)d);
+            c->total = total;
+            for (size_t i = 0; i < (size_t)(w * d); i++) c->cells[i] = sk_get(&s, 8);
+            return coll_new(c, SKETCH_CMS, SKETCH_CMS);
+        }
+    }
+    strada_throw("Sketch::deserialize: not a serialized sketch");
+}
+
+/* Release a sketch (strada_free_value's CPOINTER branch). Returns 0 if
+ * kind isn't a sketch. */
+int strada_sketch_free(const char *kind, void *p) {
+    if (strcmp(kind, SKETCH_BLOOM) != 0 && strcmp(kind, SKETCH_HLL) != 0
+        && strcmp(kind, SKETCH_CMS) != 0)
+        return 0;
+    free(p);
+    return 1;
 }
 
 /* ===== TYPE INTROSPECTION AND CASTING ===== */
@@ -19555,36 +24491,33 @@ StradaValue* strada_ref_create_take(StradaValue *sv) {
  * StradaString*, all values are owned (take semantics, no incref needed),
  * pkg name is a process-lifetime intern pointer (bless_immortal = 1).
  *
- * Falls back to strada_hash_set_ss_take only when two attribute names
- * collide in the freshly-sized hash — rare with the default 4/8-bucket
- * presizing and distinct attribute names. */
+ * The presized hash is a single probe group, so every key goes straight
+ * into a free bucket of it (see hv_put_fresh). Falls back to
+ * strada_hash_set_ss_take only when two attribute names share a hash —
+ * the same name, or a rare djb2 collision. */
+/* Store k -> v as entry `slot` of a fresh single-group hash whose keys so
+ * far all differ from k: no probe, just the first free bucket. Takes v. */
+static inline void hv_put_fresh(StradaHash *hv, uint32_t slot, StradaString *k, StradaValue *v) {
+    size_t b = hv_free_bucket(hv, k->hash);
+    ss_incref(k);
+    hv->entries[slot].key = k;
+    hv->entries[slot].value = v;
+    *hv_ctrl_at(hv, b) = strada_hv_tag(k->hash);
+    *hv_slot_at(hv, b) = slot;
+    hv->num_entries = slot + 1;
+    hv->next_slot = slot + 1;
+}
+
 StradaValue* strada_new_blessed_2attr_take(
         char *interned_pkg,
         StradaString *k1, StradaValue *v1,
         StradaString *k2, StradaValue *v2) {
-    StradaHash *hv = strada_hash_new_presized(2);  /* 4 buckets, empty */
-
-    /* k1 → slot 0. Fresh hash: all hash_index[] = HASH_EMPTY, all
-     * entries[] zeroed; first insert is a direct write. */
-    uint32_t mask = hv->num_buckets - 1;
-    uint32_t pos1 = k1->hash & mask;
-    ss_incref(k1);
-    hv->entries[0].key = k1;
-    hv->entries[0].value = v1;
-    hv->hash_index[pos1] = 0;
-
-    /* k2 → slot 1 if no bucket collision with k1, else slow path. */
-    uint32_t pos2 = k2->hash & mask;
-    if (__builtin_expect(pos2 != pos1, 1)) {
-        ss_incref(k2);
-        hv->entries[1].key = k2;
-        hv->entries[1].value = v2;
-        hv->hash_index[pos2] = 1;
-        hv->num_entries = 2;
-        hv->next_slot = 2;
+    StradaHash *hv = strada_hash_new_presized(2);  /* one group, empty */
+
+    hv_put_fresh(hv, 0, k1, v1);
+    if (__builtin_expect(k2->hash != k1->hash, 1)) {
+        hv_put_fresh(hv, 1, k2, v2);
     } else {
-        hv->num_entries = 1;
-        hv->next_slot = 1;
         strada_hash_set_ss_take(hv, k2, v2);
     }
 
@@ -19648,24 +24581,10 @@ StradaValue* strada_new_blessed_2attr_hv_take(
     }
     StradaHash *hv = strada_hash_new_presized(2);
 
-    uint32_t mask = hv->num_buckets - 1;
-    uint32_t pos1 = k1->hash & mask;
-    ss_incref(k1);
-    hv->entries[0].key = k1;
-    hv->entries[0].value = v1;
-    hv->hash_index[pos1] = 0;
-
-    uint32_t pos2 = k2->hash & mask;
-    if (__builtin_expect(pos2 != pos1, 1)) {
-        ss_incref(k2);
-        hv->entries[1].key = k2;
-        hv->entries[1].value = v2;
-        hv->hash_index[pos2] = 1;
-        hv->num_entries = 2;
-        hv->next_slot = 2;
+    hv_put_fresh(hv, 0, k1, v1);
+    if (__builtin_expect(k2->hash != k1->hash, 1)) {
+        hv_put_fresh(hv, 1, k2, v2);
     } else {
-        hv->num_entries = 1;
-        hv->next_slot = 1;
         strada_hash_set_ss_take(hv, k2, v2);
     }
 
@@ -19687,43 +24606,17 @@ StradaValue* strada_new_blessed_3attr_take(
         StradaString *k1, StradaValue *v1,
         StradaString *k2, StradaValue *v2,
         StradaString *k3, StradaValue *v3) {
-    StradaHash *hv = strada_hash_new_presized(3);  /* 8 buckets */
-
-    uint32_t mask = hv->num_buckets - 1;
-    uint32_t pos1 = k1->hash & mask;
-    uint32_t pos2 = k2->hash & mask;
-    uint32_t pos3 = k3->hash & mask;
-
-    /* k1 always direct. */
-    ss_incref(k1);
-    hv->entries[0].key = k1;
-    hv->entries[0].value = v1;
-    hv->hash_index[pos1] = 0;
-
-    /* k2 direct if no collision with k1. */
-    if (__builtin_expect(pos2 != pos1, 1)) {
-        ss_incref(k2);
-        hv->entries[1].key = k2;
-        hv->entries[1].value = v2;
-        hv->hash_index[pos2] = 1;
-        hv->num_entries = 2;
-        hv->next_slot = 2;
-
-        /* k3 direct if no collision with k1 or k2. */
-        if (__builtin_expect(pos3 != pos1 && pos3 != pos2, 1)) {
-            ss_incref(k3);
-            hv->entries[2].key = k3;
-            hv->entries[2].value = v3;
-            hv->hash_index[pos3] = 2;
-            hv->num_entries = 3;
-            hv->next_slot = 3;
+    StradaHash *hv = strada_hash_new_presized(3);  /* one group, empty */
+
+    hv_put_fresh(hv, 0, k1, v1);
+    if (__builtin_expect(k2->hash != k1->hash, 1)) {
+        hv_put_fresh(hv, 1, k2, v2);
+        if (__builtin_expect(k3->hash != k1->hash && k3->hash != k2->hash, 1)) {
+            hv_put_fresh(hv, 2, k3, v3);
         } else {
             strada_hash_set_ss_take(hv, k3, v3);
         }
     } else {
-        /* k2 collides with k1 — fall back for both remaining inserts. */
-        hv->num_entries = 1;
-        hv->next_slot = 1;
         strada_hash_set_ss_take(hv, k2, v2);
         strada_hash_set_ss_take(hv, k3, v3);
     }
@@ -19773,37 +24666,15 @@ StradaValue* strada_new_blessed_3attr_hv_take(
     }
     StradaHash *hv = strada_hash_new_presized(3);
 
-    uint32_t mask = hv->num_buckets - 1;
-    uint32_t pos1 = k1->hash & mask;
-    uint32_t pos2 = k2->hash & mask;
-    uint32_t pos3 = k3->hash & mask;
-
-    ss_incref(k1);
-    hv->entries[0].key = k1;
-    hv->entries[0].value = v1;
-    hv->hash_index[pos1] = 0;
-
-    if (__builtin_expect(pos2 != pos1, 1)) {
-        ss_incref(k2);
-        hv->entries[1].key = k2;
-        hv->entries[1].value = v2;
-        hv->hash_index[pos2] = 1;
-        hv->num_entries = 2;
-        hv->next_slot = 2;
-
-        if (__builtin_expect(pos3 != pos1 && pos3 != pos2, 1)) {
-            ss_incref(k3);
-            hv->entries[2].key = k3;
-            hv->entries[2].value = v3;
-            hv->hash_index[pos3] = 2;
-            hv->num_entries = 3;
-            hv->next_slot = 3;
+    hv_put_fresh(hv, 0, k1, v1);
+    if (__builtin_expect(k2->hash != k1->hash, 1)) {
+        hv_put_fresh(hv, 1, k2, v2);
+        if (__builtin_expect(k3->hash != k1->hash && k3->hash != k2->hash, 1)) {
+            hv_put_fresh(hv, 2, k3, v3);
         } else {
             strada_hash_set_ss_take(hv, k3, v3);
         }
     } else {
-        hv->num_entries = 1;
-        hv->next_slot = 1;
         strada_hash_set_ss_take(hv, k2, v2);
         strada_hash_set_ss_take(hv, k3, v3);
     }
@@ -19846,7 +24717,7 @@ void strada_overwrite_in_place(StradaValue *dst, StradaValue *src) {
 
     /* Release dst's existing type-specific internals. */
     if (dst->type == STRADA_STR && dst->value.pv) {
-        ss_free_pv(dst->value.pv);
+        strada_str_free_pv(dst);
         dst->value.pv = NULL;
     } else if (dst->type == STRADA_REF && dst->value.rv) {
         strada_decref(dst->value.rv);
@@ -20143,7 +25014,7 @@ StradaValue* strada_deref_set(StradaValue *ref, StradaValue *new_value) {
     switch (target->type) {
         case STRADA_STR:
             if (target->value.pv) {
-                ss_free_pv(target->value.pv);
+                strada_str_free_pv(target);
                 target->value.pv = NULL;
             }
             break;
@@ -20172,9 +25043,16 @@ StradaValue* strada_deref_set(StradaValue *ref, StradaValue *new_value) {
             target->value.nv = new_value->value.nv;
             break;
         case STRADA_STR:
-            if (new_value->value.pv) {
-                ss_incref(SS_FROM_PV(new_value->value.pv));
+            if (new_value->value.pv && STRADA_STR_IS_EMBEDDED(new_value)) {
+                /* Embedded bytes die with their value — copy them. */
+                target->value.pv = ss_alloc_pv(new_value->value.pv, STRADA_STR_BYTELEN(new_value));
+                target->struct_size = new_value->struct_size;
+            } else if (new_value->value.pv) {
+                /* Share the bytes (a view shares its root); struct_size
+                 * carries the length, flags and any view offset along. */
+                ss_incref(strada_str_owner(new_value));
                 target->value.pv = new_value->value.pv;
+                target->struct_size = new_value->struct_size;
             } else {
                 target->value.pv = NULL;
             }
@@ -20269,6 +25147,10 @@ StradaArray* strada_deref_array(StradaValue *ref) {
         return current->value.av;
     }
 
+    if (current && current->type == STRADA_CPOINTER && strada_iter_of(current)) {
+        return iter_drain(current);
+    }
+
     return NULL;
 }
 
@@ -20420,6 +25302,7 @@ StradaValue* strada_array_from_ref(StradaValue *ref) {
     }
     
     if (!src) return strada_new_array();
+    if (src->kind) return strada_array_copy(ref);   /* boxes the slots */
     
     /* Create new array and copy elements */
     StradaValue *result = strada_new_array();
@@ -20480,8 +25363,8 @@ StradaValue* strada_hash_from_flat_array(StradaValue *arr) {
 
     /* Check if this is an array-of-pairs: [[k,v], [k,v], ...] */
     /* Pairs may be STRADA_ARRAY directly or STRADA_REF to an array */
-    if (src->size > 0 && src->elements[src->head]) {
-        StradaValue *first = src->elements[src->head];
+    if (src->size > 0 && av_at(src, 0)) {
+        StradaValue *first = av_at(src, 0);
         StradaArray *first_av = NULL;
         /* Tagged-int guard: range-produced keys (map { $_ => 1 } (1..N))
          * are tagged pointers — dereferencing ->type segfaulted. */
@@ -20494,7 +25377,7 @@ StradaValue* strada_hash_from_flat_array(StradaValue *arr) {
         }
         if (first_av && first_av->size >= 2) {
             for (size_t i = 0; i < src->size; i++) {
-                StradaValue *elem = src->elements[src->head + i];
+                StradaValue *elem = av_at(src, i);
                 StradaArray *pair_av = NULL;
                 if (elem && !STRADA_IS_TAGGED_INT(elem) && elem->type == STRADA_ARRAY) {
                     pair_av = elem->value.av;
@@ -20509,7 +25392,7 @@ StradaValue* strada_hash_from_flat_array(StradaValue *arr) {
                  * first element is itself a 2+-elem array (ref or direct). */
                 int is_nested_pair_list = 0;
                 if (pair_av && pair_av->size > 0) {
-                    StradaValue *inner_first = pair_av->elements[pair_av->head];
+                    StradaValue *inner_first = av_at(pair_av, 0);
                     StradaArray *inner_first_av = NULL;
                     if (inner_first && !STRADA_IS_TAGGED_INT(inner_first) && inner_first->type == STRADA_ARRAY) {
                         inner_first_av = inner_first->value.av;
@@ -20523,7 +25406,7 @@ StradaValue* strada_hash_from_flat_array(StradaValue *arr) {
                 }
                 if (is_nested_pair_list) {
                     for (size_t j = 0; j < pair_av->size; j++) {
-                        StradaValue *sub = pair_av->elements[pair_av->head + j];
+                        StradaValue *sub = av_at(pair_av, j);
                         StradaArray *sub_av = NULL;
                         if (sub && !STRADA_IS_TAGGED_INT(sub) && sub->type == STRADA_ARRAY) {
                             sub_av = sub->value.av;
@@ -20533,14 +25416,14 @@ StradaValue* strada_hash_from_flat_array(StradaValue *arr) {
                         }
                         if (sub_av && sub_av->size >= 2) {
                             char _tb[256];
-                            const char *key_str = strada_to_str_buf(sub_av->elements[sub_av->head], _tb, sizeof(_tb));
-                            strada_hash_set(result->value.hv, key_str, sub_av->elements[sub_av->head + 1]);
+                            const char *key_str = strada_to_str_buf(av_at(sub_av, 0), _tb, sizeof(_tb));
+                            strada_hash_set(result->value.hv, key_str, av_at(sub_av, 1));
                         }
                     }
                 } else if (pair_av && pair_av->size >= 2) {
                     char _tb[256];
-                    const char *key_str = strada_to_str_buf(pair_av->elements[pair_av->head], _tb, sizeof(_tb));
-                    strada_hash_set(result->value.hv, key_str, pair_av->elements[pair_av->head + 1]);
+                    const char *key_str = strada_to_str_buf(av_at(pair_av, 0), _tb, sizeof(_tb));
+                    strada_hash_set(result->value.hv, key_str, av_at(pair_av, 1));
                 }
             }
             strada_decref(arr);
@@ -20550,8 +25433,8 @@ StradaValue* strada_hash_from_flat_array(StradaValue *arr) {
 
     /* Iterate in pairs: [0]=key, [1]=val, [2]=key, [3]=val, ... */
     for (size_t i = 0; i + 1 < src->size; i += 2) {
-        StradaValue *key = src->elements[src->head + i];
-        StradaValue *val = src->elements[src->head + i + 1];
+        StradaValue *key = av_at(src, i);
+        StradaValue *val = av_at(src, i + 1);
 
         if (key) {
             char _tb[256];
@@ -20684,6 +25567,12 @@ static StradaValue* strada_clone_rec(StradaValue *sv, StradaCloneMap *m, int dep
             out = strada_new_str_len(sv->value.pv ? sv->value.pv : "", STRADA_STR_BYTELEN(sv));
             break;
         case STRADA_ARRAY: {
+            if (sv->value.av && sv->value.av->kind) {
+                /* packed: raw slots of the same kind, nothing to recurse into */
+                out = strada_array_copy_kind(sv, sv->value.av->kind);
+                strada_clone_map_put(m, sv, out);
+                break;
+            }
             out = strada_new_array();
             strada_clone_map_put(m, sv, out);  /* record BEFORE recursing (cycles) */
             if (sv->value.av) {
@@ -21120,7 +26009,7 @@ void strada_subst_sv(StradaValue **target_ptr, const char *find, const char *rep
 
     /* If target has refcount 1, we can update in place */
     if (target->refcount == 1) {
-        ss_free_pv(target->value.pv);
+        strada_str_free_pv(target);
         size_t rlen = strlen(result);
         target->value.pv = ss_alloc_pv(result, rlen);
         target->struct_size = rlen;
@@ -21312,7 +26201,7 @@ StradaValue* strada_sv_replace_first(StradaValue *sv, const char *find, const ch
     size_t pre = fp - src;
     size_t result_len = src_len - find_len + replace_len;
     /* Build directly into StradaString — single allocation, no intermediate buffer */
-    StradaString *ss = ss_new_uninit((uint32_t)result_len);
+    StradaString *ss = ss_new_uninit(result_len);
     memcpy(ss->data, src, pre);
     memcpy(ss->data + pre, replace, replace_len);
     memcpy(ss->data + pre + replace_len, fp + find_len, src_len - pre - find_len);
@@ -21864,7 +26753,7 @@ StradaValue* strada_exec_argv(StradaValue *program, StradaValue *args_arr) {
     size_t argc = args->size;
     char **argv = malloc((argc + 1) * sizeof(char*));
     for (size_t i = 0; i < argc; i++) {
-        argv[i] = strada_to_str(args->elements[args->head + i]);
+        argv[i] = strada_to_str(av_at(args, i));
     }
     argv[argc] = NULL;
 
@@ -21931,7 +26820,7 @@ StradaValue* strada_system_argv(StradaValue *program, StradaValue *args_arr) {
         size_t argc = args->size;
         char **argv = malloc((argc + 1) * sizeof(char*));
         for (size_t i = 0; i < argc; i++) {
-            argv[i] = strada_to_str(args->elements[args->head + i]);
+            argv[i] = strada_to_str(av_at(args, i));
         }
         argv[argc] = NULL;
 
@@ -22019,10 +26908,22 @@ StradaValue* strada_write_fd(StradaValue *fd_val, StradaValue *data_val) {
     /* Write to file descriptor, returns bytes written */
     int fd = (int)strada_to_int(fd_val);
     char _tb[256];
-    const char *data = strada_to_str_buf(data_val, _tb, sizeof(_tb));
-    size_t len = strlen(data);
-    ssize_t n = write(fd, data, len);
-    return strada_new_int(n);
+    const char *data;
+    size_t len;
+    if (data_val && !STRADA_IS_TAGGED_INT(data_val) && data_val->type == STRADA_STR && data_val->value.pv) {
+        data = data_val->value.pv;
+        len = STRADA_STR_BYTELEN(data_val);
+        if (len == 0) len = strlen(data);
+    } else {
+        data = strada_to_str_buf(data_val, _tb, sizeof(_tb));
+        len = strlen(data);
+    }
+    /* Small writes keep write()'s single-call semantics (short counts on
+     * non-blocking fds are the caller's to handle); large ones loop until
+     * done, since one write() stops near 2 GiB. */
+    if (len < STRADA_DIRECT_WRITE_MIN) return strada_new_int(write(fd, data, len));
+    struct iovec iov = { (void *)data, len };
+    return strada_new_int(strada_writev_all(fd, &iov, 1));
 }
 
 StradaValue* strada_read_all_fd(StradaValue *fd_val) {
@@ -25971,6 +30872,9 @@ static int profile_entry_count = 0;
 static ProfileStack profile_stack[PROFILE_MAX_STACK];
 static int profile_stack_depth = 0;
 static int profile_initialized = 0;
+static char *profile_output_path = NULL;  /* PGO training output (see strada_profile_set_output) */
+static const char *const *profile_declared = NULL;  /* every instrumented function (strada_profile_declare) */
+static int profile_declared_count = 0;
 
 /* Get high-resolution time */
 static double profile_get_time(void) {
@@ -26067,8 +30971,102 @@ static int profile_compare(const void *a, const void *b) {
     return 0;
 }
 
+void strada_profile_set_output(const char *path) {
+    free(profile_output_path);
+    profile_output_path = (path && *path) ? strdup(path) : NULL;
+}
+
+/* A training build registers its function table from a constructor, before
+ * strada_profile_init runs, so it is kept apart from profile_entries. */
+void strada_profile_declare(const char *const *names, int count) {
+    profile_declared = names;
+    profile_declared_count = count;
+}
+
+/* PGO training dump. Counts from earlier training runs already in the file
+ * are kept and summed with this run's, so several representative workloads
+ * can be run against one --pgo-generate binary (like gcc's .gcda merging).
+ * Format: a "# strada-pgo 1" header, then "name<TAB>calls<TAB>self_ns". */
+static void profile_write_pgo(const char *path) {
+    int n = profile_entry_count;
+    uint64_t *calls = calloc((size_t)n + 1, sizeof(uint64_t));
+    uint64_t *self_ns = calloc((size_t)n + 1, sizeof(uint64_t));
+    if (!calls || !self_ns) { free(calls); free(self_ns); return; }
+    for (int i = 0; i < n; i++) {
+        calls[i] = profile_entries[i].call_count;
+        self_ns[i] = (uint64_t)(profile_entries[i].self_time * 1e9);
+    }
+
+    /* Carry over prior runs: merge matching names, keep the rest verbatim. */
+    size_t keep_len = 0, keep_cap = 0;
+    char *keep = NULL;
+    FILE *in = fopen(path, "r");
+    if (in) {
+        char line[1024];
+        while (fgets(line, sizeof(line), in)) {
+            if (line[0] == '#' || line[0] == '\n') continue;
+            char *tab1 = strchr(line, '\t');
+            if (!tab1) continue;
+            *tab1 = '\0';
+            unsigned long long c = 0, ns = 0;
+            if (sscanf(tab1 + 1, "%llu\t%llu", &c, &ns) < 1) continue;
+            int found = 0;
+            for (int i = 0; i < n; i++) {
+                if (profile_entries[i].name && strcmp(profile_entries[i].name, line) == 0) {
+                    calls[i] += c;
+                    self_ns[i] += ns;
+                    found = 1;
+                    break;
+                }
+            }
+            if (found) continue;
+            char rec[1100];
+            int rl = snprintf(rec, sizeof(rec), "%s\t%llu\t%llu\n", line, c, ns);
+            if (rl <= 0 || (size_t)rl >= sizeof(rec)) continue;
+            if (keep_len + (size_t)rl + 1 > keep_cap) {
+                size_t nc = keep_cap ? keep_cap * 2 : 4096;
+                while (nc < keep_len + (size_t)rl + 1) nc *= 2;
+                char *nk = realloc(keep, nc);
+                if (!nk) break;
+                keep = nk;
+                keep_cap = nc;
+            }
+            memcpy(keep + keep_len, rec, (size_t)rl);
+            keep_len += (size_t)rl;
+        }
+        fclose(in);
+    }
+
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Warning: cannot write PGO profile %s: %s\n", path, strerror(errno));
+    } else {
+        fprintf(out, "# strada-pgo 1\n");
+        for (int i = 0; i < n; i++) {
+            if (!profile_entries[i].name) continue;
+            fprintf(out, "%s\t%llu\t%llu\n", profile_entries[i].name,
+                    (unsigned long long)calls[i], (unsigned long long)self_ns[i]);
+        }
+        if (keep_len > 0) fwrite(keep, 1, keep_len, out);
+        fclose(out);
+    }
+    free(keep);
+    free(calls);
+    free(self_ns);
+}
+
 void strada_profile_report(void) {
-    if (!profile_initialized || profile_entry_count == 0) return;
+    if (!profile_initialized) return;
+
+    if (profile_output_path) {
+        /* Never-entered functions go out with 0 calls, so --pgo-use can tell
+         * them from functions the training build didn't have. */
+        for (int i = 0; i < profile_declared_count; i++)
+            profile_find_or_create(profile_declared[i]);
+        if (profile_entry_count > 0) profile_write_pgo(profile_output_path);
+        return;
+    }
+    if (profile_entry_count == 0) return;
 
     /* Sort entries by self_time */
     qsort(profile_entries, profile_entry_count, sizeof(ProfileEntry), profile_compare);
@@ -26658,6 +31656,85 @@ void strada_memprof_report(void) {
     fprintf(stderr, "╚══════════════════════════════════════════════════════════════════════════════╝\n");
 }
 
+/* Bytes a hash's table holds: struct, index and entries[], not the keys
+ * or values. A compact block counts whole while the struct lives in it. */
+static size_t hv_table_bytes(StradaHash *hv) {
+    int idx_in = hv_idx_in_block(hv);
+    size_t bytes = sizeof(StradaHash);
+    if (idx_in) bytes += HASH_COMPACT_INDEX_BYTES + HASH_COMPACT_ENTRIES * sizeof(StradaHashEntry);
+    else bytes += hv_index_bytes(hv->num_buckets);
+    if (!hv_ent_in_block(hv) || !idx_in) bytes += hv->capacity * sizeof(StradaHashEntry);
+    return bytes;
+}
+
+/* core::mem_stats() — process memory and hash compaction counters:
+ * rss and peak_rss in bytes (0 where the platform doesn't say), plus
+ * hash_compactions, hash_shrinks and hash_bytes_released.
+ * core::mem_stats(\%h) — one hash's table: keys, buckets, slots (entries[]
+ * high-water mark), capacity, tombstones, compact (1 while it lives in its
+ * single block) and bytes.
+ * core::mem_stats(\@a) — one array's backbone: size, capacity, head (free
+ * slots in front), packed (its kind), compact and bytes.
+ * undef when the argument is neither. */
+StradaValue* strada_mem_stats(StradaValue *target) {
+    StradaValue *result = strada_new_hash();
+    StradaHash *r = result->value.hv;
+    if (target && (STRADA_IS_TAGGED_INT(target) || target->type != STRADA_UNDEF)) {
+        StradaHash *hv = strada_deref_hash(target);
+        StradaArray *av = hv ? NULL : strada_deref_array(target);
+        if (av) {
+            int inl = !av->kind && array_elems_inline(av);
+            size_t es = av->kind ? av_slot_size(av->kind) : sizeof(StradaValue*);
+            size_t bytes = sizeof(StradaArray) + av->capacity * es;
+            if (av->boxes) bytes += av->capacity * sizeof(StradaValue*);
+            strada_hash_set_take(r, "size", strada_new_int((int64_t)av->size));
+            strada_hash_set_take(r, "capacity", strada_new_int((int64_t)av->capacity));
+            strada_hash_set_take(r, "head", strada_new_int((int64_t)av->head));
+            strada_hash_set_take(r, "packed", strada_new_int((int64_t)av->kind));
+            strada_hash_set_take(r, "compact", strada_new_int(inl));
+            strada_hash_set_take(r, "bytes", strada_new_int((int64_t)bytes));
+            return result;
+        }
+        if (!hv) {
+            strada_decref(result);
+            return strada_new_undef();
+        }
+        strada_hash_set_take(r, "keys", strada_new_int((int64_t)hv->num_entries));
+        strada_hash_set_take(r, "buckets", strada_new_int((int64_t)hv->num_buckets));
+        strada_hash_set_take(r, "slots", strada_new_int((int64_t)hv->next_slot));
+        strada_hash_set_take(r, "capacity", strada_new_int((int64_t)hv->capacity));
+        strada_hash_set_take(r, "tombstones", strada_new_int((int64_t)hv->num_tombstones));
+        strada_hash_set_take(r, "compact", strada_new_int(hv_idx_in_block(hv) && hv_ent_in_block(hv)));
+        strada_hash_set_take(r, "bytes", strada_new_int((int64_t)hv_table_bytes(hv)));
+        return result;
+    }
+    int64_t rss = 0, peak = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        long pages_total, pages_rss;
+        if (fscanf(f, "%ld %ld", &pages_total, &pages_rss) == 2)
+            rss = (int64_t)pages_rss * sysconf(_SC_PAGESIZE);
+        fclose(f);
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        peak = (int64_t)usage.ru_maxrss;            /* bytes */
+#else
+        peak = (int64_t)usage.ru_maxrss * 1024;     /* kilobytes */
+#endif
+    }
+    strada_hash_set_take(r, "rss", strada_new_int(rss));
+    strada_hash_set_take(r, "peak_rss", strada_new_int(peak));
+    strada_hash_set_take(r, "hash_compactions",
+        strada_new_int((int64_t)__atomic_load_n(&hv_stat_compactions, __ATOMIC_RELAXED)));
+    strada_hash_set_take(r, "hash_shrinks",
+        strada_new_int((int64_t)__atomic_load_n(&hv_stat_shrinks, __ATOMIC_RELAXED)));
+    strada_hash_set_take(r, "hash_bytes_released",
+        strada_new_int((int64_t)__atomic_load_n(&hv_stat_bytes_released, __ATOMIC_RELAXED)));
+    return result;
+}
+
 /* ============================================================
  * C INTEROP HELPER FUNCTIONS (c:: namespace)
  * For use with extern "C" FFI
@@ -27206,44 +32283,102 @@ StradaValue* strada_string_repeat(StradaValue *sv, int64_t count) {
     /* BYTE length so embedded NUL bytes and multibyte UTF-8 chars
      * survive — strada_str_len returns codepoint count when SVf_UTF8
      * is set, which would copy too few bytes per iteration. */
-    size_t len;
-    int src_utf8 = 0;
-    if (sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR) {
+    char _tb[256];
+    const char *str;
+    size_t len, flags;
+    if (!STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv
+        && !(sv->meta && sv->meta->is_tied)) {
+        str = sv->value.pv;
         len = STRADA_STR_BYTELEN(sv);
-        if (len == 0 && sv->value.pv) len = strlen(sv->value.pv);
-        if (STRADA_STR_IS_UTF8(sv)) src_utf8 = 1;
+        if (len == 0) len = strlen(str);
+        flags = sv->struct_size & STRADA_STR_FLAGS_MASK;
     } else {
-        len = strada_str_len(sv);
+        str = strada_to_str_buf(sv, _tb, sizeof(_tb));
+        len = strlen(str);
+        flags = _str_flags(str, len) & STRADA_STR_FLAGS_MASK;
     }
-    if (len == 0 || count == 0) { return strada_new_str(""); }
-    if ((size_t)count > SIZE_MAX / len) { return strada_new_str(""); }
-    /* strada_to_str_buf is safe here even with NULs because we know the
-     * exact length and use memcpy below (no NUL-stop scan). */
-    char _tb[256];
-    const char *str = strada_to_str_buf(sv, _tb, sizeof(_tb));
+    if (len == 0) { return strada_new_str(""); }
+    if ((size_t)count > (SIZE_MAX - sizeof(StradaString) - 1) / len) { return strada_new_str(""); }
     size_t total = len * (size_t)count;
-    char *buf = malloc(total + 1);
-    if (!buf) { return strada_new_str(""); }
-    for (int64_t i = 0; i < count; i++) {
-        memcpy(buf + i * len, str, len);
-    }
-    buf[total] = '\0';
-    StradaValue *res = strada_new_str_take(buf);
-    /* Override strada_new_str_take's strlen-derived length so embedded
-     * NULs survive round trips through length()/print/etc. struct_size's
-     * top bit is the ASCII-only flag; mask preserves whatever the
-     * constructor set. */
-    if (res && !STRADA_IS_TAGGED_INT(res) && res->type == STRADA_STR) {
-        size_t ascii_flag = res->struct_size & ((size_t)1 << 63);
-        res->struct_size = total | ascii_flag;
-        if (src_utf8) res->struct_size |= STRADA_UTF8_FLAG;
+    /* Written straight into the result: one byte is a memset, anything
+     * else doubles the filled prefix with memcpy (log2(count) calls)
+     * until the copies reach 16KB, then streams 16KB blocks from the
+     * still-cached front of the buffer. */
+    StradaValue *res = strada_str_value_uninit(total);
+    char *buf = res->value.pv;
+    if (len == 1) {
+        memset(buf, (unsigned char)str[0], total);
+    } else {
+        memcpy(buf, str, len);
+        size_t done = len;
+        size_t block = len;
+        while (done < total) {
+            size_t n = total - done < block ? total - done : block;
+            memcpy(buf + done, buf, n);
+            done += n;
+            if (block < 16384) block = done - done % len;
+        }
     }
+    res->struct_size = total | flags;
     return res;
 }
 
 /* ============================================================
  * Array splice: splice(@arr, offset, length, replacement)
  * ============================================================ */
+
+/* Packed splice: offset/length already normalized. The removed slots come
+ * back as a packed array of the same kind; replacements are coerced. */
+static StradaValue *av_packed_splice(StradaArray *av, size_t off, size_t len, StradaValue *repl_sv) {
+    size_t es = av_slot_size(av->kind);
+    size_t size = av->size;
+    StradaValue *result = strada_new_array();
+    StradaArray *rav = result->value.av;
+    av_make_packed(rav, av->kind, len);
+    memcpy(rav->elements, (char *)av->elements + (av->head + off) * es, len * es);
+    rav->size = len;
+
+    /* Coerce the replacements up front: repl may be this very array */
+    StradaArray *repl_av = NULL;
+    size_t rc = 0;
+    if (repl_sv && !STRADA_IS_TAGGED_INT(repl_sv) && repl_sv->type == STRADA_REF && repl_sv->value.rv &&
+        repl_sv->value.rv->type == STRADA_ARRAY) {
+        repl_av = repl_sv->value.rv->value.av;
+    } else if (repl_sv && !STRADA_IS_TAGGED_INT(repl_sv) && repl_sv->type == STRADA_ARRAY) {
+        repl_av = repl_sv->value.av;
+    } else if (repl_sv && (STRADA_IS_TAGGED_INT(repl_sv) || repl_sv->type != STRADA_UNDEF)) {
+        rc = 1;
+    }
+    if (repl_av) rc = repl_av->size;
+    StradaValue *tmp = NULL;
+    if (rc > 0) {
+        tmp = strada_new_array();
+        av_make_packed(tmp->value.av, av->kind, rc);
+        for (size_t i = 0; i < rc; i++)
+            strada_array_push(tmp->value.av, repl_av ? av_at(repl_av, i) : repl_sv);
+    }
+
+    for (size_t i = 0; i < len; i++) av_packed_unlend(av, av->head + off + i);
+    size_t new_size = size - len + rc;
+    if (rc > len) av_packed_fit(av, new_size);
+    size_t base = av->head;
+    memmove((char *)av->elements + (base + off + rc) * es,
+            (char *)av->elements + (base + off + len) * es, (size - off - len) * es);
+    if (av->boxes) {
+        memmove(av->boxes + base + off + rc, av->boxes + base + off + len,
+                (size - off - len) * sizeof(StradaValue*));
+        memset(av->boxes + base + off, 0, rc * sizeof(StradaValue*));
+        if (new_size < size)
+            memset(av->boxes + base + new_size, 0, (size - new_size) * sizeof(StradaValue*));
+    }
+    if (tmp) {
+        memcpy((char *)av->elements + (base + off) * es, tmp->value.av->elements, rc * es);
+        strada_decref(tmp);
+    }
+    av->size = new_size;
+    return result;
+}
+
 StradaValue* strada_array_splice_sv(StradaValue *arr_sv, int64_t offset, int64_t length, StradaValue *repl_sv) {
     if (!arr_sv || STRADA_IS_TAGGED_INT(arr_sv)) return strada_new_array();
     StradaArray *av;
@@ -27278,73 +32413,66 @@ StradaValue* strada_array_splice_sv(StradaValue *arr_sv, int64_t offset, int64_t
         if (length < 0) length = 0;
     }
     if (offset + length > size) length = size - offset;
+    if (av->kind) return av_packed_splice(av, (size_t)offset, (size_t)length, repl_sv);
+    size_t off = (size_t)offset;
+    size_t len = (size_t)length;
 
-    /* Compact head before splice to simplify offset calculations */
-    if (av->head > 0) {
-        memmove(av->elements, av->elements + av->head, av->size * sizeof(StradaValue*));
-        av->head = 0;
-    }
-
-    /* Build result array of removed elements */
+    /* The removed elements move to the result with their references */
     StradaValue *result = strada_new_array();
     StradaArray *result_av = result->value.av;
-    for (int64_t i = 0; i < length; i++) {
-        StradaValue *elem = av->elements[offset + i];
-        strada_array_push(result_av, elem);
+    if (len > 0) {
+        if (len > result_av->capacity) {
+            result_av->elements = array_grow_elems(result_av, len);
+            result_av->capacity = len;
+        }
+        memcpy(result_av->elements, av->elements + av->head + off, len * sizeof(StradaValue*));
+        result_av->size = len;
     }
 
-    /* Get replacement elements */
+    /* Get replacement elements. splice(@a, ..., @a) inserts the array as
+     * it was before the splice, so take a snapshot first. */
     StradaArray *repl_av = NULL;
-    int64_t repl_count = 0;
-    int repl_is_scalar = 0;
+    StradaValue *snap = NULL;
+    size_t rc = 0;
     if (repl_sv && !STRADA_IS_TAGGED_INT(repl_sv) && repl_sv->type == STRADA_REF && repl_sv->value.rv &&
         repl_sv->value.rv->type == STRADA_ARRAY) {
         repl_av = repl_sv->value.rv->value.av;
-        repl_count = (int64_t)repl_av->size;
     } else if (repl_sv && !STRADA_IS_TAGGED_INT(repl_sv) && repl_sv->type == STRADA_ARRAY) {
         repl_av = repl_sv->value.av;
-        repl_count = (int64_t)repl_av->size;
     } else if (repl_sv && !STRADA_IS_TAGGED_INT(repl_sv) && repl_sv->type != STRADA_UNDEF) {
         /* Scalar replacement: treat as single-element insert (like Perl) */
-        repl_count = 1;
-        repl_is_scalar = 1;
-    }
-
-    /* Calculate new size */
-    int64_t new_size = size - length + repl_count;
-    int64_t diff = repl_count - length;
-
-    /* Decref removed elements */
-    for (int64_t i = 0; i < length; i++) {
-        strada_decref(av->elements[offset + i]);
-    }
-
-    /* Shift elements */
-    if (diff != 0) {
-        /* Ensure capacity */
-        if (new_size > (int64_t)av->capacity) {
-            size_t new_cap = (size_t)new_size * 2;
-            av->elements = array_grow_elems(av, new_cap);
-            av->capacity = new_cap;
-        }
-        /* Move tail elements */
-        memmove(&av->elements[offset + repl_count],
-                &av->elements[offset + length],
-                (size - offset - length) * sizeof(StradaValue*));
-    }
-
-    /* Insert replacement elements */
-    if (repl_is_scalar) {
+        rc = 1;
+    }
+    if (repl_av == av) {
+        snap = strada_new_array();
+        strada_array_append_av(snap->value.av, av);
+        repl_av = snap->value.av;
+    }
+    if (repl_av) rc = repl_av->size;
+
+    /* Replacements overwrite the removed slots; the rest of either side
+     * opens or closes a gap, moving the shorter part of the array. */
+    size_t k = rc < len ? rc : len;
+    StradaValue **slot = av->elements + av->head + off;
+    if (repl_av) {
+        for (size_t i = 0; i < k; i++) slot[i] = av_at(repl_av, i);
+        av_incref_run(slot, k);
+    } else if (k) {
         strada_incref(repl_sv);
-        av->elements[offset] = repl_sv;
-    } else {
-        for (int64_t i = 0; i < repl_count; i++) {
-            StradaValue *elem = repl_av->elements[repl_av->head + i];
-            strada_incref(elem);
-            av->elements[offset + i] = elem;
+        slot[0] = repl_sv;
+    }
+    if (rc < len) {
+        av_close_gap(av, off + rc, len - rc);
+    } else if (rc > len) {
+        if (repl_av) {
+            av_insert_run(av, off + len, repl_av, len, rc - len);
+        } else {
+            av_open_gap(av, off, 1);
+            strada_incref(repl_sv);
+            av->elements[av->head + off] = repl_sv;
         }
     }
-    av->size = (size_t)new_size;
+    if (snap) strada_decref(snap);
 
     return result;
 }
@@ -27417,145 +32545,516 @@ StradaValue* strada_select_get(void) {
 
 /* ============================================================
  * Transliteration (tr///)
- * ============================================================ */
-StradaValue* strada_tr(StradaValue *sv, const char *search, const char *replace, const char *flags) {
-    if (!sv || !search) return strada_new_int(0);
-    char *str = strada_to_str(sv);
-    size_t len = strlen(str);
+ * ============================================================
+ * A tr/// specification is compiled once (strada_tr_compile; generated
+ * code keeps one per call site) and applied by strada_tr_run. Compiling
+ * expands ranges and escapes, applies Perl's list rules (an empty
+ * replacement list means the search list unless /d, a short one repeats
+ * its last character, the first mapping of a repeated character wins)
+ * and builds a 256-entry byte map. When both lists are ASCII, SSSE3
+ * nibble shuffles test 16 bytes at a time for membership and translate
+ * them with per-row deltas, so counting and one-to-one maps never run a
+ * byte loop, and /d and /s only step through the bytes they touch.
+ * Lists with non-ASCII characters, and /c over UTF-8-flagged text, are
+ * applied per codepoint. The subject is rewritten in place when its
+ * string is unshared. */
+#define STRADA_TR_KEEP (-1)
+#define STRADA_TR_DEL  (-2)
+#define STRADA_TR_LIST_MAX 0x110100
+
+struct StradaTr {
+    int16_t map[256];               /* byte path: KEEP, DEL or the new byte */
+    int complement, del, squeeze, ret;
+    int ascii;                      /* both lists are ASCII */
+    int identity;                   /* nothing is changed or deleted: a count */
+    int simple;                     /* nothing is deleted or squeezed */
+    int high_keep;                  /* every byte >= 0x80 maps to KEEP */
+    int32_t amap[128];              /* codepoint path, ASCII characters */
+    uint32_t *set;                  /* codepoint path: search list, sorted */
+    int32_t *to;                    /*   and its mapping (not /c) */
+    size_t nset;
+    uint32_t *repl;                 /*   replacement list (/c) */
+    size_t nrepl;
+    unsigned char lo[16], hi[16];   /* member(b): lo[b & 15] & hi[b >> 4] */
+    unsigned char delta[8][16];     /* (map[b] - b) & 0xFF for ASCII b */
+    unsigned rows;                  /* rows b >> 4 with a nonzero delta */
+};
 
-    /* Parse flags */
-    int complement = 0, delete_flag = 0, squeeze = 0;
-    if (flags) {
-        for (const char *f = flags; *f; f++) {
-            if (*f == 'c') complement = 1;
-            else if (*f == 'd') delete_flag = 1;
-            else if (*f == 's') squeeze = 1;
+static uint32_t strada_tr_escape(const unsigned char **pp, const unsigned char *end) {
+    const unsigned char *p = *pp;
+    uint32_t c = 0;
+    switch (*p) {
+    case 'n': c = '\n'; p++; break;
+    case 't': c = '\t'; p++; break;
+    case 'r': c = '\r'; p++; break;
+    case 'f': c = '\f'; p++; break;
+    case 'e': c = 27;   p++; break;
+    case 'a': c = 7;    p++; break;
+    case 'x':
+        p++;
+        if (p < end && *p == '{') {
+            for (p++; p < end && *p != '}'; p++)
+                if (isxdigit(*p)) c = c * 16 + (uint32_t)(isdigit(*p) ? *p - '0' : (tolower(*p) - 'a' + 10));
+            if (p < end) p++;
+            if (c > 0x10FFFF) c = 0xFFFD;
+        } else {
+            for (int k = 0; k < 2 && p < end && isxdigit(*p); k++, p++)
+                c = c * 16 + (uint32_t)(isdigit(*p) ? *p - '0' : (tolower(*p) - 'a' + 10));
+        }
+        break;
+    default:
+        if (*p >= '0' && *p <= '7') {
+            for (int k = 0; k < 3 && p < end && *p >= '0' && *p <= '7'; k++, p++) c = c * 8 + (uint32_t)(*p - '0');
+        } else {
+            c = *p++;   /* \\, \-, and any other escaped character */
         }
     }
+    *pp = p;
+    return c;
+}
 
-    /* Build search and replace lists (expand ranges like a-z) */
-    unsigned char search_chars[256];
-    unsigned char replace_chars[256];
-    int search_count = 0, replace_count = 0;
-
-    /* Expand ranges in search */
-    for (const char *p = search; *p; p++) {
-        if (*(p+1) == '-' && *(p+2)) {
-            unsigned char from = (unsigned char)*p;
-            unsigned char to = (unsigned char)*(p+2);
-            if (from <= to) {
-                for (unsigned int c = from; c <= to; c++) {
-                    if (search_count < 256) search_chars[search_count++] = (unsigned char)c;
-                }
-            } else {
-                for (unsigned int c = from; c >= to; c--) {
-                    if (search_count < 256) search_chars[search_count++] = (unsigned char)c;
-                }
+/* One character of a tr list: an escape, a UTF-8 sequence (utf8) or a
+ * byte. */
+static uint32_t strada_tr_char(const unsigned char **pp, const unsigned char *end, int utf8) {
+    const unsigned char *p = *pp;
+    uint32_t c;
+    if (*p == '\\' && p + 1 < end) {
+        p++;
+        c = strada_tr_escape(&p, end);
+    } else if (utf8 && *p >= 0x80) {
+        int len = utf8_char_len(*p);
+        if (len <= 0 || p + len > end) len = 1;
+        c = len == 1 ? *p : utf8_decode((const char *)p, NULL);
+        p += len;
+    } else {
+        c = *p++;
+    }
+    *pp = p;
+    return c;
+}
+
+/* Expand a tr list into characters: codepoints when utf8, else bytes
+ * (an escape above 0xFF then contributes its UTF-8 bytes). "x-y" is a
+ * range; a '-' that comes first, last or escaped is itself. */
+static uint32_t *strada_tr_expand(const char *spec, int utf8, size_t *count) {
+    const unsigned char *p = (const unsigned char *)(spec ? spec : "");
+    const unsigned char *end = p + strlen((const char *)p);
+    size_t n = 0, cap = 16;
+    uint32_t *out = sr_xmalloc(cap * sizeof(uint32_t));
+    while (p < end) {
+        uint32_t from = strada_tr_char(&p, end, utf8), to = from;
+        if (p + 1 < end && *p == '-') {
+            p++;
+            to = strada_tr_char(&p, end, utf8);
+        }
+        for (uint32_t v = from; ; v = from <= to ? v + 1 : v - 1) {
+            char enc[4];
+            int ne = 1;
+            if (!utf8 && v > 0xFF) ne = utf8_encode(v, enc);
+            else enc[0] = (char)v;
+            for (int k = 0; k < ne && n < STRADA_TR_LIST_MAX; k++) {
+                if (n == cap) { cap *= 2; out = sr_xrealloc(out, cap * sizeof(uint32_t)); }
+                out[n++] = utf8 ? v : (unsigned char)enc[k];
             }
-            p += 2;
-        } else {
-            if (search_count < 256) search_chars[search_count++] = (unsigned char)*p;
+            if (v == to || n >= STRADA_TR_LIST_MAX) break;
         }
     }
+    *count = n;
+    return out;
+}
 
-    /* Expand ranges in replace */
-    for (const char *p = replace; *p; p++) {
-        if (*(p+1) == '-' && *(p+2)) {
-            unsigned char from = (unsigned char)*p;
-            unsigned char to = (unsigned char)*(p+2);
-            if (from <= to) {
-                for (unsigned int c = from; c <= to; c++) {
-                    if (replace_count < 256) replace_chars[replace_count++] = (unsigned char)c;
-                }
-            } else {
-                for (unsigned int c = from; c >= to; c--) {
-                    if (replace_count < 256) replace_chars[replace_count++] = (unsigned char)c;
-                }
-            }
-            p += 2;
-        } else {
-            if (replace_count < 256) replace_chars[replace_count++] = (unsigned char)*p;
+/* Perl's list rules for the i-th search character c (with /c, the i-th
+ * character outside the search list). */
+static int32_t strada_tr_result(const StradaTr *t, const uint32_t *repl, size_t nrepl, size_t i, uint32_t c) {
+    if (nrepl == 0) return t->del ? STRADA_TR_DEL : (int32_t)c;
+    if (i < nrepl) return (int32_t)repl[i];
+    return t->del ? STRADA_TR_DEL : (int32_t)repl[nrepl - 1];
+}
+
+/* Codepoint path: the mapping for c (KEEP, DEL or the new codepoint). */
+static int32_t strada_tr_lookup(const StradaTr *t, uint32_t c) {
+    size_t lo = 0, hi = t->nset;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (t->set[mid] < c) lo = mid + 1; else hi = mid;
+    }
+    int found = lo < t->nset && t->set[lo] == c;
+    if (!t->complement) return found ? t->to[lo] : STRADA_TR_KEEP;
+    if (found) return STRADA_TR_KEEP;
+    /* lo search characters sort below c, so c is outside-character c - lo */
+    return strada_tr_result(t, t->repl, t->nrepl, c - lo, c);
+}
+
+typedef struct { uint32_t c; uint32_t pos; } StradaTrPair;
+
+static int strada_tr_pair_cmp(const void *a, const void *b) {
+    const StradaTrPair *x = a, *y = b;
+    if (x->c != y->c) return x->c < y->c ? -1 : 1;
+    return x->pos < y->pos ? -1 : (x->pos > y->pos);
+}
+
+StradaTr *strada_tr_compile(const char *search, const char *replace, const char *flags) {
+    StradaTr *t = sr_xmalloc(sizeof(StradaTr));
+    memset(t, 0, sizeof(*t));
+    for (const char *f = flags ? flags : ""; *f; f++) {
+        if (*f == 'c') t->complement = 1;
+        else if (*f == 'd') t->del = 1;
+        else if (*f == 's') t->squeeze = 1;
+        else if (*f == 'r') t->ret = 1;
+    }
+
+    /* Byte map */
+    size_t ns, nr;
+    uint32_t *s = strada_tr_expand(search, 0, &ns);
+    uint32_t *r = strada_tr_expand(replace, 0, &nr);
+    unsigned char seen[256] = {0};
+    t->ascii = 1;
+    for (size_t i = 0; i < ns; i++) if (s[i] >= 0x80) t->ascii = 0;
+    for (size_t i = 0; i < nr; i++) if (r[i] >= 0x80) t->ascii = 0;
+    for (int b = 0; b < 256; b++) t->map[b] = STRADA_TR_KEEP;
+    if (!t->complement) {
+        for (size_t i = 0; i < ns; i++) {
+            if (seen[s[i]]) continue;
+            seen[s[i]] = 1;
+            t->map[s[i]] = (int16_t)strada_tr_result(t, r, nr, i, s[i]);
         }
+    } else {
+        for (size_t i = 0; i < ns; i++) seen[s[i]] = 1;
+        size_t k = 0;
+        for (int b = 0; b < 256; b++)
+            if (!seen[b]) t->map[b] = (int16_t)strada_tr_result(t, r, nr, k++, (uint32_t)b);
     }
+    free(s);
+    free(r);
 
-    /* Build translation table */
-    int trans[256];
-    for (int i = 0; i < 256; i++) trans[i] = -1;  /* -1 = not in search set */
+    /* Codepoint lists: the search list sorted (first mapping wins) */
+    uint32_t *cs = strada_tr_expand(search, 1, &ns);
+    t->repl = strada_tr_expand(replace, 1, &t->nrepl);
+    StradaTrPair *pairs = sr_xmalloc((ns ? ns : 1) * sizeof(StradaTrPair));
+    for (size_t i = 0; i < ns; i++) { pairs[i].c = cs[i]; pairs[i].pos = (uint32_t)i; }
+    qsort(pairs, ns, sizeof(StradaTrPair), strada_tr_pair_cmp);
+    t->set = sr_xmalloc((ns ? ns : 1) * sizeof(uint32_t));
+    t->to = sr_xmalloc((ns ? ns : 1) * sizeof(int32_t));
+    for (size_t i = 0; i < ns; i++) {
+        if (t->nset && t->set[t->nset - 1] == pairs[i].c) continue;
+        t->set[t->nset] = pairs[i].c;
+        t->to[t->nset] = strada_tr_result(t, t->repl, t->nrepl, pairs[i].pos, pairs[i].c);
+        t->nset++;
+    }
+    free(pairs);
+    free(cs);
+    for (uint32_t c = 0; c < 128; c++) t->amap[c] = strada_tr_lookup(t, c);
+
+    /* A count when nothing is changed or deleted */
+    t->identity = !t->squeeze;
+    for (int b = 0; b < 256 && t->identity; b++)
+        if (t->map[b] != STRADA_TR_KEEP && t->map[b] != b) t->identity = 0;
+    if (t->complement) {
+        if (t->nrepl || t->del) t->identity = 0;
+    } else {
+        for (size_t i = 0; i < t->nset && t->identity; i++)
+            if (t->to[i] != (int32_t)t->set[i]) t->identity = 0;
+    }
+    t->simple = !t->squeeze;
+    for (int b = 0; b < 256 && t->simple; b++)
+        if (t->map[b] == STRADA_TR_DEL) t->simple = 0;
+    t->high_keep = 1;
+    for (int b = 0x80; b < 256; b++)
+        if (t->map[b] != STRADA_TR_KEEP) t->high_keep = 0;
+
+    /* Nibble tables for the ASCII bytes */
+    for (int h = 0; h < 8; h++) t->hi[h] = (unsigned char)(1u << h);
+    for (int b = 0; b < 128; b++) {
+        if (t->map[b] == STRADA_TR_KEEP) continue;
+        t->lo[b & 15] |= (unsigned char)(1u << (b >> 4));
+        if (t->map[b] >= 0 && t->map[b] != b) {
+            t->delta[b >> 4][b & 15] = (unsigned char)(t->map[b] - b);
+            t->rows |= 1u << (b >> 4);
+        }
+    }
+    return t;
+}
+
+void strada_tr_free(StradaTr *t) {
+    if (!t) return;
+    free(t->set);
+    free(t->to);
+    free(t->repl);
+    free(t);
+}
+
+#ifdef STRADA_SIMD_X86
+/* Bit i set when byte i of v is an ASCII byte the map changes, counts
+ * or deletes. */
+__attribute__((target("ssse3")))
+static inline unsigned strada_tr_members16(const StradaTr *t, __m128i v) {
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    __m128i m = _mm_and_si128(
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)t->lo), _mm_and_si128(v, nib)),
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)t->hi), _mm_and_si128(_mm_srli_epi16(v, 4), nib)));
+    return ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(m, _mm_setzero_si128())) & 0xFFFF;
+}
+
+__attribute__((target("ssse3")))
+static size_t strada_tr_count_ssse3(const StradaTr *t, const unsigned char *s, size_t n, int64_t *count) {
+    int64_t c = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        if (!t->high_keep && _mm_movemask_epi8(v)) {
+            for (int j = 0; j < 16; j++) c += t->map[s[i + j]] != STRADA_TR_KEEP;
+            continue;
+        }
+        c += __builtin_popcount(strada_tr_members16(t, v));
+    }
+    *count += c;
+    return i;
+}
 
-    if (!complement) {
-        for (int i = 0; i < search_count; i++) {
-            if (delete_flag && i >= replace_count) {
-                trans[search_chars[i]] = -2;  /* -2 = delete */
-            } else if (i < replace_count) {
-                trans[search_chars[i]] = replace_chars[i];
-            } else if (replace_count > 0) {
-                /* If replace list is shorter, use last replace char */
-                trans[search_chars[i]] = replace_chars[replace_count - 1];
+/* One-to-one map (no /d, no /s): each row of the map with changes adds
+ * its per-byte delta, selected by the high nibble. d may equal s. */
+__attribute__((target("ssse3")))
+static size_t strada_tr_map_ssse3(const StradaTr *t, unsigned char *d, const unsigned char *s, size_t n, int64_t *count) {
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    int64_t c = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        if (!t->high_keep && _mm_movemask_epi8(v)) {
+            for (int j = 0; j < 16; j++) {
+                int m = t->map[s[i + j]];
+                if (m != STRADA_TR_KEEP) { c++; d[i + j] = (unsigned char)m; }
+                else d[i + j] = s[i + j];
             }
+            continue;
         }
-    } else {
-        /* Complement: translate chars NOT in search set */
-        int in_search[256] = {0};
-        for (int i = 0; i < search_count; i++) in_search[search_chars[i]] = 1;
-        int rep_idx = 0;
-        for (int i = 0; i < 256; i++) {
-            if (!in_search[i]) {
-                if (delete_flag && rep_idx >= replace_count) {
-                    trans[i] = -2;
-                } else if (rep_idx < replace_count) {
-                    trans[i] = replace_chars[rep_idx++];
-                } else if (replace_count > 0) {
-                    trans[i] = replace_chars[replace_count - 1];
-                }
-            }
+        unsigned bits = strada_tr_members16(t, v);
+        c += __builtin_popcount(bits);
+        if (bits) {
+            __m128i lo = _mm_and_si128(v, nib);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nib);
+            for (unsigned rows = t->rows; rows; rows &= rows - 1) {
+                int h = __builtin_ctz(rows);
+                __m128i add = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)t->delta[h]), lo);
+                v = _mm_add_epi8(v, _mm_and_si128(add, _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)h))));
+            }
+        } else if (d == s) {
+            continue;
         }
+        _mm_storeu_si128((__m128i *)(d + i), v);
     }
+    *count += c;
+    return i;
+}
 
-    /* Apply translation */
-    char *result = malloc(len + 1);
-    size_t out_idx = 0;
-    int count = 0;
-    int last_char = -1;
+/* Offset of the first byte at or after i the map does not keep (or of
+ * the 16-byte block holding it, when bytes >= 0x80 need a look). */
+__attribute__((target("ssse3")))
+static size_t strada_tr_skip_ssse3(const StradaTr *t, const unsigned char *s, size_t i, size_t n) {
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        unsigned bits = strada_tr_members16(t, v);
+        if (!t->high_keep) bits |= (unsigned)_mm_movemask_epi8(v);
+        if (bits) return i + (size_t)__builtin_ctz(bits);
+    }
+    return i;
+}
+#endif
 
-    for (size_t i = 0; i < len; i++) {
-        unsigned char c = (unsigned char)str[i];
-        int t = trans[c];
-        if (t == -2) {
-            /* Delete this character */
-            count++;
-        } else if (t >= 0) {
-            /* Translate */
-            count++;
-            if (squeeze && (unsigned char)t == (unsigned char)last_char) {
-                /* Squeeze: skip duplicate */
-            } else {
-                result[out_idx++] = (char)t;
-                last_char = t;
-            }
+/* Byte path: translate s[0..n) into d (d may equal s; the output is never
+ * longer). Returns the bytes written; *count gets tr's count. */
+static size_t strada_tr_apply(const StradaTr *t, unsigned char *d, const unsigned char *s, size_t n, int64_t *count) {
+    size_t i = 0, o = 0;
+    int64_t c = 0;
+    int simd = 0;
+#ifdef STRADA_SIMD_X86
+    simd = t->ascii && n >= 16 && strada_cpu_ssse3();
+#endif
+    if (t->identity) {
+#ifdef STRADA_SIMD_X86
+        if (simd) i = strada_tr_count_ssse3(t, s, n, &c);
+#endif
+        for (; i < n; i++) c += t->map[s[i]] != STRADA_TR_KEEP;
+        *count = c;
+        return n;
+    }
+    if (t->simple) {
+#ifdef STRADA_SIMD_X86
+        if (simd) i = strada_tr_map_ssse3(t, d, s, n, &c);
+#endif
+        for (; i < n; i++) {
+            int m = t->map[s[i]];
+            if (m != STRADA_TR_KEEP) { c++; d[i] = (unsigned char)m; }
+            else d[i] = s[i];
+        }
+        *count = c;
+        return n;
+    }
+    int last = -1;
+    while (i < n) {
+        size_t j = i;
+#ifdef STRADA_SIMD_X86
+        if (simd) j = strada_tr_skip_ssse3(t, s, i, n);
+#endif
+        while (j < n && t->map[s[j]] == STRADA_TR_KEEP) j++;
+        if (j > i) {
+            if (d + o != s + i) memmove(d + o, s + i, j - i);
+            o += j - i;
+            i = j;
+            last = -1;
+            if (i == n) break;
+        }
+        int m = t->map[s[i++]];
+        c++;
+        if (m == STRADA_TR_DEL || (t->squeeze && m == last)) continue;
+        d[o++] = (unsigned char)m;
+        last = m;
+    }
+    *count = c;
+    return o;
+}
+
+/* Codepoint path over valid UTF-8: translate into d (4 * n bytes; NULL
+ * to count only). Returns the bytes written. */
+static size_t strada_tr_apply_cp(const StradaTr *t, unsigned char *d, const unsigned char *s, size_t n, int64_t *count) {
+    size_t i = 0, o = 0;
+    int64_t c = 0;
+    int32_t last = -1;
+    while (i < n) {
+        int len = 1;
+        int32_t m;
+        if (s[i] < 0x80) {
+            m = t->amap[s[i]];
         } else {
-            /* Not in translation set - keep as-is */
-            result[out_idx++] = (char)c;
-            last_char = -1;
+            len = utf8_char_len(s[i]);
+            if (len <= 0 || i + (size_t)len > n) len = 1;
+            m = strada_tr_lookup(t, len == 1 ? s[i] : utf8_decode((const char *)s + i, NULL));
         }
+        if (m == STRADA_TR_KEEP) {
+            if (d) { memcpy(d + o, s + i, (size_t)len); o += (size_t)len; }
+            last = -1;
+        } else {
+            c++;
+            if (d && m != STRADA_TR_DEL && !(t->squeeze && m == last)) {
+                o += (size_t)utf8_encode((uint32_t)m, (char *)d + o);
+                last = m;
+            }
+        }
+        i += (size_t)len;
     }
-    result[out_idx] = '\0';
+    *count = c;
+    return o;
+}
 
-    /* Modify the original string in-place */
-    if (sv->type == STRADA_STR && sv->value.pv) {
-        ss_free_pv(sv->value.pv);
-        sv->value.pv = ss_alloc_pv(result, out_idx);
-        /* Re-compute the ASCII flag — the transliterated bytes may be
-         * pure-ASCII even if the original wasn't, and vice versa. */
-        sv->struct_size = _str_flags(result, out_idx);
-        free(result);
+/* Apply a compiled tr/// to sv. Returns the count, or with /r the new
+ * string. The subject's string is rewritten in place when unshared and
+ * replaced otherwise; with `fresh`, sv is left alone and *fresh gets the
+ * new string value (NULL when nothing changed). Non-string subjects are
+ * read, not rewritten. */
+static StradaValue* strada_tr_exec(StradaValue *sv, const StradaTr *t, StradaValue **fresh) {
+    char _tb[256];
+    const char *src = "";
+    size_t n = 0, flags = STRADA_ASCII_FLAG;
+    int is_str = sv && !STRADA_IS_TAGGED_INT(sv) && sv->type == STRADA_STR && sv->value.pv
+                 && !(sv->meta && sv->meta->is_tied);
+    if (is_str) {
+        src = sv->value.pv;
+        n = STRADA_STR_BYTELEN(sv);
+        if (n == 0) n = strlen(src);
+        flags = sv->struct_size & STRADA_STR_FLAGS_MASK;
+    } else if (sv) {
+        src = strada_to_str_buf(sv, _tb, sizeof(_tb));
+        n = strlen(src);
+        flags = _str_flags(src, n) & STRADA_STR_FLAGS_MASK;
+    }
+    const unsigned char *s = (const unsigned char *)src;
+    int64_t count = 0;
+
+    /* Non-ASCII lists work on characters (when the text is UTF-8); so
+     * does /c on char-oriented text, where every non-listed character,
+     * not byte, is counted. */
+    int cp = 0;
+    if (!t->ascii) cp = utf8_is_valid(src, n);
+    else if (t->complement && (flags & STRADA_UTF8_FLAG) && !(flags & STRADA_ASCII_FLAG))
+        cp = strada_ascii_run(s, n) != n && utf8_is_valid(src, n);
+
+    if (t->identity) {
+        if (cp) strada_tr_apply_cp(t, NULL, s, n, &count);
+        else strada_tr_apply(t, NULL, s, n, &count);
+        if (!t->ret) return strada_new_int(count);
+        StradaValue *res = strada_new_str_len(src, n);
+        res->struct_size |= flags & STRADA_UTF8_FLAG;
+        return res;
+    }
+
+    StradaString *ss = NULL;
+    size_t o;
+    if (cp) {
+        unsigned char *buf = sr_xmalloc(n * 4 + 1);
+        o = strada_tr_apply_cp(t, buf, s, n, &count);
+        ss = ss_new((const char *)buf, o, 0);
+        free(buf);
+    } else if (!t->ret && !fresh && is_str && !STRADA_STR_IS_VIEW(sv)
+               && (STRADA_STR_IS_EMBEDDED(sv) || SS_FROM_PV(sv->value.pv)->refcount == 1)) {
+        /* Unshared: rewrite in place (the byte path never grows) */
+        o = strada_tr_apply(t, (unsigned char *)sv->value.pv, s, n, &count);
+        size_t ascii = (flags & STRADA_ASCII_FLAG) && t->ascii
+                       ? STRADA_ASCII_FLAG : _str_flags(sv->value.pv, o) & STRADA_ASCII_FLAG;
+        strada_u8_index_drop(sv);
+        SS_FROM_PV(sv->value.pv)->len = o;
+        sv->value.pv[o] = '\0';
+        sv->struct_size = o | ascii | (flags & STRADA_UTF8_FLAG);
+        return strada_new_int(count);
     } else {
-        free(result);
+        ss = ss_new_uninit(n);
+        o = strada_tr_apply(t, (unsigned char *)ss->data, s, n, &count);
+        ss->len = o;
+        ss->data[o] = '\0';
+    }
+    size_t nflags = (((flags & STRADA_ASCII_FLAG) && t->ascii && !cp)
+                     ? STRADA_ASCII_FLAG : _str_flags(ss->data, o) & STRADA_ASCII_FLAG)
+                    | (flags & STRADA_UTF8_FLAG);
+    if (t->ret) return strada_new_str_take_ss(ss, nflags);
+    if (fresh) {
+        *fresh = strada_new_str_take_ss(ss, nflags);
+    } else if (is_str) {
+        strada_str_free_pv(sv);
+        sv->value.pv = ss->data;
+        sv->struct_size = o | nflags;
+    } else {
+        ss_decref(ss);
     }
-
-    free(str);
     return strada_new_int(count);
 }
 
+StradaValue* strada_tr_run(StradaValue *sv, const StradaTr *t) {
+    return strada_tr_exec(sv, t, NULL);
+}
+
+/* tr/// on a variable: like strada_tr_run, but a string value the
+ * variable shares with others is not changed under them — the variable
+ * gets a new value instead, as with strada_concat_inplace. */
+StradaValue* strada_tr_var(StradaValue **svp, const StradaTr *t) {
+    StradaValue *sv = *svp;
+    if (t->ret || !sv || STRADA_IS_TAGGED_INT(sv) || sv->type != STRADA_STR || sv->refcount <= 1)
+        return strada_tr_exec(sv, t, NULL);
+    StradaValue *fresh = NULL;
+    StradaValue *res = strada_tr_exec(sv, t, &fresh);
+    if (fresh) {
+        *svp = fresh;
+        strada_decref(sv);
+    }
+    return res;
+}
+
+StradaValue* strada_tr(StradaValue *sv, const char *search, const char *replace, const char *flags) {
+    if (!search) return strada_new_int(0);
+    StradaTr *t = strada_tr_compile(search, replace, flags);
+    StradaValue *res = strada_tr_run(sv, t);
+    strada_tr_free(t);
+    return res;
+}
+
 /* ============================================================
  * local() - Dynamic scoping for our variables
  * ============================================================ */
@@ -27859,7 +33358,7 @@ int64_t strada_tied_array_push(StradaValue *sv, StradaValue *vals_array) {
         StradaArray *src = vals_array->value.av;
         if (src) {
             for (size_t i = 0; i < src->size; i++) {
-                StradaValue *el = src->elements[src->head + i];
+                StradaValue *el = av_at(src, i);
                 if (el) strada_incref(el);
                 strada_array_push(args_av, el);
             }
@@ -27888,7 +33387,7 @@ int64_t strada_tied_array_unshift(StradaValue *sv, StradaValue *vals_array) {
         StradaArray *src = vals_array->value.av;
         if (src) {
             for (size_t i = 0; i < src->size; i++) {
-                StradaValue *el = src->elements[src->head + i];
+                StradaValue *el = av_at(src, i);
                 if (el) strada_incref(el);
                 strada_array_push(args_av, el);
             }
@@ -27947,7 +33446,7 @@ static StradaValue *strada_tie_invoke(const char *classname, const char *method,
         strada_array_push_take(full->value.av, strada_new_str(classname));
         if (av) {
             for (size_t i = 0; i < av->size; i++) {
-                strada_array_push(full->value.av, av->elements[av->head + i]);
+                strada_array_push(full->value.av, av_at(av, i));
             }
         }
         result = strada_method_dispatch_hook(class_sv, method, full);
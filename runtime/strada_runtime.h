@@ -24,6 +24,9 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <setjmp.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #ifdef HAVE_PCRE2
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
@@ -115,7 +118,23 @@ static inline int64_t strada_floored_mod(int64_t a, int64_t b) {
  * codepoint); when both flags are 0 the string is byte-oriented Latin-1ish. */
 #define STRADA_UTF8_FLAG ((size_t)1 << 62)
 #define STRADA_STR_FLAGS_MASK (STRADA_ASCII_FLAG | STRADA_UTF8_FLAG)
-#define STRADA_STR_BYTELEN(sv) ((sv)->struct_size & ~STRADA_STR_FLAGS_MASK)
+/* Substring view flag: bit 60. A view's value.pv points INTO another
+ * StradaString's data (the root) instead of at a data[] of its own, and the
+ * byte offset from root->data is kept in bits 32..59. Views are only made for
+ * slices that run to the end of the root, so value.pv stays NUL-terminated and
+ * every reader of pv/BYTELEN works unchanged; only code that needs the owning
+ * StradaString (free, share, in-place mutation) must go through
+ * strada_str_owner(). The byte length of a view lives in the low 32 bits; the
+ * encoding has no room for more, so strada_str_suffix() copies suffixes of
+ * 4 GiB or more instead of making a view. */
+#define STRADA_STR_VIEW ((size_t)1 << 60)
+#define STRADA_STR_VIEW_SHIFT 32
+#define STRADA_STR_VIEW_MAX_OFF (((size_t)1 << 28) - 1)
+#define STRADA_STR_VIEW_BITS (STRADA_STR_VIEW | (STRADA_STR_VIEW_MAX_OFF << STRADA_STR_VIEW_SHIFT))
+#define STRADA_STR_IS_VIEW(sv) (((sv)->struct_size & STRADA_STR_VIEW) != 0)
+#define STRADA_STR_VIEW_OFF(sv) (((sv)->struct_size >> STRADA_STR_VIEW_SHIFT) & STRADA_STR_VIEW_MAX_OFF)
+#define STRADA_STR_BYTELEN(sv) ((sv)->struct_size & (STRADA_STR_IS_VIEW(sv) \
+        ? (size_t)UINT32_MAX : ~STRADA_STR_FLAGS_MASK))
 #define STRADA_STR_IS_ASCII(sv) (((sv)->struct_size & STRADA_ASCII_FLAG) != 0)
 #define STRADA_STR_IS_UTF8(sv) (((sv)->struct_size & STRADA_UTF8_FLAG) != 0)
 /* True if either flag implies "treat as chars" (ASCII or UTF-8). */
@@ -183,6 +202,8 @@ typedef struct StradaThreadPool StradaThreadPool;
 struct StradaTask {
     StradaValue *closure;           /* Closure to execute */
     StradaFuture *future;           /* Associated future */
+    void (*fn)(void *arg);          /* Native job (no future) when non-NULL */
+    void *arg;
     struct StradaTask *next;        /* Next task in queue */
 };
 
@@ -290,6 +311,10 @@ StradaValue* strada_channel_select(StradaValue *channels_ref, StradaValue *timeo
 StradaValue* strada_async_sleep(StradaValue *ms_sv);
 StradaValue* strada_async_cancelled(void);
 StradaValue* strada_async_map(StradaValue *fn, StradaValue *items_ref, StradaValue *workers_sv);
+/* par::map / grep / reduce — chunked data parallelism on the thread pool */
+StradaValue* strada_par_map(StradaValue *fn, StradaValue *items_ref);
+StradaValue* strada_par_grep(StradaValue *fn, StradaValue *items_ref);
+StradaValue* strada_par_reduce(StradaValue *fn, StradaValue *items_ref, StradaValue *init);
 /* thread::tls_* — per-thread named values (freed at thread exit) */
 StradaValue* strada_tls_set(StradaValue *name_sv, StradaValue *val);
 StradaValue* strada_tls_get(StradaValue *name_sv);
@@ -387,6 +412,11 @@ typedef struct StradaMetadata {
                               * stores X here and `${*$fh}` reads it.
                               * File::Temp->new stashes the temp filename
                               * in this slot. NULL until first assigned. */
+    void *u8_index;          /* Codepoint index of a long UTF-8 string
+                              * (StradaU8Index, built lazily by substr/
+                              * index/length); NULL until first needed.
+                              * Dropped whenever value.pv is replaced or
+                              * written in place. */
 } StradaMetadata;
 
 /* Main value structure - like Perl's SV (32 bytes) */
@@ -419,9 +449,34 @@ struct StradaArray {
     size_t size;
     size_t capacity;
     int refcount;
+    int kind;       /* STRADA_AV_*: element storage (0 = boxed) */
     size_t head;    /* Offset into elements[] where data starts (for O(1) shift) */
+    StradaValue **boxes;  /* Packed arrays: values lent out by borrowed reads,
+                           * indexed like elements (lazily allocated) */
 };
 
+/* Packed arrays (`my array<int> @a`, core::packed_int_array) keep their
+ * elements unboxed: `elements` then holds int64_t, double or uint8_t
+ * slots. Stores coerce to the element type, reads box on demand (ints
+ * come back tagged). C code that walks `elements` directly must call
+ * strada_array_unpack() first, which turns the array into a plain one. */
+#define STRADA_AV_BOXED 0
+#define STRADA_AV_INT   1
+#define STRADA_AV_NUM   2
+#define STRADA_AV_BYTE  3
+#define STRADA_AV_I64(av) ((int64_t *)(void *)(av)->elements)
+#define STRADA_AV_F64(av) ((double *)(void *)(av)->elements)
+#define STRADA_AV_U8(av)  ((uint8_t *)(void *)(av)->elements)
+void strada_array_unpack_slow(StradaArray *av);
+static inline void strada_array_unpack(StradaArray *av) {
+    if (av && av->kind) strada_array_unpack_slow(av);
+}
+/* Drop the box a packed array lent for slot idx (foreach step) */
+void strada_array_unlend_slow(StradaArray *av, int64_t idx);
+static inline void strada_array_unlend(StradaArray *av, int64_t idx) {
+    if (av && av->boxes) strada_array_unlend_slow(av, idx);
+}
+
 /* Stack-allocated 1-element array for fast method calls.
  * Usage: STRADA_STACK_ARGS1(args, self_val);
  *        method_func(&args.sv);
@@ -438,7 +493,9 @@ static inline void strada_stack_args1_init(StradaStackArgs1 *sa, StradaValue *el
     sa->av.size = 1;
     sa->av.capacity = 1;
     sa->av.refcount = 2;  /* prevent freeing — StradaArray has no incref/decref API */
+    sa->av.kind = 0;
     sa->av.head = 0;
+    sa->av.boxes = NULL;
     sa->sv.type = STRADA_ARRAY;
     sa->sv.value.av = &sa->av;
     /* Immortal sentinel rather than just "2 to prevent freeing":
@@ -471,13 +528,19 @@ static inline void strada_stack_args1_init(StradaStackArgs1 *sa, StradaValue *el
 typedef struct StradaString {
     uint32_t refcount;
     uint32_t hash;              /* cached hash value */
-    uint32_t len;
-    char data[];                /* flexible array member — string bytes inline */
+    uint64_t len;               /* 64-bit: strings may exceed 4 GiB */
+    char data[];                /* flexible array member — string bytes inline,
+                                 * 16-byte aligned */
 } StradaString;
 
 /* StradaString operations */
-StradaString *ss_new(const char *s, uint32_t len, uint32_t hash);
+StradaString *ss_new(const char *s, size_t len, uint32_t hash);
 StradaString *strada_intern_attr_ss(const char *key, unsigned int hash);
+/* Weak intern table: one shared StradaString per distinct short string,
+ * released when its last user goes (new reference returned). */
+StradaString *strada_ss_intern(const char *s, size_t len);
+StradaValue* strada_intern_sv(StradaValue *sv);      /* core::intern */
+int64_t strada_intern_count(void);                   /* core::intern_count */
 char *strada_intern_pkg_name(const char *s);
 void ss_decref_slow(StradaString *ss);  /* handles pool return or free */
 /* Set once when the first thread is created (defined in the runtime).
@@ -520,18 +583,50 @@ static inline void ss_decref(StradaString *ss) {
 /* Allocate a StradaString and return pointer to its data (for use as value.pv).
  * The returned char* is valid for all string ops; to free, use SS_FREE_PV(). */
 static inline char *ss_alloc_pv(const char *s, size_t len) {
-    StradaString *ss = ss_new(s, (uint32_t)len, 0);
+    StradaString *ss = ss_new(s, len, 0);
     return ss->data;
 }
 /* Free a value.pv that was allocated by ss_alloc_pv */
 static inline void ss_free_pv(char *pv) {
     if (pv) ss_decref(SS_FROM_PV(pv));
 }
+/* Small strings (at most STRADA_SSO_MAX bytes) are co-allocated with their
+ * StradaValue: one block holding the value, a StradaString header and the
+ * bytes, with value.pv pointing into it exactly as for a separate string.
+ * The address test below is a positional proof — a separate allocation can
+ * never sit at that interior offset. Embedded bytes die with their value, so
+ * they are never shared: every path that would ss_incref a value's string
+ * (strada_to_str_ss, deref assignment) copies instead, and releasing them is
+ * a no-op. An in-place append that outgrows the block moves the string to
+ * the heap. */
+#define STRADA_SSO_MAX 15
+#define STRADA_STR_IS_EMBEDDED(sv) \
+    ((sv)->value.pv == (char *)(sv) + sizeof(StradaValue) + sizeof(StradaString))
+
+/* The StradaString owning a STR value's bytes: its own, or the root of a
+ * substring view (see STRADA_STR_VIEW). */
+static inline StradaString *strada_str_owner(StradaValue *sv) {
+    if (STRADA_STR_IS_VIEW(sv)) return SS_FROM_PV(sv->value.pv - STRADA_STR_VIEW_OFF(sv));
+    return SS_FROM_PV(sv->value.pv);
+}
+/* Release a STR value's bytes before value.pv is replaced or the value dies.
+ * View-aware replacement for ss_free_pv(sv->value.pv); also clears the view
+ * bits so a new pv stored by the caller is never read as a view, and drops
+ * the codepoint index built for the old bytes. */
+static inline void strada_str_free_pv(StradaValue *sv) {
+    if (sv->value.pv && !STRADA_STR_IS_EMBEDDED(sv)) ss_decref(strada_str_owner(sv));
+    sv->struct_size &= ~STRADA_STR_VIEW_BITS;
+    if (sv->meta && sv->meta->u8_index) {
+        free(sv->meta->u8_index);
+        sv->meta->u8_index = NULL;
+    }
+}
 
-/* Open-addressing hash table with linear probing in hash_index,
- * separate ordered entries array for iteration */
-#define HASH_EMPTY     UINT32_MAX
-#define HASH_TOMBSTONE (UINT32_MAX - 1)
+/* Open-addressing hash table, Swiss-table style: buckets come in groups
+ * of 16, each group one control byte per bucket (scanned with a single
+ * compare) followed by each bucket's slot in the separate
+ * insertion-ordered entries array used for iteration. */
+#define HASH_EMPTY     UINT32_MAX   /* free list end */
 
 /* Hash entry — key is a refcounted StradaString */
 typedef struct StradaHashEntry {
@@ -543,20 +638,78 @@ typedef struct StradaHashEntry {
 /* Hash structure - like Perl's HV */
 struct StradaHash {
     StradaHashEntry *entries;   /* contiguous entry array (insertion order) */
-    uint32_t *hash_index;       /* open-addressing table: entry index, HASH_EMPTY, or HASH_TOMBSTONE */
-    size_t num_buckets;         /* hash_index size (power of 2) */
+    uint8_t *ctrl;              /* bucket groups: 16 control bytes (STRADA_HV_*)
+                                 * then 16 uint32 entries[] slots each */
+    size_t num_buckets;         /* bucket count (power of 2) */
     size_t num_entries;         /* live entries */
     size_t capacity;            /* allocated entries array size */
     size_t next_slot;           /* next append position */
-    size_t num_tombstones;      /* tombstone count in hash_index */
+    size_t num_tombstones;      /* STRADA_HV_DELETED count in ctrl */
     uint32_t free_head;         /* internal free list head (HASH_EMPTY = none) */
     int refcount;
     size_t iter_index;          /* for each() */
     uint8_t index_dirty;        /* set when cross-boundary dispatch may have desynced
-                                 * hash_index from entries[]; when 0, hash_linear_find
+                                 * the index from entries[]; when 0, hash_linear_find
                                  * short-circuits (clean hashes never need a full scan). */
 };
 
+/* Control bytes. A live bucket holds its key's 7-bit tag (strada_hv_tag);
+ * free buckets have the top bit set. Bucket b lives in group b/16, which
+ * keeps its control bytes and slots together so a hit touches one
+ * 80-byte block rather than two arrays. A table smaller than a group
+ * still gets 16 control bytes, the tail ones permanently EMPTY, so a
+ * probe never reads past the block. Lookups start at group
+ * strada_hv_group0, step 1, 2, 3... groups further (triangular, so every
+ * group is reached) and stop at the first group holding an EMPTY byte. */
+#define STRADA_HV_GROUP   16
+#define STRADA_HV_GROUP_BYTES (STRADA_HV_GROUP * (1 + sizeof(uint32_t)))
+#define STRADA_HV_EMPTY   0x80
+#define STRADA_HV_DELETED 0xFE
+
+/* Group holding bucket pos, and that group's entries[] slots */
+static inline uint8_t *strada_hv_grp(const StradaHash *hv, size_t pos) {
+    return hv->ctrl + (pos / STRADA_HV_GROUP) * STRADA_HV_GROUP_BYTES;
+}
+static inline uint32_t *strada_hv_slots(uint8_t *g) {
+    return (uint32_t *)(g + STRADA_HV_GROUP);
+}
+
+/* 7-bit tag of a key hash: the top bits of a multiplicative mix, so it
+ * depends on every hash bit and not on the ones that pick the group */
+static inline uint8_t strada_hv_tag(unsigned int hash) {
+    return (uint8_t)(((uint32_t)hash * 0x9E3779B1U) >> 25);
+}
+
+/* First bucket of the first group probed for a key hash. The low hash
+ * bits pick it, as the linear-probing index did, so keys with nearby
+ * hashes keep nearby buckets. */
+static inline size_t strada_hv_group0(const StradaHash *hv, unsigned int hash) {
+    return (size_t)hash & (hv->num_buckets - 1) & ~(size_t)(STRADA_HV_GROUP - 1);
+}
+
+/* Bit i set when group byte i equals b */
+static inline uint32_t strada_hv_match(const uint8_t *g, uint8_t b) {
+#if defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)g);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)b)));
+#else
+    uint32_t m = 0;
+    for (int i = 0; i < STRADA_HV_GROUP; i++) m |= (uint32_t)(g[i] == b) << i;
+    return m;
+#endif
+}
+
+/* Bit i set when group byte i is EMPTY or DELETED */
+static inline uint32_t strada_hv_match_free(const uint8_t *g) {
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)g));
+#else
+    uint32_t m = 0;
+    for (int i = 0; i < STRADA_HV_GROUP; i++) m |= (uint32_t)(g[i] >> 7) << i;
+    return m;
+#endif
+}
+
 /* Mark a hash's index as possibly out-of-sync with entries[]. Subsequent
  * probes will fall back to a linear scan + rebuild. Call this at the point
  * where dispatch crosses a dlopen boundary or wherever the index may have
@@ -693,11 +846,39 @@ static inline __attribute__((always_inline)) void strada_break_self_cycle(Strada
     strada_break_self_cycle_impl(sv);
 }
 #endif
+/* Numeric read of $a[idx] without materializing the element: packed
+ * slots are read raw, boxed ones coerced; holes and out-of-range are 0. */
+static inline double strada_array_num_at(StradaArray *av, int64_t idx) {
+    if (!av) return 0.0;
+    if (idx < 0) idx += (int64_t)av->size;
+    if (idx < 0 || (size_t)idx >= av->size) return 0.0;
+    size_t p = av->head + (size_t)idx;
+    switch (av->kind) {
+    case STRADA_AV_INT: return (double)STRADA_AV_I64(av)[p];
+    case STRADA_AV_NUM: return STRADA_AV_F64(av)[p];
+    case STRADA_AV_BYTE: return (double)STRADA_AV_U8(av)[p];
+    }
+    return av->elements[p] ? strada_to_num(av->elements[p]) : 0.0;
+}
+static inline int64_t strada_array_int_at(StradaArray *av, int64_t idx) {
+    if (!av) return 0;
+    if (idx < 0) idx += (int64_t)av->size;
+    if (idx < 0 || (size_t)idx >= av->size) return 0;
+    size_t p = av->head + (size_t)idx;
+    switch (av->kind) {
+    case STRADA_AV_INT: return STRADA_AV_I64(av)[p];
+    case STRADA_AV_NUM: return (int64_t)STRADA_AV_F64(av)[p];
+    case STRADA_AV_BYTE: return STRADA_AV_U8(av)[p];
+    }
+    return av->elements[p] ? strada_to_int(av->elements[p]) : 0;
+}
 char* strada_to_str(StradaValue *sv);    /* Returns strdup'd char* — free with free() (backward compat) */
 char* strada_to_str_ss(StradaValue *sv); /* Returns StradaString-backed char* — free with strada_cstr_free() */
 void strada_cstr_free(char *s);          /* Free a strada_to_str_ss() result (handles both SS and malloc'd) */
 const char* strada_to_str_buf(StradaValue *sv, char *buf, size_t buflen);  /* Non-allocating variant */
 int strada_to_bool(StradaValue *sv);
+int strada_double_to_str(double v, char *buf);             /* Perl-style number text; buf >= 32 bytes */
+double strada_str_to_double(const char *s, size_t len);   /* Exact decimal parse of s[0..len) */
 
 /* ===== Memory-management features (compile-time: STRADA_CYCLE_GC / STRADA_ARENA) =====
  * These symbols are ALWAYS declared and ALWAYS defined in strada_runtime.c — as
@@ -753,10 +934,17 @@ int64_t strada_get_array_default_capacity(void);
 void strada_set_array_default_capacity(int64_t capacity);
 void strada_array_reserve(StradaArray *av, size_t capacity);
 void strada_reserve_sv(StradaValue *sv, int64_t capacity);
+void strada_array_shrink(StradaArray *av);
+void strada_shrink_to_fit_sv(StradaValue *sv);
+void strada_array_insert_av(StradaArray *av, size_t at, StradaArray *src);
+void strada_array_append_av(StradaArray *av, StradaArray *src);
+void strada_array_prepend_av(StradaArray *av, StradaArray *src);
 int64_t strada_size(StradaValue *sv);
 StradaValue* strada_new_array_from_av(StradaArray *av);
 StradaValue* strada_sort(StradaValue *arr);   /* Sort array alphabetically */
 StradaValue* strada_nsort(StradaValue *arr);  /* Sort array numerically */
+StradaValue* strada_sort_par(StradaValue *arr, StradaValue *cmp);  /* sort_par { ... } @arr */
+void strada_keysort(StradaValue *result, const char *spec, StradaValue **cols);  /* sort { KEY($a) <=> KEY($b) } */
 StradaValue* strada_range(StradaValue *start, StradaValue *end);  /* Create array from range */
 
 /* Hash operations */
@@ -777,6 +965,7 @@ StradaValue **strada_hv_fetch_lvalue_sv(StradaValue *sv, const char *key, int au
  * strdup. Returns NULL for tied/non-hash sv (caller falls back). */
 StradaValue **strada_hv_fetch_lvalue_sv_key(StradaValue *sv, StradaValue *key_sv, int autoviv);
 void strada_hash_set_ss_take(StradaHash *hv, StradaString *key_ss, StradaValue *sv);
+void strada_hash_set_interned(StradaHash *hv, const char *key, size_t len, StradaValue *sv);  /* takes sv, interns key */
 StradaValue* strada_hash_get(StradaHash *hv, const char *key);
 StradaValue* strada_autoviv_hash(StradaValue *sv, const char *key);
 StradaValue* strada_autoviv_array(StradaValue *sv, const char *key);
@@ -810,6 +999,8 @@ size_t strada_length_sv(StradaValue *sv); /* Binary-safe length using struct_siz
 size_t strada_bytes(const char *s);       /* Returns byte count */
 StradaValue* strada_char_at(StradaValue *str, StradaValue *index);  /* Fast char code by index */
 StradaValue* strada_byte_at(StradaValue *str, StradaValue *index);  /* Preferred alias for char_at */
+StradaValue* strada_lex_scan(StradaValue *lexer, StradaValue *tokens, StradaValue *word_types);  /* Native scanner behind lex_tokenize */
+StradaValue* sys_lex_scan(StradaValue *lexer, StradaValue *tokens, StradaValue *word_types);     /* alias used by bootstrap codegen */
 StradaValue* strada_idiv(StradaValue *a, StradaValue *b);           /* Integer division (truncated) */
 StradaValue* strada_substr(StradaValue *str, int64_t offset, int64_t length);
 StradaValue* strada_substr_bytes(StradaValue *str, int64_t offset, int64_t length);
@@ -818,12 +1009,28 @@ StradaValue* strada_substr_replace(StradaValue *str, int64_t offset, int64_t len
 int strada_index(const char *haystack, const char *needle);
 int64_t strada_index_sv(StradaValue *haystack_sv, const char *needle);
 int64_t strada_index_sv2(StradaValue *haystack_sv, StradaValue *needle_sv, int64_t offset);
+int64_t strada_rindex_sv(StradaValue *haystack_sv, StradaValue *needle_sv);
+/* Precompiled literal searcher: one needle, or several searched at once
+ * (leftmost match wins, ties go to the earlier needle). Generated code
+ * builds one per literal index()/split() call site and keeps it. */
+typedef struct StradaSearcher StradaSearcher;
+StradaSearcher *strada_searcher_new(const char *needle, size_t len);
+StradaSearcher *strada_searcher_new_multi(size_t count, const char *const *needles, const size_t *lens);
+void strada_searcher_free(StradaSearcher *s);
+StradaSearcher *strada_searcher_publish(StradaSearcher **slot, StradaSearcher *s);
+/* Read a call site's searcher slot; pairs with strada_searcher_publish. */
+#define STRADA_SEARCHER_CACHED(slot) __atomic_load_n(&(slot), __ATOMIC_ACQUIRE)
+int64_t strada_index_searcher(StradaValue *haystack_sv, StradaSearcher *s, int64_t offset);
+int64_t strada_index_any(StradaValue *haystack_sv, StradaValue *needles_sv, int64_t offset);
+StradaArray* strada_split_searcher(StradaValue *str_sv, StradaSearcher *s);
 int strada_index_offset(const char *haystack, const char *needle, int offset);
 int strada_rindex(const char *haystack, const char *needle);
 char* strada_upper(const char *str);
 char* strada_lower(const char *str);
 char* strada_uc(const char *str);  /* Alias for upper */
 char* strada_lc(const char *str);  /* Alias for lower */
+StradaValue* strada_uc_sv(StradaValue *sv);  /* uc()/lc() on a value, binary-safe */
+StradaValue* strada_lc_sv(StradaValue *sv);
 char* strada_ucfirst(const char *str);
 char* strada_lcfirst(const char *str);
 /* ASCII-only case mapping (a-z<->A-Z, bytes >=128 untouched) — used for
@@ -859,6 +1066,13 @@ StradaValue* strada_base64_encode(StradaValue *sv);  /* Encode string to base64
 StradaValue* strada_base64_decode(StradaValue *sv);  /* Decode base64 to string */
 StradaValue* strada_hex(StradaValue *sv);  /* Convert hex string to integer: hex("ff") -> 255 */
 StradaValue* strada_array_copy(StradaValue *src);  /* Deep copy array: new array with incref'd elements */
+StradaValue* strada_array_copy_kind(StradaValue *src, int kind);
+void strada_array_pack(StradaValue *sv, int kind);      /* Convert to packed STRADA_AV_* storage in place */
+StradaValue* strada_packed_array_new(int kind, int64_t n); /* n zeroed packed slots */
+int strada_packed_kind(StradaValue *sv);
+StradaValue* strada_list_sum(StradaValue *sv);
+StradaValue* strada_list_min(StradaValue *sv);
+StradaValue* strada_list_max(StradaValue *sv);
 char* strada_chomp(const char *str);
 char* strada_chop(const char *str);
 int strada_strcmp(const char *s1, const char *s2);
@@ -876,6 +1090,76 @@ StradaValue* strada_sb_length(StradaValue *sb);                /* Get current le
 void strada_sb_clear(StradaValue *sb);                         /* Clear buffer */
 void strada_sb_free(StradaValue *sb);                          /* Free StringBuilder */
 
+/* Native collections behind lib/Collections (Set, Deque, Heap, OrderedMap).
+ * Each returns an owned value; self is the blessed container ref. */
+StradaValue* strada_coll_set_new(StradaValue *items);
+StradaValue* strada_coll_set_add(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_set_remove(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_set_contains(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_set_size(StradaValue *self);
+StradaValue* strada_coll_set_clear(StradaValue *self);
+StradaValue* strada_coll_set_members(StradaValue *self);
+StradaValue* strada_coll_set_algebra(StradaValue *self, StradaValue *other, int op);
+StradaValue* strada_coll_set_common(StradaValue *self, StradaValue *other);
+StradaValue* strada_coll_deque_new(StradaValue *items);
+StradaValue* strada_coll_deque_push_back(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_deque_push_front(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_deque_pop_back(StradaValue *self);
+StradaValue* strada_coll_deque_pop_front(StradaValue *self);
+StradaValue* strada_coll_deque_get(StradaValue *self, StradaValue *index);
+StradaValue* strada_coll_deque_set(StradaValue *self, StradaValue *index, StradaValue *v);
+StradaValue* strada_coll_deque_size(StradaValue *self);
+StradaValue* strada_coll_deque_clear(StradaValue *self);
+StradaValue* strada_coll_deque_to_array(StradaValue *self);
+StradaValue* strada_coll_heap_new(int max, StradaValue *cmp);
+StradaValue* strada_coll_heap_push(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_heap_insert(StradaValue *self, StradaValue *prio, StradaValue *v);
+StradaValue* strada_coll_heap_pop(StradaValue *self);
+StradaValue* strada_coll_heap_peek(StradaValue *self);
+StradaValue* strada_coll_heap_peek_priority(StradaValue *self);
+StradaValue* strada_coll_heap_size(StradaValue *self);
+StradaValue* strada_coll_heap_clear(StradaValue *self);
+StradaValue* strada_coll_omap_new(int numeric);
+StradaValue* strada_coll_omap_set(StradaValue *self, StradaValue *key, StradaValue *v);
+StradaValue* strada_coll_omap_get(StradaValue *self, StradaValue *key);
+StradaValue* strada_coll_omap_contains(StradaValue *self, StradaValue *key);
+StradaValue* strada_coll_omap_remove(StradaValue *self, StradaValue *key);
+StradaValue* strada_coll_omap_end_key(StradaValue *self, int which);
+StradaValue* strada_coll_omap_near_key(StradaValue *self, StradaValue *key, int which);
+StradaValue* strada_coll_omap_range(StradaValue *self, StradaValue *lo, StradaValue *hi, int what);
+StradaValue* strada_coll_omap_size(StradaValue *self);
+StradaValue* strada_coll_omap_clear(StradaValue *self);
+int strada_coll_free(const char *kind, void *p, int release);
+
+/* Lazy iterators (iter::) */
+int strada_iter_step(StradaValue *self, StradaValue **out);
+StradaValue* strada_iter_advance(StradaValue *self);
+StradaValue* strada_iter_of(StradaValue *sv);
+StradaValue* strada_iter_range(StradaValue *lo, StradaValue *hi);
+StradaValue* strada_iter_from_array(StradaValue *arr);
+StradaValue* strada_iter_lines(StradaValue *src);
+StradaValue* strada_iter_from_fn(StradaValue *fn);
+StradaValue* strada_iter_map(StradaValue *src, StradaValue *fn);
+StradaValue* strada_iter_grep(StradaValue *src, StradaValue *fn);
+StradaValue* strada_iter_take(StradaValue *src, StradaValue *n);
+StradaValue* strada_iter_next(StradaValue *self);
+StradaValue* strada_iter_collect(StradaValue *self);
+int strada_iter_free(const char *kind, void *p, int release);
+StradaValue* strada_sketch_bloom_new(StradaValue *capacity, StradaValue *fp_rate);
+StradaValue* strada_sketch_bloom_add(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_bloom_contains(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_hll_new(StradaValue *precision);
+StradaValue* strada_sketch_hll_add(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_cms_new(StradaValue *epsilon, StradaValue *delta);
+StradaValue* strada_sketch_cms_add(StradaValue *self, StradaValue *key, StradaValue *count);
+StradaValue* strada_sketch_cms_estimate(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_count(StradaValue *self);
+StradaValue* strada_sketch_merge(StradaValue *self, StradaValue *other);
+StradaValue* strada_sketch_info(StradaValue *self);
+StradaValue* strada_sketch_serialize(StradaValue *self);
+StradaValue* strada_sketch_deserialize(StradaValue *bytes);
+int strada_sketch_free(const char *kind, void *p);
+
 /* I/O functions */
 void strada_print(StradaValue *sv);
 void strada_say(StradaValue *sv);
@@ -889,6 +1173,13 @@ void strada_printf(const char *format, ...);
 StradaValue* strada_sprintf(const char *format, ...);
 StradaValue* strada_sprintf_sv(StradaValue *format_sv, int arg_count, ...);
 StradaValue* strada_sprintf_sv_arr(StradaValue *format_sv, StradaValue *args_sv);
+/* Streaming sprintf/join: format straight into a handle (NULL = default
+ * output; newline=1 for say) or append to a string/StringBuilder in place
+ * (ownership as strada_concat_inplace), with no intermediate string. */
+void strada_printf_fh(StradaValue *fh, int newline, StradaValue *format_sv, int arg_count, ...);
+StradaValue* strada_sprintf_append(StradaValue *dst, StradaValue *format_sv, int arg_count, ...);
+void strada_join_to(StradaValue *fh, int newline, StradaValue *sep_sv, StradaArray *arr);
+StradaValue* strada_join_append(StradaValue *dst, StradaValue *sep_sv, StradaArray *arr);
 void strada_warn(const char *format, ...);
 
 /* File I/O functions */
@@ -935,6 +1226,7 @@ const char* strada_caller(int level);
 typedef struct {
     jmp_buf buf;
     int active;
+    int builtin;    /* entered via __builtin_setjmp (STRADA_TRY_ENTER) */
 } StradaTryContext;
 
 /* THREAD-LOCAL (see runtime): per-thread try frames + exception slots. */
@@ -1009,9 +1301,28 @@ void strada_cleanup_drain_to(int mark); /* Drain to depth (with decref) */
 
 /* Macros for try/catch - used by generated code */
 #define STRADA_TRY_PUSH() (strada_try_depth < STRADA_MAX_TRY_DEPTH ? \
-    (strada_try_stack[strada_try_depth].active = 1, &strada_try_stack[strada_try_depth++].buf) : NULL)
+    (strada_try_stack[strada_try_depth].active = 1, strada_try_stack[strada_try_depth].builtin = 0, \
+     &strada_try_stack[strada_try_depth++].buf) : NULL)
 #define STRADA_TRY_POP() (strada_try_depth > 0 ? (strada_try_stack[--strada_try_depth].active = 0, 1) : 0)
 
+/* Try entry used by generated code: true on the normal path, false when a
+ * throw lands here. On gcc it is __builtin_setjmp — a few stores (frame and
+ * stack pointer, resume label) and no libc call or signal-mask save, so
+ * entering a try in a hot loop costs next to nothing until something throws.
+ * The matching __builtin_longjmp sits in a noinline runtime helper, which
+ * keeps it out of the function holding the setjmp as gcc requires. Other
+ * compilers get the portable setjmp frame. */
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__TINYC__)
+#define STRADA_TRY_ENTER() __extension__ ({ \
+    if (strada_try_depth >= STRADA_MAX_TRY_DEPTH) \
+        strada_die("try blocks nested deeper than %d", STRADA_MAX_TRY_DEPTH); \
+    StradaTryContext *__tc = &strada_try_stack[strada_try_depth++]; \
+    __tc->active = 1; __tc->builtin = 1; \
+    __builtin_setjmp((void **)__tc->buf) == 0; })
+#else
+#define STRADA_TRY_ENTER() (setjmp(*STRADA_TRY_PUSH()) == 0)
+#endif
+
 /* Call stack for stack traces */
 #define STRADA_MAX_CALL_DEPTH 256
 typedef struct {
@@ -1064,6 +1375,38 @@ static inline void strada_stack_pop_il(void) {
 static inline void strada_stack_line_il(int line) {
     strada_call_stack[strada_call_depth].line = line;
 }
+
+/* Unwind-mode traces (stradac --stack-trace=unwind): no per-call
+ * bookkeeping at all. Each function entry and call site drops an assembler
+ * label plus a {pc, line, function} record into a per-module section
+ * (STRADA_TRACE_SECTION, #defined by the generated file); nothing executes
+ * at runtime. A constructor hands the section bounds and the module's
+ * function-name table to strada_trace_register, and the trace functions
+ * rebuild frames from backtrace() return addresses on demand — the nearest
+ * record at or below each return address, if it lies in the same machine
+ * function. */
+typedef struct {
+    int32_t pc_rel;          /* label address, relative to this field */
+    int32_t line;            /* Strada line of the call (0 = function entry) */
+    int32_t func;            /* index into the module's StradaTraceFunc table */
+} StradaTraceLine;
+typedef struct {
+    const char *func_name;
+    const char *file_name;
+} StradaTraceFunc;
+void strada_trace_register(const StradaTraceFunc *funcs, int nfuncs,
+                           const StradaTraceLine *start, const StradaTraceLine *end);
+/* asm inline: the inliner sizes the record as one instruction rather than
+ * by its line count, so it doesn't change gcc's inlining decisions. */
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9
+#define STRADA_TRACE_ASM __asm__ volatile __inline__
+#else
+#define STRADA_TRACE_ASM __asm__ volatile
+#endif
+#define STRADA_TRACE_LINE(line, func) ({ STRADA_TRACE_ASM( \
+    "771:\n\t.pushsection " STRADA_TRACE_SECTION ",\"a\"\n\t.balign 4\n" \
+    "\t.long 771b - .\n\t.long " #line "\n\t.long " #func "\n\t.popsection" ::: "memory"); })
+
 StradaValue* strada_caller_info(StradaValue *level);
 void strada_print_stack_trace(FILE *out);
 char* strada_capture_stack_trace(void);
@@ -1865,6 +2208,11 @@ void strada_profile_init(void);
 void strada_profile_enter(const char *func_name);
 void strada_profile_exit(const char *func_name);
 void strada_profile_report(void);
+/* PGO training: when set, strada_profile_report merges per-function call
+ * counts into this file (tab-separated, one function per line) instead of
+ * printing the table. Read back by `stradac --pgo-use`. */
+void strada_profile_set_output(const char *path);
+void strada_profile_declare(const char *const *names, int count);
 
 /* ============================================================
  * Full Profiling - Line-level timing (NYTProf-style)
@@ -1895,6 +2243,7 @@ void strada_memprof_enable(void);
 void strada_memprof_disable(void);
 void strada_memprof_report(void);
 void strada_memprof_reset(void);
+StradaValue* strada_mem_stats(StradaValue *target);
 
 /* ============================================================
  * String Repetition (x operator)
@@ -1922,6 +2271,14 @@ StradaValue* strada_select_get(void);
  * Transliteration (tr///)
  * ============================================================ */
 StradaValue* strada_tr(StradaValue *sv, const char *search, const char *replace, const char *flags);
+/* tr/// compiled once per call site: strada_tr_run returns the count, or
+ * the new string with /r; strada_tr_var also gives a variable sharing its
+ * value a new one. strada_tr compiles, runs and frees. */
+typedef struct StradaTr StradaTr;
+StradaTr *strada_tr_compile(const char *search, const char *replace, const char *flags);
+StradaValue* strada_tr_run(StradaValue *sv, const StradaTr *t);
+StradaValue* strada_tr_var(StradaValue **svp, const StradaTr *t);  /* $var =~ tr */
+void strada_tr_free(StradaTr *t);
 
 /* ============================================================
  * local() - Dynamic scoping for our variables
@@ -2014,6 +2371,7 @@ static inline int strada_av_exists_sv(StradaValue *sv, int64_t idx) {
     int64_t len = (int64_t)strada_array_length(av);
     if (idx < 0) idx += len;
     if (idx < 0 || idx >= len) return 0;
+    if (av->kind) return 1;
     StradaValue *el = av->elements[av->head + idx];
     return el != NULL;
 }
@@ -2070,12 +2428,12 @@ static inline StradaValue* strada_hv_fetch_owned_ph(StradaValue *sv, const char
  * incref/decref. Used by inline int accessors (e.g. $self->x()) where the
  * accessor's has-attr is declared int. Returns 0 for missing/undef keys.
  *
- * Hot-path streamlined: probe the first bucket inline. The vast majority
- * of fetches on a clean (no-tombstones, no-index-dirty) hash hit on the
- * first probe — we can check that without leaving the inline body, which
- * lets gcc keep the whole `$self->x()` chain in registers under -O3+LTO.
- * Falls back to strada_hash_get_with_hash for collisions / tombstones /
- * dirty index, which is far slower but rare. */
+ * Hot-path streamlined: try the key's home bucket (inserts take it when
+ * free), then the rest of the first group. Object hashes are a single
+ * group, so nearly every fetch resolves here without leaving the inline
+ * body, which lets gcc keep the whole `$self->x()` chain in registers
+ * under -O3+LTO. Falls back to strada_hash_get_with_hash for a key past
+ * the first group, a miss, or a dirty index. */
 static inline __attribute__((always_inline)) int64_t strada_hv_fetch_int_ph(StradaValue *sv, const char *key, unsigned int hash) {
     if (STRADA_IS_TAGGED_INT(sv)) return 0;
     if (__builtin_expect(sv->meta && sv->meta->is_tied, 0)) {
@@ -2086,21 +2444,28 @@ static inline __attribute__((always_inline)) int64_t strada_hv_fetch_int_ph(Stra
     }
     StradaHash *hv = strada_deref_hash(sv);
     if (__builtin_expect(hv != NULL, 1)) {
-        uint32_t pos = hash & (hv->num_buckets - 1);
-        uint32_t idx = hv->hash_index[pos];
-        if (__builtin_expect(idx < HASH_TOMBSTONE, 1)) {
-            StradaHashEntry *e = &hv->entries[idx];
-            /* Hash alone is not sufficient — DJB2 is 32-bit and two
-             * distinct attribute names can collide; we also need to
-             * confirm the key content matches. strcmp on short attribute
-             * names lowers to a handful of cmp/branch insns when `key`
-             * is a string literal, so the fast path stays cheap. */
-            if (__builtin_expect(e->key && e->key->hash == hash && strcmp(e->key->data, key) == 0, 1)) {
+        size_t home = (size_t)hash & (hv->num_buckets - 1);
+        uint8_t *g = strada_hv_grp(hv, home);
+        unsigned hi = (unsigned)(home & (STRADA_HV_GROUP - 1));
+        /* Hash alone is not sufficient — DJB2 is 32-bit and two
+         * distinct attribute names can collide; we also need to
+         * confirm the key content matches. strcmp on short attribute
+         * names lowers to a handful of cmp/branch insns when `key`
+         * is a string literal, so the fast path stays cheap. */
+        if (__builtin_expect(g[hi] < STRADA_HV_EMPTY, 1)) {
+            StradaHashEntry *e = &hv->entries[strada_hv_slots(g)[hi]];
+            if (__builtin_expect(e->key->hash == hash && strcmp(e->key->data, key) == 0, 1))
+                return strada_to_int(e->value);
+        }
+        uint32_t m = strada_hv_match(g, strada_hv_tag(hash)) & ~(1u << hi);
+        while (m) {
+            StradaHashEntry *e = &hv->entries[strada_hv_slots(g)[__builtin_ctz(m)]];
+            if (e->key->hash == hash && strcmp(e->key->data, key) == 0)
                 return strada_to_int(e->value);
-            }
+            m &= m - 1;
         }
     }
-    /* Slow path: collision, tombstone, or dirty index. */
+    /* Slow path: key outside the first group, absent, or dirty index. */
     StradaValue *v = strada_hash_get_with_hash(hv, key, hash);
     return strada_to_int(v);
 }
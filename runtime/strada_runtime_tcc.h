@@ -67,7 +67,12 @@ static inline int64_t strada_floored_mod(int64_t a, int64_t b) {
 /* ASCII string flag: bit 63 of struct_size. When set, the string is pure ASCII
  * and byte offset == char offset, making substr() O(1). */
 #define STRADA_ASCII_FLAG ((size_t)1 << 63)
-#define STRADA_STR_BYTELEN(sv) ((sv)->struct_size & ~STRADA_ASCII_FLAG)
+/* Substring views (bit 60, offset in bits 32..59) — mirrors strada_runtime.h.
+ * BYTELEN also masks the UTF-8 flag (bit 62), as the main header does. */
+#define STRADA_STR_VIEW ((size_t)1 << 60)
+#define STRADA_STR_IS_VIEW(sv) (((sv)->struct_size & STRADA_STR_VIEW) != 0)
+#define STRADA_STR_BYTELEN(sv) ((sv)->struct_size & (STRADA_STR_IS_VIEW(sv) \
+        ? (size_t)UINT32_MAX : ~(STRADA_ASCII_FLAG | ((size_t)1 << 62))))
 #define STRADA_STR_IS_ASCII(sv) (((sv)->struct_size & STRADA_ASCII_FLAG) != 0)
 
 #if STRADA_POINTER_SIZE == 4
@@ -128,6 +133,7 @@ typedef struct StradaMetadata {
     int32_t regex_pos;
     void *locked_keys;
     StradaValue *glob_scalar_slot;
+    void *u8_index;
 } StradaMetadata;
 
 /* Value structure - core of Strada runtime (32 bytes) */
@@ -156,17 +162,38 @@ struct StradaArray {
     size_t size;
     size_t capacity;
     int refcount;
+    int kind;       /* STRADA_AV_*: element storage (0 = boxed) */
     size_t head;    /* Offset into elements[] where data starts (for O(1) shift) */
+    StradaValue **boxes;  /* Packed arrays: values lent out by borrowed reads,
+                           * indexed like elements (lazily allocated) */
 };
 
+/* Packed array kinds (see strada_runtime.h) */
+#define STRADA_AV_BOXED 0
+#define STRADA_AV_INT   1
+#define STRADA_AV_NUM   2
+#define STRADA_AV_BYTE  3
+#define STRADA_AV_I64(av) ((int64_t *)(void *)(av)->elements)
+#define STRADA_AV_F64(av) ((double *)(void *)(av)->elements)
+#define STRADA_AV_U8(av)  ((uint8_t *)(void *)(av)->elements)
+void strada_array_unpack_slow(StradaArray *av);
+static inline void strada_array_unpack(StradaArray *av) {
+    if (av && av->kind) strada_array_unpack_slow(av);
+}
+/* Drop the box a packed array lent for slot idx (foreach step) */
+void strada_array_unlend_slow(StradaArray *av, int64_t idx);
+static inline void strada_array_unlend(StradaArray *av, int64_t idx) {
+    if (av && av->boxes) strada_array_unlend_slow(av, idx);
+}
+
 /* Refcounted string */
 typedef struct StradaString {
     uint32_t refcount;
     uint32_t hash;
-    uint32_t len;
+    uint64_t len;
     char data[];
 } StradaString;
-StradaString *ss_new(const char *s, uint32_t len, uint32_t hash);
+StradaString *ss_new(const char *s, size_t len, uint32_t hash);
 /* Exported runtime functions (threading-safe: atomic refcounts when
  * threads are active). tcc code must NOT inline these — tcc's __sync
  * builtin support is unreliable, so always call the runtime symbols. */
@@ -176,9 +203,8 @@ void ss_decref_slow(StradaString *ss);
 /* Recover the StradaString header from a value.pv (= &ss->data). */
 #define SS_FROM_PV(pv) ((StradaString*)((char*)(pv) - sizeof(StradaString)))
 
-/* Open-addressing hash table */
-#define HASH_EMPTY     UINT32_MAX
-#define HASH_TOMBSTONE (UINT32_MAX - 1)
+/* Open-addressing hash table (control bytes + entry index) */
+#define HASH_EMPTY     UINT32_MAX   /* free list end */
 
 struct StradaHashEntry {
     StradaString *key;          /* NULL = free/deleted slot */
@@ -189,12 +215,12 @@ struct StradaHashEntry {
 /* Hash structure - like Perl's HV */
 struct StradaHash {
     StradaHashEntry *entries;   /* contiguous entry array (insertion order) */
-    uint32_t *hash_index;       /* open-addressing table */
-    size_t num_buckets;         /* hash_index size (power of 2) */
+    uint8_t *ctrl;              /* bucket groups: control bytes + entry slots */
+    size_t num_buckets;         /* bucket count (power of 2) */
     size_t num_entries;         /* live entries */
     size_t capacity;            /* allocated entries array size */
     size_t next_slot;           /* next append position */
-    size_t num_tombstones;      /* tombstone count in hash_index */
+    size_t num_tombstones;      /* deleted-bucket count in ctrl */
     uint32_t free_head;         /* internal free list head (HASH_EMPTY = none) */
     int refcount;
     size_t iter_index;          /* for each() */
@@ -216,6 +242,7 @@ struct StradaHash {
 typedef struct {
     jmp_buf buf;
     int active;
+    int builtin;
 } StradaTryContext;
 
 /* The try stack is thread-local in the runtime; tcc-compiled code must
@@ -257,6 +284,7 @@ extern int (*strada_die_continue_hook)(void);
 
 #define STRADA_TRY_PUSH() strada_try_push_slot()
 #define STRADA_TRY_POP()   strada_try_pop_slot()
+#define STRADA_TRY_ENTER() (setjmp(*STRADA_TRY_PUSH()) == 0)
 
 /* ============================================================
  * Value Creation
@@ -280,6 +308,9 @@ StradaValue* strada_new_hash_presized(int capacity);
 StradaValue* strada_anon_hash_ph(int count, ...);
 StradaValue* strada_anon_hash_take_ph(int count, ...);
 StradaString *strada_intern_attr_ss(const char *key, unsigned int hash);
+StradaString *strada_ss_intern(const char *s, size_t len);
+StradaValue* strada_intern_sv(StradaValue *sv);
+int64_t strada_intern_count(void);
 StradaValue* strada_new_hash_with_capacity(size_t capacity);
 StradaValue* strada_new_filehandle(FILE *fh);
 StradaValue* strada_new_ref(StradaValue *target, char ref_type);
@@ -307,6 +338,8 @@ double strada_to_num(StradaValue *sv);
 char* strada_to_str(StradaValue *sv);  /* Returns malloc'd string - caller must free */
 const char* strada_to_str_buf(StradaValue *sv, char *buf, size_t buflen);  /* Non-allocating variant */
 int strada_to_bool(StradaValue *sv);
+int strada_double_to_str(double v, char *buf);             /* Perl-style number text; buf >= 32 bytes */
+double strada_str_to_double(const char *s, size_t len);   /* Exact decimal parse of s[0..len) */
 
 /* C type conversions */
 int8_t strada_to_int8(StradaValue *sv);
@@ -383,6 +416,8 @@ char* strada_upper(const char *str);
 char* strada_lower(const char *str);
 char* strada_uc(const char *str);
 char* strada_lc(const char *str);
+StradaValue* strada_uc_sv(StradaValue *sv);  /* uc()/lc() on a value, binary-safe */
+StradaValue* strada_lc_sv(StradaValue *sv);
 char* strada_ucfirst(const char *str);
 char* strada_lcfirst(const char *str);
 char* strada_trim(const char *str);
@@ -425,6 +460,76 @@ StradaValue* strada_sb_length(StradaValue *sb);
 void strada_sb_clear(StradaValue *sb);
 void strada_sb_free(StradaValue *sb);
 
+/* Native collections behind lib/Collections (Set, Deque, Heap, OrderedMap).
+ * Each returns an owned value; self is the blessed container ref. */
+StradaValue* strada_coll_set_new(StradaValue *items);
+StradaValue* strada_coll_set_add(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_set_remove(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_set_contains(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_set_size(StradaValue *self);
+StradaValue* strada_coll_set_clear(StradaValue *self);
+StradaValue* strada_coll_set_members(StradaValue *self);
+StradaValue* strada_coll_set_algebra(StradaValue *self, StradaValue *other, int op);
+StradaValue* strada_coll_set_common(StradaValue *self, StradaValue *other);
+StradaValue* strada_coll_deque_new(StradaValue *items);
+StradaValue* strada_coll_deque_push_back(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_deque_push_front(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_deque_pop_back(StradaValue *self);
+StradaValue* strada_coll_deque_pop_front(StradaValue *self);
+StradaValue* strada_coll_deque_get(StradaValue *self, StradaValue *index);
+StradaValue* strada_coll_deque_set(StradaValue *self, StradaValue *index, StradaValue *v);
+StradaValue* strada_coll_deque_size(StradaValue *self);
+StradaValue* strada_coll_deque_clear(StradaValue *self);
+StradaValue* strada_coll_deque_to_array(StradaValue *self);
+StradaValue* strada_coll_heap_new(int max, StradaValue *cmp);
+StradaValue* strada_coll_heap_push(StradaValue *self, StradaValue *v);
+StradaValue* strada_coll_heap_insert(StradaValue *self, StradaValue *prio, StradaValue *v);
+StradaValue* strada_coll_heap_pop(StradaValue *self);
+StradaValue* strada_coll_heap_peek(StradaValue *self);
+StradaValue* strada_coll_heap_peek_priority(StradaValue *self);
+StradaValue* strada_coll_heap_size(StradaValue *self);
+StradaValue* strada_coll_heap_clear(StradaValue *self);
+StradaValue* strada_coll_omap_new(int numeric);
+StradaValue* strada_coll_omap_set(StradaValue *self, StradaValue *key, StradaValue *v);
+StradaValue* strada_coll_omap_get(StradaValue *self, StradaValue *key);
+StradaValue* strada_coll_omap_contains(StradaValue *self, StradaValue *key);
+StradaValue* strada_coll_omap_remove(StradaValue *self, StradaValue *key);
+StradaValue* strada_coll_omap_end_key(StradaValue *self, int which);
+StradaValue* strada_coll_omap_near_key(StradaValue *self, StradaValue *key, int which);
+StradaValue* strada_coll_omap_range(StradaValue *self, StradaValue *lo, StradaValue *hi, int what);
+StradaValue* strada_coll_omap_size(StradaValue *self);
+StradaValue* strada_coll_omap_clear(StradaValue *self);
+int strada_coll_free(const char *kind, void *p, int release);
+
+/* Lazy iterators (iter::) */
+int strada_iter_step(StradaValue *self, StradaValue **out);
+StradaValue* strada_iter_advance(StradaValue *self);
+StradaValue* strada_iter_of(StradaValue *sv);
+StradaValue* strada_iter_range(StradaValue *lo, StradaValue *hi);
+StradaValue* strada_iter_from_array(StradaValue *arr);
+StradaValue* strada_iter_lines(StradaValue *src);
+StradaValue* strada_iter_from_fn(StradaValue *fn);
+StradaValue* strada_iter_map(StradaValue *src, StradaValue *fn);
+StradaValue* strada_iter_grep(StradaValue *src, StradaValue *fn);
+StradaValue* strada_iter_take(StradaValue *src, StradaValue *n);
+StradaValue* strada_iter_next(StradaValue *self);
+StradaValue* strada_iter_collect(StradaValue *self);
+int strada_iter_free(const char *kind, void *p, int release);
+StradaValue* strada_sketch_bloom_new(StradaValue *capacity, StradaValue *fp_rate);
+StradaValue* strada_sketch_bloom_add(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_bloom_contains(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_hll_new(StradaValue *precision);
+StradaValue* strada_sketch_hll_add(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_cms_new(StradaValue *epsilon, StradaValue *delta);
+StradaValue* strada_sketch_cms_add(StradaValue *self, StradaValue *key, StradaValue *count);
+StradaValue* strada_sketch_cms_estimate(StradaValue *self, StradaValue *key);
+StradaValue* strada_sketch_count(StradaValue *self);
+StradaValue* strada_sketch_merge(StradaValue *self, StradaValue *other);
+StradaValue* strada_sketch_info(StradaValue *self);
+StradaValue* strada_sketch_serialize(StradaValue *self);
+StradaValue* strada_sketch_deserialize(StradaValue *bytes);
+int strada_sketch_free(const char *kind, void *p);
+
 /* String repetition (x operator) */
 StradaValue* strada_string_repeat(StradaValue *sv, int64_t count);
 
@@ -448,13 +553,27 @@ size_t strada_array_length(StradaArray *arr);
 void strada_array_reverse(StradaArray *arr);
 void strada_array_reserve(StradaArray *av, size_t capacity);
 void strada_reserve_sv(StradaValue *sv, int64_t capacity);
+void strada_array_shrink(StradaArray *av);
+void strada_shrink_to_fit_sv(StradaValue *sv);
+void strada_array_insert_av(StradaArray *av, size_t at, StradaArray *src);
+void strada_array_append_av(StradaArray *av, StradaArray *src);
+void strada_array_prepend_av(StradaArray *av, StradaArray *src);
 int64_t strada_size(StradaValue *sv);
 int64_t strada_get_array_default_capacity(void);
 void strada_set_array_default_capacity(int64_t capacity);
 StradaValue* strada_new_array_from_av(StradaArray *av);
 StradaValue* strada_array_copy(StradaValue *src);
+StradaValue* strada_array_copy_kind(StradaValue *src, int kind);
+void strada_array_pack(StradaValue *sv, int kind);
+StradaValue* strada_packed_array_new(int kind, int64_t n);
+int strada_packed_kind(StradaValue *sv);
+StradaValue* strada_list_sum(StradaValue *sv);
+StradaValue* strada_list_min(StradaValue *sv);
+StradaValue* strada_list_max(StradaValue *sv);
 StradaValue* strada_sort(StradaValue *arr);
 StradaValue* strada_nsort(StradaValue *arr);
+StradaValue* strada_sort_par(StradaValue *arr, StradaValue *cmp);
+void strada_keysort(StradaValue *result, const char *spec, StradaValue **cols);
 StradaValue* strada_range(StradaValue *start, StradaValue *end);
 StradaValue* strada_array_slice(StradaValue *arr, StradaValue *start, StradaValue *end);
 StradaValue* strada_array_splice(StradaValue *arr, StradaValue *offset, StradaValue *length, StradaValue *replacement);
@@ -620,6 +739,14 @@ StradaValue* strada_regex_find_all(const char *str, const char *pattern, const c
 void strada_set_captures_sv(StradaValue *match);
 StradaValue* strada_regex_build_result(const char *src, StradaValue *matches, StradaValue *replacements);
 StradaValue* strada_tr(StradaValue *sv, const char *search, const char *replace, const char *flags);
+/* tr/// compiled once per call site: strada_tr_run returns the count, or
+ * the new string with /r; strada_tr_var also gives a variable sharing its
+ * value a new one. strada_tr compiles, runs and frees. */
+typedef struct StradaTr StradaTr;
+StradaTr *strada_tr_compile(const char *search, const char *replace, const char *flags);
+StradaValue* strada_tr_run(StradaValue *sv, const StradaTr *t);
+StradaValue* strada_tr_var(StradaValue **svp, const StradaTr *t);  /* $var =~ tr */
+void strada_tr_free(StradaTr *t);
 
 /* ============================================================
  * OOP - Blessed References
@@ -741,6 +868,12 @@ void strada_stack_set_line(int line);
 #define strada_stack_push_il strada_stack_push
 #define strada_stack_pop_il  strada_stack_pop
 #define strada_stack_line_il strada_stack_set_line
+/* --stack-trace=unwind needs GNU assembler sections; the driver falls back
+ * to --stack-trace for tcc builds, so only the registration ABI is here. */
+typedef struct { int32_t pc_rel; int32_t line; int32_t func; } StradaTraceLine;
+typedef struct { const char *func_name; const char *file_name; } StradaTraceFunc;
+void strada_trace_register(const StradaTraceFunc *funcs, int nfuncs,
+                           const StradaTraceLine *start, const StradaTraceLine *end);
 void strada_print_stack_trace(void);
 char* strada_capture_stack_trace(void);
 void strada_set_recursion_limit(int limit);
@@ -1230,6 +1363,10 @@ StradaValue* strada_channel_select(StradaValue *channels_ref, StradaValue *timeo
 StradaValue* strada_async_sleep(StradaValue *ms_sv);
 StradaValue* strada_async_cancelled(void);
 StradaValue* strada_async_map(StradaValue *fn, StradaValue *items_ref, StradaValue *workers_sv);
+/* par::map / grep / reduce — chunked data parallelism on the thread pool */
+StradaValue* strada_par_map(StradaValue *fn, StradaValue *items_ref);
+StradaValue* strada_par_grep(StradaValue *fn, StradaValue *items_ref);
+StradaValue* strada_par_reduce(StradaValue *fn, StradaValue *items_ref, StradaValue *init);
 /* thread::tls_* — per-thread named values (freed at thread exit) */
 StradaValue* strada_tls_set(StradaValue *name_sv, StradaValue *val);
 StradaValue* strada_tls_get(StradaValue *name_sv);
@@ -1254,6 +1391,8 @@ void strada_profile_init(void);
 void strada_profile_enter(const char *func_name);
 void strada_profile_exit(const char *func_name);
 void strada_profile_report(void);
+void strada_profile_set_output(const char *path);
+void strada_profile_declare(const char *const *names, int count);
 
 /* Full Profiling - Line-level timing */
 void strada_full_profile_init(const char *output_file);
@@ -1268,6 +1407,7 @@ void strada_memprof_enable(void);
 void strada_memprof_disable(void);
 void strada_memprof_reset(void);
 void strada_memprof_report(void);
+StradaValue* strada_mem_stats(StradaValue *target);
 
 /* ============================================================
  * Global Variable Registry
@@ -1451,7 +1591,9 @@ static inline void strada_stack_args1_init(StradaStackArgs1 *sa, StradaValue *el
     sa->av.size = 1;
     sa->av.capacity = 1;
     sa->av.refcount = 2;
+    sa->av.kind = 0;
     sa->av.head = 0;
+    sa->av.boxes = NULL;
     sa->sv.type = STRADA_ARRAY;
     sa->sv.value.av = &sa->av;
     sa->sv.refcount = 2;
@@ -1492,8 +1634,34 @@ int64_t strada_to_int(StradaValue *sv);
 int64_t strada_to_int_impl(StradaValue *sv);
 double strada_to_num(StradaValue *sv);
 double strada_to_num_impl(StradaValue *sv);
+/* Numeric element reads (see strada_runtime.h) */
+static inline double strada_array_num_at(StradaArray *av, int64_t idx) {
+    if (!av) return 0.0;
+    if (idx < 0) idx += (int64_t)av->size;
+    if (idx < 0 || (size_t)idx >= av->size) return 0.0;
+    size_t p = av->head + (size_t)idx;
+    switch (av->kind) {
+    case STRADA_AV_INT: return (double)STRADA_AV_I64(av)[p];
+    case STRADA_AV_NUM: return STRADA_AV_F64(av)[p];
+    case STRADA_AV_BYTE: return (double)STRADA_AV_U8(av)[p];
+    }
+    return av->elements[p] ? strada_to_num(av->elements[p]) : 0.0;
+}
+static inline int64_t strada_array_int_at(StradaArray *av, int64_t idx) {
+    if (!av) return 0;
+    if (idx < 0) idx += (int64_t)av->size;
+    if (idx < 0 || (size_t)idx >= av->size) return 0;
+    size_t p = av->head + (size_t)idx;
+    switch (av->kind) {
+    case STRADA_AV_INT: return STRADA_AV_I64(av)[p];
+    case STRADA_AV_NUM: return (int64_t)STRADA_AV_F64(av)[p];
+    case STRADA_AV_BYTE: return STRADA_AV_U8(av)[p];
+    }
+    return av->elements[p] ? strada_to_int(av->elements[p]) : 0;
+}
 StradaValue* strada_usleep(StradaValue *usecs);
 void strada_hash_set_ss_take(StradaHash *hv, StradaString *key_ss, StradaValue *sv);
+void strada_hash_set_interned(StradaHash *hv, const char *key, size_t len, StradaValue *sv);
 void strada_hash_set_take_ph(StradaHash *hv, const char *key, unsigned int hash, StradaValue *sv);
 double strada_cstruct_get_double(StradaValue *sv, const char *field, size_t offset);
 int64_t strada_cstruct_get_int(StradaValue *sv, const char *field, size_t offset);
@@ -1515,7 +1683,7 @@ void strada_cstruct_set_int(StradaValue *sv, const char *field, size_t offset, i
 extern StradaThreadPool *strada_thread_pool;
 void strada_pool_submit(StradaFuture *future);
 static inline char *ss_alloc_pv(const char *s, size_t len) {
-    StradaString *ss = ss_new(s, (uint32_t)len, 0);
+    StradaString *ss = ss_new(s, len, 0);
     return ss->data;
 }
 static inline void ss_free_pv(char *pv) {
@@ -1556,11 +1724,27 @@ StradaValue* strada_hash_each_sv(StradaValue *sv);
 void strada_tied_each_reset(StradaValue *sv);
 size_t strada_length_chars_sv(StradaValue *sv);  /* Binary-safe UTF-8 char count */
 StradaValue* strada_byte_at(StradaValue *str, StradaValue *index);  /* Preferred alias for char_at */
+StradaValue* strada_lex_scan(StradaValue *lexer, StradaValue *tokens, StradaValue *word_types);  /* Native scanner behind lex_tokenize */
 StradaValue* strada_idiv(StradaValue *a, StradaValue *b);           /* Integer division (truncated) */
 StradaValue* strada_substr_replace(StradaValue *str, int64_t offset, int64_t length,
                                     StradaValue *repl, StradaValue **out_removed);
 int64_t strada_index_sv(StradaValue *haystack_sv, const char *needle);
 int64_t strada_index_sv2(StradaValue *haystack_sv, StradaValue *needle_sv, int64_t offset);
+int64_t strada_rindex_sv(StradaValue *haystack_sv, StradaValue *needle_sv);
+/* Precompiled literal searcher: one needle, or several searched at once
+ * (leftmost match wins, ties go to the earlier needle). Generated code
+ * builds one per literal index()/split() call site and keeps it. */
+typedef struct StradaSearcher StradaSearcher;
+StradaSearcher *strada_searcher_new(const char *needle, size_t len);
+StradaSearcher *strada_searcher_new_multi(size_t count, const char *const *needles, const size_t *lens);
+void strada_searcher_free(StradaSearcher *s);
+StradaSearcher *strada_searcher_publish(StradaSearcher **slot, StradaSearcher *s);
+/* tcc has no reliable atomic builtins; a volatile load is an acquire on
+ * the x86-64 targets tcc builds for. */
+#define STRADA_SEARCHER_CACHED(slot) (*(StradaSearcher *volatile *)&(slot))
+int64_t strada_index_searcher(StradaValue *haystack_sv, StradaSearcher *s, int64_t offset);
+int64_t strada_index_any(StradaValue *haystack_sv, StradaValue *needles_sv, int64_t offset);
+StradaArray* strada_split_searcher(StradaValue *str_sv, StradaSearcher *s);
 char* strada_uc_ascii(const char *str);
 char* strada_lc_ascii(const char *str);
 char* strada_ucfirst_ascii(const char *str);
@@ -1570,6 +1754,10 @@ void strada_vec_set(StradaValue *sv, int64_t offset, int bits, int64_t value);
 StradaValue* strada_join_sv(StradaValue *sep_sv, StradaArray *arr);
 extern int (*strada_fh_write_hook)(StradaValue *sv, StradaValue *fh);
 StradaValue* strada_sprintf_sv_arr(StradaValue *format_sv, StradaValue *args_sv);
+void strada_printf_fh(StradaValue *fh, int newline, StradaValue *format_sv, int arg_count, ...);
+StradaValue* strada_sprintf_append(StradaValue *dst, StradaValue *format_sv, int arg_count, ...);
+void strada_join_to(StradaValue *fh, int newline, StradaValue *sep_sv, StradaArray *arr);
+StradaValue* strada_join_append(StradaValue *dst, StradaValue *sep_sv, StradaArray *arr);
 StradaValue* strada_file_mtime(StradaValue *path);  /* mtime as int sv, -1 on failure */
 void strada_spew_sv(const char *filename, StradaValue *content_sv);  /* Binary-safe write from StradaValue */
 void strada_spew_len(const char *filename, const char *content, size_t len);  /* Length-aware write */
@@ -1668,6 +1856,7 @@ static inline int strada_av_exists_sv(StradaValue *sv, int64_t idx) {
     int64_t len = (int64_t)strada_array_length(av);
     if (idx < 0) idx += len;
     if (idx < 0 || idx >= len) return 0;
+    if (av->kind) return 1;
     StradaValue *el = av->elements[av->head + idx];
     return el != NULL;
 }
@@ -0,0 +1,88 @@
+#!/bin/bash
+#
+# Regression test: `strada --pgo-counts` / `--pgo-generate` / `--pgo-use`.
+# The counts build must leave strada.pgo call counts merged across runs, the
+# gcc training build .gcda files for the program and the runtime, and the
+# feedback build must read both: same program output, hot/cold attributes
+# in the generated C, and no coverage-mismatch or missing-profile warning
+# from gcc (the gcc profile must be trained on the C that --pgo-use builds).
+#
+# Exits non-zero on any failure.
+
+set -u
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+STRADA="$REPO_DIR/strada"
+
+if [ ! -x "$STRADA" ]; then
+    echo "Build strada first (run 'make' in $REPO_DIR)" >&2
+    exit 2
+fi
+if "${CC:-cc}" --version 2>&1 | grep -qi clang; then
+    echo "SKIP: --pgo-* needs GCC"
+    exit 0
+fi
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+cat > pgo.strada <<'EOF'
+func hot_step(int $n) int {
+    return $n * 3 + 1;
+}
+
+func cold_path(int $n) int {
+    return $n - 1;
+}
+
+func main() int {
+    my int $s = 0;
+    for (my int $i = 0; $i < 50000; $i = $i + 1) {
+        $s = $s + hot_step($i);
+    }
+    if ($s < 0) { $s = cold_path($s); }
+    say("sum " . $s);
+    return 0;
+}
+EOF
+
+fail() { echo "FAIL: $*"; exit 1; }
+
+"$STRADA" --pgo-counts=prof -o counts pgo.strada || fail "counts build"
+[ "$(./counts)" = "sum 3749975000" ] || fail "counts binary output"
+./counts > /dev/null || fail "second counts run"
+
+[ -f prof/strada.pgo ] || fail "no strada.pgo written"
+grep -q "^hot_step	100000	" prof/strada.pgo || fail "call counts not merged across runs: $(cat prof/strada.pgo)"
+grep -q "^cold_path	0	" prof/strada.pgo || fail "never-entered cold_path not listed with 0 calls"
+
+"$STRADA" -c --pgo-generate=prof -o train pgo.strada || fail "training build"
+grep -q "strada_profile_enter" train.c && fail "gcc training C carries the -p hooks"
+[ "$(./train)" = "sum 3749975000" ] || fail "training binary output"
+[ -n "$(find prof -name 'program.gcda')" ] || fail "no gcc profile for the program"
+[ -n "$(find prof -name 'strada_runtime.gcda')" ] || fail "no gcc profile for the runtime"
+
+"$STRADA" -c --pgo-use prof -o final pgo.strada 2> use.log || { cat use.log; fail "feedback build"; }
+if grep -Eq "coverage-mismatch|missing-profile" use.log; then
+    cat use.log
+    fail "gcc discarded the training profile"
+fi
+cmp -s train.c final.c || fail "--pgo-generate and --pgo-use compiled different C"
+[ "$(./final)" = "sum 3749975000" ] || fail "feedback binary output"
+grep -q "__attribute__((hot)) .*hot_step(" final.c || fail "hot_step not marked hot"
+grep -q "__attribute__((cold)) .*cold_path(" final.c || fail "cold_path not marked cold"
+
+"$STRADA" --pgo-use missing-dir -o x pgo.strada > /dev/null 2>&1 && fail "--pgo-use accepted a missing profile dir"
+"$STRADA" pgo.strada --pgo-use > usage.log 2>&1 && fail "--pgo-use accepted a missing argument"
+grep -q "requires a profile directory" usage.log || fail "no usage error for a trailing --pgo-use: $(cat usage.log)"
+
+# A function the training build didn't have gets no temperature
+sed 's/^func main/func added_later(int $n) int {\n    return $n;\n}\n\nfunc main/' pgo.strada > later.strada
+"$REPO_DIR/stradac" --pgo-use prof/strada.pgo later.strada later.c > /dev/null || fail "stradac --pgo-use on edited source"
+grep -q "StradaValue\* added_later(" later.c || fail "added_later missing from the C"
+grep -q "__attribute__((cold)) .*added_later(" later.c && fail "unprofiled added_later marked cold"
+grep -q "__attribute__((cold)) .*cold_path(" later.c || fail "cold_path lost its cold mark"
+
+echo "PASS"
+exit 0
@@ -0,0 +1,101 @@
+#!/bin/bash
+#
+# Regression test: `strada -j N` (stradac --split-c). A multi-package
+# program built as parallel C parts must behave exactly like the single-file
+# build; a rebuild must reuse every cached part object, editing one package
+# must recompile only that package's part, and a program with top-level
+# __C__ code must fall back to one file.
+#
+# Exits non-zero on any failure.
+
+set -u
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+STRADA="$REPO_DIR/strada"
+
+if [ ! -x "$STRADA" ]; then
+    echo "Build strada first (run 'make' in $REPO_DIR)" >&2
+    exit 2
+fi
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+# Private scratch dir, so the part cache starts empty.
+export TMPDIR="$WORK"
+
+cat > prog.strada <<'EOF'
+package Counter;
+
+func new(int $start) scalar {
+    my hash %self = ("n" => $start);
+    return bless(\%self, "Counter");
+}
+
+func bump(scalar $self) int {
+    $self->{"n"} = $self->{"n"} + 1;
+    return $self->{"n"};
+}
+
+package Shape;
+
+func area(int $w, int $h) int {
+    return $w * $h;
+}
+
+package main;
+
+our int $total = 0;
+
+private func twice(int $x) int {
+    return $x * 2;
+}
+
+func main() int {
+    my scalar $c = Counter::new(40);
+    $c->bump();
+    my scalar $add = func (int $v) { $total = $total + $v; return $total; };
+    $add->(twice($c->bump()));
+    $add->(Shape::area(3, 4));
+    say("total " . $total);
+    return 0;
+}
+EOF
+
+fail() { echo "FAIL: $*"; exit 1; }
+
+"$STRADA" -o single prog.strada || fail "single-file build"
+expect="$(./single)"
+[ "$expect" = "total 96" ] || fail "single-file output: $expect"
+
+"$STRADA" -v -j 2 -o split prog.strada > build1.log 2>&1 || { cat build1.log; fail "-j build"; }
+[ "$(./split)" = "$expect" ] || fail "-j binary output: $(./split)"
+grep -q -- "-j: \([0-9]*\) of \1 C parts changed" build1.log || fail "first -j build should compile every part: $(grep -- '-j:' build1.log)"
+ls "$WORK"/strada-scratch-*/prog-*.parts/pkg_Counter.0.c > /dev/null 2>&1 || fail "no per-package part for Counter"
+
+"$STRADA" -v -j 2 -o split prog.strada > build2.log 2>&1 || fail "-j rebuild"
+grep -q -- "-j: 0 of" build2.log || fail "unchanged rebuild recompiled parts: $(grep -- '-j:' build2.log)"
+
+sed -i 's/return \$w \* \$h;/return $w * $h + 1;/' prog.strada
+"$STRADA" -v -j 2 -o split prog.strada > build3.log 2>&1 || fail "-j build after edit"
+grep -q -- "-j: 1 of" build3.log || fail "editing Shape should recompile one part: $(grep -- '-j:' build3.log)"
+[ "$(./split)" = "total 97" ] || fail "edited -j binary output: $(./split)"
+
+cat > cblock.strada <<'EOF'
+__C__ {
+static int bump_c(int x) { return x + 1; }
+}
+
+func main() int {
+    say("ok");
+    return 0;
+}
+EOF
+"$STRADA" -v -j 2 -o cblock cblock.strada > build4.log 2>&1 || { cat build4.log; fail "-j build with __C__ block"; }
+grep -q "can't be split" build4.log || fail "__C__ program should fall back to one file"
+[ "$(./cblock)" = "ok" ] || fail "__C__ fallback output"
+
+"$STRADA" -j x prog.strada > /dev/null 2>&1 && fail "-j accepted a bad job count"
+
+echo "PASS"
+exit 0
@@ -16,6 +16,46 @@ test_output_contains "$EXAMPLES_DIR/test_strings.strada" "test_strings" "All tes
 # Test: index()/substr() agree on byte-vs-char offset units (UTF-8 round-trip)
 test_output_contains "$EXAMPLES_DIR/test_utf8_index_substr.strada" "test_utf8_index_substr" "All UTF-8 index/substr tests passed" "UTF-8 index/substr round-trip"
 
+# Test: native lexer fast path hands strings/regexes/heredocs/% back correctly
+test_exit_code "$EXAMPLES_DIR/test_lexer_fastpath.strada" "test_lexer_fastpath" 0 "Lexer fast path"
+# Test: locals written inside try bodies survive the longjmp back to the catch
+test_exit_code "$EXAMPLES_DIR/test_try_locals.strada" "test_try_locals" 0 "Try locals across throws"
+# Test: SIMD ASCII/UTF-8 scans (validation, codepoint length, case mapping)
+test_exit_code "$EXAMPLES_DIR/test_utf8_kernels.strada" "test_utf8_kernels" 0 "UTF-8 kernels"
+# Test: substring views (suffix slices share the source; COW on mutation)
+test_exit_code "$EXAMPLES_DIR/test_substr_views.strada" "test_substr_views" 0 "Substring views"
+# Test: codepoint index (UTF-8 substr/index/rindex/length; invalidation)
+test_exit_code "$EXAMPLES_DIR/test_utf8_index.strada" "test_utf8_index" 0 "UTF-8 codepoint index"
+# Test: large print/say/write_fd payloads (direct writev path, ordering, NULs)
+test_exit_code "$EXAMPLES_DIR/test_large_write.strada" "test_large_write" 0 "Large writes"
+# Test: small strings co-allocated with their value (appends, sharing paths)
+test_exit_code "$EXAMPLES_DIR/test_sso.strada" "test_sso" 0 "Small strings"
+# Test: literal substring search (index/rindex/split, core::index_any)
+test_exit_code "$EXAMPLES_DIR/test_search.strada" "test_search" 0 "Literal search"
+# Test: sprintf/join streamed into handles, strings and StringBuilders
+test_exit_code "$EXAMPLES_DIR/test_stream_format.strada" "test_stream_format" 0 "Stream format"
+
+# Test: string interning, weak release and interned decoder keys
+test_exit_code "$EXAMPLES_DIR/test_intern.strada" "test_intern" 0 "String interning"
+
+# Test: number <-> string conversion (stringify, numify, %e/%g, JSON)
+test_exit_code "$EXAMPLES_DIR/test_numconv.strada" "test_numconv" 0 "Number conversion"
+
+# Test: tr/// per call site, codepoint tr, vectorized lc/uc/reverse/x
+test_exit_code "$EXAMPLES_DIR/test_tr_vec.strada" "test_tr_vec" 0 "tr and string vector ops"
+
+# Test: packed typed arrays (array<int>/array<num>/array<byte>)
+test_exit_code "$EXAMPLES_DIR/test_packed.strada" "test_packed" 0 "packed typed arrays"
+
+# Test: grouped control-byte hash index (growth, churn, wide objects)
+test_exit_code "$EXAMPLES_DIR/test_hash_probe.strada" "test_hash_probe" 0 "hash group probing"
+
+# Test: parallel merge sort (sort/nsort above the threshold, sort_par)
+STRADA_SORT_THREADS=4 test_exit_code "$EXAMPLES_DIR/test_par_sort.strada" "test_par_sort" 0 "parallel sort"
+
+# Test: key-extraction sort (key-only comparator blocks)
+test_exit_code "$EXAMPLES_DIR/test_keysort.strada" "test_keysort" 0 "key sort"
+
 # Test: Control flow
 test_run "$EXAMPLES_DIR/control_flow_demo.strada" "control_flow_demo" "Control flow"
 
@@ -318,6 +358,24 @@ test_output_contains "$EXAMPLES_DIR/test_bigint.strada" "test_bigint" "All BigIn
 # Test: Math::BigFloat
 test_output_contains "$EXAMPLES_DIR/test_bigfloat.strada" "test_bigfloat" "All BigFloat tests passed" "BigFloat"
 
+# Test: Collections (Set/Deque/Heap/OrderedMap)
+test_exit_code "$EXAMPLES_DIR/test_collections.strada" "test_collections" 0 "Collections"
+
+# Test: Fused map/grep pipelines, first/any/all/none, iter:: streams
+test_exit_code "$EXAMPLES_DIR/test_pipeline_fusion.strada" "test_pipeline_fusion" 0 "Pipeline fusion"
+
+# Test: par::map / par::grep / par::reduce
+test_exit_code "$EXAMPLES_DIR/test_par.strada" "test_par" 0 "par:: data parallelism"
+
+# Test: Hash compaction/shrinking and core::mem_stats
+test_exit_code "$EXAMPLES_DIR/test_hash_shrink.strada" "test_hash_shrink" 0 "Hash shrinking"
+
+# Test: Sketch::Bloom / Sketch::HyperLogLog / Sketch::CountMin
+test_exit_code "$EXAMPLES_DIR/test_sketch.strada" "test_sketch" 0 "Sketches"
+
+# Test: Bulk push/unshift/splice, front gap, reserve / shrink_to_fit
+test_exit_code "$EXAMPLES_DIR/test_array_bulk.strada" "test_array_bulk" 0 "Array bulk ops"
+
 # Test: String repeat (x operator)
 test_output_contains "$EXAMPLES_DIR/test_str_repeat.strada" "test_str_repeat" "All str repeat tests passed" "String repeat"
 
@@ -0,0 +1,28 @@
+#!/bin/bash
+# t_pgo.sh — profile-guided build (`--pgo-counts` / `--pgo-generate` /
+# `--pgo-use`)
+#
+# Delegates to t/pgo_test/run.sh: runs the counts and gcc training builds,
+# checks the profiles they leave behind, then rebuilds with --pgo-use and
+# checks gcc used the profile and it reached codegen. Skips (passes) on clang.
+#
+# Counts the runner as a single test that either passes or fails.
+
+TOTAL=$((TOTAL + 1))
+pgo_script="$SCRIPT_DIR/pgo_test/run.sh"
+if [ ! -x "$pgo_script" ]; then
+    FAILED=$((FAILED + 1))
+    log_fail "pgo" "runner not executable: $pgo_script"
+else
+    pgo_log="$BUILD_DIR/pgo.log"
+    if "$pgo_script" > "$pgo_log" 2>&1; then
+        PASSED=$((PASSED + 1))
+        log_pass "pgo (--pgo-generate profiles, --pgo-use hot/cold codegen)"
+    else
+        FAILED=$((FAILED + 1))
+        log_fail "pgo" "see $pgo_log"
+        if [ $VERBOSE -eq 1 ]; then
+            cat "$pgo_log"
+        fi
+    fi
+fi
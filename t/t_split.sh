@@ -0,0 +1,27 @@
+#!/bin/bash
+# t_split.sh — parallel, incremental C compilation (`strada -j N`)
+#
+# Delegates to t/split_test/run.sh: builds a multi-package program as
+# per-package C parts, compares it with the single-file build, and checks
+# that rebuilds reuse the cached part objects.
+#
+# Counts the runner as a single test that either passes or fails.
+
+TOTAL=$((TOTAL + 1))
+split_script="$SCRIPT_DIR/split_test/run.sh"
+if [ ! -x "$split_script" ]; then
+    FAILED=$((FAILED + 1))
+    log_fail "split" "runner not executable: $split_script"
+else
+    split_log="$BUILD_DIR/split.log"
+    if "$split_script" > "$split_log" 2>&1; then
+        PASSED=$((PASSED + 1))
+        log_pass "split (-j per-package C parts, cached objects)"
+    else
+        FAILED=$((FAILED + 1))
+        log_fail "split" "see $split_log"
+        if [ $VERBOSE -eq 1 ]; then
+            cat "$split_log"
+        fi
+    fi
+fi
@@ -0,0 +1,28 @@
+#!/bin/bash
+# t_unwind_trace.sh — stack traces without per-call bookkeeping
+# (`--stack-trace=unwind`)
+#
+# Delegates to t/unwind_trace_test/run.sh: builds the same program in the
+# tracked and unwind modes (plus a -M module and a -j build) and checks the
+# traces match and that unwind mode emits no push/pop/line calls.
+#
+# Counts the runner as a single test that either passes or fails.
+
+TOTAL=$((TOTAL + 1))
+ut_script="$SCRIPT_DIR/unwind_trace_test/run.sh"
+if [ ! -x "$ut_script" ]; then
+    FAILED=$((FAILED + 1))
+    log_fail "unwind_trace" "runner not executable: $ut_script"
+else
+    ut_log="$BUILD_DIR/unwind_trace.log"
+    if "$ut_script" > "$ut_log" 2>&1; then
+        PASSED=$((PASSED + 1))
+        log_pass "unwind_trace (--stack-trace=unwind matches tracked traces)"
+    else
+        FAILED=$((FAILED + 1))
+        log_fail "unwind_trace" "see $ut_log"
+        if [ $VERBOSE -eq 1 ]; then
+            cat "$ut_log"
+        fi
+    fi
+fi
@@ -0,0 +1,127 @@
+#!/bin/bash
+#
+# Regression test: `strada --stack-trace=unwind`. The generated C must have
+# no per-call stack bookkeeping, yet exception_trace(), caller() and the
+# uncaught-exception trace must name the same frames and lines as the
+# tracked (default) mode — including frames of functions gcc inlined, a
+# separately compiled -M module, and a strada -j build.
+#
+# Exits non-zero on any failure.
+
+set -u
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+STRADA="$REPO_DIR/strada"
+STRADAC="$REPO_DIR/stradac"
+
+if [ ! -x "$STRADA" ]; then
+    echo "Build strada first (run 'make' in $REPO_DIR)" >&2
+    exit 2
+fi
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+cat > Helper.strada <<'EOF'
+package Helper;
+
+func check(int $n) int {
+    if ($n > 3) {
+        throw "too big " . $n;
+    }
+    return $n;
+}
+
+func relay(int $n) int {
+    my int $r = check($n);
+    return $r + 1;
+}
+EOF
+
+cat > trace.strada <<'EOF'
+use lib ".";
+use Helper;
+
+func leaf(int $n) int {
+    if ($n > 2) {
+        throw "deep " . $n;
+    }
+    return $n;
+}
+
+func step(int $n) int {
+    my int $r = leaf($n + 1);
+    return $r + 1;
+}
+
+func walk(int $n) int {
+    my int $r = step($n);
+    return $r * 2;
+}
+
+func who() str {
+    my scalar $c = core::caller();
+    return $c->{"function"} . ":" . $c->{"line"};
+}
+
+func asker() str {
+    return who();
+}
+
+func main() int {
+    # One throw per run: the tracked mode leaves a caught throw's frames
+    # on its call stack, which would show up in any later trace.
+    my str $what = $ARGV[0];
+    if ($what eq "uncaught") {
+        walk(7);
+    }
+    try {
+        if ($what eq "module") {
+            Helper::relay(9);
+        } else {
+            walk(5);
+        }
+    } catch ($e) {
+        say("caught " . $e);
+        print(core::exception_trace());
+    }
+    say("caller " . asker());
+    return 0;
+}
+EOF
+
+fail() { echo "FAIL: $*"; exit 1; }
+
+run_all() {   # <binary> <output prefix>
+    ./$1 local > $2.out || fail "$1 local run"
+    ./$1 module >> $2.out || fail "$1 module run"
+    ./$1 uncaught > /dev/null 2> $2.err && fail "$1 uncaught run exited 0"
+    return 0
+}
+
+"$STRADA" -M Helper.strada > /dev/null || fail "tracked module build"
+"$STRADA" -o tracked trace.strada > /dev/null || fail "tracked build"
+run_all tracked tracked
+
+rm -f Helper.o
+"$STRADA" --stack-trace=unwind -M Helper.strada > /dev/null || fail "unwind module build"
+"$STRADA" --stack-trace=unwind -o unwind trace.strada > /dev/null || fail "unwind build"
+run_all unwind unwind
+
+grep -q "at step (trace.strada:12)" tracked.out || fail "unexpected tracked trace: $(cat tracked.out)"
+grep -q "at Helper_relay (Helper.strada:11)" tracked.out || fail "unexpected tracked trace: $(cat tracked.out)"
+grep -q "^Stack trace:" tracked.err || fail "unexpected tracked uncaught trace: $(cat tracked.err)"
+diff tracked.out unwind.out || fail "unwind traces differ from tracked ones"
+diff tracked.err unwind.err || fail "uncaught-exception traces differ"
+
+"$STRADA" --stack-trace=unwind -j 2 -o unwind_j trace.strada > /dev/null || fail "unwind -j build"
+run_all unwind_j unwind_j
+diff tracked.out unwind_j.out || fail "unwind -j traces differ from tracked ones"
+
+"$STRADAC" --stack-trace=unwind trace.strada trace.c > /dev/null || fail "stradac"
+grep -q "strada_stack_" trace.c && fail "unwind mode still emits stack bookkeeping"
+grep -q "STRADA_TRACE_LINE(12, " trace.c || fail "no call-site record for step -> leaf"
+
+echo "PASS"
+exit 0
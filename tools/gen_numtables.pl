@@ -0,0 +1,84 @@
+#!/usr/bin/perl
+# Generate runtime/strada_num_tables.h: the power-of-5 / power-of-10 tables
+# behind the shortest round-trip double formatter (Ryu) and the exact
+# decimal parser (Eisel-Lemire) in strada_runtime.c.
+#
+#   perl tools/gen_numtables.pl > runtime/strada_num_tables.h
+use strict;
+use warnings;
+use Math::BigInt try => 'GMP';
+
+my $POW5_INV_BITCOUNT = 125;
+my $POW5_BITCOUNT     = 125;
+my $INV_SIZE          = 342;
+my $POW_SIZE          = 326;
+my $P10_MIN           = -348;
+my $P10_MAX           = 347;
+
+my $mask64 = Math::BigInt->new(1)->blsft(64)->bsub(1);
+
+sub bitlen { my ($n) = @_; return length($n->as_bin()) - 2; }
+
+sub hex64 {
+    my ($n) = @_;
+    my $h = substr($n->as_hex(), 2);
+    return "0x" . ("0" x (16 - length $h)) . $h . "ULL";
+}
+
+sub entry {
+    my ($n) = @_;
+    my $lo = $n->copy->band($mask64);
+    my $hi = $n->copy->brsft(64);
+    return "{ " . hex64($lo) . ", " . hex64($hi) . " }";
+}
+
+print <<'EOF';
+/* Auto-generated by tools/gen_numtables.pl.
+ *   DO NOT EDIT — regenerate via the script. */
+
+/* Ryu: floor(2^(bitlen(5^q) - 1 + 125) / 5^q) + 1, as { low, high }. */
+static const uint64_t strada_ryu_pow5_inv_split[342][2] = {
+EOF
+for my $q (0 .. $INV_SIZE - 1) {
+    my $p = Math::BigInt->new(5)->bpow($q);
+    my $j = bitlen($p) - 1 + $POW5_INV_BITCOUNT;
+    my $v = Math::BigInt->new(1)->blsft($j)->bdiv($p)->badd(1);
+    print "    ", entry($v), ",\n";
+}
+print "};\n\n";
+
+print "/* Ryu: 5^i normalized to exactly 125 bits (truncated), as { low, high }. */\n";
+print "static const uint64_t strada_ryu_pow5_split[326][2] = {\n";
+for my $i (0 .. $POW_SIZE - 1) {
+    my $p = Math::BigInt->new(5)->bpow($i);
+    my $len = bitlen($p);
+    my $v = $len > $POW5_BITCOUNT ? $p->copy->brsft($len - $POW5_BITCOUNT)
+                                  : $p->copy->blsft($POW5_BITCOUNT - $len);
+    print "    ", entry($v), ",\n";
+}
+print "};\n\n";
+
+print <<'EOF';
+/* Eisel-Lemire: the top 128 bits of 10^e (rounded down) for
+ * e in [-348, 347], as { low, high } with the high bit of high set. */
+#define STRADA_P10_MIN_EXP (-348)
+#define STRADA_P10_MAX_EXP 347
+static const uint64_t strada_p10_128[696][2] = {
+EOF
+for my $e ($P10_MIN .. $P10_MAX) {
+    my $v;
+    if ($e >= 0) {
+        $v = Math::BigInt->new(10)->bpow($e);
+        my $len = bitlen($v);
+        $v = $len > 128 ? $v->brsft($len - 128) : $v->blsft(128 - $len);
+    } else {
+        my $d = Math::BigInt->new(10)->bpow(-$e);
+        # 2^k / 10^-e with k chosen so the quotient has exactly 128 bits.
+        my $k = bitlen($d) + 127;
+        $v = Math::BigInt->new(1)->blsft($k)->bdiv($d);
+        $v->brsft(1) while bitlen($v) > 128;
+        $v->blsft(1) while bitlen($v) < 128;
+    }
+    print "    ", entry($v), ",\n";
+}
+print "};\n";